@@ -0,0 +1,196 @@
+#include "block_batch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int block_batch_reader_init(BlockBatchReader *reader, GDALDatasetH dataset,
+                            int band_index, int capacity) {
+  memset(reader, 0, sizeof(*reader));
+
+  if (!geo_context_init(&reader->geo, dataset)) {
+    return 0;
+  }
+
+  reader->band = GDALGetRasterBand(dataset, band_index);
+  if (!reader->band) {
+    fprintf(stderr, "Error: Failed to get band %d\n", band_index);
+    return 0;
+  }
+  reader->data_type = GDALGetRasterDataType(reader->band);
+  reader->data_type_size = GDALGetDataTypeSizeBytes(reader->data_type);
+  GDALGetBlockSize(reader->band, &reader->block_x, &reader->block_y);
+  reader->blocks_per_row =
+      (reader->geo.raster_x + reader->block_x - 1) / reader->block_x;
+  reader->nodata = GDALGetRasterNoDataValue(reader->band, &reader->has_nodata);
+  reader->native_supported =
+      native_kernels_init(&reader->native, reader->data_type,
+                          reader->has_nodata, reader->nodata);
+
+  reader->capacity = capacity;
+  reader->pixel_x = (int *)malloc(sizeof(int) * (size_t)capacity);
+  reader->pixel_y = (int *)malloc(sizeof(int) * (size_t)capacity);
+  reader->in_bounds = (uint8_t *)malloc((size_t)capacity);
+  reader->keys = (uint64_t *)malloc(sizeof(uint64_t) * (size_t)capacity);
+  reader->block_buf =
+      (GByte *)malloc((size_t)reader->block_x * (size_t)reader->block_y *
+                      (size_t)reader->data_type_size);
+  reader->block_offsets = (size_t *)malloc(sizeof(size_t) * (size_t)capacity);
+  reader->block_points = (int *)malloc(sizeof(int) * (size_t)capacity);
+  if (!reader->pixel_x || !reader->pixel_y || !reader->in_bounds ||
+      !reader->keys || !reader->block_buf || !reader->block_offsets ||
+      !reader->block_points) {
+    fprintf(stderr, "Error: Out of memory allocating batch reader\n");
+    block_batch_reader_destroy(reader);
+    return 0;
+  }
+  return 1;
+}
+
+void block_batch_reader_destroy(BlockBatchReader *reader) {
+  free(reader->pixel_x);
+  free(reader->pixel_y);
+  free(reader->in_bounds);
+  free(reader->keys);
+  free(reader->block_buf);
+  free(reader->block_offsets);
+  free(reader->block_points);
+  reader->pixel_x = NULL;
+  reader->pixel_y = NULL;
+  reader->in_bounds = NULL;
+  reader->keys = NULL;
+  reader->block_buf = NULL;
+  reader->block_offsets = NULL;
+  reader->block_points = NULL;
+}
+
+int block_batch_prepare(BlockBatchReader *reader, const double *geo_x,
+                        const double *geo_y, int count, float *values,
+                        int *is_nodata) {
+  if (count > reader->capacity) {
+    fprintf(stderr, "Error: Batch of %d points exceeds capacity %d\n", count,
+            reader->capacity);
+    return 0;
+  }
+
+  geo_context_to_pixels(&reader->geo, geo_x, geo_y, count, reader->pixel_x,
+                        reader->pixel_y, reader->in_bounds);
+
+  reader->count = count;
+  reader->key_count = 0;
+  for (int i = 0; i < count; i++) {
+    if (!reader->in_bounds[i]) {
+      // Outside dataset bounds
+      if (values) {
+        values[i] = 0.0f;
+      }
+      is_nodata[i] = 1;
+      continue;
+    }
+    int x = reader->pixel_x[i];
+    int y = reader->pixel_y[i];
+    uint64_t block_id = (uint64_t)(y / reader->block_y) *
+                            (uint64_t)reader->blocks_per_row +
+                        (uint64_t)(x / reader->block_x);
+    reader->keys[reader->key_count++] = (block_id << 32) | (uint32_t)i;
+  }
+  return 1;
+}
+
+static int compare_keys(const void *a, const void *b) {
+  uint64_t ka = *(const uint64_t *)a;
+  uint64_t kb = *(const uint64_t *)b;
+  return (ka > kb) - (ka < kb);
+}
+
+// Reads the block of the sorted key at index `first` and sets *end past the
+// last key in that block. Returns 0 if the read failed.
+static int read_key_block(BlockBatchReader *reader, int first, int *end,
+                          int *origin_x, int *origin_y) {
+  uint64_t block_id = reader->keys[first] >> 32;
+  int block_col = (int)(block_id % (uint64_t)reader->blocks_per_row);
+  int block_row = (int)(block_id / (uint64_t)reader->blocks_per_row);
+
+  CPLErr err =
+      GDALReadBlock(reader->band, block_col, block_row, reader->block_buf);
+  if (err != CE_None) {
+    fprintf(stderr, "Error reading block (%d, %d)\n", block_col, block_row);
+    return 0;
+  }
+  reader->blocks_read++;
+
+  *origin_x = block_col * reader->block_x;
+  *origin_y = block_row * reader->block_y;
+  int k = first + 1;
+  while (k < reader->key_count && (reader->keys[k] >> 32) == block_id) {
+    k++;
+  }
+  *end = k;
+  return 1;
+}
+
+static inline size_t block_offset(const BlockBatchReader *reader, int i,
+                                  int origin_x, int origin_y) {
+  return (size_t)(reader->pixel_y[i] - origin_y) * (size_t)reader->block_x +
+         (size_t)(reader->pixel_x[i] - origin_x);
+}
+
+int block_batch_read(BlockBatchReader *reader, float *values, int *is_nodata) {
+  qsort(reader->keys, (size_t)reader->key_count, sizeof(uint64_t),
+        compare_keys);
+
+  float nodata_f = (float)reader->nodata;
+  int k = 0;
+  while (k < reader->key_count) {
+    int end, origin_x, origin_y;
+    if (!read_key_block(reader, k, &end, &origin_x, &origin_y)) {
+      return 0;
+    }
+    for (; k < end; k++) {
+      int i = (int)(reader->keys[k] & 0xFFFFFFFFu);
+      size_t offset = block_offset(reader, i, origin_x, origin_y);
+      float value = 0.0f;
+      GDALCopyWords(reader->block_buf + offset * reader->data_type_size,
+                    reader->data_type, 0, &value, GDT_Float32, 0, 1);
+      values[i] = value;
+      is_nodata[i] = reader->has_nodata && value == nodata_f;
+    }
+  }
+  reader->points_read += reader->key_count;
+  return 1;
+}
+
+int block_batch_read_native(BlockBatchReader *reader, NativeValue *values,
+                            int *is_nodata) {
+  if (!reader->native_supported) {
+    fprintf(stderr, "Error: No native kernels for data type %s\n",
+            GDALGetDataTypeName(reader->data_type));
+    return 0;
+  }
+  for (int i = 0; i < reader->count; i++) {
+    if (!reader->in_bounds[i]) {
+      memset(&values[i], 0, sizeof(values[i]));
+    }
+  }
+  qsort(reader->keys, (size_t)reader->key_count, sizeof(uint64_t),
+        compare_keys);
+
+  int k = 0;
+  while (k < reader->key_count) {
+    int end, origin_x, origin_y;
+    if (!read_key_block(reader, k, &end, &origin_x, &origin_y)) {
+      return 0;
+    }
+    int n = 0;
+    for (; k < end; k++, n++) {
+      int i = (int)(reader->keys[k] & 0xFFFFFFFFu);
+      reader->block_offsets[n] = block_offset(reader, i, origin_x, origin_y);
+      reader->block_points[n] = i;
+    }
+    reader->native.gather(&reader->native, reader->block_buf,
+                          reader->block_offsets, reader->block_points, n,
+                          values, is_nodata);
+  }
+  reader->points_read += reader->key_count;
+  return 1;
+}
@@ -0,0 +1,68 @@
+#ifndef BLOCK_BATCH_H
+#define BLOCK_BATCH_H
+
+#include "gdal.h"
+#include "geo_transform.h"
+#include "native_read.h"
+#include <stdint.h>
+
+// Batched point reader. A batch of world coordinates is converted to pixel
+// space, the points are grouped by the source block they fall in, every
+// distinct block is decoded once with GDALReadBlock and the values are
+// gathered back in the caller's original order.
+typedef struct {
+  GDALRasterBandH band;
+  GeoContext geo;
+  GDALDataType data_type;
+  int data_type_size;
+  int block_x;
+  int block_y;
+  int blocks_per_row;
+  int has_nodata;
+  double nodata;
+  // Kernels for data_type; native_supported is 0 if it has none
+  NativeKernels native;
+  int native_supported;
+
+  int capacity;
+  int count;
+  int *pixel_x;
+  int *pixel_y;
+  uint8_t *in_bounds;
+  // (block id << 32 | point index) for every in-bounds point of the batch.
+  uint64_t *keys;
+  int key_count;
+  GByte *block_buf;
+  // Offsets into block_buf and point indexes of the points of one block,
+  // for the native gather
+  size_t *block_offsets;
+  int *block_points;
+
+  long long blocks_read;
+  long long points_read;
+} BlockBatchReader;
+
+// Prepares a reader for band `band_index` of `dataset` that accepts batches
+// of up to `capacity` points. Returns 0 on failure.
+int block_batch_reader_init(BlockBatchReader *reader, GDALDatasetH dataset,
+                            int band_index, int capacity);
+void block_batch_reader_destroy(BlockBatchReader *reader);
+
+// Converts the batch to pixel space and computes the block of every point.
+// Points outside the raster are flagged as nodata with a value of 0; values
+// may be NULL when the batch is read with block_batch_read_native.
+int block_batch_prepare(BlockBatchReader *reader, const double *geo_x,
+                        const double *geo_y, int count, float *values,
+                        int *is_nodata);
+
+// Reads every distinct block of the prepared batch once and fills values and
+// is_nodata for the in-bounds points. Returns 0 if a block read failed.
+int block_batch_read(BlockBatchReader *reader, float *values, int *is_nodata);
+
+// Like block_batch_read, keeping the band's data type and comparing nodata
+// in it. Requires native_supported. Points outside the raster get a zero
+// value.
+int block_batch_read_native(BlockBatchReader *reader, NativeValue *values,
+                            int *is_nodata);
+
+#endif
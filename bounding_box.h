@@ -0,0 +1,13 @@
+#ifndef BOUNDING_BOX_H
+#define BOUNDING_BOX_H
+
+// Georeferenced extent, kept apart from geo_transform.h so that code which
+// only draws query points does not depend on GDAL.
+typedef struct {
+  double xmin;
+  double ymin;
+  double xmax;
+  double ymax;
+} BoundingBox;
+
+#endif
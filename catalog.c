@@ -0,0 +1,294 @@
+#include "catalog.h"
+
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define CATALOG_NODE_SIZE 16
+
+static int has_tiff_extension(const char *name) {
+  const char *dot = strrchr(name, '.');
+  if (!dot) {
+    return 0;
+  }
+  return strcasecmp(dot, ".tif") == 0 || strcasecmp(dot, ".tiff") == 0;
+}
+
+// Returns the dataset paths of a directory (GeoTIFFs only) or list file.
+static char **list_catalog_paths(const char *source) {
+  VSIStatBufL stat_buf;
+  if (VSIStatL(source, &stat_buf) != 0) {
+    fprintf(stderr, "Error: Catalog source '%s' does not exist\n", source);
+    return NULL;
+  }
+
+  char **paths = NULL;
+  if (VSI_ISDIR(stat_buf.st_mode)) {
+    char **names = VSIReadDir(source);
+    for (int i = 0; names && names[i]; i++) {
+      if (!has_tiff_extension(names[i])) {
+        continue;
+      }
+      size_t len = strlen(source) + strlen(names[i]) + 2;
+      char *full = (char *)malloc(len);
+      if (!full) {
+        break;
+      }
+      snprintf(full, len, "%s/%s", source, names[i]);
+      paths = CSLAddString(paths, full);
+      free(full);
+    }
+    CSLDestroy(names);
+  } else {
+    char **lines = CSLLoad(source);
+    for (int i = 0; lines && lines[i]; i++) {
+      const char *line = lines[i];
+      while (*line == ' ' || *line == '\t') {
+        line++;
+      }
+      if (*line != '\0' && *line != '#') {
+        paths = CSLAddString(paths, line);
+      }
+    }
+    CSLDestroy(lines);
+  }
+  return paths;
+}
+
+static int read_entry(CatalogEntry *entry, const char *path) {
+  GDALDatasetH ds = GDALOpen(path, GA_ReadOnly);
+  if (!ds) {
+    fprintf(stderr, "Error: Failed to open catalog dataset '%s'\n", path);
+    return 0;
+  }
+  int ok = GDALGetGeoTransform(ds, entry->geo_transform) == CE_None;
+  entry->raster_x = GDALGetRasterXSize(ds);
+  entry->raster_y = GDALGetRasterYSize(ds);
+  GDALClose(ds);
+  if (!ok) {
+    fprintf(stderr, "Error: Catalog dataset '%s' has no geotransform\n",
+            path);
+    return 0;
+  }
+
+  // Footprint of the four corners, which also covers rotated rasters
+  const double corners[4][2] = {{0, 0},
+                                {entry->raster_x, 0},
+                                {0, entry->raster_y},
+                                {entry->raster_x, entry->raster_y}};
+  for (int c = 0; c < 4; c++) {
+    double x, y;
+    GDALApplyGeoTransform(entry->geo_transform, corners[c][0], corners[c][1],
+                          &x, &y);
+    if (c == 0 || x < entry->footprint.xmin)
+      entry->footprint.xmin = x;
+    if (c == 0 || x > entry->footprint.xmax)
+      entry->footprint.xmax = x;
+    if (c == 0 || y < entry->footprint.ymin)
+      entry->footprint.ymin = y;
+    if (c == 0 || y > entry->footprint.ymax)
+      entry->footprint.ymax = y;
+  }
+  entry->path = strdup(path);
+  return entry->path != NULL;
+}
+
+static void extend_box(BoundingBox *box, const BoundingBox *other, int first) {
+  if (first || other->xmin < box->xmin)
+    box->xmin = other->xmin;
+  if (first || other->ymin < box->ymin)
+    box->ymin = other->ymin;
+  if (first || other->xmax > box->xmax)
+    box->xmax = other->xmax;
+  if (first || other->ymax > box->ymax)
+    box->ymax = other->ymax;
+}
+
+// Position of (x, y) along a Hilbert curve over a 2^16 x 2^16 grid.
+static uint32_t hilbert_xy2d(uint32_t x, uint32_t y) {
+  uint32_t d = 0;
+  for (uint32_t s = 1u << 15; s > 0; s >>= 1) {
+    uint32_t rx = (x & s) > 0;
+    uint32_t ry = (y & s) > 0;
+    d += s * s * ((3 * rx) ^ ry);
+    if (ry == 0) {
+      if (rx == 1) {
+        x = s - 1 - x;
+        y = s - 1 - y;
+      }
+      uint32_t t = x;
+      x = y;
+      y = t;
+    }
+  }
+  return d;
+}
+
+typedef struct {
+  uint32_t hilbert;
+  int index;
+} HilbertItem;
+
+static int compare_hilbert(const void *a, const void *b) {
+  const HilbertItem *ha = (const HilbertItem *)a;
+  const HilbertItem *hb = (const HilbertItem *)b;
+  if (ha->hilbert != hb->hilbert) {
+    return ha->hilbert < hb->hilbert ? -1 : 1;
+  }
+  return ha->index - hb->index;
+}
+
+static int build_index(Catalog *catalog) {
+  int n = catalog->count;
+  // Upper bound on the node count of a tree with fan-out CATALOG_NODE_SIZE
+  int capacity = n;
+  for (int level = n; level > 1;) {
+    level = (level + CATALOG_NODE_SIZE - 1) / CATALOG_NODE_SIZE;
+    capacity += level;
+  }
+  catalog->node_boxes =
+      (BoundingBox *)malloc(sizeof(BoundingBox) * (size_t)capacity);
+  catalog->node_index = (int *)malloc(sizeof(int) * (size_t)capacity);
+  HilbertItem *items = (HilbertItem *)malloc(sizeof(HilbertItem) * (size_t)n);
+  if (!catalog->node_boxes || !catalog->node_index || !items) {
+    free(items);
+    fprintf(stderr, "Error: Out of memory building catalog index\n");
+    return 0;
+  }
+
+  const BoundingBox *ext = &catalog->extent;
+  double width = ext->xmax > ext->xmin ? ext->xmax - ext->xmin : 1.0;
+  double height = ext->ymax > ext->ymin ? ext->ymax - ext->ymin : 1.0;
+  for (int i = 0; i < n; i++) {
+    const BoundingBox *fp = &catalog->entries[i].footprint;
+    double cx = ((fp->xmin + fp->xmax) / 2 - ext->xmin) / width;
+    double cy = ((fp->ymin + fp->ymax) / 2 - ext->ymin) / height;
+    items[i].hilbert = hilbert_xy2d((uint32_t)(cx * 65535.0),
+                                    (uint32_t)(cy * 65535.0));
+    items[i].index = i;
+  }
+  qsort(items, (size_t)n, sizeof(HilbertItem), compare_hilbert);
+  for (int i = 0; i < n; i++) {
+    catalog->node_boxes[i] = catalog->entries[items[i].index].footprint;
+    catalog->node_index[i] = items[i].index;
+  }
+  free(items);
+
+  int pos = n;
+  int level_start = 0;
+  int level_end = n;
+  catalog->level_count = 0;
+  catalog->level_ends[catalog->level_count++] = n;
+  while (level_end - level_start > 1) {
+    for (int child = level_start; child < level_end;
+         child += CATALOG_NODE_SIZE) {
+      int last = child + CATALOG_NODE_SIZE;
+      if (last > level_end) {
+        last = level_end;
+      }
+      for (int c = child; c < last; c++) {
+        extend_box(&catalog->node_boxes[pos], &catalog->node_boxes[c],
+                   c == child);
+      }
+      catalog->node_index[pos] = child;
+      pos++;
+    }
+    level_start = level_end;
+    level_end = pos;
+    catalog->level_ends[catalog->level_count++] = pos;
+  }
+  catalog->node_count = pos;
+  return 1;
+}
+
+int catalog_load(Catalog *catalog, const char *source) {
+  memset(catalog, 0, sizeof(*catalog));
+
+  char **paths = list_catalog_paths(source);
+  int count = CSLCount(paths);
+  if (count == 0) {
+    fprintf(stderr, "Error: No datasets found in catalog '%s'\n", source);
+    CSLDestroy(paths);
+    return 0;
+  }
+
+  catalog->entries =
+      (CatalogEntry *)calloc((size_t)count, sizeof(CatalogEntry));
+  if (!catalog->entries) {
+    fprintf(stderr, "Error: Out of memory loading catalog\n");
+    CSLDestroy(paths);
+    return 0;
+  }
+  for (int i = 0; i < count; i++) {
+    if (!read_entry(&catalog->entries[i], paths[i])) {
+      CSLDestroy(paths);
+      catalog_destroy(catalog);
+      return 0;
+    }
+    catalog->count++;
+    extend_box(&catalog->extent, &catalog->entries[i].footprint, i == 0);
+  }
+  CSLDestroy(paths);
+
+  if (!build_index(catalog)) {
+    catalog_destroy(catalog);
+    return 0;
+  }
+  return 1;
+}
+
+void catalog_destroy(Catalog *catalog) {
+  for (int i = 0; i < catalog->count; i++) {
+    free(catalog->entries[i].path);
+  }
+  free(catalog->entries);
+  free(catalog->node_boxes);
+  free(catalog->node_index);
+  memset(catalog, 0, sizeof(*catalog));
+}
+
+static int box_contains(const BoundingBox *box, double x, double y) {
+  return x >= box->xmin && x < box->xmax && y > box->ymin && y <= box->ymax;
+}
+
+int catalog_query_point(const Catalog *catalog, double x, double y,
+                        int *matches, int max_matches) {
+  if (catalog->node_count == 0) {
+    return 0;
+  }
+
+  // Depth is at most level_count, each level pushes at most NODE_SIZE nodes
+  int stack[32 * CATALOG_NODE_SIZE];
+  int top = 0;
+  int found = 0;
+  stack[top++] = catalog->node_count - 1;
+  while (top > 0) {
+    int node = stack[--top];
+    if (!box_contains(&catalog->node_boxes[node], x, y)) {
+      continue;
+    }
+    if (node < catalog->count) {
+      if (found < max_matches) {
+        matches[found] = catalog->node_index[node];
+      }
+      found++;
+      continue;
+    }
+    int first = catalog->node_index[node];
+    int level = 0;
+    while (first >= catalog->level_ends[level]) {
+      level++;
+    }
+    int last = first + CATALOG_NODE_SIZE;
+    if (last > catalog->level_ends[level]) {
+      last = catalog->level_ends[level];
+    }
+    for (int child = first; child < last; child++) {
+      stack[top++] = child;
+    }
+  }
+  return found;
+}
@@ -0,0 +1,47 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include "geo_transform.h"
+
+// Maximum number of covering files returned for a single point.
+#define CATALOG_MAX_MATCHES 16
+
+typedef struct {
+  char *path;
+  BoundingBox footprint;
+  double geo_transform[6];
+  int raster_x;
+  int raster_y;
+} CatalogEntry;
+
+// A set of GeoTIFF tiles with their footprints, indexed by a packed
+// Hilbert R-tree. Immutable once loaded, so it can be shared by threads.
+typedef struct {
+  CatalogEntry *entries;
+  int count;
+  BoundingBox extent;
+
+  // Packed R-tree: the first `count` nodes are the entries sorted by the
+  // Hilbert value of their center, followed by each level of parents up to
+  // the root. node_index holds the entry index for leaves and the position
+  // of the first child for parents.
+  BoundingBox *node_boxes;
+  int *node_index;
+  int node_count;
+  int level_ends[32];
+  int level_count;
+} Catalog;
+
+// Loads every GeoTIFF of a directory, or every path listed (one per line)
+// in a text file, and reads its footprint from the geotransform. Returns 0
+// on failure.
+int catalog_load(Catalog *catalog, const char *source);
+void catalog_destroy(Catalog *catalog);
+
+// Finds the entries whose footprint contains (x, y). Writes up to
+// max_matches entry indices to matches and returns the number of covering
+// entries found (which may exceed max_matches).
+int catalog_query_point(const Catalog *catalog, double x, double y,
+                        int *matches, int max_matches);
+
+#endif
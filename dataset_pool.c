@@ -0,0 +1,179 @@
+#include "dataset_pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct DatasetPoolEntry {
+  char *path;
+  unsigned int hash;
+  GDALDatasetH dataset;
+  int bucket_next;
+  int prev;
+  int next;
+};
+
+// FNV-1a
+static unsigned int hash_path(const char *path) {
+  unsigned int h = 2166136261u;
+  for (const unsigned char *c = (const unsigned char *)path; *c; c++) {
+    h ^= *c;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+int dataset_pool_init(DatasetPool *pool, int capacity) {
+  memset(pool, 0, sizeof(*pool));
+  if (capacity <= 0) {
+    return 0;
+  }
+
+  unsigned int bucket_count = 1;
+  while (bucket_count < (unsigned int)capacity * 2) {
+    bucket_count <<= 1;
+  }
+  pool->entries =
+      (DatasetPoolEntry *)calloc((size_t)capacity, sizeof(DatasetPoolEntry));
+  pool->buckets = (int *)malloc(sizeof(int) * bucket_count);
+  if (!pool->entries || !pool->buckets) {
+    free(pool->entries);
+    free(pool->buckets);
+    memset(pool, 0, sizeof(*pool));
+    return 0;
+  }
+  for (unsigned int b = 0; b < bucket_count; b++) {
+    pool->buckets[b] = -1;
+  }
+  for (int i = 0; i < capacity; i++) {
+    pool->entries[i].next = i + 1 < capacity ? i + 1 : -1;
+  }
+  pool->capacity = capacity;
+  pool->bucket_mask = bucket_count - 1;
+  pool->head = -1;
+  pool->tail = -1;
+  pool->free_list = 0;
+  return 1;
+}
+
+void dataset_pool_destroy(DatasetPool *pool) {
+  if (!pool->entries) {
+    return;
+  }
+  for (int i = pool->head; i >= 0; i = pool->entries[i].next) {
+    GDALClose(pool->entries[i].dataset);
+    free(pool->entries[i].path);
+  }
+  free(pool->entries);
+  free(pool->buckets);
+  pool->entries = NULL;
+  pool->buckets = NULL;
+  pool->count = 0;
+}
+
+static void lru_unlink(DatasetPool *pool, int i) {
+  DatasetPoolEntry *e = &pool->entries[i];
+  if (e->prev >= 0) {
+    pool->entries[e->prev].next = e->next;
+  } else {
+    pool->head = e->next;
+  }
+  if (e->next >= 0) {
+    pool->entries[e->next].prev = e->prev;
+  } else {
+    pool->tail = e->prev;
+  }
+}
+
+static void lru_push_front(DatasetPool *pool, int i) {
+  DatasetPoolEntry *e = &pool->entries[i];
+  e->prev = -1;
+  e->next = pool->head;
+  if (pool->head >= 0) {
+    pool->entries[pool->head].prev = i;
+  }
+  pool->head = i;
+  if (pool->tail < 0) {
+    pool->tail = i;
+  }
+}
+
+static void bucket_remove(DatasetPool *pool, int i) {
+  int *link = &pool->buckets[pool->entries[i].hash & pool->bucket_mask];
+  while (*link != i) {
+    link = &pool->entries[*link].bucket_next;
+  }
+  *link = pool->entries[i].bucket_next;
+}
+
+static void evict_lru(DatasetPool *pool) {
+  int victim = pool->tail;
+  DatasetPoolEntry *e = &pool->entries[victim];
+  lru_unlink(pool, victim);
+  bucket_remove(pool, victim);
+  GDALClose(e->dataset);
+  free(e->path);
+  e->path = NULL;
+  e->dataset = NULL;
+  e->next = pool->free_list;
+  pool->free_list = victim;
+  pool->count--;
+  pool->evictions++;
+}
+
+GDALDatasetH dataset_pool_lookup(DatasetPool *pool, const char *path) {
+  unsigned int hash = hash_path(path);
+  for (int i = pool->buckets[hash & pool->bucket_mask]; i >= 0;
+       i = pool->entries[i].bucket_next) {
+    DatasetPoolEntry *e = &pool->entries[i];
+    if (e->hash == hash && strcmp(e->path, path) == 0) {
+      pool->hits++;
+      if (pool->head != i) {
+        lru_unlink(pool, i);
+        lru_push_front(pool, i);
+      }
+      return e->dataset;
+    }
+  }
+  pool->misses++;
+  return NULL;
+}
+
+int dataset_pool_insert(DatasetPool *pool, const char *path,
+                        GDALDatasetH dataset) {
+  char *key = strdup(path);
+  if (!key) {
+    return 0;
+  }
+
+  if (pool->count == pool->capacity) {
+    evict_lru(pool);
+  }
+  unsigned int hash = hash_path(path);
+  int i = pool->free_list;
+  DatasetPoolEntry *e = &pool->entries[i];
+  pool->free_list = e->next;
+  e->path = key;
+  e->hash = hash;
+  e->dataset = dataset;
+  e->bucket_next = pool->buckets[hash & pool->bucket_mask];
+  pool->buckets[hash & pool->bucket_mask] = i;
+  lru_push_front(pool, i);
+  pool->count++;
+  return 1;
+}
+
+GDALDatasetH dataset_pool_get(DatasetPool *pool, const char *path) {
+  GDALDatasetH dataset = dataset_pool_lookup(pool, path);
+  if (dataset) {
+    return dataset;
+  }
+  dataset = GDALOpen(path, GA_ReadOnly);
+  if (!dataset) {
+    return NULL;
+  }
+  if (!dataset_pool_insert(pool, path, dataset)) {
+    GDALClose(dataset);
+    return NULL;
+  }
+  return dataset;
+}
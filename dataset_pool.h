@@ -0,0 +1,50 @@
+#ifndef DATASET_POOL_H
+#define DATASET_POOL_H
+
+#include "gdal.h"
+
+typedef struct DatasetPoolEntry DatasetPoolEntry;
+
+// Bounded pool of open datasets keyed by path with LRU eviction. Keys need
+// not be real paths when datasets are added with dataset_pool_insert. A pool
+// is not thread-safe; like any GDAL handle it belongs to a single thread.
+typedef struct {
+  int capacity;
+  int count;
+  DatasetPoolEntry *entries;
+  // Hash buckets of entry indices, chained through DatasetPoolEntry.
+  int *buckets;
+  unsigned int bucket_mask;
+  // Most and least recently used entries.
+  int head;
+  int tail;
+  // Unused entry slots, chained through DatasetPoolEntry.next.
+  int free_list;
+
+  long long hits;
+  long long misses;
+  long long evictions;
+} DatasetPool;
+
+// Returns 0 if capacity is not positive or allocation fails.
+int dataset_pool_init(DatasetPool *pool, int capacity);
+// Closes every pooled dataset. Safe to call on a zeroed pool.
+void dataset_pool_destroy(DatasetPool *pool);
+
+// Returns the pooled dataset for path, counting a hit, or NULL, counting a
+// miss. A hit makes the dataset the most recently used one.
+GDALDatasetH dataset_pool_lookup(DatasetPool *pool, const char *path);
+// Adds a dataset opened by the caller under path, evicting the least
+// recently used dataset if the pool is full. The pool takes ownership of the
+// handle unless this returns 0 (on allocation failure). path must not be
+// pooled already.
+int dataset_pool_insert(DatasetPool *pool, const char *path,
+                        GDALDatasetH dataset);
+
+// Returns an open dataset for path, opening it (and evicting the least
+// recently used dataset if the pool is full) on a miss. The handle is owned
+// by the pool and stays valid until it is evicted by a later call. Returns
+// NULL if the dataset cannot be opened.
+GDALDatasetH dataset_pool_get(DatasetPool *pool, const char *path);
+
+#endif
@@ -0,0 +1,292 @@
+#include "gdal.h"
+#include "gdal_frmts.h"
+#include "latency_histogram.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Measures what a short-lived worker pays before its first pixel. Every run
+// starts a fresh copy of this program, which registers drivers, opens the
+// dataset and reads its center pixel from band 1. CLOCK_MONOTONIC is shared
+// by all processes, so the child's timestamps split the run into:
+//   process_start  from spawning the child to its main (exec, dynamic
+//                  loading of GDAL and its dependencies)
+//   register       GDALAllRegister, or GDALRegister_GTiff and
+//                  GDALRegister_VRT only
+//   open           the first GDALOpen
+//   read           the first GDALRasterIO, including the block read
+//   exit           from the read to the parent reaping the child
+// With --evict, the file is dropped from the page cache with
+// posix_fadvise(POSIX_FADV_DONTNEED) before each run, so the open and the
+// read pay for cold I/O. Runs alternate between the driver sets.
+
+#define DEFAULT_RUNS 20
+
+typedef enum { DRIVERS_ALL, DRIVERS_GTIFF_VRT, DRIVERS_COUNT } DriverSet;
+
+static const char *const driver_set_names[DRIVERS_COUNT] = {"all",
+                                                            "gtiff_vrt"};
+
+typedef enum {
+  COLD_PROCESS_START,
+  COLD_REGISTER,
+  COLD_OPEN,
+  COLD_READ,
+  COLD_EXIT,
+  COLD_TOTAL,
+  COLD_PHASE_COUNT
+} ColdPhase;
+
+static const char *const cold_phase_names[COLD_PHASE_COUNT] = {
+    "process_start", "register", "open", "read", "exit", "total"};
+
+typedef struct {
+  LatencyHistogram hist[COLD_PHASE_COUNT];
+  int driver_count;
+} DriverSetStats;
+
+// Child side: registers `drivers`, opens path and reads its center pixel,
+// then prints the timestamps for the parent. Returns the exit status.
+static int run_child(uint64_t main_ns, const char *drivers, const char *path) {
+  if (strcmp(drivers, "all") == 0) {
+    GDALAllRegister();
+  } else {
+    GDALRegister_GTiff();
+    GDALRegister_VRT();
+  }
+  uint64_t register_ns = monotonic_ns();
+  GDALDatasetH ds = GDALOpen(path, GA_ReadOnly);
+  uint64_t open_ns = monotonic_ns();
+  if (!ds) {
+    fprintf(stderr, "Error: Failed to open dataset '%s'\n", path);
+    return 1;
+  }
+  GDALRasterBandH band = GDALGetRasterBand(ds, 1);
+  double value = 0.0;
+  CPLErr err = GDALRasterIO(band, GF_Read, GDALGetRasterXSize(ds) / 2,
+                            GDALGetRasterYSize(ds) / 2, 1, 1, &value, 1, 1,
+                            GDT_Float64, 0, 0);
+  uint64_t read_ns = monotonic_ns();
+  if (err != CE_None) {
+    fprintf(stderr, "Error: Failed to read the center pixel of '%s'\n", path);
+    return 1;
+  }
+  printf("%llu %llu %llu %llu %d %.17g\n", (unsigned long long)main_ns,
+         (unsigned long long)register_ns, (unsigned long long)open_ns,
+         (unsigned long long)read_ns, GDALGetDriverCount(), value);
+  // A short-lived worker exits without tearing GDAL down
+  fflush(stdout);
+  return 0;
+}
+
+// Drops the cached pages of path. Returns 0 on failure.
+static int evict_file(const char *path) {
+#ifdef POSIX_FADV_DONTNEED
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Error: Failed to open '%s' to evict it\n", path);
+    return 0;
+  }
+  int err = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+  if (err != 0) {
+    fprintf(stderr, "Error: posix_fadvise failed on '%s': %s\n", path,
+            strerror(err));
+    return 0;
+  }
+  return 1;
+#else
+  fprintf(stderr, "Error: posix_fadvise is not available on this platform\n");
+  (void)path;
+  return 0;
+#endif
+}
+
+// Spawns one child with the driver set and records its phases. Returns 0
+// if the child fails.
+static int run_once(const char *self, const char *path, DriverSet drivers,
+                    DriverSetStats *stats) {
+  int pipe_fds[2];
+  if (pipe(pipe_fds) != 0) {
+    perror("Error: pipe");
+    return 0;
+  }
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, pipe_fds[1], STDOUT_FILENO);
+  posix_spawn_file_actions_addclose(&actions, pipe_fds[0]);
+  posix_spawn_file_actions_addclose(&actions, pipe_fds[1]);
+  char *child_argv[] = {(char *)self, (char *)"--child",
+                        (char *)driver_set_names[drivers], (char *)path,
+                        NULL};
+  extern char **environ;
+  pid_t pid;
+  uint64_t spawn_ns = monotonic_ns();
+  int err = posix_spawn(&pid, self, &actions, NULL, child_argv, environ);
+  posix_spawn_file_actions_destroy(&actions);
+  close(pipe_fds[1]);
+  if (err != 0) {
+    fprintf(stderr, "Error: Failed to start '%s': %s\n", self, strerror(err));
+    close(pipe_fds[0]);
+    return 0;
+  }
+
+  char line[256];
+  size_t used = 0;
+  ssize_t r;
+  while (used < sizeof(line) - 1 &&
+         (r = read(pipe_fds[0], line + used, sizeof(line) - 1 - used)) != 0) {
+    if (r < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    used += (size_t)r;
+  }
+  line[used] = '\0';
+  close(pipe_fds[0]);
+  int status = 0;
+  while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+  }
+  uint64_t exit_ns = monotonic_ns();
+
+  unsigned long long main_ns, register_ns, open_ns, read_ns;
+  int driver_count;
+  double value;
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+      sscanf(line, "%llu %llu %llu %llu %d %lf", &main_ns, &register_ns,
+             &open_ns, &read_ns, &driver_count, &value) != 6) {
+    fprintf(stderr, "Error: The %s run did not complete\n",
+            driver_set_names[drivers]);
+    return 0;
+  }
+  LatencyHistogram *hist = stats->hist;
+  latency_histogram_record(&hist[COLD_PROCESS_START], main_ns - spawn_ns);
+  latency_histogram_record(&hist[COLD_REGISTER], register_ns - main_ns);
+  latency_histogram_record(&hist[COLD_OPEN], open_ns - register_ns);
+  latency_histogram_record(&hist[COLD_READ], read_ns - open_ns);
+  latency_histogram_record(&hist[COLD_EXIT], exit_ns - read_ns);
+  latency_histogram_record(&hist[COLD_TOTAL], exit_ns - spawn_ns);
+  stats->driver_count = driver_count;
+  return 1;
+}
+
+static void print_stats(DriverSet drivers, const DriverSetStats *stats) {
+  printf("\nDrivers: %s (%d registered)\n", driver_set_names[drivers],
+         stats->driver_count);
+  printf("%-14s %8s %10s %10s %10s %10s %10s\n", "phase (us)", "count",
+         "mean", "p50", "p90", "p99", "max");
+  for (int p = 0; p < COLD_PHASE_COUNT; p++) {
+    const LatencyHistogram *h = &stats->hist[p];
+    printf("%-14s %8llu %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+           cold_phase_names[p], (unsigned long long)h->total_count,
+           latency_histogram_mean(h) / 1000.0,
+           (double)latency_histogram_percentile(h, 0.50) / 1000.0,
+           (double)latency_histogram_percentile(h, 0.90) / 1000.0,
+           (double)latency_histogram_percentile(h, 0.99) / 1000.0,
+           (double)h->max_ns / 1000.0);
+  }
+}
+
+static double mean_us(const DriverSetStats *stats, ColdPhase phase) {
+  return latency_histogram_mean(&stats->hist[phase]) / 1000.0;
+}
+
+int main(int argc, char *argv[]) {
+  uint64_t main_ns = monotonic_ns();
+  if (argc == 4 && strcmp(argv[1], "--child") == 0) {
+    return run_child(main_ns, argv[2], argv[3]);
+  }
+
+  const char *path = NULL;
+  int runs = DEFAULT_RUNS;
+  int evict = 0;
+  int first_set = 0;
+  int last_set = DRIVERS_COUNT - 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--evict") == 0) {
+      evict = 1;
+    } else if (strcmp(argv[i], "--drivers") == 0 && i + 1 < argc) {
+      i++;
+      if (strcmp(argv[i], "all") == 0) {
+        last_set = DRIVERS_ALL;
+      } else if (strcmp(argv[i], "gtiff_vrt") == 0) {
+        first_set = DRIVERS_GTIFF_VRT;
+      } else if (strcmp(argv[i], "both") != 0) {
+        fprintf(stderr, "Error: Unknown driver set '%s'\n", argv[i]);
+        return 1;
+      }
+    } else if (!path) {
+      path = argv[i];
+    } else {
+      runs = atoi(argv[i]);
+    }
+  }
+  if (!path || runs <= 0) {
+    fprintf(stderr,
+            "Usage: %s <path> [runs] [--evict] [--drivers all|gtiff_vrt|both]"
+            "\n",
+            argv[0]);
+    return 1;
+  }
+  if (evict && strncmp(path, "/vsi", 4) == 0) {
+    fprintf(stderr, "Error: --evict requires a local file\n");
+    return 1;
+  }
+
+  // The child is this same program, found through /proc when possible so
+  // that it does not depend on PATH or the working directory
+  char self[4096];
+  ssize_t self_length = readlink("/proc/self/exe", self, sizeof(self) - 1);
+  if (self_length > 0) {
+    self[self_length] = '\0';
+  } else {
+    snprintf(self, sizeof(self), "%s", argv[0]);
+  }
+
+  DriverSetStats *stats =
+      (DriverSetStats *)calloc(DRIVERS_COUNT, sizeof(DriverSetStats));
+  if (!stats) {
+    fprintf(stderr, "Error: Out of memory\n");
+    return 1;
+  }
+  for (int d = 0; d < DRIVERS_COUNT; d++) {
+    for (int p = 0; p < COLD_PHASE_COUNT; p++) {
+      latency_histogram_init(&stats[d].hist[p]);
+    }
+  }
+
+  printf("Cold start of '%s': %d runs per driver set, page cache %s\n", path,
+         runs, evict ? "evicted before each run" : "left warm");
+  int ok = 1;
+  for (int run = 0; run < runs && ok; run++) {
+    for (int d = first_set; d <= last_set && ok; d++) {
+      ok = (!evict || evict_file(path)) &&
+           run_once(self, path, (DriverSet)d, &stats[d]);
+    }
+  }
+  if (ok) {
+    for (int d = first_set; d <= last_set; d++) {
+      print_stats((DriverSet)d, &stats[d]);
+    }
+  }
+  if (ok && first_set != last_set) {
+    const DriverSetStats *all = &stats[DRIVERS_ALL];
+    const DriverSetStats *few = &stats[DRIVERS_GTIFF_VRT];
+    double saved = mean_us(all, COLD_REGISTER) - mean_us(few, COLD_REGISTER);
+    double total = mean_us(all, COLD_TOTAL);
+    printf("\nRegistering GTiff and VRT only: %.1f us less registration "
+           "(%.1f%% of the mean all-driver start), %.1f us less in total\n",
+           saved, total > 0.0 ? saved / total * 100.0 : 0.0,
+           total - mean_us(few, COLD_TOTAL));
+  }
+  free(stats);
+  return ok ? 0 : 1;
+}
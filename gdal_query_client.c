@@ -0,0 +1,331 @@
+#include "latency_histogram.h"
+#include "query_dist.h"
+#include "query_protocol.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Load client for gdal_query_server. For every combination of concurrency
+// and batch size, opens that many connections, each sending batches of
+// uniform points in the bbox back to back (closed loop), and reports
+// request and query throughput and request latency. Each connection sends
+// one untimed batch first, which also opens the dataset in its worker.
+
+#define DEFAULT_QUERIES 100000
+#define MAX_LIST 16
+
+typedef struct {
+  const char *socket_path;
+  const char *path;
+  BoundingBox bbox;
+  long long queries;
+  uint64_t seed;
+} ClientConfig;
+
+typedef struct {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  int ready;
+  int go;
+  // Set with go when setting up the cell failed, so started threads skip
+  // their workload
+  int abort;
+} StartGate;
+
+typedef struct {
+  const ClientConfig *config;
+  StartGate *gate;
+  int index;
+  int batch_size;
+  int requests;
+  int fd;
+  int ok;
+  QueryPoint *points;
+  double *values;
+  uint8_t *status;
+  LatencyHistogram latency;
+  long long status_counts[QUERY_ERROR + 1];
+} ClientThread;
+
+static int connect_socket(const char *path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Error: Socket path '%s' is too long\n", path);
+    return -1;
+  }
+  strcpy(addr.sun_path, path);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    fprintf(stderr, "Error: Failed to connect to '%s'\n", path);
+    if (fd >= 0) {
+      close(fd);
+    }
+    return -1;
+  }
+  return fd;
+}
+
+// Sends one batch of fresh points and waits for its response. Returns 0 on
+// a transport error or a response of the wrong size.
+static int send_batch(ClientThread *t, Rng *rng, int timed) {
+  const BoundingBox *bbox = &t->config->bbox;
+  for (int k = 0; k < t->batch_size; k++) {
+    t->points[k].path = 0;
+    t->points[k].x = bbox->xmin + rng_uniform(rng) * (bbox->xmax - bbox->xmin);
+    t->points[k].y = bbox->ymin + rng_uniform(rng) * (bbox->ymax - bbox->ymin);
+  }
+  const char *paths[1] = {t->config->path};
+  int count = 0;
+  uint64_t t0 = monotonic_ns();
+  if (!query_request_write(t->fd, paths, 1, t->points, t->batch_size) ||
+      !query_response_read(t->fd, t->values, t->status, t->batch_size,
+                           &count)) {
+    return 0;
+  }
+  if (timed) {
+    latency_histogram_record(&t->latency, monotonic_ns() - t0);
+  }
+  if (count != t->batch_size) {
+    fprintf(stderr, "Error: Sent %d queries, got %d values back\n",
+            t->batch_size, count);
+    return 0;
+  }
+  for (int k = 0; timed && k < count; k++) {
+    t->status_counts[t->status[k] <= QUERY_ERROR ? t->status[k]
+                                                 : QUERY_ERROR]++;
+  }
+  return 1;
+}
+
+static void *client_thread_main(void *arg) {
+  ClientThread *t = (ClientThread *)arg;
+  StartGate *gate = t->gate;
+  Rng rng;
+  rng_seed(&rng, t->config->seed, (uint64_t)t->index);
+  t->ok = send_batch(t, &rng, 0);
+
+  pthread_mutex_lock(&gate->mutex);
+  gate->ready++;
+  pthread_cond_broadcast(&gate->cond);
+  while (!gate->go) {
+    pthread_cond_wait(&gate->cond, &gate->mutex);
+  }
+  int abort = gate->abort;
+  pthread_mutex_unlock(&gate->mutex);
+  if (abort) {
+    return NULL;
+  }
+
+  for (int r = 0; t->ok && r < t->requests; r++) {
+    t->ok = send_batch(t, &rng, 1);
+  }
+  return NULL;
+}
+
+// Runs one cell of the sweep and prints its row. Returns 0 if a connection
+// failed.
+static int run_cell(const ClientConfig *cfg, int concurrency,
+                    int batch_size) {
+  long long per_connection =
+      (cfg->queries + (long long)concurrency * batch_size - 1) /
+      ((long long)concurrency * batch_size);
+  int requests = per_connection > 0 ? (int)per_connection : 1;
+  ClientThread *threads =
+      (ClientThread *)calloc((size_t)concurrency, sizeof(ClientThread));
+  pthread_t *handles =
+      (pthread_t *)calloc((size_t)concurrency, sizeof(pthread_t));
+  if (!threads || !handles) {
+    fprintf(stderr, "Error: Out of memory\n");
+    free(threads);
+    free(handles);
+    return 0;
+  }
+  StartGate gate;
+  pthread_mutex_init(&gate.mutex, NULL);
+  pthread_cond_init(&gate.cond, NULL);
+  gate.ready = 0;
+  gate.go = 0;
+  gate.abort = 0;
+  for (int c = 0; c < concurrency; c++) {
+    threads[c].fd = -1;
+  }
+
+  int ok = 1;
+  int started = 0;
+  for (int c = 0; c < concurrency; c++) {
+    ClientThread *t = &threads[c];
+    t->config = cfg;
+    t->gate = &gate;
+    t->index = c;
+    t->batch_size = batch_size;
+    t->requests = requests;
+    latency_histogram_init(&t->latency);
+    t->points = (QueryPoint *)malloc(sizeof(QueryPoint) * batch_size);
+    t->values = (double *)malloc(sizeof(double) * batch_size);
+    t->status = (uint8_t *)malloc((size_t)batch_size);
+    t->fd = connect_socket(cfg->socket_path);
+    if (!t->points || !t->values || !t->status || t->fd < 0 ||
+        pthread_create(&handles[c], NULL, client_thread_main, t) != 0) {
+      ok = 0;
+      break;
+    }
+    started++;
+  }
+
+  pthread_mutex_lock(&gate.mutex);
+  while (gate.ready < started) {
+    pthread_cond_wait(&gate.cond, &gate.mutex);
+  }
+  uint64_t start_ns = monotonic_ns();
+  gate.go = 1;
+  gate.abort = !ok;
+  pthread_cond_broadcast(&gate.cond);
+  pthread_mutex_unlock(&gate.mutex);
+  for (int c = 0; c < started; c++) {
+    pthread_join(handles[c], NULL);
+  }
+  double seconds = (double)(monotonic_ns() - start_ns) / 1e9;
+
+  LatencyHistogram latency;
+  latency_histogram_init(&latency);
+  long long status_counts[QUERY_ERROR + 1] = {0};
+  for (int c = 0; c < concurrency; c++) {
+    ClientThread *t = &threads[c];
+    ok &= c < started && t->ok;
+    latency_histogram_merge(&latency, &t->latency);
+    for (int s = 0; s <= QUERY_ERROR; s++) {
+      status_counts[s] += t->status_counts[s];
+    }
+    if (t->fd >= 0) {
+      close(t->fd);
+    }
+    free(t->points);
+    free(t->values);
+    free(t->status);
+  }
+  free(threads);
+  free(handles);
+  pthread_mutex_destroy(&gate.mutex);
+  pthread_cond_destroy(&gate.cond);
+  if (!ok) {
+    return 0;
+  }
+
+  long long total_requests = (long long)latency.total_count;
+  long long total_queries = total_requests * batch_size;
+  double mean_us = latency_histogram_mean(&latency) / 1000.0;
+  printf("%11d %8d %10lld %12.1f %12.1f %10.2f %10.2f %10.2f %10.2f %10.3f "
+         "%9lld %9lld %9lld\n",
+         concurrency, batch_size, total_requests,
+         seconds > 0.0 ? total_requests / seconds : 0.0,
+         seconds > 0.0 ? total_queries / seconds : 0.0, mean_us,
+         (double)latency_histogram_percentile(&latency, 0.50) / 1000.0,
+         (double)latency_histogram_percentile(&latency, 0.99) / 1000.0,
+         (double)latency_histogram_percentile(&latency, 0.999) / 1000.0,
+         mean_us / batch_size, status_counts[QUERY_NODATA],
+         status_counts[QUERY_OUTSIDE], status_counts[QUERY_ERROR]);
+  return 1;
+}
+
+// Parses a comma-separated list of positive integers. Returns the count, or
+// 0 if the list is malformed.
+static int parse_list(const char *str, int *values, int capacity) {
+  int count = 0;
+  const char *p = str;
+  while (*p) {
+    char *end = NULL;
+    long v = strtol(p, &end, 10);
+    if (end == p || v <= 0 || v > QUERY_MAX_BATCH || count == capacity ||
+        (*end != ',' && *end != '\0')) {
+      return 0;
+    }
+    values[count++] = (int)v;
+    p = *end == ',' ? end + 1 : end;
+  }
+  return count;
+}
+
+static void usage(const char *program_name) {
+  fprintf(stderr,
+          "Usage: %s <socket> <path> <xmin,ymin,xmax,ymax> [--queries N] "
+          "[--batch-sizes LIST] [--concurrency LIST] [--seed S]\n"
+          "  --queries N         - Queries per cell, split over its "
+          "connections (default %d)\n"
+          "  --batch-sizes LIST  - Queries per request (default "
+          "1,16,256,4096)\n"
+          "  --concurrency LIST  - Connections sending at once (default "
+          "1,4,16)\n"
+          "  --seed S            - Seed for the points (default 42)\n",
+          program_name, DEFAULT_QUERIES);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 4) {
+    usage(argv[0]);
+    return 1;
+  }
+  ClientConfig cfg;
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.socket_path = argv[1];
+  cfg.path = argv[2];
+  cfg.queries = DEFAULT_QUERIES;
+  cfg.seed = 42;
+  if (sscanf(argv[3], "%lf,%lf,%lf,%lf", &cfg.bbox.xmin, &cfg.bbox.ymin,
+             &cfg.bbox.xmax, &cfg.bbox.ymax) != 4) {
+    fprintf(stderr, "Error: Invalid bounding box format. Use: "
+                    "xmin,ymin,xmax,ymax\n");
+    return 1;
+  }
+  int batch_sizes[MAX_LIST] = {1, 16, 256, 4096};
+  int batch_count = 4;
+  int concurrency[MAX_LIST] = {1, 4, 16};
+  int concurrency_count = 3;
+  for (int i = 4; i < argc; i++) {
+    if (strcmp(argv[i], "--queries") == 0 && i + 1 < argc) {
+      cfg.queries = atoll(argv[++i]);
+      if (cfg.queries <= 0) {
+        fprintf(stderr, "Error: --queries must be positive\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--batch-sizes") == 0 && i + 1 < argc) {
+      batch_count = parse_list(argv[++i], batch_sizes, MAX_LIST);
+      if (batch_count == 0) {
+        fprintf(stderr, "Error: Invalid --batch-sizes '%s'\n", argv[i]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--concurrency") == 0 && i + 1 < argc) {
+      concurrency_count = parse_list(argv[++i], concurrency, MAX_LIST);
+      if (concurrency_count == 0) {
+        fprintf(stderr, "Error: Invalid --concurrency '%s'\n", argv[i]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      cfg.seed = strtoull(argv[++i], NULL, 10);
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  printf("Querying '%s' through %s, about %lld queries per cell\n", cfg.path,
+         cfg.socket_path, cfg.queries);
+  printf("%11s %8s %10s %12s %12s %10s %10s %10s %10s %10s %9s %9s %9s\n",
+         "connections", "batch", "requests", "requests/s", "queries/s",
+         "mean_us", "p50_us", "p99_us", "p99.9_us", "us/query", "nodata",
+         "outside", "errors");
+  for (int c = 0; c < concurrency_count; c++) {
+    for (int b = 0; b < batch_count; b++) {
+      if (!run_cell(&cfg, concurrency[c], batch_sizes[b])) {
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
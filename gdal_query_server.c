@@ -0,0 +1,461 @@
+#include "dataset_pool.h"
+#include "gdal.h"
+#include "geo_transform.h"
+#include "query_protocol.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Long-lived point query server. GDAL is registered once, and every
+// connection is served by a worker that keeps its datasets open in an LRU
+// pool across batches and connections, so the opens and the GDAL block
+// cache stay warm. Requests and responses use the framing of
+// query_protocol.h, over a Unix domain socket or stdin/stdout.
+
+#define DEFAULT_POOL_SIZE 64
+#define LISTEN_BACKLOG 128
+
+typedef struct {
+  const char *socket_path;
+  int pool_size;
+  int band;
+} ServerConfig;
+
+// A path of the current batch, resolved once per batch
+typedef struct {
+  GDALRasterBandH band;
+  GeoContext geo;
+  int has_nodata;
+  double nodata;
+} ResolvedPath;
+
+// Per-thread state: GDAL handles belong to one thread at a time. Idle
+// workers are kept for later connections with their pools still open.
+typedef struct ServerWorker {
+  const ServerConfig *config;
+  DatasetPool pool;
+  QueryBatch batch;
+  ResolvedPath *resolved;
+  int resolved_capacity;
+  double *values;
+  uint8_t *status;
+  int capacity;
+  struct ServerWorker *next_idle;
+} ServerWorker;
+
+typedef struct {
+  const ServerConfig *config;
+  pthread_mutex_t mutex;
+  ServerWorker *idle;
+  long long connections;
+  long long batches;
+  long long queries;
+  long long errors;
+} Server;
+
+typedef struct {
+  Server *server;
+  ServerWorker *worker;
+  int fd;
+} Connection;
+
+static volatile sig_atomic_t stop_requested = 0;
+// Write end of the pipe that wakes the accept loop on a stop signal
+static int stop_pipe_fd = -1;
+
+static void handle_stop(int sig) {
+  (void)sig;
+  int saved_errno = errno;
+  stop_requested = 1;
+  if (stop_pipe_fd >= 0) {
+    ssize_t written = write(stop_pipe_fd, "", 1);
+    (void)written;
+  }
+  errno = saved_errno;
+}
+
+static ServerWorker *worker_create(const ServerConfig *cfg) {
+  ServerWorker *w = (ServerWorker *)calloc(1, sizeof(ServerWorker));
+  if (!w) {
+    return NULL;
+  }
+  w->config = cfg;
+  if (!dataset_pool_init(&w->pool, cfg->pool_size)) {
+    free(w);
+    return NULL;
+  }
+  return w;
+}
+
+static void worker_destroy(ServerWorker *w) {
+  dataset_pool_destroy(&w->pool);
+  query_batch_free(&w->batch);
+  free(w->resolved);
+  free(w->values);
+  free(w->status);
+  free(w);
+}
+
+static int worker_reserve(ServerWorker *w, int path_count, int count) {
+  if (path_count > w->resolved_capacity) {
+    ResolvedPath *resolved = (ResolvedPath *)realloc(
+        w->resolved, sizeof(ResolvedPath) * (size_t)path_count);
+    if (!resolved) {
+      return 0;
+    }
+    w->resolved = resolved;
+    w->resolved_capacity = path_count;
+  }
+  if (count > w->capacity) {
+    double *values =
+        (double *)realloc(w->values, sizeof(double) * (size_t)count);
+    if (values) {
+      w->values = values;
+    }
+    uint8_t *status = (uint8_t *)realloc(w->status, (size_t)count);
+    if (status) {
+      w->status = status;
+    }
+    if (!values || !status) {
+      return 0;
+    }
+    w->capacity = count;
+  }
+  return 1;
+}
+
+// Opens (or finds in the pool) the dataset of every path of the batch. A
+// path that cannot be used leaves its band NULL, and its queries fail.
+static void resolve_paths(ServerWorker *w) {
+  const QueryBatch *batch = &w->batch;
+  for (int i = 0; i < batch->path_count; i++) {
+    ResolvedPath *r = &w->resolved[i];
+    memset(r, 0, sizeof(*r));
+    GDALDatasetH ds = dataset_pool_get(&w->pool, batch->paths[i]);
+    if (!ds) {
+      fprintf(stderr, "Error: Failed to open dataset '%s'\n", batch->paths[i]);
+      continue;
+    }
+    if (w->config->band > GDALGetRasterCount(ds)) {
+      fprintf(stderr, "Error: '%s' has no band %d\n", batch->paths[i],
+              w->config->band);
+      continue;
+    }
+    if (!geo_context_init(&r->geo, ds)) {
+      fprintf(stderr, "Error: Dataset '%s' has no invertible geotransform\n",
+              batch->paths[i]);
+      continue;
+    }
+    r->band = GDALGetRasterBand(ds, w->config->band);
+    int has_nodata = FALSE;
+    r->nodata = GDALGetRasterNoDataValue(r->band, &has_nodata);
+    r->has_nodata = has_nodata;
+  }
+}
+
+// Answers the batch into w->values and w->status. Returns the number of
+// queries that failed.
+static long long answer_batch(ServerWorker *w) {
+  const QueryBatch *batch = &w->batch;
+  long long errors = 0;
+  resolve_paths(w);
+  for (int k = 0; k < batch->count; k++) {
+    const QueryPoint *q = &batch->queries[k];
+    const ResolvedPath *r = &w->resolved[q->path];
+    w->values[k] = NAN;
+    if (!r->band) {
+      w->status[k] = QUERY_ERROR;
+      errors++;
+      continue;
+    }
+    int pixel_x, pixel_y;
+    geo_context_to_pixel(&r->geo, q->x, q->y, &pixel_x, &pixel_y);
+    if (pixel_x < 0 || pixel_y < 0 || pixel_x >= r->geo.raster_x ||
+        pixel_y >= r->geo.raster_y) {
+      w->status[k] = QUERY_OUTSIDE;
+      continue;
+    }
+    double value = 0.0;
+    if (GDALRasterIO(r->band, GF_Read, pixel_x, pixel_y, 1, 1, &value, 1, 1,
+                     GDT_Float64, 0, 0) != CE_None) {
+      fprintf(stderr, "Error reading pixel at (%d, %d)\n", pixel_x, pixel_y);
+      w->status[k] = QUERY_ERROR;
+      errors++;
+      continue;
+    }
+    w->values[k] = value;
+    // A NaN nodata value marks NaN pixels
+    int is_nodata = r->has_nodata &&
+                    (value == r->nodata || (isnan(value) && isnan(r->nodata)));
+    w->status[k] = is_nodata ? QUERY_NODATA : QUERY_VALUE;
+  }
+  return errors;
+}
+
+// Serves requests from in_fd, answering on out_fd, until the peer closes
+// the stream or sends a malformed frame. Returns 0 on a protocol or write
+// error.
+static int serve_stream(Server *server, ServerWorker *w, int in_fd,
+                        int out_fd) {
+  for (;;) {
+    int eof = 0;
+    if (!query_batch_read(in_fd, &w->batch, &eof)) {
+      return eof;
+    }
+    // Every path of a batch must stay open until the batch is answered
+    if (w->batch.path_count > w->config->pool_size) {
+      fprintf(stderr,
+              "Error: A batch names %d paths, more than the pool size %d\n",
+              w->batch.path_count, w->config->pool_size);
+      return 0;
+    }
+    if (!worker_reserve(w, w->batch.path_count, w->batch.count)) {
+      fprintf(stderr, "Error: Out of memory\n");
+      return 0;
+    }
+    long long errors = answer_batch(w);
+    if (!query_response_write(out_fd, w->values, w->status, w->batch.count)) {
+      fprintf(stderr, "Error: Failed to write a response\n");
+      return 0;
+    }
+    pthread_mutex_lock(&server->mutex);
+    server->batches++;
+    server->queries += w->batch.count;
+    server->errors += errors;
+    pthread_mutex_unlock(&server->mutex);
+  }
+}
+
+static void *connection_main(void *arg) {
+  Connection *c = (Connection *)arg;
+  Server *server = c->server;
+  serve_stream(server, c->worker, c->fd, c->fd);
+  close(c->fd);
+  pthread_mutex_lock(&server->mutex);
+  c->worker->next_idle = server->idle;
+  server->idle = c->worker;
+  pthread_mutex_unlock(&server->mutex);
+  free(c);
+  return NULL;
+}
+
+// Takes an idle worker, or creates one. Returns NULL on failure.
+static ServerWorker *acquire_worker(Server *server) {
+  pthread_mutex_lock(&server->mutex);
+  ServerWorker *w = server->idle;
+  if (w) {
+    server->idle = w->next_idle;
+  }
+  server->connections++;
+  pthread_mutex_unlock(&server->mutex);
+  return w ? w : worker_create(server->config);
+}
+
+static int open_listener(const char *path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Error: Socket path '%s' is too long\n", path);
+    return -1;
+  }
+  strcpy(addr.sun_path, path);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    perror("Error: socket");
+    return -1;
+  }
+  unlink(path);
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      listen(fd, LISTEN_BACKLOG) != 0) {
+    fprintf(stderr, "Error: Failed to listen on '%s': %s\n", path,
+            strerror(errno));
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Accepts connections until SIGINT or SIGTERM, serving each on its own
+// thread. The signal handler writes to a pipe that is polled next to the
+// listening socket, so a signal arriving between the stop check and the
+// wait still wakes the loop. Connection threads block both signals.
+// Returns 0 if the socket cannot be opened.
+static int serve_socket(Server *server) {
+  const char *path = server->config->socket_path;
+  int listen_fd = open_listener(path);
+  if (listen_fd < 0) {
+    return 0;
+  }
+  int wake_fds[2];
+  if (pipe(wake_fds) != 0) {
+    perror("Error: pipe");
+    close(listen_fd);
+    unlink(path);
+    return 0;
+  }
+  // Neither end may block: the handler must not stall on a full pipe, and
+  // a connection that goes away between poll and accept must not hang
+  // the loop
+  fcntl(wake_fds[1], F_SETFL, fcntl(wake_fds[1], F_GETFL) | O_NONBLOCK);
+  fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+  stop_pipe_fd = wake_fds[1];
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = handle_stop;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  sigset_t stop_signals, previous;
+  sigemptyset(&stop_signals);
+  sigaddset(&stop_signals, SIGINT);
+  sigaddset(&stop_signals, SIGTERM);
+  fprintf(stderr, "Listening on %s (band %d, pool of %d datasets per "
+                  "connection)\n",
+          path, server->config->band, server->config->pool_size);
+
+  struct pollfd fds[2] = {{listen_fd, POLLIN, 0}, {wake_fds[0], POLLIN, 0}};
+  while (!stop_requested) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno != EINTR) {
+        perror("Error: poll");
+      }
+      continue;
+    }
+    if (!(fds[0].revents & POLLIN)) {
+      continue;
+    }
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) {
+      if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK &&
+          errno != ECONNABORTED) {
+        perror("Error: accept");
+      }
+      continue;
+    }
+    // Some systems pass O_NONBLOCK on from the listening socket
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    Connection *c = (Connection *)malloc(sizeof(Connection));
+    ServerWorker *w = c ? acquire_worker(server) : NULL;
+    if (!w) {
+      fprintf(stderr, "Error: Out of memory\n");
+      free(c);
+      close(fd);
+      continue;
+    }
+    c->server = server;
+    c->worker = w;
+    c->fd = fd;
+    pthread_t thread;
+    pthread_sigmask(SIG_BLOCK, &stop_signals, &previous);
+    int err = pthread_create(&thread, NULL, connection_main, c);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    if (err != 0) {
+      fprintf(stderr, "Error: Failed to start a connection thread\n");
+      close(fd);
+      pthread_mutex_lock(&server->mutex);
+      w->next_idle = server->idle;
+      server->idle = w;
+      pthread_mutex_unlock(&server->mutex);
+      free(c);
+      continue;
+    }
+    pthread_detach(thread);
+  }
+  stop_pipe_fd = -1;
+  close(wake_fds[0]);
+  close(wake_fds[1]);
+  close(listen_fd);
+  unlink(path);
+  return 1;
+}
+
+static void usage(const char *program_name) {
+  fprintf(stderr,
+          "Usage: %s [--socket PATH] [--pool-size N] [--band N]\n"
+          "\n"
+          "Answers batches of (path, x, y) point queries with the value of "
+          "band N\n"
+          "(default 1) at each point. Without --socket, requests are read "
+          "from stdin\n"
+          "and responses written to stdout until stdin closes.\n"
+          "  --socket PATH   - Listen on a Unix domain socket until SIGINT "
+          "or SIGTERM\n"
+          "  --pool-size N   - Datasets each connection keeps open "
+          "(default %d)\n"
+          "  --band N        - Band to read (default 1)\n",
+          program_name, DEFAULT_POOL_SIZE);
+}
+
+int main(int argc, char *argv[]) {
+  ServerConfig cfg;
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.pool_size = DEFAULT_POOL_SIZE;
+  cfg.band = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+      cfg.socket_path = argv[++i];
+    } else if (strcmp(argv[i], "--pool-size") == 0 && i + 1 < argc) {
+      cfg.pool_size = atoi(argv[++i]);
+      if (cfg.pool_size <= 0) {
+        fprintf(stderr, "Error: --pool-size must be positive\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--band") == 0 && i + 1 < argc) {
+      cfg.band = atoi(argv[++i]);
+      if (cfg.band <= 0) {
+        fprintf(stderr, "Error: --band must be positive\n");
+        return 1;
+      }
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  // A client that goes away mid-response must not kill the server
+  signal(SIGPIPE, SIG_IGN);
+  GDALAllRegister();
+
+  Server server;
+  memset(&server, 0, sizeof(server));
+  server.config = &cfg;
+  pthread_mutex_init(&server.mutex, NULL);
+  int ok;
+  if (cfg.socket_path) {
+    ok = serve_socket(&server);
+  } else {
+    ServerWorker *w = worker_create(&cfg);
+    server.connections = 1;
+    if (!w) {
+      fprintf(stderr, "Error: Out of memory\n");
+    }
+    ok = w && serve_stream(&server, w, STDIN_FILENO, STDOUT_FILENO);
+    if (w) {
+      worker_destroy(w);
+    }
+  }
+
+  pthread_mutex_lock(&server.mutex);
+  fprintf(stderr,
+          "Served %lld queries in %lld batches over %lld connections, %lld "
+          "failed\n",
+          server.queries, server.batches, server.connections, server.errors);
+  pthread_mutex_unlock(&server.mutex);
+  // Connection threads may still be answering, so the socket server leaves
+  // its workers and GDAL to process exit
+  if (!cfg.socket_path) {
+    GDALDestroyDriverManager();
+  }
+  return ok ? 0 : 1;
+}
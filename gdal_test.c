@@ -1,15 +1,68 @@
+#include "block_batch.h"
+#include "catalog.h"
 #include "cpl_conv.h"
+#include "cpl_minixml.h"
 #include "cpl_port.h"
 #include "cpl_string.h"
+#include "cpl_vsi.h"
+#include "dataset_pool.h"
 #include "gdal.h"
 #include "gdal_vrt.h"
+#include "geo_transform.h"
+#include "latency_histogram.h"
+#include "mmap_store.h"
+#include "native_read.h"
+#include "prefetch_pool.h"
+#include "query_dist.h"
+#include "raw_tile.h"
+#include "tile_cache.h"
+#include "tile_occupancy.h"
+#include "trace.h"
+#include "usdt.h"
+#include "vsi_count.h"
+#include "vsi_sim.h"
+#include "window_stats.h"
+#include <errno.h>
 #include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+#include <malloc.h>
+#define HAVE_MALLINFO2
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#endif
 
 #define VRT_XML_BUFFER_SIZE 4096
+#define DEFAULT_BATCH_SIZE 1000
+#define BATCH_SWEEP_COUNT 6
+#define DEFAULT_POOL_SIZE 64
+#define POOL_SWEEP_COUNT 5
+#define DEFAULT_TILE_CACHE_SHARDS 16
+#define DEFAULT_MMAP_DIR "/tmp"
+#define DEFAULT_VRT_TILE_BLOCKS 1
+#define DEFAULT_VRT_TILE_CACHE 64
+// Tile VRTs built to estimate the heap each one holds
+#define VRT_TILE_MEMORY_SAMPLES 64
+#define VRT_TILE_SWEEP_COUNT 5
+#define DEFAULT_WINDOW_SIZE 16
+#define DEFAULT_LOOKAHEAD 64
+#define DEFAULT_IO_THREADS 4
+// Tile cache budget for direct_pipelined when --tile-cache is not given
+#define DEFAULT_PIPELINE_CACHE_MIB 256.0
+// --rate-sweep counts a rate as sustained while the achieved rate stays
+// within this share of the offered rate and p99 response time within this
+// multiple of the lowest p99 seen at the rates before
+#define SUSTAINED_THROUGHPUT_SHARE 0.95
+#define SUSTAINED_P99_FACTOR 10.0
+// Replay sleeps until this long before a query is due and spins for the rest,
+// so scheduler wake-up latency does not show up as response time
+#define REPLAY_SPIN_NS 200000ull
+// Enough for the baselines plus every run of the largest sweep
+#define MAX_RUNS 8
 static inline double make_nan() { return NAN; }
 
 static void print_cache_sizes(void) {
@@ -36,22 +89,129 @@ typedef enum {
   MODE_DIRECT_REUSE_BAND,
   MODE_VRT_API,
   MODE_VRT_XML,
+  MODE_VRT_XML_CACHED,
+  MODE_VRT_TILE,
   MODE_VRT_API_REUSE_SOURCE,
   MODE_VRT_API_REUSE_DATASET,
+  MODE_DIRECT_BATCHED_BLOCKS,
+  MODE_DIRECT_POOLED,
+  MODE_CATALOG,
+  MODE_CATALOG_VRT,
+  MODE_MMAP_CACHE,
+  MODE_DIRECT_PIPELINED,
+  MODE_DIRECT_WINDOW,
+  MODE_DIRECT_BANDS,
+  MODE_RAW_TILE,
   MODE_INVALID
 } Mode;
 
+// How a multi-band read lays the bands out in its buffer.
+typedef enum {
+  // One GDALRasterIO call per band, each into its own plane
+  BAND_LAYOUT_SEPARATE,
+  // One GDALDatasetRasterIO call, the band planes one after another
+  BAND_LAYOUT_SEQUENTIAL,
+  // One GDALDatasetRasterIO call, the bands of each pixel next to each other
+  BAND_LAYOUT_INTERLEAVED,
+  BAND_LAYOUT_COUNT
+} BandLayout;
+
+static const char *const band_layout_names[BAND_LAYOUT_COUNT] = {
+    "separate", "sequential", "interleaved"};
+
+// Bands a read covers, as 1-based band numbers of the dataset read.
+typedef struct {
+  int *list;
+  int count;
+  BandLayout layout;
+} BandSet;
+
+// Phases of a single iteration that are timed separately. PHASE_ITERATION
+// covers the whole iteration including coordinate generation.
+typedef enum {
+  PHASE_INDEX,
+  PHASE_OPEN,
+  PHASE_VRT_BUILD,
+  // --occupancy: pixel conversion and lookup in the occupancy bitmap
+  PHASE_OCCUPANCY,
+  PHASE_GEO_TO_PIXEL,
+  PHASE_RASTERIO,
+  PHASE_TILE_CACHE,
+  PHASE_MMAP_READ,
+  // raw_tile: reading a block's compressed bytes and decoding them
+  PHASE_FETCH,
+  PHASE_DECODE,
+  // Reduction of a direct_window buffer
+  PHASE_REDUCE,
+  PHASE_CLOSE,
+  PHASE_ITERATION,
+  // direct_batched_blocks: one whole batch, recorded once per batch
+  PHASE_BATCH,
+  // Replay only: from the scheduled start of a query to its completion,
+  // including any time it waited behind earlier queries
+  PHASE_RESPONSE,
+  PHASE_COUNT
+} Phase;
+
+static const char *const phase_names[PHASE_COUNT] = {
+    "index",     "open",       "vrt_build", "occupancy", "geo_to_pixel",
+    "rasterio",  "tile_cache", "mmap_read", "fetch",     "decode",
+    "reduce",    "close",      "iteration", "batch",     "response"};
+
 typedef struct {
-  double xmin;
-  double ymin;
-  double xmax;
-  double ymax;
-} BoundingBox;
+  LatencyHistogram hist[PHASE_COUNT];
+} PhaseStats;
+
+static void phase_stats_init(PhaseStats *stats) {
+  for (int p = 0; p < PHASE_COUNT; p++) {
+    latency_histogram_init(&stats->hist[p]);
+  }
+}
+
+static void phase_stats_merge(PhaseStats *dst, const PhaseStats *src) {
+  for (int p = 0; p < PHASE_COUNT; p++) {
+    latency_histogram_merge(&dst->hist[p], &src->hist[p]);
+  }
+}
+
+// Fires the phase_begin tracepoint and returns the start time to pass to
+// phase_record.
+static inline uint64_t phase_begin(Phase phase) {
+  USDT_PROBE2(phase_begin, (int)phase, phase_names[phase]);
+  return monotonic_ns();
+}
+
+// Records the time elapsed since start_ns and fires the phase_end
+// tracepoint; stats may be NULL. Returns the elapsed time.
+static inline uint64_t phase_record(PhaseStats *stats, Phase phase,
+                                    uint64_t start_ns) {
+  uint64_t elapsed = monotonic_ns() - start_ns;
+  USDT_PROBE3(phase_end, (int)phase, phase_names[phase], elapsed);
+  if (stats) {
+    latency_histogram_record(&stats->hist[phase], elapsed);
+  }
+  return elapsed;
+}
 
 void print_usage(const char *program_name) {
   fprintf(stderr,
           "Usage: %s <path> <iterations> <seed> <xmin,ymin,xmax,ymax> <mode> "
-          "[--print-pixels]\n",
+          "[--print-pixels] [--threads N] [--json FILE] [--batch-size N] "
+          "[--batch-sweep] [--file-list FILE] [--pool-size N] "
+          "[--pool-sweep] [--tile-cache MIB] [--tile-cache-shards N] "
+          "[--tile-cache-compare] [--vrt-xml-compare] "
+          "[--vrt-tile-blocks N] [--vrt-tile-cache N] [--vrt-tile-sweep] "
+          "[--window WxH] [--window-buffer WxH] [--resampling NAME] "
+          "[--window-kernel NAME] [--bands LIST] [--band-layout NAME] "
+          "[--band-compare] [--target-resolution R] [--overview-sweep] "
+          "[--native-type] [--raw-tile-verify] [--raw-tile-compare] "
+          "[--occupancy NAME] [--occupancy-compare] "
+          "[--mmap-dir DIR] [--lookahead N] "
+          "[--io-threads N] "
+          "[--distribution NAME] [--centers N] [--zipf-exponent S] "
+          "[--spread F] [--step F] "
+          "[--distribution-sweep] [--record FILE] [--replay FILE] "
+          "[--rate QPS] [--rate-sweep] [--csv FILE]\n",
           program_name);
   fprintf(stderr, "\nModes:\n");
   fprintf(stderr, "  direct              - Read directly from GeoTIFF, create "
@@ -65,13 +225,164 @@ void print_usage(const char *program_name) {
       "  vrt_api             - Read from VRT dataset created using VRT API\n");
   fprintf(stderr,
           "  vrt_xml             - Read from VRT dataset created from XML\n");
+  fprintf(stderr, "  vrt_xml_cached      - vrt_xml mode but build the XML once "
+                  "and open each VRT\n"
+                  "                        from a /vsimem/ copy\n");
+  fprintf(stderr, "  vrt_tile            - Read through cached VRTs over the "
+                  "block-aligned tile\n"
+                  "                        holding each point\n");
   fprintf(stderr,
           "  vrt_api_reuse_source - VRT API mode but reuse same source\n");
   fprintf(stderr, "  vrt_api_reuse_dataset - VRT API mode, create VRT once and "
                   "reuse dataset\n");
+  fprintf(stderr, "  direct_batched_blocks - Read batches of points, decoding "
+                  "each distinct block once\n");
+  fprintf(stderr, "  direct_pooled       - Read directly from GeoTIFF, using "
+                  "an LRU pool of open datasets\n");
+  fprintf(stderr, "  catalog             - <path> is a directory or file list; "
+                  "route each point\n"
+                  "                        through an R-tree of file "
+                  "footprints\n");
+  fprintf(stderr, "  catalog_vrt         - <path> is a directory or file list; "
+                  "read through one\n"
+                  "                        mosaic VRT built with the VRT API\n");
+  fprintf(stderr, "  mmap_cache          - Read from a memory-mapped file of "
+                  "the bbox window,\n"
+                  "                        decoded once and reused across "
+                  "runs\n");
+  fprintf(stderr, "  direct_pipelined    - Generate points ahead, prefetch "
+                  "their blocks into the\n"
+                  "                        tile cache on I/O threads, then "
+                  "read them\n");
+  fprintf(stderr, "  direct_window       - Reduce a window around each point "
+                  "to its mean, min, max\n"
+                  "                        and valid pixel count\n");
+  fprintf(stderr, "  direct_bands        - Read a window around each point "
+                  "from all --bands at once\n");
+  fprintf(stderr, "  raw_tile            - Fetch and decode GTiff blocks "
+                  "without GDAL's block\n"
+                  "                        machinery\n");
   fprintf(stderr, "\nOptions:\n");
   fprintf(stderr, "  --print-pixels      - Print pixel value for each "
                   "iteration (disabled by default)\n");
+  fprintf(stderr, "  --threads N         - Also run N worker threads, each "
+                  "with its own datasets,\n"
+                  "                        and report scaling vs 1 thread\n");
+  fprintf(stderr, "  --json FILE         - Write throughput and per-phase "
+                  "latencies as JSON\n");
+  fprintf(stderr, "  --csv FILE          - Append one row per run with "
+                  "throughput and iteration\n"
+                  "                        latency percentiles to FILE\n");
+  fprintf(stderr, "  --batch-size N      - Points per batch in "
+                  "direct_batched_blocks mode (default %d)\n",
+          DEFAULT_BATCH_SIZE);
+  fprintf(stderr, "  --batch-sweep       - Compare direct_batched_blocks at "
+                  "batch sizes 1..100k\n"
+                  "                        against direct_reuse_band\n");
+  fprintf(stderr, "  --file-list FILE    - Datasets (one per line) queried at "
+                  "random by direct and\n"
+                  "                        direct_pooled\n");
+  fprintf(stderr, "  --pool-size N       - Open datasets kept per thread by "
+                  "direct_pooled (default %d)\n",
+          DEFAULT_POOL_SIZE);
+  fprintf(stderr, "  --pool-sweep        - Compare direct_pooled against "
+                  "direct and direct_reuse_ds\n"
+                  "                        as the working set grows past the "
+                  "pool size\n");
+  fprintf(stderr, "  --tile-cache MIB    - Serve direct_reuse_band reads from "
+                  "a shared cache of\n"
+                  "                        decoded blocks with a MIB budget\n");
+  fprintf(stderr, "  --tile-cache-shards N - Lock shards of the tile cache "
+                  "(default %d)\n",
+          DEFAULT_TILE_CACHE_SHARDS);
+  fprintf(stderr, "  --tile-cache-compare - Compare the tile cache against "
+                  "GDAL's block cache alone\n");
+  fprintf(stderr, "  --vrt-xml-compare   - Compare vrt_xml against "
+                  "vrt_xml_cached and split a\n"
+                  "                        vrt_xml query into source open and "
+                  "XML work\n");
+  fprintf(stderr, "  --vrt-tile-blocks N  - Internal blocks per vrt_tile tile, "
+                  "a power of two\n"
+                  "                        (default %d)\n",
+          DEFAULT_VRT_TILE_BLOCKS);
+  fprintf(stderr, "  --vrt-tile-cache N  - Tile VRTs kept per thread by "
+                  "vrt_tile (default %d)\n",
+          DEFAULT_VRT_TILE_CACHE);
+  fprintf(stderr, "  --vrt-tile-sweep    - Compare vrt_tile with tiles of 1 "
+                  "to 16 blocks\n");
+  fprintf(stderr, "  --window WxH        - Window read by direct_window and "
+                  "direct_bands\n"
+                  "                        (default %dx%d)\n",
+          DEFAULT_WINDOW_SIZE, DEFAULT_WINDOW_SIZE);
+  fprintf(stderr, "  --window-buffer WxH - Down-sample the window into a "
+                  "smaller buffer\n");
+  fprintf(stderr, "  --resampling NAME   - Down-sampling algorithm: nearest "
+                  "(default), bilinear,\n"
+                  "                        cubic, cubicspline, lanczos, "
+                  "average, mode or gauss\n");
+  fprintf(stderr, "  --window-kernel NAME - Reduction kernel: auto (default), "
+                  "scalar, sse2 or avx2\n");
+  fprintf(stderr, "  --bands LIST        - Bands to read, e.g. 1,3,4 or all "
+                  "(default 1)\n");
+  fprintf(stderr, "  --band-layout NAME  - Multi-band buffer: separate, "
+                  "sequential (default) or\n"
+                  "                        interleaved\n");
+  fprintf(stderr, "  --band-compare      - Compare the three band layouts\n");
+  fprintf(stderr, "  --target-resolution R - Read the coarsest overview whose "
+                  "pixels are at most R\n"
+                  "                        georeferenced units wide\n");
+  fprintf(stderr, "  --overview-sweep    - Compare full resolution with "
+                  "each overview level\n");
+  fprintf(stderr, "  --native-type       - Read pixels in the band's data "
+                  "type instead of Float32\n");
+  fprintf(stderr, "  --raw-tile-verify   - Check every raw_tile read against "
+                  "GDALRasterIO\n");
+  fprintf(stderr, "  --raw-tile-compare  - Compare raw_tile with "
+                  "direct_reuse_band\n");
+  fprintf(stderr, "  --occupancy NAME    - Answer points in empty blocks "
+                  "without reading: coverage\n"
+                  "                        (driver coverage status) or scan "
+                  "(also read blocks)\n");
+  fprintf(stderr, "  --occupancy-compare - Compare reads with and without "
+                  "the occupancy bitmap\n");
+  fprintf(stderr, "  --mmap-dir DIR      - Where mmap_cache keeps its files "
+                  "(default %s)\n",
+          DEFAULT_MMAP_DIR);
+  fprintf(stderr, "  --lookahead N       - Points generated ahead of the "
+                  "reader in direct_pipelined\n"
+                  "                        (default %d)\n",
+          DEFAULT_LOOKAHEAD);
+  fprintf(stderr, "  --io-threads N      - Prefetch threads per worker in "
+                  "direct_pipelined (default %d)\n",
+          DEFAULT_IO_THREADS);
+  fprintf(stderr, "  --distribution NAME - Where points fall in the bbox: "
+                  "uniform (default), zipf,\n"
+                  "                        gaussian, sweep or walk\n");
+  fprintf(stderr, "  --centers N         - Hotspots for zipf (default 1000) or "
+                  "clusters for gaussian\n"
+                  "                        (default 16)\n");
+  fprintf(stderr, "  --zipf-exponent S   - Skew of the zipf hotspot weights "
+                  "(default 1.0)\n");
+  fprintf(stderr, "  --spread F          - Hotspot half-width (default 0.001) "
+                  "or cluster sigma\n"
+                  "                        (default 0.01) as a fraction of the "
+                  "bbox\n");
+  fprintf(stderr, "  --step F            - Sweep spacing or largest walk step "
+                  "as a fraction of the\n"
+                  "                        bbox (default 0.001)\n");
+  fprintf(stderr, "  --distribution-sweep - Run the mode under every "
+                  "distribution and compare\n");
+  fprintf(stderr, "  --record FILE       - Write the queries of the first run "
+                  "as a trace\n");
+  fprintf(stderr, "  --replay FILE       - Send the queries of a trace at "
+                  "their arrival times instead\n"
+                  "                        of back to back, and measure "
+                  "response time from them\n");
+  fprintf(stderr, "  --rate QPS          - Replay at a constant QPS instead of "
+                  "the trace timestamps\n");
+  fprintf(stderr, "  --rate-sweep        - Replay at increasing rates and "
+                  "report the highest one\n"
+                  "                        sustained before p99 diverges\n");
 }
 
 Mode parse_mode(const char *mode_str) {
@@ -85,10 +396,32 @@ Mode parse_mode(const char *mode_str) {
     return MODE_VRT_API;
   } else if (strcmp(mode_str, "vrt_xml") == 0) {
     return MODE_VRT_XML;
+  } else if (strcmp(mode_str, "vrt_xml_cached") == 0) {
+    return MODE_VRT_XML_CACHED;
+  } else if (strcmp(mode_str, "vrt_tile") == 0) {
+    return MODE_VRT_TILE;
   } else if (strcmp(mode_str, "vrt_api_reuse_source") == 0) {
     return MODE_VRT_API_REUSE_SOURCE;
   } else if (strcmp(mode_str, "vrt_api_reuse_dataset") == 0) {
     return MODE_VRT_API_REUSE_DATASET;
+  } else if (strcmp(mode_str, "direct_batched_blocks") == 0) {
+    return MODE_DIRECT_BATCHED_BLOCKS;
+  } else if (strcmp(mode_str, "direct_pooled") == 0) {
+    return MODE_DIRECT_POOLED;
+  } else if (strcmp(mode_str, "catalog") == 0) {
+    return MODE_CATALOG;
+  } else if (strcmp(mode_str, "catalog_vrt") == 0) {
+    return MODE_CATALOG_VRT;
+  } else if (strcmp(mode_str, "mmap_cache") == 0) {
+    return MODE_MMAP_CACHE;
+  } else if (strcmp(mode_str, "direct_pipelined") == 0) {
+    return MODE_DIRECT_PIPELINED;
+  } else if (strcmp(mode_str, "direct_window") == 0) {
+    return MODE_DIRECT_WINDOW;
+  } else if (strcmp(mode_str, "direct_bands") == 0) {
+    return MODE_DIRECT_BANDS;
+  } else if (strcmp(mode_str, "raw_tile") == 0) {
+    return MODE_RAW_TILE;
   } else {
     return MODE_INVALID;
   }
@@ -99,53 +432,28 @@ int parse_bbox(const char *bbox_str, BoundingBox *bbox) {
                 &bbox->xmax, &bbox->ymax) == 4;
 }
 
-void geo_to_pixel(GDALDatasetH dataset, double geo_x, double geo_y,
-                  int *pixel_x, int *pixel_y) {
-  double adfGeoTransform[6];
-  double adfInvGeoTransform[6];
-
-  // Get the geotransform (pixel -> world)
-  if (GDALGetGeoTransform(dataset, adfGeoTransform) != CE_None) {
-    fprintf(stderr, "Warning: Dataset has no geotransform\n");
-    *pixel_x = 0;
-    *pixel_y = 0;
-    return;
-  }
-
-  // Invert the geotransform (world -> pixel) using GDAL's built-in function
-  if (!GDALInvGeoTransform(adfGeoTransform, adfInvGeoTransform)) {
-    fprintf(stderr, "Warning: Geotransform is not invertible\n");
-    *pixel_x = 0;
-    *pixel_y = 0;
-    return;
-  }
-
-  // Apply the inverted transform to convert world coordinates to pixel
-  // coordinates
-  double pixel_x_d, pixel_y_d;
-  GDALApplyGeoTransform(adfInvGeoTransform, geo_x, geo_y, &pixel_x_d,
-                        &pixel_y_d);
-
-  *pixel_x = (int)pixel_x_d;
-  *pixel_y = (int)pixel_y_d;
-}
-
+// Formats a VRT with one band per entry of `bands`, over overview level ov
+// of the source. Returns NULL if the document does not fit.
 char *create_vrt_xml(const char *source_path, GDALDatasetH source_ds,
-                     BoundingBox *bbox) {
+                     BoundingBox *bbox, const BandSet *bands,
+                     const OverviewLevel *ov) {
+  double full_transform[6];
+  GDALGetGeoTransform(source_ds, full_transform);
   double adfGeoTransform[6];
-  GDALGetGeoTransform(source_ds, adfGeoTransform);
+  overview_geo_transform(ov, full_transform, adfGeoTransform);
 
-  int xmin_pix, ymin_pix, xmax_pix, ymax_pix;
-  geo_to_pixel(source_ds, bbox->xmin, bbox->ymax, &xmin_pix, &ymin_pix);
-  geo_to_pixel(source_ds, bbox->xmax, bbox->ymin, &xmax_pix, &ymax_pix);
+  int xmin_pix, ymin_pix, width, height;
+  bbox_to_pixel_window(source_ds, bbox, &xmin_pix, &ymin_pix, &width, &height);
+  overview_scale_window(ov, &xmin_pix, &ymin_pix, &width, &height);
 
-  int width = xmax_pix - xmin_pix;
-  int height = ymax_pix - ymin_pix;
-
-  if (width <= 0)
-    width = 1;
-  if (height <= 0)
-    height = 1;
+  // The source opens straight at the overview, whose band numbers match
+  char open_options[96] = "";
+  if (ov->level >= 0) {
+    snprintf(open_options, sizeof(open_options),
+             "      <OpenOptions><OOI key=\"OVERVIEW_LEVEL\">%d</OOI>"
+             "</OpenOptions>\n",
+             ov->level);
+  }
 
   // Calculate new geotransform
   double new_geo_x = adfGeoTransform[0] + xmin_pix * adfGeoTransform[1] +
@@ -153,48 +461,104 @@ char *create_vrt_xml(const char *source_path, GDALDatasetH source_ds,
   double new_geo_y = adfGeoTransform[3] + xmin_pix * adfGeoTransform[4] +
                      ymin_pix * adfGeoTransform[5];
 
-  GDALRasterBandH band = GDALGetRasterBand(source_ds, 1);
-  GDALDataType datatype = GDALGetRasterDataType(band);
-  const char *datatype_name = GDALGetDataTypeName(datatype);
-
-  char *xml = (char *)malloc(VRT_XML_BUFFER_SIZE);
-  snprintf(
-      xml, VRT_XML_BUFFER_SIZE,
+  size_t size = VRT_XML_BUFFER_SIZE * (size_t)bands->count;
+  char *xml = (char *)malloc(size);
+  if (!xml) {
+    return NULL;
+  }
+  size_t len = (size_t)snprintf(
+      xml, size,
       "<VRTDataset rasterXSize=\"%d\" rasterYSize=\"%d\">\n"
       "  <GeoTransform>%.15f, %.15f, %.15f, %.15f, %.15f, "
-      "%.15f</GeoTransform>\n"
-      "  <VRTRasterBand dataType=\"%s\" band=\"1\">\n"
-      "    <SimpleSource>\n"
-      "      <SourceFilename relativeToVRT=\"0\">%s</SourceFilename>\n"
-      "      <SourceBand>1</SourceBand>\n"
-      "      <SrcRect xOff=\"%d\" yOff=\"%d\" xSize=\"%d\" ySize=\"%d\"/>\n"
-      "      <DstRect xOff=\"0\" yOff=\"0\" xSize=\"%d\" ySize=\"%d\"/>\n"
-      "    </SimpleSource>\n"
-      "  </VRTRasterBand>\n"
-      "</VRTDataset>\n",
+      "%.15f</GeoTransform>\n",
       width, height, new_geo_x, adfGeoTransform[1], adfGeoTransform[2],
-      new_geo_y, adfGeoTransform[4], adfGeoTransform[5], datatype_name,
-      source_path, xmin_pix, ymin_pix, width, height, width, height);
+      new_geo_y, adfGeoTransform[4], adfGeoTransform[5]);
+  for (int b = 0; b < bands->count && len < size; b++) {
+    GDALRasterBandH band = GDALGetRasterBand(source_ds, bands->list[b]);
+    GDALDataType datatype = GDALGetRasterDataType(band);
+    const char *datatype_name = GDALGetDataTypeName(datatype);
+    len += (size_t)snprintf(
+        xml + len, size - len,
+        "  <VRTRasterBand dataType=\"%s\" band=\"%d\">\n"
+        "    <SimpleSource>\n"
+        "      <SourceFilename relativeToVRT=\"0\">%s</SourceFilename>\n"
+        "%s"
+        "      <SourceBand>%d</SourceBand>\n"
+        "      <SrcRect xOff=\"%d\" yOff=\"%d\" xSize=\"%d\" "
+        "ySize=\"%d\"/>\n"
+        "      <DstRect xOff=\"0\" yOff=\"0\" xSize=\"%d\" ySize=\"%d\"/>\n"
+        "    </SimpleSource>\n"
+        "  </VRTRasterBand>\n",
+        datatype_name, b + 1, source_path, open_options, bands->list[b],
+        xmin_pix, ymin_pix, width, height, width, height);
+  }
+  if (len < size) {
+    len += (size_t)snprintf(xml + len, size - len, "</VRTDataset>\n");
+  }
+  if (len >= size) {
+    free(xml);
+    return NULL;
+  }
 
   return xml;
 }
 
-GDALDatasetH create_vrt_api(const char *source_path, GDALDatasetH source_ds,
-                            BoundingBox *bbox) {
-  double adfGeoTransform[6];
-  GDALGetGeoTransform(source_ds, adfGeoTransform);
-
-  int xmin_pix, ymin_pix, xmax_pix, ymax_pix;
-  geo_to_pixel(source_ds, bbox->xmin, bbox->ymax, &xmin_pix, &ymin_pix);
-  geo_to_pixel(source_ds, bbox->xmax, bbox->ymin, &xmax_pix, &ymax_pix);
-
-  int width = xmax_pix - xmin_pix;
-  int height = ymax_pix - ymin_pix;
+// Builds the create_vrt_xml document once, with the source nodata value
+// set on the band so opening it needs no patching, and stores it as the
+// /vsimem/ file template_path. GDAL's C API cannot open a VRT from a parsed
+// CPLXMLNode tree, so every open still parses the file, but none formats it
+// or opens the source up front. Returns 0 on failure.
+int create_vrt_xml_template(const char *template_path, const char *source_path,
+                            GDALDatasetH source_ds, BoundingBox *bbox,
+                            const BandSet *bands, const OverviewLevel *ov) {
+  char *xml = create_vrt_xml(source_path, source_ds, bbox, bands, ov);
+  if (!xml) {
+    return 0;
+  }
+  CPLXMLNode *tree = CPLParseXMLString(xml);
+  free(xml);
+  if (!tree) {
+    return 0;
+  }
+  // The VRTRasterBand elements follow each other in band order
+  CPLXMLNode *band = CPLGetXMLNode(tree, "=VRTDataset.VRTRasterBand");
+  for (int b = 0; b < bands->count && band; b++, band = band->psNext) {
+    int has_nodata = FALSE;
+    double nodata = GDALGetRasterNoDataValue(
+        GDALGetRasterBand(source_ds, bands->list[b]), &has_nodata);
+    if (has_nodata) {
+      char value[64];
+      snprintf(value, sizeof(value), "%.17g", nodata);
+      CPLCreateXMLElementAndValue(band, "NoDataValue", value);
+    }
+  }
+  char *serialized = CPLSerializeXMLTree(tree);
+  CPLDestroyXMLNode(tree);
+  if (!serialized) {
+    return 0;
+  }
+  // The /vsimem/ file takes ownership of the buffer
+  VSILFILE *file = VSIFileFromMemBuffer(template_path, (GByte *)serialized,
+                                        (vsi_l_offset)strlen(serialized), TRUE);
+  if (!file) {
+    CPLFree(serialized);
+    return 0;
+  }
+  VSIFCloseL(file);
+  return 1;
+}
 
-  if (width <= 0)
-    width = 1;
-  if (height <= 0)
-    height = 1;
+// Builds a VRT over the source pixel window with the VRT API, with one band
+// per entry of `bands`. The window is in full resolution pixels; the VRT
+// reads overview level ov of the source over the same area.
+GDALDatasetH create_vrt_window(GDALDatasetH source_ds, int xmin_pix,
+                               int ymin_pix, int width, int height,
+                               const BandSet *bands, const OverviewLevel *ov) {
+  double full_transform[6];
+  GDALGetGeoTransform(source_ds, full_transform);
+  double adfGeoTransform[6];
+  overview_geo_transform(ov, full_transform, adfGeoTransform);
+  overview_scale_window(ov, &xmin_pix, &ymin_pix, &width, &height);
 
   // Calculate new geotransform
   double new_geo_x = adfGeoTransform[0] + xmin_pix * adfGeoTransform[1] +
@@ -202,9 +566,6 @@ GDALDatasetH create_vrt_api(const char *source_path, GDALDatasetH source_ds,
   double new_geo_y = adfGeoTransform[3] + xmin_pix * adfGeoTransform[4] +
                      ymin_pix * adfGeoTransform[5];
 
-  GDALRasterBandH source_band = GDALGetRasterBand(source_ds, 1);
-  GDALDataType datatype = GDALGetRasterDataType(source_band);
-
   // Create VRT dataset using VRT API
   GDALDatasetH vrt_ds = VRTCreate(width, height);
   if (!vrt_ds) {
@@ -216,37 +577,228 @@ GDALDatasetH create_vrt_api(const char *source_path, GDALDatasetH source_ds,
                              new_geo_y, adfGeoTransform[4], adfGeoTransform[5]};
   GDALSetGeoTransform(vrt_ds, new_transform);
 
-  // Add band
-  GDALAddBand(vrt_ds, datatype, NULL);
+  for (int b = 0; b < bands->count; b++) {
+    GDALRasterBandH source_band = GDALGetRasterBand(source_ds, bands->list[b]);
+    if (ov->level >= 0) {
+      source_band = GDALGetOverview(source_band, ov->level);
+      if (!source_band) {
+        GDALClose(vrt_ds);
+        return NULL;
+      }
+    }
+    GDALDataType datatype = GDALGetRasterDataType(source_band);
+
+    // Add band
+    GDALAddBand(vrt_ds, datatype, NULL);
 
-  // Get the VRT band
+    // Get the VRT band
+    GDALRasterBandH vrt_band = GDALGetRasterBand(vrt_ds, b + 1);
+
+    // Propagate NoData from source to VRT band
+    int has_nodata = FALSE;
+    double nodata = GDALGetRasterNoDataValue(source_band, &has_nodata);
+    if (has_nodata) {
+      GDALSetRasterNoDataValue(vrt_band, nodata);
+    }
+
+    // Add simple source
+    VRTAddSimpleSource((VRTSourcedRasterBandH)vrt_band, source_band, xmin_pix,
+                       ymin_pix, width, height, 0, 0, width, height, NULL,
+                       VRT_NODATA_UNSET);
+  }
+
+  // Flush cache to finalize the VRT
+  VRTFlushCache(vrt_ds);
+
+  return vrt_ds;
+}
+
+GDALDatasetH create_vrt_api(const char *source_path, GDALDatasetH source_ds,
+                            BoundingBox *bbox, const BandSet *bands,
+                            const OverviewLevel *ov) {
+  int xmin_pix, ymin_pix, width, height;
+  bbox_to_pixel_window(source_ds, bbox, &xmin_pix, &ymin_pix, &width, &height);
+  return create_vrt_window(source_ds, xmin_pix, ymin_pix, width, height,
+                           bands, ov);
+}
+
+// Size in pixels of a vrt_tile tile of `blocks` internal blocks of the
+// source, which must be a power of two. The tile grows by doubling whichever
+// side is shorter in pixels, so striped files get tall tiles and square
+// blocks give 1x1, 2x1, 2x2, 4x2, ... tiles.
+void vrt_tile_size(GDALDatasetH source_ds, int blocks, int *tile_width,
+                   int *tile_height) {
+  int block_width, block_height;
+  GDALGetBlockSize(GDALGetRasterBand(source_ds, 1), &block_width,
+                   &block_height);
+  int tiles_x = 1;
+  int tiles_y = 1;
+  while (tiles_x * tiles_y < blocks) {
+    if ((long long)tiles_x * block_width <= (long long)tiles_y * block_height) {
+      tiles_x *= 2;
+    } else {
+      tiles_y *= 2;
+    }
+  }
+  *tile_width = tiles_x * block_width;
+  *tile_height = tiles_y * block_height;
+}
+
+// Builds the VRT over tile (tile_x, tile_y) of the grid anchored at the
+// source origin, clipped to the raster.
+GDALDatasetH create_tile_vrt(GDALDatasetH source_ds, int tile_width,
+                             int tile_height, int tile_x, int tile_y,
+                             const BandSet *bands, const OverviewLevel *ov) {
+  int xoff = tile_x * tile_width;
+  int yoff = tile_y * tile_height;
+  int width = GDALGetRasterXSize(source_ds) - xoff;
+  int height = GDALGetRasterYSize(source_ds) - yoff;
+  return create_vrt_window(source_ds, xoff, yoff,
+                           width < tile_width ? width : tile_width,
+                           height < tile_height ? height : tile_height,
+                           bands, ov);
+}
+
+// Builds a VRT mosaic of every catalog entry, placing each source by its
+// footprint. Assumes north-up tiles sharing the resolution of the first
+// entry. The sources must stay open while the VRT is in use.
+GDALDatasetH create_mosaic_vrt_api(const Catalog *catalog,
+                                   GDALDatasetH *sources) {
+  const BoundingBox *ext = &catalog->extent;
+  const double *first_gt = catalog->entries[0].geo_transform;
+  double res_x = first_gt[1];
+  double res_y = first_gt[5];
+
+  int width = (int)((ext->xmax - ext->xmin) / res_x + 0.5);
+  int height = (int)((ext->ymin - ext->ymax) / res_y + 0.5);
+  if (width <= 0)
+    width = 1;
+  if (height <= 0)
+    height = 1;
+
+  GDALRasterBandH first_band = GDALGetRasterBand(sources[0], 1);
+  GDALDataType datatype = GDALGetRasterDataType(first_band);
+
+  GDALDatasetH vrt_ds = VRTCreate(width, height);
+  if (!vrt_ds) {
+    return NULL;
+  }
+  double transform[6] = {ext->xmin, res_x, 0.0, ext->ymax, 0.0, res_y};
+  GDALSetGeoTransform(vrt_ds, transform);
+  GDALAddBand(vrt_ds, datatype, NULL);
   GDALRasterBandH vrt_band = GDALGetRasterBand(vrt_ds, 1);
 
-  // Propagate NoData from source to VRT band
   int has_nodata = FALSE;
-  double nodata = GDALGetRasterNoDataValue(source_band, &has_nodata);
+  double nodata = GDALGetRasterNoDataValue(first_band, &has_nodata);
   if (has_nodata) {
     GDALSetRasterNoDataValue(vrt_band, nodata);
   }
 
-  // Add simple source
-  VRTAddSimpleSource((VRTSourcedRasterBandH)vrt_band, source_band, xmin_pix,
-                     ymin_pix, width, height, 0, 0, width, height, NULL,
-                     VRT_NODATA_UNSET);
+  // Later sources overwrite earlier ones where footprints overlap
+  for (int i = 0; i < catalog->count; i++) {
+    const CatalogEntry *entry = &catalog->entries[i];
+    int dst_x = (int)((entry->footprint.xmin - ext->xmin) / res_x + 0.5);
+    int dst_y = (int)((entry->footprint.ymax - ext->ymax) / res_y + 0.5);
+    VRTAddSimpleSource((VRTSourcedRasterBandH)vrt_band,
+                       GDALGetRasterBand(sources[i], 1), 0, 0,
+                       entry->raster_x, entry->raster_y, dst_x, dst_y,
+                       entry->raster_x, entry->raster_y, NULL,
+                       VRT_NODATA_UNSET);
+  }
 
-  // Flush cache to finalize the VRT
   VRTFlushCache(vrt_ds);
 
   return vrt_ds;
 }
 
-float read_pixel_from_dataset(GDALDatasetH dataset, double geo_x, double geo_y,
-                              int *is_nodata, double *nodata_value) {
+// Reads the window from every band of `bands` as float, in the band set's
+// layout, from overview `overview` (-1 for full resolution). The separate
+// layout puts the bands in planes like the sequential one, but with a
+// GDALRasterIO call per band.
+CPLErr read_bands(GDALDatasetH dataset, const BandSet *bands, int overview,
+                  int xoff, int yoff, int width, int height, float *values) {
+  // Zero spacings give GDAL's default, band-sequential layout
+  int pixel_space = 0;
+  int line_space = 0;
+  int band_space = 0;
+  if (bands->layout == BAND_LAYOUT_INTERLEAVED) {
+    pixel_space = (int)sizeof(float) * bands->count;
+    line_space = pixel_space * width;
+    band_space = (int)sizeof(float);
+  }
+  if (bands->layout != BAND_LAYOUT_SEPARATE && overview < 0) {
+    return GDALDatasetRasterIO(dataset, GF_Read, xoff, yoff, width, height,
+                               values, width, height, GDT_Float32,
+                               bands->count, bands->list, pixel_space,
+                               line_space, band_space);
+  }
+  // The C API has no dataset-wide read of one overview level, so overview
+  // reads go band by band whatever the layout
+  size_t band_offset = band_space ? 1 : (size_t)width * height;
+  for (int b = 0; b < bands->count; b++) {
+    GDALRasterBandH band = GDALGetRasterBand(dataset, bands->list[b]);
+    if (overview >= 0) {
+      band = GDALGetOverview(band, overview);
+    }
+    CPLErr err = GDALRasterIO(band, GF_Read, xoff, yoff, width, height,
+                              values + b * band_offset, width, height,
+                              GDT_Float32, pixel_space, line_space);
+    if (err != CE_None) {
+      return err;
+    }
+  }
+  return CE_None;
+}
+
+// Value of band index `band` at `pixel` of a read_bands buffer holding
+// `pixels` pixels per band.
+static inline float band_value_at(const BandSet *bands, const float *values,
+                                  size_t pixels, size_t pixel, int band) {
+  return bands->layout == BAND_LAYOUT_INTERLEAVED
+             ? values[pixel * bands->count + band]
+             : values[band * pixels + pixel];
+}
+
+// Reads the point from every band of `bands` into band_values and returns
+// the first one. Nodata is that of the first band. A single band is read
+// with GDALRasterIO whatever the layout; NULL bands reads band 1 only. The
+// point is read from `overview`, picked by the caller once per dataset or
+// worker; NULL or level -1 reads full resolution. `geo` is the context of a
+// dataset the caller reuses; NULL converts with geo_to_pixel, as a dataset
+// opened for this one query must.
+float read_pixel_bands_from_dataset(GDALDatasetH dataset, const GeoContext *geo,
+                                    double geo_x, double geo_y,
+                                    const BandSet *bands,
+                                    const OverviewLevel *overview,
+                                    float *band_values, int *is_nodata,
+                                    double *nodata_value, PhaseStats *stats) {
+  if (band_values) {
+    memset(band_values, 0, sizeof(float) * (size_t)(bands ? bands->count : 1));
+  }
+  GDALRasterBandH band =
+      GDALGetRasterBand(dataset, bands ? bands->list[0] : 1);
+  int level = overview ? overview->level : -1;
   int pixel_x, pixel_y;
-  geo_to_pixel(dataset, geo_x, geo_y, &pixel_x, &pixel_y);
+  uint64_t t0 = phase_begin(PHASE_GEO_TO_PIXEL);
+  if (level >= 0 && geo) {
+    geo_context_to_overview_pixel(geo, overview, geo_x, geo_y, &pixel_x,
+                                  &pixel_y);
+  } else if (level >= 0) {
+    geo_to_overview_pixel(dataset, overview, geo_x, geo_y, &pixel_x,
+                          &pixel_y);
+  } else if (geo) {
+    geo_context_to_pixel(geo, geo_x, geo_y, &pixel_x, &pixel_y);
+  } else {
+    geo_to_pixel(dataset, geo_x, geo_y, &pixel_x, &pixel_y);
+  }
+  phase_record(stats, PHASE_GEO_TO_PIXEL, t0);
 
-  int raster_x = GDALGetRasterXSize(dataset);
-  int raster_y = GDALGetRasterYSize(dataset);
+  int raster_x = level >= 0 ? overview->raster_x
+                 : geo      ? geo->raster_x
+                            : GDALGetRasterXSize(dataset);
+  int raster_y = level >= 0 ? overview->raster_y
+                 : geo      ? geo->raster_y
+                            : GDALGetRasterYSize(dataset);
   if (pixel_x < 0 || pixel_y < 0 || pixel_x >= raster_x ||
       pixel_y >= raster_y) {
     // Outside dataset bounds
@@ -257,11 +809,26 @@ float read_pixel_from_dataset(GDALDatasetH dataset, double geo_x, double geo_y,
     return 0.0f;
   }
 
-  GDALRasterBandH band = GDALGetRasterBand(dataset, 1);
   float pixel_value = 0.0f;
 
-  CPLErr err = GDALRasterIO(band, GF_Read, pixel_x, pixel_y, 1, 1, &pixel_value,
-                            1, 1, GDT_Float32, 0, 0);
+  CPLErr err;
+  t0 = phase_begin(PHASE_RASTERIO);
+  if (bands && bands->count > 1) {
+    err = read_bands(dataset, bands, level, pixel_x, pixel_y, 1, 1,
+                     band_values);
+    pixel_value = band_values[0];
+  } else {
+    GDALRasterBandH read_band =
+        level >= 0 ? GDALGetOverview(band, level) : band;
+    // A file of a list may lack the overview picked on `path`
+    err = read_band ? GDALRasterIO(read_band, GF_Read, pixel_x, pixel_y, 1, 1,
+                                   &pixel_value, 1, 1, GDT_Float32, 0, 0)
+                    : CE_Failure;
+    if (band_values) {
+      band_values[0] = pixel_value;
+    }
+  }
+  phase_record(stats, PHASE_RASTERIO, t0);
 
   if (err != CE_None) {
     fprintf(stderr, "Error reading pixel at (%d, %d)\n", pixel_x, pixel_y);
@@ -282,14 +849,115 @@ float read_pixel_from_dataset(GDALDatasetH dataset, double geo_x, double geo_y,
   return pixel_value;
 }
 
-float read_pixel_from_band(GDALRasterBandH band, GDALDatasetH dataset,
+float read_pixel_from_dataset(GDALDatasetH dataset, const GeoContext *geo,
+                              double geo_x, double geo_y, int *is_nodata,
+                              double *nodata_value, PhaseStats *stats) {
+  return read_pixel_bands_from_dataset(dataset, geo, geo_x, geo_y, NULL, NULL,
+                                       NULL, is_nodata, nodata_value, stats);
+}
+
+// Reads the point from `band` in its own data type, with the kernels picked
+// for it, and compares nodata in that type. Returned as a double, which
+// holds every type with native kernels exactly. `geo` is the context of the
+// band's dataset.
+double read_pixel_native(const GeoContext *geo, GDALRasterBandH band,
+                         const NativeKernels *kernels, double geo_x,
+                         double geo_y, int *is_nodata, double *nodata_value,
+                         PhaseStats *stats) {
+  int pixel_x, pixel_y;
+  uint64_t t0 = phase_begin(PHASE_GEO_TO_PIXEL);
+  geo_context_to_pixel(geo, geo_x, geo_y, &pixel_x, &pixel_y);
+  phase_record(stats, PHASE_GEO_TO_PIXEL, t0);
+
+  *nodata_value = kernels->nodata_matches ? kernels->to_double(&kernels->nodata)
+                                          : make_nan();
+  if (pixel_x < 0 || pixel_y < 0 || pixel_x >= geo->raster_x ||
+      pixel_y >= geo->raster_y) {
+    // Outside dataset bounds
+    *is_nodata = 1;
+    *nodata_value = make_nan();
+    return 0.0;
+  }
+
+  NativeValue value;
+  memset(&value, 0, sizeof(value));
+  t0 = phase_begin(PHASE_RASTERIO);
+  CPLErr err = GDALRasterIO(band, GF_Read, pixel_x, pixel_y, 1, 1, &value, 1,
+                            1, kernels->data_type, 0, 0);
+  phase_record(stats, PHASE_RASTERIO, t0);
+  if (err != CE_None) {
+    fprintf(stderr, "Error reading pixel at (%d, %d)\n", pixel_x, pixel_y);
+    *is_nodata = 1;
+    *nodata_value = make_nan();
+    return 0.0;
+  }
+  *is_nodata = kernels->is_nodata(kernels, &value);
+  return kernels->to_double(&value);
+}
+
+// Reads the point through the raw tile reader, fetching and decoding its
+// block unless it is the one decoded last, and compares nodata in the band's
+// type like read_pixel_native. Sets *pixel_x to -1 when the point is outside
+// the raster. Returns 0 if the block cannot be read.
+static int read_pixel_raw_tile(RawTileReader *reader,
+                               const NativeKernels *kernels, double geo_x,
+                               double geo_y, int *pixel_x, int *pixel_y,
+                               double *value, int *is_nodata,
+                               double *nodata_value, PhaseStats *stats) {
+  uint64_t t0 = phase_begin(PHASE_GEO_TO_PIXEL);
+  geo_context_to_pixel(&reader->geo, geo_x, geo_y, pixel_x, pixel_y);
+  phase_record(stats, PHASE_GEO_TO_PIXEL, t0);
+
+  *value = 0.0;
+  *nodata_value = kernels->nodata_matches ? kernels->to_double(&kernels->nodata)
+                                          : make_nan();
+  if (*pixel_x < 0 || *pixel_y < 0 || *pixel_x >= reader->geo.raster_x ||
+      *pixel_y >= reader->geo.raster_y) {
+    // Outside dataset bounds
+    *pixel_x = -1;
+    *is_nodata = 1;
+    *nodata_value = make_nan();
+    return 1;
+  }
+
+  int block_x = *pixel_x / reader->block_width;
+  int block_y = *pixel_y / reader->block_height;
+  if (!raw_tile_is_decoded(reader, block_x, block_y)) {
+    t0 = phase_begin(PHASE_FETCH);
+    int fetched = raw_tile_fetch(reader, block_x, block_y);
+    phase_record(stats, PHASE_FETCH, t0);
+    if (!fetched) {
+      return 0;
+    }
+    t0 = phase_begin(PHASE_DECODE);
+    int decoded = raw_tile_decode(reader);
+    phase_record(stats, PHASE_DECODE, t0);
+    if (!decoded) {
+      return 0;
+    }
+  }
+  NativeValue pixel;
+  memcpy(&pixel, raw_tile_pixel(reader, *pixel_x, *pixel_y),
+         (size_t)kernels->data_type_size);
+  *is_nodata = kernels->is_nodata(kernels, &pixel);
+  *value = kernels->to_double(&pixel);
+  return 1;
+}
+
+// Serves the read from tile_cache when it is not NULL, otherwise through
+// GDALRasterIO and GDAL's block cache. `geo` is the context of the band's
+// dataset.
+float read_pixel_from_band(GDALRasterBandH band, const GeoContext *geo,
                            double geo_x, double geo_y, int *is_nodata,
-                           double *nodata_value) {
+                           double *nodata_value, TileCache *tile_cache,
+                           uint64_t dataset_id, PhaseStats *stats) {
   int pixel_x, pixel_y;
-  geo_to_pixel(dataset, geo_x, geo_y, &pixel_x, &pixel_y);
+  uint64_t t0 = phase_begin(PHASE_GEO_TO_PIXEL);
+  geo_context_to_pixel(geo, geo_x, geo_y, &pixel_x, &pixel_y);
+  phase_record(stats, PHASE_GEO_TO_PIXEL, t0);
 
-  int raster_x = GDALGetRasterXSize(dataset);
-  int raster_y = GDALGetRasterYSize(dataset);
+  int raster_x = geo->raster_x;
+  int raster_y = geo->raster_y;
   if (pixel_x < 0 || pixel_y < 0 || pixel_x >= raster_x ||
       pixel_y >= raster_y) {
     // Outside dataset bounds
@@ -302,8 +970,19 @@ float read_pixel_from_band(GDALRasterBandH band, GDALDatasetH dataset,
 
   float pixel_value = 0.0f;
 
-  CPLErr err = GDALRasterIO(band, GF_Read, pixel_x, pixel_y, 1, 1, &pixel_value,
-                            1, 1, GDT_Float32, 0, 0);
+  CPLErr err;
+  t0 = phase_begin(tile_cache ? PHASE_TILE_CACHE : PHASE_RASTERIO);
+  if (tile_cache) {
+    err = tile_cache_read_pixel(tile_cache, dataset_id, band, pixel_x, pixel_y,
+                                &pixel_value, NULL)
+              ? CE_None
+              : CE_Failure;
+    phase_record(stats, PHASE_TILE_CACHE, t0);
+  } else {
+    err = GDALRasterIO(band, GF_Read, pixel_x, pixel_y, 1, 1, &pixel_value, 1,
+                       1, GDT_Float32, 0, 0);
+    phase_record(stats, PHASE_RASTERIO, t0);
+  }
 
   if (err != CE_None) {
     fprintf(stderr, "Error reading pixel at (%d, %d)\n", pixel_x, pixel_y);
@@ -324,290 +1003,3476 @@ float read_pixel_from_band(GDALRasterBandH band, GDALDatasetH dataset,
   return pixel_value;
 }
 
-int main(int argc, char *argv[]) {
-  GDALDatasetH reused_vrt_ds = NULL;
-
-  if (argc < 6 || argc > 7) {
-    print_usage(argv[0]);
-    return 1;
-  }
+// Collects the queries of the first run for --record.
+typedef struct {
+  const char *path;
+  int done;
+} TraceRecorder;
 
-  const char *path = argv[1];
-  int iterations = atoi(argv[2]);
-  unsigned int seed = (unsigned int)atoi(argv[3]);
+typedef struct {
+  const char *path;
+  const char *mode_name;
+  Mode mode;
   BoundingBox bbox;
-  if (!parse_bbox(argv[4], &bbox)) {
-    fprintf(stderr,
-            "Error: Invalid bounding box format. Use xmin,ymin,xmax,ymax\n");
-    return 1;
-  }
+  int iterations;
+  unsigned int seed;
+  int print_pixels;
+  int batch_size;
+  // Datasets queried by direct and direct_pooled; when empty only `path` is
+  // used.
+  char **file_list;
+  int file_count;
+  int pool_size;
+  // Loaded from `path` in the catalog modes
+  const Catalog *catalog;
+  // Shared by all workers of a run; NULL to rely on GDAL's block cache
+  TileCache *tile_cache;
+  // Mapped from `path` and `bbox` in MODE_MMAP_CACHE
+  const MmapStore *mmap_store;
+  // Built from `path` with --occupancy; NULL to read every point
+  const TileOccupancy *occupancy;
+  // MODE_VRT_TILE: internal blocks per tile and tile VRTs kept per worker
+  int vrt_tile_blocks;
+  int vrt_tile_cache;
+  // MODE_DIRECT_WINDOW: window around each point, the buffer it is read
+  // into (smaller when down-sampling) and the reduction kernel
+  int window_width;
+  int window_height;
+  int window_buffer_width;
+  int window_buffer_height;
+  GDALRIOResampleAlg window_resampling;
+  WindowStatsFunc window_kernel;
+  // Bands read from `path`, and the same bands as numbered in the VRTs
+  // built over it (1 to count), with the layout of multi-band reads
+  BandSet bands;
+  BandSet vrt_bands;
+  // Resolution the reads target, in georeferenced units; 0 reads full
+  // resolution
+  double target_resolution;
+  // Read in the band's data type rather than Float32 (direct_reuse_ds and
+  // direct_batched_blocks)
+  int native_type;
+  // MODE_RAW_TILE: compare every read with GDALRasterIO
+  int raw_tile_verify;
+  int lookahead;
+  int io_threads;
+  const QueryDist *dist;
+  // Geotransform and block size of `path`, used to measure how often queries
+  // return to a block; NULL when queries span several files
+  const GeoContext *block_geo;
+  int block_width;
+  int block_height;
+  TraceRecorder *recorder;
+  // When set, queries come from the trace instead of the distribution.
+  // Query k is scheduled k / replay_rate seconds after the start if
+  // replay_rate is positive, else at its timestamp divided by replay_speed.
+  const Trace *replay;
+  double replay_rate;
+  double replay_speed;
+} BenchConfig;
 
-  Mode mode = parse_mode(argv[5]);
-  if (mode == MODE_INVALID) {
-    fprintf(stderr, "Error: Invalid mode '%s'\n", argv[5]);
-    print_usage(argv[0]);
-    return 1;
-  }
+// Picks the overview of source_ds the reads of cfg use, judged on the first
+// band read.
+static void select_overview(const BenchConfig *cfg, GDALDatasetH source_ds,
+                            OverviewLevel *ov) {
+  overview_select(source_ds, GDALGetRasterBand(source_ds, cfg->bands.list[0]),
+                  cfg->target_resolution, ov);
+}
 
-  // Check for --print-pixels option
-  int print_pixels = 0;
-  if (argc == 7) {
-    if (strcmp(argv[6], "--print-pixels") == 0) {
-      print_pixels = 1;
-    } else {
-      fprintf(stderr, "Error: Unknown option '%s'\n", argv[6]);
-      print_usage(argv[0]);
-      return 1;
-    }
+// select_overview on `path`, opened for the purpose. Leaves full resolution
+// in ov and returns 0 if it cannot be opened.
+static int path_overview(const BenchConfig *cfg, OverviewLevel *ov) {
+  ov->level = -1;
+  GDALDatasetH ds = GDALOpen(cfg->path, GA_ReadOnly);
+  if (!ds) {
+    return 0;
   }
+  select_overview(cfg, ds, ov);
+  GDALClose(ds);
+  return 1;
+}
 
-  GDALAllRegister();
-
-  print_cache_sizes();
+// State owned by a single worker thread. GDAL dataset handles are not
+// thread-safe, so every worker opens its own datasets and VRTs.
+typedef struct {
+  const BenchConfig *config;
+  int index;
+  // Also picks the file in modes that query a file list
+  QueryStream query;
+  // Blocks of cfg->block_geo this worker's points fell in
+  KeySet blocks_seen;
+  long long block_queries;
+  long long block_repeats;
+  long long blocks_touched;
+  int thread_count;
+  // Start of the timed section, shared by all workers of a run
+  uint64_t run_start_ns;
+  // Queries drawn so far, kept when recording a trace
+  TraceQuery *recorded;
+  int recorded_count;
+  int recorded_capacity;
+  // Trace query being replayed
+  const TraceQuery *replay_query;
+  GDALDatasetH reused_ds;
+  GDALRasterBandH reused_band;
+  uint64_t reused_dataset_id;
+  // Geotransforms of reused_ds and reused_vrt_ds, inverted once when they
+  // are opened
+  GeoContext reused_geo;
+  // Overview read by direct, direct_pooled and direct_reuse_ds, picked once
+  // on `path` for --target-resolution; level -1 for full resolution
+  OverviewLevel overview;
+  GDALDatasetH reused_vrt_source;
+  GDALDatasetH reused_vrt_ds;
+  GeoContext reused_vrt_geo;
+  // Tile VRTs over reused_vrt_source in MODE_VRT_TILE, keyed by "x,y" tile
+  // index, and the grid they are cut from
+  DatasetPool vrt_tiles;
+  GeoContext vrt_tile_geo;
+  int vrt_tile_width;
+  int vrt_tile_height;
+  // Overview the tile VRTs read; the grid stays in full resolution pixels
+  OverviewLevel vrt_tile_overview;
+  // /vsimem/ VRT file opened by every query in MODE_VRT_XML_CACHED
+  char *vrt_template_path;
+  // Batch buffers, only used in MODE_DIRECT_BATCHED_BLOCKS
+  BlockBatchReader batch_reader;
+  double *batch_x;
+  double *batch_y;
+  float *batch_values;
+  int *batch_nodata;
+  // Native type batch values, only with cfg->native_type
+  NativeValue *batch_native;
+  // Used in MODE_DIRECT_POOLED and MODE_CATALOG
+  DatasetPool pool;
+  // Pipeline state, only used in MODE_DIRECT_PIPELINED. Slots of the ring
+  // are indexed by query number modulo the lookahead.
+  PrefetchPool prefetch;
+  double *pipe_x;
+  double *pipe_y;
+  int *pipe_pixel_x;
+  int *pipe_pixel_y;
+  uint8_t *pipe_in_bounds;
+  long long stall_count;
+  uint64_t stall_ns;
+  // Buffer of MODE_DIRECT_WINDOW and the pixels reduced from it
+  float *window_values;
+  long long window_pixels;
+  // Kernels for the band read with cfg->native_type, picked when the
+  // dataset is opened
+  NativeKernels native;
+  // MODE_RAW_TILE reader, with `native` set for its band. The last pixel
+  // read, x -1 when the point was outside the raster, is what
+  // cfg->raw_tile_verify checks.
+  RawTileReader raw_tile;
+  int raw_tile_x;
+  int raw_tile_y;
+  long long raw_tile_verified;
+  // Queries answered from cfg->occupancy without reading
+  long long occupancy_skipped;
+  // Value of every cfg->bands band at the last point read, and the window
+  // buffer of MODE_DIRECT_BANDS with the band pixels read into it
+  float *band_values;
+  float *band_window;
+  long long band_pixels;
+  // Sources of the mosaic VRT in MODE_CATALOG_VRT
+  GDALDatasetH *mosaic_sources;
+  int mosaic_source_count;
+  long long index_lookups;
+  long long index_matches;
+  long long index_misses;
+  double setup_seconds;
+  // GDALGetCacheUsed64() when the worker finished its queries
+  GIntBig gdal_cache_used;
+  PhaseStats stats[1];
+  int ok;
+} Worker;
 
-  printf("Running %d iterations in mode '%s'\n", iterations, argv[5]);
-  printf("Bounding box: (%.2f, %.2f) - (%.2f, %.2f)\n", bbox.xmin, bbox.ymin,
-         bbox.xmax, bbox.ymax);
+// Holds workers back until all of them have opened their datasets, so the
+// timed section only covers the query loop.
+typedef struct {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  int ready;
+  int go;
+  uint64_t start_ns;
+} StartGate;
 
-  srand(seed);
+typedef struct {
+  Worker worker;
+  StartGate *gate;
+} WorkerThread;
 
-  clock_t start_time = clock();
+typedef struct {
+  const char *mode_name;
+  const char *distribution;
+  int batch_size;
+  int file_count;
+  int threads;
+  long long queries;
+  // Replay only: queries per second the schedule asked for
+  double offered_rate;
+  // In-bounds queries, those that fell in a block the same worker had
+  // already touched, and distinct blocks summed over workers
+  long long block_queries;
+  long long block_repeats;
+  long long blocks_touched;
+  long long pool_hits;
+  long long pool_misses;
+  long long pool_evictions;
+  long long index_lookups;
+  long long index_matches;
+  long long index_misses;
+  // vrt_tile: tile size and lookups in the per-worker VRT caches, and the
+  // heap one tile VRT holds (-1 if it cannot be measured)
+  int vrt_tile_blocks;
+  int vrt_tile_width;
+  int vrt_tile_height;
+  long long vrt_tile_hits;
+  long long vrt_tile_misses;
+  long long vrt_tile_evictions;
+  double vrt_tile_bytes;
+  // Slowest per-worker setup (dataset opens, VRT or mosaic build)
+  double setup_seconds;
+  int tile_cache_enabled;
+  TileCacheStats tile_cache;
+  // Largest GDAL block cache usage seen by a worker at the end of its queries
+  long long gdal_cache_used;
+  // Operations on /vsicount/ paths from the start of the queries to the
+  // last worker finishing
+  VsiCountStats io;
+  // Simulated remote requests on /vsisim/ paths over the same span
+  VsiSimStats sim;
+  // direct_pipelined: background block reads against reads the consumer had
+  // to do itself
+  long long prefetch_submitted;
+  long long prefetch_dropped;
+  long long prefetch_blocks_read;
+  double prefetch_read_seconds;
+  long long stall_count;
+  double stall_seconds;
+  // direct_window: pixels reduced over all queries
+  long long window_pixels;
+  // Bands read per query and their layout; direct_bands also counts the
+  // pixels read over all bands
+  int band_count;
+  const char *band_layout;
+  long long band_pixels;
+  // --target-resolution and the overview of `path` it selects; level -1
+  // when reading full resolution
+  double target_resolution;
+  OverviewLevel overview;
+  // Data type read with --native-type, NULL when reading Float32
+  const char *native_type;
+  // raw_tile: codec and predictor of the source, blocks and compressed bytes
+  // fetched, blocks decoded, and reads checked against GDALRasterIO
+  const char *raw_tile_codec;
+  int raw_tile_predictor;
+  long long raw_tile_blocks_fetched;
+  long long raw_tile_bytes_fetched;
+  long long raw_tile_blocks_decoded;
+  long long raw_tile_verified;
+  // --occupancy: empty blocks of the bitmap and queries that fell in one
+  int occupancy_enabled;
+  long long occupancy_empty_blocks;
+  long long occupancy_blocks;
+  long long occupancy_skipped;
+  double elapsed_seconds;
+  PhaseStats stats;
+} RunResult;
 
-  // For reuse modes
-  GDALDatasetH reused_ds = NULL;
-  GDALRasterBandH reused_band = NULL;
-  GDALDatasetH reused_vrt_source = NULL;
+static int worker_open(Worker *w) {
+  const BenchConfig *cfg = w->config;
+  const char *path = cfg->path;
 
-  // Open dataset for reuse modes
-  if (mode == MODE_DIRECT_REUSE_DS || mode == MODE_DIRECT_REUSE_BAND) {
-    reused_ds = GDALOpen(path, GA_ReadOnly);
-    if (!reused_ds) {
+  if (cfg->mode == MODE_DIRECT_REUSE_DS ||
+      cfg->mode == MODE_DIRECT_REUSE_BAND ||
+      cfg->mode == MODE_DIRECT_BATCHED_BLOCKS ||
+      cfg->mode == MODE_DIRECT_PIPELINED || cfg->mode == MODE_DIRECT_WINDOW ||
+      cfg->mode == MODE_DIRECT_BANDS) {
+    w->reused_ds = GDALOpen(path, GA_ReadOnly);
+    if (!w->reused_ds) {
       fprintf(stderr, "Error: Failed to open dataset '%s'\n", path);
-      return 1;
+      return 0;
     }
-    if (mode == MODE_DIRECT_REUSE_BAND) {
-      reused_band = GDALGetRasterBand(reused_ds, 1);
+    if (cfg->mode == MODE_DIRECT_REUSE_BAND ||
+        cfg->mode == MODE_DIRECT_PIPELINED ||
+        cfg->mode == MODE_DIRECT_WINDOW) {
+      w->reused_band = GDALGetRasterBand(w->reused_ds, 1);
+      w->reused_dataset_id = tile_cache_dataset_id(path);
+    }
+    if (!geo_context_init(&w->reused_geo, w->reused_ds)) {
+      fprintf(stderr, "Error: Dataset '%s' has no invertible geotransform\n",
+              path);
+      return 0;
+    }
+    if (cfg->native_type) {
+      GDALRasterBandH band =
+          GDALGetRasterBand(w->reused_ds, cfg->bands.list[0]);
+      if (!native_kernels_init_band(&w->native, band)) {
+        fprintf(stderr, "Error: No native read kernels for data type %s\n",
+                GDALGetDataTypeName(GDALGetRasterDataType(band)));
+        return 0;
+      }
     }
   }
-  if (mode == MODE_VRT_API_REUSE_DATASET) {
-    reused_vrt_source = GDALOpen(path, GA_ReadOnly);
-    if (!reused_vrt_source) {
-      fprintf(stderr, "Error: Failed to open source dataset '%s'\n", path);
-      return 1;
+  w->overview.level = -1;
+  if (cfg->target_resolution > 0.0 &&
+      (cfg->mode == MODE_DIRECT || cfg->mode == MODE_DIRECT_POOLED ||
+       cfg->mode == MODE_DIRECT_REUSE_DS)) {
+    if (w->reused_ds) {
+      select_overview(cfg, w->reused_ds, &w->overview);
+    } else if (!path_overview(cfg, &w->overview)) {
+      fprintf(stderr, "Error: Failed to open dataset '%s'\n", path);
+      return 0;
     }
-    reused_vrt_ds = create_vrt_api(path, reused_vrt_source, &bbox);
-    if (!reused_vrt_ds) {
-      fprintf(stderr, "Error: Failed to create VRT dataset\n");
-      GDALClose(reused_vrt_source);
-      return 1;
+  }
+  if (cfg->mode == MODE_RAW_TILE) {
+    if (!raw_tile_open(&w->raw_tile, path, 1)) {
+      return 0;
+    }
+    if (!native_kernels_init_band(&w->native, w->raw_tile.band)) {
+      fprintf(stderr, "Error: No native read kernels for data type %s\n",
+              GDALGetDataTypeName(w->raw_tile.data_type));
+      return 0;
     }
   }
-
-  for (int i = 0; i < iterations; i++) {
-    // Generate random coordinate
-    double random_x =
-        bbox.xmin + ((double)rand() / RAND_MAX) * (bbox.xmax - bbox.xmin);
-    double random_y =
-        bbox.ymin + ((double)rand() / RAND_MAX) * (bbox.ymax - bbox.ymin);
-
-    float pixel_value = 0.0f;
-
-    switch (mode) {
-    case MODE_DIRECT: {
-      GDALDatasetH ds = GDALOpen(path, GA_ReadOnly);
-      if (!ds) {
-        fprintf(stderr, "Error: Failed to open dataset '%s'\n", path);
-        return 1;
-      }
-      int is_nodata = 0;
-      double nodata_value = make_nan();
-      pixel_value = read_pixel_from_dataset(ds, random_x, random_y, &is_nodata,
-                                            &nodata_value);
-      if (print_pixels) {
-        if (is_nodata) {
-          printf("Iteration %d: pixel at (%.2f, %.2f) is NODATA (pixel=%g, "
-                 "nodata=%g)\n",
-                 i + 1, random_x, random_y, (double)pixel_value, nodata_value);
-        }
-      }
-      GDALClose(ds);
-      break;
+  if (cfg->mode == MODE_DIRECT_PIPELINED) {
+    size_t n = (size_t)cfg->lookahead;
+    w->pipe_x = (double *)malloc(sizeof(double) * n);
+    w->pipe_y = (double *)malloc(sizeof(double) * n);
+    w->pipe_pixel_x = (int *)malloc(sizeof(int) * n);
+    w->pipe_pixel_y = (int *)malloc(sizeof(int) * n);
+    w->pipe_in_bounds = (uint8_t *)malloc(n);
+    if (!w->pipe_x || !w->pipe_y || !w->pipe_pixel_x || !w->pipe_pixel_y ||
+        !w->pipe_in_bounds) {
+      fprintf(stderr, "Error: Out of memory allocating pipeline buffers\n");
+      return 0;
     }
-
-    case MODE_DIRECT_REUSE_DS: {
-      int is_nodata = 0;
-      double nodata_value = make_nan();
-      pixel_value = read_pixel_from_dataset(reused_ds, random_x, random_y,
-                                            &is_nodata, &nodata_value);
-      if (print_pixels) {
-        if (is_nodata) {
-          printf("Iteration %d: pixel at (%.2f, %.2f) is NODATA (pixel=%g, "
-                 "nodata=%g)\n",
-                 i + 1, random_x, random_y, (double)pixel_value, nodata_value);
-        }
-      }
-      break;
+    if (!prefetch_pool_start(&w->prefetch, path, cfg->tile_cache,
+                             w->reused_dataset_id, cfg->io_threads,
+                             cfg->lookahead)) {
+      return 0;
     }
-
-    case MODE_DIRECT_REUSE_BAND: {
-      int is_nodata = 0;
-      double nodata_value = make_nan();
-      pixel_value = read_pixel_from_band(reused_band, reused_ds, random_x,
-                                         random_y, &is_nodata, &nodata_value);
-      if (print_pixels) {
-        if (is_nodata) {
-          printf("Iteration %d: pixel at (%.2f, %.2f) is NODATA (pixel=%g, "
-                 "nodata=%g)\n",
-                 i + 1, random_x, random_y, (double)pixel_value, nodata_value);
-        }
-      }
-      break;
+  }
+  if (cfg->mode == MODE_DIRECT_BATCHED_BLOCKS) {
+    size_t n = (size_t)cfg->batch_size;
+    w->batch_x = (double *)malloc(sizeof(double) * n);
+    w->batch_y = (double *)malloc(sizeof(double) * n);
+    w->batch_values = (float *)malloc(sizeof(float) * n);
+    w->batch_nodata = (int *)malloc(sizeof(int) * n);
+    if (cfg->native_type) {
+      w->batch_native = (NativeValue *)malloc(sizeof(NativeValue) * n);
     }
-
-    case MODE_VRT_API: {
-      GDALDatasetH source_ds = GDALOpen(path, GA_ReadOnly);
-      if (!source_ds) {
-        fprintf(stderr, "Error: Failed to open source dataset '%s'\n", path);
-        return 1;
-      }
-      GDALDatasetH vrt_ds = create_vrt_api(path, source_ds, &bbox);
-      if (!vrt_ds) {
-        fprintf(stderr, "Error: Failed to create VRT dataset\n");
-        GDALClose(source_ds);
-        return 1;
-      }
-      int is_nodata = 0;
-      double nodata_value = make_nan();
-      pixel_value = read_pixel_from_dataset(vrt_ds, random_x, random_y,
-                                            &is_nodata, &nodata_value);
-      if (print_pixels) {
-        if (is_nodata) {
-          printf("Iteration %d: pixel at (%.2f, %.2f) is NODATA (pixel=%g, "
-                 "nodata=%g)\n",
-                 i + 1, random_x, random_y, (double)pixel_value, nodata_value);
-        }
-      }
-      GDALClose(vrt_ds);
-      GDALClose(source_ds);
-      break;
+    if (!w->batch_x || !w->batch_y || !w->batch_values || !w->batch_nodata ||
+        (cfg->native_type && !w->batch_native)) {
+      fprintf(stderr, "Error: Out of memory allocating batch buffers\n");
+      return 0;
     }
-
-    case MODE_VRT_XML: {
-      GDALDatasetH source_ds = GDALOpen(path, GA_ReadOnly);
-      if (!source_ds) {
-        fprintf(stderr, "Error: Failed to open source dataset '%s'\n", path);
-        return 1;
-      }
-      char *vrt_xml = create_vrt_xml(path, source_ds, &bbox);
-      GDALDatasetH vrt_ds = GDALOpen(vrt_xml, GA_ReadOnly);
-      free(vrt_xml);
-      if (!vrt_ds) {
-        fprintf(stderr, "Error: Failed to create VRT dataset\n");
-        GDALClose(source_ds);
-        return 1;
-      }
-      // Ensure band nodata is recognized in VRT XML mode
-      GDALRasterBandH vrt_band = GDALGetRasterBand(vrt_ds, 1);
-      int has_nodata = FALSE;
-      GDALRasterBandH src_band = GDALGetRasterBand(source_ds, 1);
-      double nodata = GDALGetRasterNoDataValue(src_band, &has_nodata);
-      if (has_nodata) {
-        GDALSetRasterNoDataValue(vrt_band, nodata);
-      }
-      int is_nodata = 0;
-      double nodata_value = make_nan();
-      pixel_value = read_pixel_from_dataset(vrt_ds, random_x, random_y,
-                                            &is_nodata, &nodata_value);
-      if (print_pixels) {
-        if (is_nodata) {
-          printf("Iteration %d: pixel at (%.2f, %.2f) is NODATA (pixel=%g, "
-                 "nodata=%g)\n",
-                 i + 1, random_x, random_y, (double)pixel_value, nodata_value);
-        }
-      }
-      GDALClose(vrt_ds);
-      GDALClose(source_ds);
-      break;
+    if (!block_batch_reader_init(&w->batch_reader, w->reused_ds, 1,
+                                 cfg->batch_size)) {
+      return 0;
     }
-
-    case MODE_VRT_API_REUSE_DATASET: {
-      int is_nodata = 0;
-      double nodata_value = make_nan();
-      pixel_value = read_pixel_from_dataset(reused_vrt_ds, random_x, random_y,
-                                            &is_nodata, &nodata_value);
-      if (print_pixels) {
-        if (is_nodata) {
-          printf("Iteration %d: pixel at (%.2f, %.2f) is NODATA (pixel=%g, "
-                 "nodata=%g)\n",
-                 i + 1, random_x, random_y, (double)pixel_value, nodata_value);
-        }
-      }
-      break;
+  }
+  if ((cfg->mode == MODE_DIRECT_POOLED || cfg->mode == MODE_CATALOG) &&
+      !dataset_pool_init(&w->pool, cfg->pool_size)) {
+    fprintf(stderr, "Error: Failed to create dataset pool of size %d\n",
+            cfg->pool_size);
+    return 0;
+  }
+  if (cfg->mode == MODE_CATALOG_VRT) {
+    const Catalog *catalog = cfg->catalog;
+    w->mosaic_sources =
+        (GDALDatasetH *)calloc((size_t)catalog->count, sizeof(GDALDatasetH));
+    if (!w->mosaic_sources) {
+      fprintf(stderr, "Error: Out of memory opening catalog\n");
+      return 0;
     }
-
-    case MODE_VRT_API_REUSE_SOURCE: {
-      if (!reused_vrt_source) {
-        reused_vrt_source = GDALOpen(path, GA_ReadOnly);
-        if (!reused_vrt_source) {
-          fprintf(stderr, "Error: Failed to open source dataset '%s'\n", path);
-          return 1;
-        }
-        if (reused_vrt_ds) {
-          GDALClose(reused_vrt_ds);
-        }
-      }
-      GDALDatasetH vrt_ds = create_vrt_api(path, reused_vrt_source, &bbox);
-      if (!vrt_ds) {
-        fprintf(stderr, "Error: Failed to create VRT dataset\n");
-        GDALClose(reused_vrt_source);
-        reused_vrt_source = NULL;
-        return 1;
+    for (int i = 0; i < catalog->count; i++) {
+      w->mosaic_sources[i] = GDALOpen(catalog->entries[i].path, GA_ReadOnly);
+      if (!w->mosaic_sources[i]) {
+        fprintf(stderr, "Error: Failed to open source dataset '%s'\n",
+                catalog->entries[i].path);
+        return 0;
       }
-      int is_nodata = 0;
-      double nodata_value = make_nan();
-      pixel_value = read_pixel_from_dataset(vrt_ds, random_x, random_y,
-                                            &is_nodata, &nodata_value);
-      if (print_pixels) {
-        if (is_nodata) {
-          printf("Iteration %d: pixel at (%.2f, %.2f) is NODATA (pixel=%g, "
-                 "nodata=%g)\n",
-                 i + 1, random_x, random_y, (double)pixel_value, nodata_value);
-        }
-      }
-      GDALClose(vrt_ds);
-      break;
+      w->mosaic_source_count++;
     }
-
-    case MODE_INVALID:
-      // This should never happen as we check for MODE_INVALID before the loop
-      fprintf(stderr, "Error: Invalid mode\n");
-      return 1;
+    w->reused_vrt_ds = create_mosaic_vrt_api(catalog, w->mosaic_sources);
+    if (!w->reused_vrt_ds) {
+      fprintf(stderr, "Error: Failed to create mosaic VRT dataset\n");
+      return 0;
     }
-
-    // Optionally print pixel value
-    if (print_pixels) {
-      printf("Iteration %d: pixel value at (%.2f, %.2f) = %.2f\n", i + 1,
-             random_x, random_y, pixel_value);
-    } else {
-      (void)pixel_value; // Suppress unused variable warning when not printing
+  }
+  if (cfg->mode == MODE_VRT_API_REUSE_DATASET) {
+    w->reused_vrt_source = GDALOpen(path, GA_ReadOnly);
+    if (!w->reused_vrt_source) {
+      fprintf(stderr, "Error: Failed to open source dataset '%s'\n", path);
+      return 0;
+    }
+    BoundingBox bbox = cfg->bbox;
+    OverviewLevel ov;
+    select_overview(cfg, w->reused_vrt_source, &ov);
+    w->reused_vrt_ds =
+        create_vrt_api(path, w->reused_vrt_source, &bbox, &cfg->bands, &ov);
+    if (!w->reused_vrt_ds) {
+      fprintf(stderr, "Error: Failed to create VRT dataset\n");
+      return 0;
     }
   }
-
-  // Clean up reused resources
-  if (reused_ds) {
-    GDALClose(reused_ds);
+  if (w->reused_vrt_ds &&
+      !geo_context_init(&w->reused_vrt_geo, w->reused_vrt_ds)) {
+    fprintf(stderr, "Error: VRT dataset has no invertible geotransform\n");
+    return 0;
   }
-  if (reused_vrt_source) {
-    GDALClose(reused_vrt_source);
+  if (cfg->mode == MODE_DIRECT_WINDOW) {
+    w->window_values = (float *)malloc(sizeof(float) *
+                                       (size_t)cfg->window_buffer_width *
+                                       (size_t)cfg->window_buffer_height);
+    if (!w->window_values) {
+      fprintf(stderr, "Error: Out of memory allocating the window buffer\n");
+      return 0;
+    }
   }
+  w->band_values = (float *)malloc(sizeof(float) * (size_t)cfg->bands.count);
+  if (!w->band_values) {
+    fprintf(stderr, "Error: Out of memory allocating band values\n");
+    return 0;
+  }
+  if (cfg->mode == MODE_DIRECT_BANDS) {
+    w->band_window = (float *)malloc(
+        sizeof(float) * (size_t)cfg->window_width *
+        (size_t)cfg->window_height * (size_t)cfg->bands.count);
+    if (!w->band_window) {
+      fprintf(stderr, "Error: Out of memory allocating the band window\n");
+      return 0;
+    }
+  }
+  if (cfg->mode == MODE_VRT_TILE) {
+    w->reused_vrt_source = GDALOpen(path, GA_ReadOnly);
+    if (!w->reused_vrt_source) {
+      fprintf(stderr, "Error: Failed to open source dataset '%s'\n", path);
+      return 0;
+    }
+    if (!geo_context_init(&w->vrt_tile_geo, w->reused_vrt_source)) {
+      fprintf(stderr, "Error: Dataset '%s' has no invertible geotransform\n",
+              path);
+      return 0;
+    }
+    vrt_tile_size(w->reused_vrt_source, cfg->vrt_tile_blocks,
+                  &w->vrt_tile_width, &w->vrt_tile_height);
+    select_overview(cfg, w->reused_vrt_source, &w->vrt_tile_overview);
+    if (!dataset_pool_init(&w->vrt_tiles, cfg->vrt_tile_cache)) {
+      fprintf(stderr, "Error: Failed to create VRT tile cache of size %d\n",
+              cfg->vrt_tile_cache);
+      return 0;
+    }
+  }
+  if (cfg->mode == MODE_VRT_XML_CACHED) {
+    // The source is only needed to build the template; each VRT opens its
+    // own copy when read
+    GDALDatasetH source_ds = GDALOpen(path, GA_ReadOnly);
+    if (!source_ds) {
+      fprintf(stderr, "Error: Failed to open source dataset '%s'\n", path);
+      return 0;
+    }
+    w->vrt_template_path =
+        CPLStrdup(CPLSPrintf("/vsimem/gdal_test_%d.vrt", w->index));
+    BoundingBox bbox = cfg->bbox;
+    OverviewLevel ov;
+    select_overview(cfg, source_ds, &ov);
+    int built = create_vrt_xml_template(w->vrt_template_path, path,
+                                        source_ds, &bbox, &cfg->bands, &ov);
+    GDALClose(source_ds);
+    if (!built) {
+      fprintf(stderr, "Error: Failed to create VRT template\n");
+      return 0;
+    }
+  }
+  return 1;
+}
 
-  clock_t end_time = clock();
-  double elapsed_time = ((double)(end_time - start_time)) / CLOCKS_PER_SEC;
-
-  printf("Completed %d iterations in %.3f seconds (%.3f ms per iteration)\n",
-         iterations, elapsed_time, (elapsed_time * 1000.0) / iterations);
-
-  GDALDestroyDriverManager();
+static void worker_close(Worker *w) {
+  key_set_destroy(&w->blocks_seen);
+  // The recorded queries outlive the worker; run_workers writes them out
+  prefetch_pool_stop(&w->prefetch);
+  free(w->pipe_x);
+  free(w->pipe_y);
+  free(w->pipe_pixel_x);
+  free(w->pipe_pixel_y);
+  free(w->pipe_in_bounds);
+  w->pipe_x = NULL;
+  w->pipe_y = NULL;
+  w->pipe_pixel_x = NULL;
+  w->pipe_pixel_y = NULL;
+  w->pipe_in_bounds = NULL;
+  dataset_pool_destroy(&w->pool);
+  dataset_pool_destroy(&w->vrt_tiles);
+  free(w->window_values);
+  w->window_values = NULL;
+  free(w->band_values);
+  free(w->band_window);
+  w->band_values = NULL;
+  w->band_window = NULL;
+  block_batch_reader_destroy(&w->batch_reader);
+  raw_tile_close(&w->raw_tile);
+  free(w->batch_x);
+  free(w->batch_y);
+  free(w->batch_values);
+  free(w->batch_nodata);
+  free(w->batch_native);
+  w->batch_x = NULL;
+  w->batch_y = NULL;
+  w->batch_values = NULL;
+  w->batch_nodata = NULL;
+  w->batch_native = NULL;
+  if (w->reused_vrt_ds) {
+    GDALClose(w->reused_vrt_ds);
+    w->reused_vrt_ds = NULL;
+  }
+  if (w->vrt_template_path) {
+    VSIUnlink(w->vrt_template_path);
+    CPLFree(w->vrt_template_path);
+    w->vrt_template_path = NULL;
+  }
+  if (w->reused_ds) {
+    GDALClose(w->reused_ds);
+    w->reused_ds = NULL;
+  }
+  if (w->reused_vrt_source) {
+    GDALClose(w->reused_vrt_source);
+    w->reused_vrt_source = NULL;
+  }
+  for (int i = 0; i < w->mosaic_source_count; i++) {
+    GDALClose(w->mosaic_sources[i]);
+  }
+  free(w->mosaic_sources);
+  w->mosaic_sources = NULL;
+  w->mosaic_source_count = 0;
+}
+
+static void print_nodata_pixel(int iteration, double x, double y,
+                               double pixel_value, double nodata_value) {
+  printf("Iteration %d: pixel at (%.2f, %.2f) is NODATA (pixel=%g, "
+         "nodata=%g)\n",
+         iteration, x, y, pixel_value, nodata_value);
+}
+
+// Compares the pixel of the last raw_tile read with a GDALRasterIO read of
+// the same pixel in the band's type. Returns 0 on a mismatch.
+static int verify_raw_tile_read(Worker *w) {
+  const RawTileReader *reader = &w->raw_tile;
+  const NativeKernels *kernels = &w->native;
+  if (w->raw_tile_x < 0) {
+    return 1;
+  }
+  NativeValue expected, actual;
+  memset(&expected, 0, sizeof(expected));
+  memset(&actual, 0, sizeof(actual));
+  memcpy(&actual, raw_tile_pixel(reader, w->raw_tile_x, w->raw_tile_y),
+         (size_t)kernels->data_type_size);
+  if (GDALRasterIO(reader->band, GF_Read, w->raw_tile_x, w->raw_tile_y, 1, 1,
+                   &expected, 1, 1, kernels->data_type, 0, 0) != CE_None) {
+    fprintf(stderr, "Error reading pixel at (%d, %d)\n", w->raw_tile_x,
+            w->raw_tile_y);
+    return 0;
+  }
+  // Bitwise, so that NaN pixels match
+  if (memcmp(&expected, &actual, sizeof(expected)) != 0) {
+    fprintf(stderr,
+            "Error: raw_tile read %.17g at pixel (%d, %d), GDALRasterIO "
+            "%.17g\n",
+            kernels->to_double(&actual), w->raw_tile_x, w->raw_tile_y,
+            kernels->to_double(&expected));
+    return 0;
+  }
+  w->raw_tile_verified++;
+  return 1;
+}
+
+// Opens a dataset, recording the time spent in GDALOpen.
+static GDALDatasetH timed_open(const char *path, PhaseStats *stats) {
+  uint64_t t0 = phase_begin(PHASE_OPEN);
+  GDALDatasetH ds = GDALOpen(path, GA_ReadOnly);
+  phase_record(stats, PHASE_OPEN, t0);
+  return ds;
+}
+
+static void timed_close(GDALDatasetH ds, PhaseStats *stats) {
+  uint64_t t0 = phase_begin(PHASE_CLOSE);
+  GDALClose(ds);
+  phase_record(stats, PHASE_CLOSE, t0);
+}
+
+// Picks the dataset to query: a random entry of the file list if one was
+// given, the path argument otherwise.
+static const char *pick_path(Worker *w) {
+  const BenchConfig *cfg = w->config;
+  if (w->replay_query && w->replay_query->path >= 0) {
+    return cfg->replay->paths[w->replay_query->path];
+  }
+  if (cfg->file_count == 0) {
+    return cfg->path;
+  }
+  int file = (int)rng_below(&w->query.rng, (uint32_t)cfg->file_count);
+  // The point of this query was drawn just before
+  if (w->recorded_count > 0) {
+    w->recorded[w->recorded_count - 1].path = file;
+  }
+  return cfg->file_list[file];
+}
+
+// Appends a query to the worker's recording. Recording stops quietly if
+// memory runs out.
+static void record_query(Worker *w, double x, double y) {
+  if (w->recorded_count == w->recorded_capacity) {
+    int capacity = w->recorded_capacity ? w->recorded_capacity * 2 : 4096;
+    TraceQuery *recorded = (TraceQuery *)realloc(
+        w->recorded, sizeof(TraceQuery) * (size_t)capacity);
+    if (!recorded) {
+      return;
+    }
+    w->recorded = recorded;
+    w->recorded_capacity = capacity;
+  }
+  TraceQuery *q = &w->recorded[w->recorded_count++];
+  q->t = (double)(monotonic_ns() - w->run_start_ns) / 1e9;
+  q->x = x;
+  q->y = y;
+  q->path = -1;
+}
+
+// Draws the next point of the worker's distribution, or takes the point of
+// the trace query being replayed, and notes whether it falls in a block the
+// worker has already touched.
+static void random_point(Worker *w, double *x, double *y) {
+  const BenchConfig *cfg = w->config;
+  if (w->replay_query) {
+    *x = w->replay_query->x;
+    *y = w->replay_query->y;
+  } else {
+    query_stream_next(&w->query, x, y);
+  }
+  if (cfg->recorder && !cfg->recorder->done) {
+    record_query(w, *x, *y);
+  }
+  if (!cfg->block_geo) {
+    return;
+  }
+  int px, py;
+  geo_context_to_pixel(cfg->block_geo, *x, *y, &px, &py);
+  if (px < 0 || py < 0 || px >= cfg->block_geo->raster_x ||
+      py >= cfg->block_geo->raster_y) {
+    return;
+  }
+  uint64_t key = ((uint64_t)(uint32_t)(px / cfg->block_width) << 32) |
+                 (uint32_t)(py / cfg->block_height);
+  w->block_queries++;
+  if (key_set_insert(&w->blocks_seen, key) == 1) {
+    w->block_repeats++;
+  }
+}
+
+// Answers the point from cfg->occupancy when it falls in an empty block, with
+// the fill value the block reads as. Returns 0, leaving the read to the mode,
+// without a bitmap or when the block may hold data or the point is outside
+// the raster.
+static int occupancy_skips(Worker *w, double geo_x, double geo_y,
+                           double *value, int *is_nodata,
+                           double *nodata_value) {
+  const TileOccupancy *occ = w->config->occupancy;
+  if (!occ) {
+    return 0;
+  }
+  int pixel_x, pixel_y;
+  uint64_t t0 = phase_begin(PHASE_OCCUPANCY);
+  geo_context_to_pixel(&occ->geo, geo_x, geo_y, &pixel_x, &pixel_y);
+  int empty = pixel_x >= 0 && pixel_y >= 0 && pixel_x < occ->geo.raster_x &&
+              pixel_y < occ->geo.raster_y &&
+              tile_occupancy_is_empty(occ, pixel_x, pixel_y);
+  phase_record(w->stats, PHASE_OCCUPANCY, t0);
+  if (!empty) {
+    return 0;
+  }
+  *value = occ->fill_value;
+  *is_nodata = occ->has_nodata;
+  *nodata_value = occ->has_nodata ? occ->nodata_value : make_nan();
+  w->occupancy_skipped++;
+  return 1;
+}
+
+// Runs queries [first, first + count) as one batch. Returns 0 on a fatal
+// error.
+static int worker_run_batch(Worker *w, int first, int count) {
+  PhaseStats *stats = w->stats;
+  uint64_t batch_start = phase_begin(PHASE_BATCH);
+
+  for (int k = 0; k < count; k++) {
+    random_point(w, &w->batch_x[k], &w->batch_y[k]);
+  }
+
+  // The native read zeroes the values of points outside the raster itself
+  float *values = w->batch_native ? NULL : w->batch_values;
+  uint64_t t0 = phase_begin(PHASE_GEO_TO_PIXEL);
+  if (!block_batch_prepare(&w->batch_reader, w->batch_x, w->batch_y, count,
+                           values, w->batch_nodata)) {
+    return 0;
+  }
+  phase_record(stats, PHASE_GEO_TO_PIXEL, t0);
+
+  t0 = phase_begin(PHASE_RASTERIO);
+  int read_ok =
+      w->batch_native
+          ? block_batch_read_native(&w->batch_reader, w->batch_native,
+                                    w->batch_nodata)
+          : block_batch_read(&w->batch_reader, values, w->batch_nodata);
+  if (!read_ok) {
+    return 0;
+  }
+  phase_record(stats, PHASE_RASTERIO, t0);
+  // iteration stays per point, as in the other modes: each point of the
+  // batch gets an equal share of its time
+  uint64_t batch_ns = phase_record(stats, PHASE_BATCH, batch_start);
+  for (int k = 0; stats && k < count; k++) {
+    latency_histogram_record(&stats->hist[PHASE_ITERATION], batch_ns / count);
+  }
+
+  if (w->config->print_pixels) {
+    const BlockBatchReader *reader = &w->batch_reader;
+    for (int k = 0; k < count; k++) {
+      double value =
+          w->batch_native
+              ? reader->native.to_double(&w->batch_native[k])
+              : w->batch_values[k];
+      if (w->batch_nodata[k]) {
+        // Points outside the raster report NaN like read_pixel_from_band
+        double nodata_value = reader->in_bounds[k] && reader->has_nodata
+                                  ? reader->nodata
+                                  : make_nan();
+        print_nodata_pixel(first + k + 1, w->batch_x[k], w->batch_y[k], value,
+                           nodata_value);
+      }
+      printf("Iteration %d: pixel value at (%.2f, %.2f) = %.2f\n",
+             first + k + 1, w->batch_x[k], w->batch_y[k], value);
+    }
+  }
+  return 1;
+}
+
+// Clips the cfg->window centred on the pixel to the raster. Returns 0 if
+// nothing is left.
+static int clip_window(const BenchConfig *cfg, int raster_x, int raster_y,
+                       int pixel_x, int pixel_y, int *xoff, int *yoff,
+                       int *width, int *height) {
+  int x0 = pixel_x - cfg->window_width / 2;
+  int y0 = pixel_y - cfg->window_height / 2;
+  int x1 = x0 + cfg->window_width;
+  int y1 = y0 + cfg->window_height;
+  x0 = x0 < 0 ? 0 : x0;
+  y0 = y0 < 0 ? 0 : y0;
+  x1 = x1 > raster_x ? raster_x : x1;
+  y1 = y1 > raster_y ? raster_y : y1;
+  *xoff = x0;
+  *yoff = y0;
+  *width = x1 - x0;
+  *height = y1 - y0;
+  return x1 > x0 && y1 > y0;
+}
+
+// Reads the window centred on the point, clipped to the raster and
+// down-sampled in proportion to the buffer size, and reduces it. Points
+// whose window misses the raster reduce to no valid pixels. Returns 0 on a
+// read error.
+static int read_window_stats(Worker *w, double geo_x, double geo_y,
+                             WindowStats *window, double *nodata_value,
+                             PhaseStats *stats) {
+  const BenchConfig *cfg = w->config;
+  window->sum = 0.0;
+  window->min = INFINITY;
+  window->max = -INFINITY;
+  window->count = 0;
+
+  int pixel_x, pixel_y;
+  uint64_t t0 = phase_begin(PHASE_GEO_TO_PIXEL);
+  geo_context_to_pixel(&w->reused_geo, geo_x, geo_y, &pixel_x, &pixel_y);
+  phase_record(stats, PHASE_GEO_TO_PIXEL, t0);
+
+  int x0, y0, width, height;
+  int has_nodata = FALSE;
+  double nodata = GDALGetRasterNoDataValue(w->reused_band, &has_nodata);
+  *nodata_value = has_nodata ? nodata : make_nan();
+  if (!clip_window(cfg, w->reused_geo.raster_x, w->reused_geo.raster_y,
+                   pixel_x, pixel_y, &x0, &y0, &width, &height)) {
+    return 1;
+  }
+
+  int buffer_width =
+      (int)((long long)cfg->window_buffer_width * width / cfg->window_width);
+  int buffer_height = (int)((long long)cfg->window_buffer_height * height /
+                            cfg->window_height);
+  buffer_width = buffer_width > 0 ? buffer_width : 1;
+  buffer_height = buffer_height > 0 ? buffer_height : 1;
+  GDALRasterIOExtraArg extra;
+  INIT_RASTERIO_EXTRA_ARG(extra);
+  extra.eResampleAlg = cfg->window_resampling;
+
+  t0 = phase_begin(PHASE_RASTERIO);
+  CPLErr err = GDALRasterIOEx(w->reused_band, GF_Read, x0, y0, width, height,
+                              w->window_values, buffer_width, buffer_height,
+                              GDT_Float32, 0, 0, &extra);
+  phase_record(stats, PHASE_RASTERIO, t0);
+  if (err != CE_None) {
+    fprintf(stderr, "Error reading window at (%d, %d)\n", x0, y0);
+    return 0;
+  }
+
+  int count = buffer_width * buffer_height;
+  t0 = phase_begin(PHASE_REDUCE);
+  cfg->window_kernel(w->window_values, count, has_nodata, (float)nodata,
+                     window);
+  phase_record(stats, PHASE_REDUCE, t0);
+  w->window_pixels += count;
+  return 1;
+}
+
+// Reads the window centred on the point, clipped to the raster, from all
+// cfg->bands in the configured layout, and keeps the value of every band at
+// the point. Points outside the raster read as nodata. Returns 0 on a read
+// error.
+static int read_band_window(Worker *w, double geo_x, double geo_y,
+                            int *is_nodata, double *nodata_value,
+                            PhaseStats *stats) {
+  const BenchConfig *cfg = w->config;
+  const BandSet *bands = &cfg->bands;
+  int pixel_x, pixel_y;
+  uint64_t t0 = phase_begin(PHASE_GEO_TO_PIXEL);
+  geo_context_to_pixel(&w->reused_geo, geo_x, geo_y, &pixel_x, &pixel_y);
+  phase_record(stats, PHASE_GEO_TO_PIXEL, t0);
+
+  int raster_x = w->reused_geo.raster_x;
+  int raster_y = w->reused_geo.raster_y;
+  int has_nodata = FALSE;
+  double nodata = GDALGetRasterNoDataValue(
+      GDALGetRasterBand(w->reused_ds, bands->list[0]), &has_nodata);
+  *nodata_value = has_nodata ? nodata : make_nan();
+  if (pixel_x < 0 || pixel_y < 0 || pixel_x >= raster_x ||
+      pixel_y >= raster_y) {
+    // Outside dataset bounds
+    *is_nodata = 1;
+    memset(w->band_values, 0, sizeof(float) * (size_t)bands->count);
+    return 1;
+  }
+
+  int x0, y0, width, height;
+  clip_window(cfg, raster_x, raster_y, pixel_x, pixel_y, &x0, &y0, &width,
+              &height);
+  t0 = phase_begin(PHASE_RASTERIO);
+  CPLErr err = read_bands(w->reused_ds, bands, -1, x0, y0, width, height,
+                          w->band_window);
+  phase_record(stats, PHASE_RASTERIO, t0);
+  if (err != CE_None) {
+    fprintf(stderr, "Error reading bands at (%d, %d)\n", x0, y0);
+    return 0;
+  }
+
+  size_t pixels = (size_t)width * height;
+  size_t pixel = (size_t)(pixel_y - y0) * width + (pixel_x - x0);
+  for (int b = 0; b < bands->count; b++) {
+    w->band_values[b] =
+        band_value_at(bands, w->band_window, pixels, pixel, b);
+  }
+  *is_nodata = has_nodata && w->band_values[0] == (float)nodata;
+  w->band_pixels += (long long)pixels * bands->count;
+  return 1;
+}
+
+// Runs a single query. Returns 0 on a fatal error.
+static int worker_run_iteration(Worker *w, int i) {
+  const BenchConfig *cfg = w->config;
+  const char *path = cfg->path;
+  BoundingBox bbox = cfg->bbox;
+  PhaseStats *stats = w->stats;
+  VsiCountStats io_start;
+  if (cfg->print_pixels) {
+    vsi_count_thread_stats(&io_start);
+  }
+  uint64_t iteration_start = phase_begin(PHASE_ITERATION);
+
+  double random_x, random_y;
+  random_point(w, &random_x, &random_y);
+
+  double pixel_value = 0.0;
+  int is_nodata = 0;
+  double nodata_value = make_nan();
+  WindowStats window;
+
+  switch (cfg->mode) {
+  case MODE_DIRECT: {
+    if (occupancy_skips(w, random_x, random_y, &pixel_value, &is_nodata,
+                        &nodata_value)) {
+      break;
+    }
+    const char *file = pick_path(w);
+    GDALDatasetH ds = timed_open(file, stats);
+    if (!ds) {
+      fprintf(stderr, "Error: Failed to open dataset '%s'\n", file);
+      return 0;
+    }
+    pixel_value = read_pixel_bands_from_dataset(
+        ds, NULL, random_x, random_y, &cfg->bands, &w->overview,
+        w->band_values, &is_nodata, &nodata_value, stats);
+    timed_close(ds, stats);
+    break;
+  }
+
+  case MODE_CATALOG: {
+    int matches[CATALOG_MAX_MATCHES];
+    uint64_t t0 = phase_begin(PHASE_INDEX);
+    int found = catalog_query_point(cfg->catalog, random_x, random_y, matches,
+                                    CATALOG_MAX_MATCHES);
+    phase_record(stats, PHASE_INDEX, t0);
+    w->index_lookups++;
+    w->index_matches += found;
+    if (found == 0) {
+      // Not covered by any file
+      w->index_misses++;
+      is_nodata = 1;
+      break;
+    }
+    // Like the mosaic VRT, the last file in catalog order wins
+    int entry = matches[0];
+    for (int m = 1; m < found && m < CATALOG_MAX_MATCHES; m++) {
+      if (matches[m] > entry) {
+        entry = matches[m];
+      }
+    }
+    const char *file = cfg->catalog->entries[entry].path;
+    t0 = phase_begin(PHASE_OPEN);
+    GDALDatasetH ds = dataset_pool_get(&w->pool, file);
+    phase_record(stats, PHASE_OPEN, t0);
+    if (!ds) {
+      fprintf(stderr, "Error: Failed to open dataset '%s'\n", file);
+      return 0;
+    }
+    pixel_value = read_pixel_from_dataset(ds, NULL, random_x, random_y,
+                                          &is_nodata, &nodata_value, stats);
+    break;
+  }
+
+  case MODE_CATALOG_VRT:
+    pixel_value =
+        read_pixel_from_dataset(w->reused_vrt_ds, &w->reused_vrt_geo, random_x,
+                                random_y, &is_nodata, &nodata_value, stats);
+    break;
+
+  case MODE_DIRECT_POOLED: {
+    // The open phase covers the pool lookup plus GDALOpen and the eviction
+    // of the least recently used dataset on a miss.
+    const char *file = pick_path(w);
+    uint64_t t0 = phase_begin(PHASE_OPEN);
+    GDALDatasetH ds = dataset_pool_get(&w->pool, file);
+    phase_record(stats, PHASE_OPEN, t0);
+    if (!ds) {
+      fprintf(stderr, "Error: Failed to open dataset '%s'\n", file);
+      return 0;
+    }
+    pixel_value = read_pixel_bands_from_dataset(
+        ds, NULL, random_x, random_y, &cfg->bands, &w->overview,
+        w->band_values, &is_nodata, &nodata_value, stats);
+    break;
+  }
+
+  case MODE_DIRECT_REUSE_DS:
+    if (occupancy_skips(w, random_x, random_y, &pixel_value, &is_nodata,
+                        &nodata_value)) {
+      break;
+    }
+    if (cfg->native_type) {
+      pixel_value = read_pixel_native(
+          &w->reused_geo, GDALGetRasterBand(w->reused_ds, cfg->bands.list[0]),
+          &w->native, random_x, random_y, &is_nodata, &nodata_value, stats);
+      break;
+    }
+    pixel_value = read_pixel_bands_from_dataset(
+        w->reused_ds, &w->reused_geo, random_x, random_y, &cfg->bands,
+        &w->overview, w->band_values, &is_nodata, &nodata_value, stats);
+    break;
+
+  case MODE_DIRECT_REUSE_BAND:
+    if (occupancy_skips(w, random_x, random_y, &pixel_value, &is_nodata,
+                        &nodata_value)) {
+      break;
+    }
+    pixel_value =
+        read_pixel_from_band(w->reused_band, &w->reused_geo, random_x, random_y,
+                             &is_nodata, &nodata_value, cfg->tile_cache,
+                             w->reused_dataset_id, stats);
+    break;
+
+  case MODE_DIRECT_WINDOW:
+    if (!read_window_stats(w, random_x, random_y, &window, &nodata_value,
+                           stats)) {
+      return 0;
+    }
+    // The window mean stands in for the pixel value
+    is_nodata = window.count == 0;
+    pixel_value = is_nodata ? 0.0f : (float)(window.sum / window.count);
+    break;
+
+  case MODE_DIRECT_BANDS:
+    if (!read_band_window(w, random_x, random_y, &is_nodata, &nodata_value,
+                          stats)) {
+      return 0;
+    }
+    pixel_value = w->band_values[0];
+    break;
+
+  case MODE_RAW_TILE:
+    if (occupancy_skips(w, random_x, random_y, &pixel_value, &is_nodata,
+                        &nodata_value)) {
+      // Nothing for --raw-tile-verify to check
+      w->raw_tile_x = -1;
+      break;
+    }
+    if (!read_pixel_raw_tile(&w->raw_tile, &w->native, random_x, random_y,
+                             &w->raw_tile_x, &w->raw_tile_y, &pixel_value,
+                             &is_nodata, &nodata_value, stats)) {
+      return 0;
+    }
+    break;
+
+  case MODE_MMAP_CACHE: {
+    const MmapStore *store = cfg->mmap_store;
+    int pixel_x, pixel_y;
+    uint64_t t0 = phase_begin(PHASE_GEO_TO_PIXEL);
+    geo_context_to_pixel(&store->geo, random_x, random_y, &pixel_x, &pixel_y);
+    phase_record(stats, PHASE_GEO_TO_PIXEL, t0);
+    if (pixel_x < 0 || pixel_y < 0 || pixel_x >= store->geo.raster_x ||
+        pixel_y >= store->geo.raster_y) {
+      // Outside the window
+      is_nodata = 1;
+      nodata_value = make_nan();
+      break;
+    }
+    t0 = phase_begin(PHASE_MMAP_READ);
+    pixel_value = mmap_store_read_pixel(store, pixel_x, pixel_y);
+    phase_record(stats, PHASE_MMAP_READ, t0);
+    is_nodata = store->has_nodata && pixel_value == (float)store->nodata;
+    nodata_value = store->has_nodata ? store->nodata : make_nan();
+    break;
+  }
+
+  case MODE_VRT_API: {
+    GDALDatasetH source_ds = timed_open(path, stats);
+    if (!source_ds) {
+      fprintf(stderr, "Error: Failed to open source dataset '%s'\n", path);
+      return 0;
+    }
+    uint64_t t0 = phase_begin(PHASE_VRT_BUILD);
+    OverviewLevel ov;
+    select_overview(cfg, source_ds, &ov);
+    GDALDatasetH vrt_ds =
+        create_vrt_api(path, source_ds, &bbox, &cfg->bands, &ov);
+    phase_record(stats, PHASE_VRT_BUILD, t0);
+    if (!vrt_ds) {
+      fprintf(stderr, "Error: Failed to create VRT dataset\n");
+      GDALClose(source_ds);
+      return 0;
+    }
+    pixel_value = read_pixel_bands_from_dataset(
+        vrt_ds, NULL, random_x, random_y, &cfg->vrt_bands, NULL,
+        w->band_values, &is_nodata, &nodata_value, stats);
+    t0 = phase_begin(PHASE_CLOSE);
+    GDALClose(vrt_ds);
+    GDALClose(source_ds);
+    phase_record(stats, PHASE_CLOSE, t0);
+    break;
+  }
+
+  case MODE_VRT_XML: {
+    GDALDatasetH source_ds = timed_open(path, stats);
+    if (!source_ds) {
+      fprintf(stderr, "Error: Failed to open source dataset '%s'\n", path);
+      return 0;
+    }
+    // The VRT build phase covers generating the XML, opening it and
+    // patching the nodata value.
+    uint64_t t0 = phase_begin(PHASE_VRT_BUILD);
+    OverviewLevel ov;
+    select_overview(cfg, source_ds, &ov);
+    char *vrt_xml = create_vrt_xml(path, source_ds, &bbox, &cfg->bands, &ov);
+    GDALDatasetH vrt_ds = vrt_xml ? GDALOpen(vrt_xml, GA_ReadOnly) : NULL;
+    free(vrt_xml);
+    if (!vrt_ds) {
+      fprintf(stderr, "Error: Failed to create VRT dataset\n");
+      GDALClose(source_ds);
+      return 0;
+    }
+    // Ensure band nodata is recognized in VRT XML mode
+    for (int b = 0; b < cfg->bands.count; b++) {
+      GDALRasterBandH vrt_band = GDALGetRasterBand(vrt_ds, b + 1);
+      int has_nodata = FALSE;
+      GDALRasterBandH src_band =
+          GDALGetRasterBand(source_ds, cfg->bands.list[b]);
+      double nodata = GDALGetRasterNoDataValue(src_band, &has_nodata);
+      if (has_nodata) {
+        GDALSetRasterNoDataValue(vrt_band, nodata);
+      }
+    }
+    phase_record(stats, PHASE_VRT_BUILD, t0);
+    pixel_value = read_pixel_bands_from_dataset(
+        vrt_ds, NULL, random_x, random_y, &cfg->vrt_bands, NULL,
+        w->band_values, &is_nodata, &nodata_value, stats);
+    t0 = phase_begin(PHASE_CLOSE);
+    GDALClose(vrt_ds);
+    GDALClose(source_ds);
+    phase_record(stats, PHASE_CLOSE, t0);
+    break;
+  }
+
+  case MODE_VRT_TILE: {
+    int pixel_x, pixel_y;
+    geo_context_to_pixel(&w->vrt_tile_geo, random_x, random_y, &pixel_x,
+                         &pixel_y);
+    if (pixel_x < 0 || pixel_y < 0 ||
+        pixel_x >= w->vrt_tile_geo.raster_x ||
+        pixel_y >= w->vrt_tile_geo.raster_y) {
+      // Outside every tile
+      is_nodata = 1;
+      break;
+    }
+    int tile_x = pixel_x / w->vrt_tile_width;
+    int tile_y = pixel_y / w->vrt_tile_height;
+    const char *key = CPLSPrintf("%d,%d", tile_x, tile_y);
+    GDALDatasetH vrt_ds = dataset_pool_lookup(&w->vrt_tiles, key);
+    if (!vrt_ds) {
+      uint64_t t0 = phase_begin(PHASE_VRT_BUILD);
+      vrt_ds = create_tile_vrt(w->reused_vrt_source, w->vrt_tile_width,
+                               w->vrt_tile_height, tile_x, tile_y,
+                               &cfg->bands, &w->vrt_tile_overview);
+      phase_record(stats, PHASE_VRT_BUILD, t0);
+      if (!vrt_ds) {
+        fprintf(stderr, "Error: Failed to create VRT dataset\n");
+        return 0;
+      }
+      if (!dataset_pool_insert(&w->vrt_tiles, key, vrt_ds)) {
+        fprintf(stderr, "Error: Out of memory caching tile VRT\n");
+        GDALClose(vrt_ds);
+        return 0;
+      }
+    }
+    pixel_value = read_pixel_bands_from_dataset(
+        vrt_ds, NULL, random_x, random_y, &cfg->vrt_bands, NULL,
+        w->band_values, &is_nodata, &nodata_value, stats);
+    break;
+  }
+
+  case MODE_VRT_XML_CACHED: {
+    // Only parses the cached document; the VRT opens the source itself
+    // when first read, inside the rasterio phase
+    uint64_t t0 = phase_begin(PHASE_VRT_BUILD);
+    GDALDatasetH vrt_ds = GDALOpen(w->vrt_template_path, GA_ReadOnly);
+    phase_record(stats, PHASE_VRT_BUILD, t0);
+    if (!vrt_ds) {
+      fprintf(stderr, "Error: Failed to open VRT template\n");
+      return 0;
+    }
+    pixel_value = read_pixel_bands_from_dataset(
+        vrt_ds, NULL, random_x, random_y, &cfg->vrt_bands, NULL,
+        w->band_values, &is_nodata, &nodata_value, stats);
+    timed_close(vrt_ds, stats);
+    break;
+  }
+
+  case MODE_VRT_API_REUSE_DATASET:
+    pixel_value = read_pixel_bands_from_dataset(
+        w->reused_vrt_ds, &w->reused_vrt_geo, random_x, random_y,
+        &cfg->vrt_bands, NULL, w->band_values, &is_nodata, &nodata_value,
+        stats);
+    break;
+
+  case MODE_VRT_API_REUSE_SOURCE: {
+    if (!w->reused_vrt_source) {
+      w->reused_vrt_source = timed_open(path, stats);
+      if (!w->reused_vrt_source) {
+        fprintf(stderr, "Error: Failed to open source dataset '%s'\n", path);
+        return 0;
+      }
+    }
+    uint64_t t0 = phase_begin(PHASE_VRT_BUILD);
+    OverviewLevel ov;
+    select_overview(cfg, w->reused_vrt_source, &ov);
+    GDALDatasetH vrt_ds =
+        create_vrt_api(path, w->reused_vrt_source, &bbox, &cfg->bands, &ov);
+    phase_record(stats, PHASE_VRT_BUILD, t0);
+    if (!vrt_ds) {
+      fprintf(stderr, "Error: Failed to create VRT dataset\n");
+      return 0;
+    }
+    pixel_value = read_pixel_bands_from_dataset(
+        vrt_ds, NULL, random_x, random_y, &cfg->vrt_bands, NULL,
+        w->band_values, &is_nodata, &nodata_value, stats);
+    timed_close(vrt_ds, stats);
+    break;
+  }
+
+  case MODE_DIRECT_BATCHED_BLOCKS:
+  case MODE_DIRECT_PIPELINED:
+    // These modes run whole batches in worker_run_batch and
+    // worker_run_pipelined, never one query at a time
+    fprintf(stderr, "Error: Mode '%s' cannot run one iteration at a time\n",
+            cfg->mode_name);
+    return 0;
+
+  case MODE_INVALID:
+    // This should never happen as we check for MODE_INVALID before running
+    fprintf(stderr, "Error: Invalid mode\n");
+    return 0;
+  }
+
+  phase_record(stats, PHASE_ITERATION, iteration_start);
+  // Outside the iteration phase, though not outside the run's elapsed time
+  if (cfg->mode == MODE_RAW_TILE && cfg->raw_tile_verify &&
+      !verify_raw_tile_read(w)) {
+    return 0;
+  }
+
+  // Optionally print pixel value
+  if (cfg->print_pixels) {
+    if (is_nodata) {
+      print_nodata_pixel(i + 1, random_x, random_y, pixel_value, nodata_value);
+    }
+    printf("Iteration %d: pixel value at (%.2f, %.2f) = %.2f\n", i + 1,
+           random_x, random_y, pixel_value);
+    if (cfg->mode == MODE_DIRECT_WINDOW) {
+      printf("Iteration %d: window count %lld, mean %.2f, min %.2f, max "
+             "%.2f\n",
+             i + 1, window.count, pixel_value, (double)window.min,
+             (double)window.max);
+    }
+    if (cfg->bands.count > 1) {
+      printf("Iteration %d: bands", i + 1);
+      for (int b = 0; b < cfg->bands.count; b++) {
+        printf(" %d=%.2f", cfg->bands.list[b], (double)w->band_values[b]);
+      }
+      printf("\n");
+    }
+    VsiCountStats io_end, io;
+    vsi_count_thread_stats(&io_end);
+    vsi_count_stats_sub(&io, &io_end, &io_start);
+    if (vsi_count_stats_any(&io)) {
+      printf("Iteration %d I/O: %lld opens, %lld reads, %lld bytes, %lld "
+             "seeks, %lld stats, %lld dir reads\n",
+             i + 1, io.opens, io.reads, io.bytes_read, io.seeks, io.stats,
+             io.dir_reads);
+    }
+  } else {
+    (void)pixel_value; // Suppress unused variable warning when not printing
+  }
+  return 1;
+}
+
+// Runs all queries as a pipeline. The producer stays up to cfg->lookahead
+// queries ahead of the consumer and hands the block of every point it
+// generates to the prefetch pool, so that by the time the consumer reaches
+// the point the block is usually already in the tile cache. Consumer misses
+// are block reads, or waits for a prefetch in flight, that the prefetch did
+// not hide. Returns 0 on a fatal error.
+static int worker_run_pipelined(Worker *w) {
+  const BenchConfig *cfg = w->config;
+  PhaseStats *stats = w->stats;
+  const int depth = cfg->lookahead;
+  int block_width, block_height;
+  GDALGetBlockSize(w->reused_band, &block_width, &block_height);
+  int has_nodata = FALSE;
+  double nodata = GDALGetRasterNoDataValue(w->reused_band, &has_nodata);
+
+  int produced = 0;
+  for (int i = 0; i < cfg->iterations; i++) {
+    uint64_t t0 = phase_begin(PHASE_GEO_TO_PIXEL);
+    while (produced < cfg->iterations && produced - i < depth) {
+      int slot = produced % depth;
+      random_point(w, &w->pipe_x[slot], &w->pipe_y[slot]);
+      int px, py;
+      geo_context_to_pixel(&w->reused_geo, w->pipe_x[slot], w->pipe_y[slot],
+                           &px, &py);
+      w->pipe_pixel_x[slot] = px;
+      w->pipe_pixel_y[slot] = py;
+      w->pipe_in_bounds[slot] = px >= 0 && py >= 0 &&
+                                px < w->reused_geo.raster_x &&
+                                py < w->reused_geo.raster_y;
+      if (w->pipe_in_bounds[slot]) {
+        prefetch_pool_submit(&w->prefetch, px / block_width,
+                             py / block_height);
+      }
+      produced++;
+    }
+    phase_record(stats, PHASE_GEO_TO_PIXEL, t0);
+
+    uint64_t iteration_start = phase_begin(PHASE_ITERATION);
+    int slot = i % depth;
+    float pixel_value = 0.0f;
+    int is_nodata = 0;
+    double nodata_value = has_nodata ? nodata : make_nan();
+    if (w->pipe_in_bounds[slot]) {
+      int hit = 0;
+      t0 = phase_begin(PHASE_TILE_CACHE);
+      if (!tile_cache_read_pixel(cfg->tile_cache, w->reused_dataset_id,
+                                 w->reused_band, w->pipe_pixel_x[slot],
+                                 w->pipe_pixel_y[slot], &pixel_value, &hit)) {
+        fprintf(stderr, "Error reading pixel at (%d, %d)\n",
+                w->pipe_pixel_x[slot], w->pipe_pixel_y[slot]);
+        return 0;
+      }
+      uint64_t elapsed = monotonic_ns() - t0;
+      phase_record(stats, PHASE_TILE_CACHE, t0);
+      if (!hit) {
+        w->stall_count++;
+        w->stall_ns += elapsed;
+      }
+      is_nodata = has_nodata && pixel_value == (float)nodata;
+    } else {
+      // Outside dataset bounds
+      is_nodata = 1;
+      nodata_value = make_nan();
+    }
+    phase_record(stats, PHASE_ITERATION, iteration_start);
+
+    if (cfg->print_pixels) {
+      if (is_nodata) {
+        print_nodata_pixel(i + 1, w->pipe_x[slot], w->pipe_y[slot],
+                           pixel_value, nodata_value);
+      }
+      printf("Iteration %d: pixel value at (%.2f, %.2f) = %.2f\n", i + 1,
+             w->pipe_x[slot], w->pipe_y[slot], pixel_value);
+    }
+  }
+  return 1;
+}
+
+// Seconds after the start of the run at which trace query k is due.
+static double replay_offset(const BenchConfig *cfg, int k) {
+  if (cfg->replay_rate > 0.0) {
+    return k / cfg->replay_rate;
+  }
+  return cfg->replay->queries[k].t / cfg->replay_speed;
+}
+
+// Open loop: worker w sends trace queries w, w + threads, ... each at its
+// scheduled time, or at once if it is already late. Response time is taken
+// from the schedule, so time spent waiting behind a slow query is counted
+// instead of silently stretching the gap to the next one.
+static int worker_run_replay(Worker *w) {
+  const BenchConfig *cfg = w->config;
+  for (int k = w->index; k < cfg->replay->count; k += w->thread_count) {
+    uint64_t scheduled =
+        w->run_start_ns + (uint64_t)(replay_offset(cfg, k) * 1e9);
+    if (monotonic_ns() + REPLAY_SPIN_NS < scheduled) {
+      uint64_t wake = scheduled - REPLAY_SPIN_NS;
+      struct timespec ts;
+      ts.tv_sec = (time_t)(wake / 1000000000ull);
+      ts.tv_nsec = (long)(wake % 1000000000ull);
+      while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) ==
+             EINTR) {
+      }
+    }
+    while (monotonic_ns() < scheduled) {
+    }
+    w->replay_query = &cfg->replay->queries[k];
+    if (!worker_run_iteration(w, k)) {
+      return 0;
+    }
+    // Starts at the due time rather than at a phase_begin, so only its
+    // phase_end probe fires
+    phase_record(w->stats, PHASE_RESPONSE, scheduled);
+  }
+  return 1;
+}
+
+static void *worker_thread_main(void *arg) {
+  WorkerThread *t = (WorkerThread *)arg;
+  Worker *w = &t->worker;
+  StartGate *gate = t->gate;
+
+  uint64_t setup_start = monotonic_ns();
+  w->ok = worker_open(w);
+  w->setup_seconds = (double)(monotonic_ns() - setup_start) / 1e9;
+
+  pthread_mutex_lock(&gate->mutex);
+  gate->ready++;
+  pthread_cond_broadcast(&gate->cond);
+  while (!gate->go) {
+    pthread_cond_wait(&gate->cond, &gate->mutex);
+  }
+  w->run_start_ns = gate->start_ns;
+  pthread_mutex_unlock(&gate->mutex);
+
+  const BenchConfig *cfg = w->config;
+  if (w->ok && cfg->replay) {
+    w->ok = worker_run_replay(w);
+  } else if (w->ok && cfg->mode == MODE_DIRECT_PIPELINED) {
+    w->ok = worker_run_pipelined(w);
+  }
+  for (int i = 0; w->ok && !cfg->replay &&
+                  cfg->mode != MODE_DIRECT_PIPELINED && i < cfg->iterations;) {
+    if (cfg->mode == MODE_DIRECT_BATCHED_BLOCKS) {
+      int count = cfg->iterations - i;
+      if (count > cfg->batch_size) {
+        count = cfg->batch_size;
+      }
+      w->ok = worker_run_batch(w, i, count);
+      i += count;
+    } else {
+      w->ok = worker_run_iteration(w, i);
+      i++;
+    }
+  }
+
+  w->gdal_cache_used = GDALGetCacheUsed64();
+  w->blocks_touched = (long long)w->blocks_seen.count;
+  worker_close(w);
+  return NULL;
+}
+
+// Bytes allocated by malloc and not yet freed, or -1 if the C library does
+// not say.
+static long long heap_bytes_in_use(void) {
+#if defined(HAVE_MALLINFO2)
+  struct mallinfo2 info = mallinfo2();
+  return (long long)(info.uordblks + info.hblkhd);
+#elif defined(__APPLE__)
+  return (long long)mstats().bytes_used;
+#else
+  return -1;
+#endif
+}
+
+// Estimates the heap one cached tile VRT holds by building
+// VRT_TILE_MEMORY_SAMPLES of them on this thread before the workers start.
+// Returns -1 if the heap cannot be measured or the source cannot be opened.
+static double estimate_vrt_tile_bytes(const BenchConfig *cfg) {
+  if (heap_bytes_in_use() < 0) {
+    return -1.0;
+  }
+  GDALDatasetH source_ds = GDALOpen(cfg->path, GA_ReadOnly);
+  if (!source_ds) {
+    return -1.0;
+  }
+  int tile_width, tile_height;
+  vrt_tile_size(source_ds, cfg->vrt_tile_blocks, &tile_width, &tile_height);
+  int tiles_x = (GDALGetRasterXSize(source_ds) + tile_width - 1) / tile_width;
+  int tiles_y =
+      (GDALGetRasterYSize(source_ds) + tile_height - 1) / tile_height;
+  OverviewLevel ov;
+  select_overview(cfg, source_ds, &ov);
+  // The first VRT also pays for one-off driver and band state
+  GDALDatasetH warmup = create_tile_vrt(source_ds, tile_width, tile_height, 0,
+                                        0, &cfg->bands, &ov);
+  if (warmup) {
+    GDALClose(warmup);
+  }
+
+  GDALDatasetH vrts[VRT_TILE_MEMORY_SAMPLES];
+  int built = 0;
+  long long before = heap_bytes_in_use();
+  for (int i = 0; i < VRT_TILE_MEMORY_SAMPLES; i++) {
+    int tile = i % (tiles_x * tiles_y);
+    vrts[built] = create_tile_vrt(source_ds, tile_width, tile_height,
+                                  tile % tiles_x, tile / tiles_x,
+                                  &cfg->bands, &ov);
+    if (vrts[built]) {
+      built++;
+    }
+  }
+  long long after = heap_bytes_in_use();
+  for (int i = 0; i < built; i++) {
+    GDALClose(vrts[i]);
+  }
+  GDALClose(source_ds);
+  return built > 0 ? (double)(after - before) / built : -1.0;
+}
+
+// Runs the configured mode on `threads` workers, each performing
+// cfg->iterations queries, and merges their phase histograms into result.
+// Returns 0 if any worker failed.
+static int run_workers(const BenchConfig *cfg, int threads,
+                       RunResult *result) {
+  WorkerThread *workers =
+      (WorkerThread *)calloc((size_t)threads, sizeof(WorkerThread));
+  pthread_t *tids = (pthread_t *)calloc((size_t)threads, sizeof(pthread_t));
+  if (!workers || !tids) {
+    fprintf(stderr, "Error: Out of memory allocating %d workers\n", threads);
+    free(workers);
+    free(tids);
+    return 0;
+  }
+
+  // Every run starts cold, like the datasets the workers open
+  if (cfg->tile_cache) {
+    tile_cache_clear(cfg->tile_cache);
+  }
+  double vrt_tile_bytes =
+      cfg->mode == MODE_VRT_TILE ? estimate_vrt_tile_bytes(cfg) : -1.0;
+  OverviewLevel overview;
+  overview.level = -1;
+  if (cfg->target_resolution > 0.0) {
+    path_overview(cfg, &overview);
+  }
+
+  StartGate gate;
+  pthread_mutex_init(&gate.mutex, NULL);
+  pthread_cond_init(&gate.cond, NULL);
+  gate.ready = 0;
+  gate.go = 0;
+
+  int started = 0;
+  for (int t = 0; t < threads; t++) {
+    workers[t].gate = &gate;
+    workers[t].worker.config = cfg;
+    workers[t].worker.index = t;
+    workers[t].worker.thread_count = threads;
+    // Stream 0 for worker 0, so a single-threaded run sees the same points
+    // whatever the thread count of the runs around it
+    query_stream_init(&workers[t].worker.query, cfg->dist, cfg->seed, t);
+    phase_stats_init(workers[t].worker.stats);
+    if (pthread_create(&tids[t], NULL, worker_thread_main, &workers[t]) != 0) {
+      fprintf(stderr, "Error: Failed to start worker thread %d\n", t);
+      break;
+    }
+    started++;
+  }
+
+  pthread_mutex_lock(&gate.mutex);
+  while (gate.ready < started) {
+    pthread_cond_wait(&gate.cond, &gate.mutex);
+  }
+  VsiCountStats io_start;
+  vsi_count_total_stats(&io_start);
+  VsiSimStats sim_start;
+  vsi_sim_total_stats(&sim_start);
+  USDT_PROBE2(run_begin, cfg->mode_name, threads);
+  uint64_t start_ns = monotonic_ns();
+  gate.start_ns = start_ns;
+  gate.go = 1;
+  pthread_cond_broadcast(&gate.cond);
+  pthread_mutex_unlock(&gate.mutex);
+
+  int ok = (started == threads);
+  memset(result, 0, sizeof(*result));
+  phase_stats_init(&result->stats);
+  for (int t = 0; t < started; t++) {
+    pthread_join(tids[t], NULL);
+    if (!workers[t].worker.ok) {
+      ok = 0;
+    }
+    phase_stats_merge(&result->stats, workers[t].worker.stats);
+    result->pool_hits += workers[t].worker.pool.hits;
+    result->pool_misses += workers[t].worker.pool.misses;
+    result->pool_evictions += workers[t].worker.pool.evictions;
+    result->index_lookups += workers[t].worker.index_lookups;
+    result->index_matches += workers[t].worker.index_matches;
+    result->index_misses += workers[t].worker.index_misses;
+    result->vrt_tile_hits += workers[t].worker.vrt_tiles.hits;
+    result->vrt_tile_misses += workers[t].worker.vrt_tiles.misses;
+    result->vrt_tile_evictions += workers[t].worker.vrt_tiles.evictions;
+    result->block_queries += workers[t].worker.block_queries;
+    result->block_repeats += workers[t].worker.block_repeats;
+    result->blocks_touched += workers[t].worker.blocks_touched;
+    if (workers[t].worker.setup_seconds > result->setup_seconds) {
+      result->setup_seconds = workers[t].worker.setup_seconds;
+    }
+    if (workers[t].worker.gdal_cache_used > result->gdal_cache_used) {
+      result->gdal_cache_used = workers[t].worker.gdal_cache_used;
+    }
+    const PrefetchPool *prefetch = &workers[t].worker.prefetch;
+    result->prefetch_submitted += prefetch->submitted;
+    result->prefetch_dropped += prefetch->dropped;
+    result->prefetch_blocks_read += prefetch->blocks_read;
+    result->prefetch_read_seconds += (double)prefetch->read_ns / 1e9;
+    result->stall_count += workers[t].worker.stall_count;
+    result->stall_seconds += (double)workers[t].worker.stall_ns / 1e9;
+    result->window_pixels += workers[t].worker.window_pixels;
+    result->band_pixels += workers[t].worker.band_pixels;
+    const RawTileReader *raw = &workers[t].worker.raw_tile;
+    result->raw_tile_blocks_fetched += raw->blocks_fetched;
+    result->raw_tile_bytes_fetched += raw->bytes_fetched;
+    result->raw_tile_blocks_decoded += raw->blocks_decoded;
+    result->raw_tile_verified += workers[t].worker.raw_tile_verified;
+    result->occupancy_skipped += workers[t].worker.occupancy_skipped;
+  }
+  result->elapsed_seconds = (double)(monotonic_ns() - start_ns) / 1e9;
+  USDT_PROBE2(run_end, cfg->mode_name, threads);
+  VsiCountStats io_end;
+  vsi_count_total_stats(&io_end);
+  vsi_count_stats_sub(&result->io, &io_end, &io_start);
+  VsiSimStats sim_end;
+  vsi_sim_total_stats(&sim_end);
+  vsi_sim_stats_sub(&result->sim, &sim_end, &sim_start);
+  result->mode_name = cfg->mode_name;
+  result->distribution =
+      cfg->replay ? "replay" : query_dist_name(cfg->dist->params.kind);
+  result->batch_size =
+      cfg->mode == MODE_DIRECT_BATCHED_BLOCKS ? cfg->batch_size : 1;
+  result->file_count = cfg->file_count;
+  result->threads = threads;
+  result->band_count = cfg->bands.count;
+  result->band_layout = band_layout_names[cfg->bands.layout];
+  result->target_resolution = cfg->target_resolution;
+  result->overview = overview;
+  result->native_type =
+      cfg->native_type
+          ? GDALGetDataTypeName(workers[0].worker.native.data_type)
+          : NULL;
+  if (cfg->mode == MODE_RAW_TILE && started > 0) {
+    const RawTileReader *raw = &workers[0].worker.raw_tile;
+    result->raw_tile_codec = raw_tile_codec_name(raw->codec);
+    result->raw_tile_predictor = raw->predictor;
+  }
+  if (cfg->occupancy) {
+    const TileOccupancy *occ = cfg->occupancy;
+    result->occupancy_enabled = 1;
+    result->occupancy_empty_blocks = tile_occupancy_empty_blocks(occ);
+    result->occupancy_blocks = (long long)occ->blocks_x * occ->blocks_y;
+  }
+  if (cfg->mode == MODE_VRT_TILE) {
+    result->vrt_tile_blocks = cfg->vrt_tile_blocks;
+    result->vrt_tile_width = workers[0].worker.vrt_tile_width;
+    result->vrt_tile_height = workers[0].worker.vrt_tile_height;
+    result->vrt_tile_bytes = vrt_tile_bytes;
+  }
+  result->queries = (long long)cfg->iterations * threads;
+  if (cfg->replay) {
+    result->queries = cfg->replay->count;
+    double span = replay_offset(cfg, cfg->replay->count - 1);
+    result->offered_rate = span > 0.0 ? (cfg->replay->count - 1) / span : 0.0;
+  }
+  if (cfg->tile_cache) {
+    result->tile_cache_enabled = 1;
+    tile_cache_get_stats(cfg->tile_cache, &result->tile_cache);
+  }
+
+  if (cfg->recorder && !cfg->recorder->done) {
+    int total = 0;
+    for (int t = 0; t < started; t++) {
+      total += workers[t].worker.recorded_count;
+    }
+    TraceQuery *all =
+        (TraceQuery *)malloc(sizeof(TraceQuery) * (size_t)(total ? total : 1));
+    if (all) {
+      int n = 0;
+      for (int t = 0; t < started; t++) {
+        memcpy(all + n, workers[t].worker.recorded,
+               sizeof(TraceQuery) * (size_t)workers[t].worker.recorded_count);
+        n += workers[t].worker.recorded_count;
+      }
+      if (trace_write(cfg->recorder->path, all, total, cfg->file_list)) {
+        printf("Recorded %d queries to '%s'\n", total, cfg->recorder->path);
+      } else {
+        ok = 0;
+      }
+      free(all);
+    } else {
+      fprintf(stderr, "Error: Out of memory writing trace\n");
+      ok = 0;
+    }
+    cfg->recorder->done = 1;
+  }
+  for (int t = 0; t < started; t++) {
+    free(workers[t].worker.recorded);
+  }
+
+  pthread_cond_destroy(&gate.cond);
+  pthread_mutex_destroy(&gate.mutex);
+  free(workers);
+  free(tids);
+  return ok;
+}
+
+static double run_qps(const RunResult *result) {
+  return result->elapsed_seconds > 0.0
+             ? result->queries / result->elapsed_seconds
+             : 0.0;
+}
+
+static void print_phase_table(const PhaseStats *stats) {
+  printf("%-13s %10s %10s %10s %10s %10s %10s %10s\n", "phase (us)", "count",
+         "mean", "p50", "p90", "p99", "p99.9", "max");
+  for (int p = 0; p < PHASE_COUNT; p++) {
+    const LatencyHistogram *h = &stats->hist[p];
+    if (h->total_count == 0) {
+      continue;
+    }
+    printf("%-13s %10llu %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+           phase_names[p], (unsigned long long)h->total_count,
+           latency_histogram_mean(h) / 1000.0,
+           (double)latency_histogram_percentile(h, 0.50) / 1000.0,
+           (double)latency_histogram_percentile(h, 0.90) / 1000.0,
+           (double)latency_histogram_percentile(h, 0.99) / 1000.0,
+           (double)latency_histogram_percentile(h, 0.999) / 1000.0,
+           (double)h->max_ns / 1000.0);
+  }
+}
+
+static double tile_cache_hit_rate(const TileCacheStats *stats) {
+  long long lookups = stats->hits + stats->misses;
+  return lookups ? (double)stats->hits / lookups * 100.0 : 0.0;
+}
+
+static double block_reuse_rate(const RunResult *result) {
+  return result->block_queries
+             ? (double)result->block_repeats / result->block_queries * 100.0
+             : 0.0;
+}
+
+static double pool_hit_rate(const RunResult *result) {
+  long long lookups = result->pool_hits + result->pool_misses;
+  return lookups ? (double)result->pool_hits / lookups * 100.0 : 0.0;
+}
+
+static double vrt_tile_hit_rate(const RunResult *result) {
+  long long lookups = result->vrt_tile_hits + result->vrt_tile_misses;
+  return lookups ? (double)result->vrt_tile_hits / lookups * 100.0 : 0.0;
+}
+
+// Prints the phase table followed by the counters the mode maintains.
+static void print_run_details(const RunResult *result) {
+  printf("Setup (slowest worker): %.3f seconds\n", result->setup_seconds);
+  print_phase_table(&result->stats);
+  if (result->index_lookups > 0) {
+    printf("Catalog index: %lld lookups, %.2f files per point, %lld points "
+           "outside every file\n",
+           result->index_lookups,
+           (double)result->index_matches / result->index_lookups,
+           result->index_misses);
+  }
+  if (result->pool_hits + result->pool_misses > 0) {
+    printf("Dataset pool: %lld hits, %lld misses, %lld evictions "
+           "(%.1f%% hit rate)\n",
+           result->pool_hits, result->pool_misses, result->pool_evictions,
+           pool_hit_rate(result));
+  }
+  if (result->vrt_tile_blocks > 0) {
+    printf("VRT tiles: %d blocks (%dx%d pixels), %lld hits, %lld misses, "
+           "%lld evictions (%.1f%% hit rate)",
+           result->vrt_tile_blocks, result->vrt_tile_width,
+           result->vrt_tile_height, result->vrt_tile_hits,
+           result->vrt_tile_misses, result->vrt_tile_evictions,
+           vrt_tile_hit_rate(result));
+    if (result->vrt_tile_bytes >= 0.0) {
+      printf(", %.1f KiB heap per cached VRT",
+             result->vrt_tile_bytes / 1024.0);
+    }
+    printf("\n");
+  }
+  if (result->window_pixels > 0) {
+    const LatencyHistogram *h = &result->stats.hist[PHASE_REDUCE];
+    double reduce_seconds =
+        latency_histogram_mean(h) * (double)h->total_count / 1e9;
+    printf("Window reads: %lld pixels reduced, %.1f Mpixels/s overall, "
+           "%.1f Mpixels/s in the reduce phase\n",
+           result->window_pixels,
+           result->elapsed_seconds > 0.0
+               ? result->window_pixels / result->elapsed_seconds / 1e6
+               : 0.0,
+           reduce_seconds > 0.0
+               ? result->window_pixels / reduce_seconds / 1e6
+               : 0.0);
+  }
+  if (result->band_pixels > 0) {
+    printf("Band reads: %d bands (%s), %lld band pixels, %.1f Mpixels/s\n",
+           result->band_count, result->band_layout, result->band_pixels,
+           result->elapsed_seconds > 0.0
+               ? result->band_pixels / result->elapsed_seconds / 1e6
+               : 0.0);
+  }
+  if (result->native_type) {
+    printf("Native reads: %s pixels, nodata compared in that type\n",
+           result->native_type);
+  }
+  if (result->raw_tile_codec) {
+    double q = result->queries > 0 ? (double)result->queries : 1.0;
+    printf("Raw tiles: %s, predictor %d, %lld blocks decoded (%.2f per "
+           "query), %lld fetched, %lld compressed bytes\n",
+           result->raw_tile_codec, result->raw_tile_predictor,
+           result->raw_tile_blocks_decoded,
+           result->raw_tile_blocks_decoded / q,
+           result->raw_tile_blocks_fetched, result->raw_tile_bytes_fetched);
+    if (result->raw_tile_verified > 0) {
+      printf("Raw tiles: %lld reads match GDALRasterIO\n",
+             result->raw_tile_verified);
+    }
+  }
+  if (result->occupancy_enabled) {
+    printf("Occupancy: %lld of %lld blocks empty, %lld queries (%.1f%%) "
+           "answered without reading\n",
+           result->occupancy_empty_blocks, result->occupancy_blocks,
+           result->occupancy_skipped,
+           result->queries > 0
+               ? 100.0 * result->occupancy_skipped / result->queries
+               : 0.0);
+  }
+  if (result->target_resolution > 0.0) {
+    if (result->overview.level >= 0) {
+      printf("Overview: level %d (%dx%d pixels) for target resolution %g\n",
+             result->overview.level, result->overview.raster_x,
+             result->overview.raster_y, result->target_resolution);
+    } else {
+      printf("Overview: none within target resolution %g, reading full "
+             "resolution\n",
+             result->target_resolution);
+    }
+  }
+  if (result->tile_cache_enabled) {
+    const TileCacheStats *tc = &result->tile_cache;
+    printf("Tile cache: %lld hits, %lld misses (%lld waited for a read in "
+           "flight), %lld evictions (%.1f%% hit rate), %lld tiles, %.2f MiB "
+           "(peak %.2f MiB)\n",
+           tc->hits, tc->misses, tc->waits, tc->evictions,
+           tile_cache_hit_rate(tc), tc->tiles,
+           (double)tc->bytes / (1024.0 * 1024.0),
+           (double)tc->peak_bytes / (1024.0 * 1024.0));
+  }
+  printf("GDAL block cache in use: %.2f MiB\n",
+         (double)result->gdal_cache_used / (1024.0 * 1024.0));
+  if (result->offered_rate > 0.0) {
+    const LatencyHistogram *h = &result->stats.hist[PHASE_RESPONSE];
+    printf("Replay: offered %.1f queries/s, achieved %.1f queries/s, "
+           "response p50 %.2f us, p99 %.2f us\n",
+           result->offered_rate, run_qps(result),
+           (double)latency_histogram_percentile(h, 0.50) / 1000.0,
+           (double)latency_histogram_percentile(h, 0.99) / 1000.0);
+  }
+  if (result->block_queries > 0) {
+    // What a per-worker block cache that never evicts would hit
+    printf("Block reuse (%s): %.1f%% of %lld in-raster points fell in a "
+           "block the worker had touched, %lld distinct blocks\n",
+           result->distribution, block_reuse_rate(result),
+           result->block_queries, result->blocks_touched);
+  }
+  if (vsi_count_stats_any(&result->io)) {
+    const VsiCountStats *io = &result->io;
+    double q = result->queries > 0 ? (double)result->queries : 1.0;
+    printf("I/O (%s): %lld opens, %lld reads, %lld bytes, %lld seeks, %lld "
+           "stats, %lld dir reads\n",
+           VSI_COUNT_PREFIX, io->opens, io->reads, io->bytes_read, io->seeks,
+           io->stats, io->dir_reads);
+    printf("I/O per query: %.2f opens, %.2f reads, %.1f bytes, %.2f seeks, "
+           "%.2f stats, %.2f dir reads\n",
+           io->opens / q, io->reads / q, io->bytes_read / q, io->seeks / q,
+           io->stats / q, io->dir_reads / q);
+  }
+  if (result->prefetch_submitted > 0) {
+    double exposed = result->stall_seconds;
+    double hidden = result->prefetch_read_seconds;
+    printf("Pipeline: %lld prefetches queued (%lld dropped on a full queue), "
+           "%lld blocks read ahead in %.3f seconds\n",
+           result->prefetch_submitted, result->prefetch_dropped,
+           result->prefetch_blocks_read, hidden);
+    printf("Pipeline: reader stalled on %lld blocks for %.3f seconds; "
+           "%.1f%% of block read time hidden\n",
+           result->stall_count, exposed,
+           hidden + exposed > 0.0 ? hidden / (hidden + exposed) * 100.0
+                                  : 0.0);
+  }
+  if (result->sim.requests > 0) {
+    const VsiSimStats *sim = &result->sim;
+    double q = result->queries > 0 ? (double)result->queries : 1.0;
+    printf("Simulated remote (%s): %lld requests (%.2f per query), %lld "
+           "bytes fetched, %.3f seconds waited\n",
+           VSI_SIM_PREFIX, sim->requests, sim->requests / q,
+           sim->bytes_fetched, sim->wait_seconds);
+  }
+}
+
+static void write_json_string(FILE *out, const char *str) {
+  fputc('"', out);
+  for (const char *c = str; *c; c++) {
+    if (*c == '"' || *c == '\\') {
+      fputc('\\', out);
+      fputc(*c, out);
+    } else if ((unsigned char)*c < 0x20) {
+      fprintf(out, "\\u%04x", (unsigned char)*c);
+    } else {
+      fputc(*c, out);
+    }
+  }
+  fputc('"', out);
+}
+
+// Writes the configuration and per-run phase histograms so that runs can be
+// compared with standard JSON tooling.
+static int write_json_report(const char *json_path, const BenchConfig *cfg,
+                             const RunResult *results, int result_count) {
+  FILE *out = fopen(json_path, "w");
+  if (!out) {
+    fprintf(stderr, "Error: Failed to open '%s' for writing\n", json_path);
+    return 0;
+  }
+  fprintf(out, "{\n  \"path\": ");
+  write_json_string(out, cfg->path);
+  fprintf(out, ",\n  \"mode\": ");
+  write_json_string(out, cfg->mode_name);
+  fprintf(out,
+          ",\n  \"iterations\": %d,\n  \"seed\": %u,\n"
+          "  \"bbox\": [%.17g, %.17g, %.17g, %.17g],\n"
+          "  \"gdal_cache_max\": %lld,\n  \"runs\": [",
+          cfg->iterations, cfg->seed, cfg->bbox.xmin, cfg->bbox.ymin,
+          cfg->bbox.xmax, cfg->bbox.ymax, (long long)GDALGetCacheMax64());
+  for (int r = 0; r < result_count; r++) {
+    const RunResult *result = &results[r];
+    fprintf(out,
+            "%s\n    {\"mode\": \"%s\", \"distribution\": \"%s\", "
+            "\"batch_size\": %d, "
+            "\"files\": %d, \"threads\": %d, \"queries\": %lld, "
+            "\"elapsed_seconds\": %.6f, \"queries_per_second\": %.3f,\n"
+            "     \"offered_rate\": %.3f,\n"
+            "     \"setup_seconds\": %.6f,\n"
+            "     \"pool\": {\"hits\": %lld, \"misses\": %lld, "
+            "\"evictions\": %lld},\n"
+            "     \"index\": {\"lookups\": %lld, \"matches\": %lld, "
+            "\"misses\": %lld},\n"
+            "     \"gdal_cache_used\": %lld,\n"
+            "     \"block_reuse\": {\"queries\": %lld, \"repeats\": %lld, "
+            "\"distinct_blocks\": %lld},\n"
+            "     \"io\": {\"opens\": %lld, \"reads\": %lld, "
+            "\"bytes_read\": %lld, \"seeks\": %lld, \"stats\": %lld, "
+            "\"dir_reads\": %lld},\n"
+            "     \"sim\": {\"requests\": %lld, \"bytes_fetched\": %lld, "
+            "\"wait_seconds\": %.6f},\n"
+            "     \"pipeline\": {\"prefetches\": %lld, \"dropped\": %lld, "
+            "\"blocks_read\": %lld, \"read_seconds\": %.6f, "
+            "\"stalls\": %lld, \"stall_seconds\": %.6f},\n",
+            r ? "," : "", result->mode_name, result->distribution,
+            result->batch_size,
+            result->file_count, result->threads, result->queries,
+            result->elapsed_seconds, run_qps(result), result->offered_rate,
+            result->setup_seconds,
+            result->pool_hits, result->pool_misses, result->pool_evictions,
+            result->index_lookups, result->index_matches,
+            result->index_misses, result->gdal_cache_used,
+            result->block_queries, result->block_repeats,
+            result->blocks_touched, result->io.opens,
+            result->io.reads, result->io.bytes_read, result->io.seeks,
+            result->io.stats, result->io.dir_reads, result->sim.requests,
+            result->sim.bytes_fetched, result->sim.wait_seconds,
+            result->prefetch_submitted, result->prefetch_dropped,
+            result->prefetch_blocks_read, result->prefetch_read_seconds,
+            result->stall_count, result->stall_seconds);
+    if (result->tile_cache_enabled) {
+      const TileCacheStats *tc = &result->tile_cache;
+      fprintf(out,
+              "     \"tile_cache\": {\"hits\": %lld, \"misses\": %lld, "
+              "\"waits\": %lld, \"evictions\": %lld, \"tiles\": %lld, "
+              "\"bytes\": %llu, \"peak_bytes\": %llu},\n",
+              tc->hits, tc->misses, tc->waits, tc->evictions, tc->tiles,
+              (unsigned long long)tc->bytes,
+              (unsigned long long)tc->peak_bytes);
+    }
+    if (result->vrt_tile_blocks > 0) {
+      fprintf(out,
+              "     \"vrt_tiles\": {\"blocks\": %d, \"width\": %d, "
+              "\"height\": %d, \"hits\": %lld, \"misses\": %lld, "
+              "\"evictions\": %lld, \"bytes_per_vrt\": %.0f},\n",
+              result->vrt_tile_blocks, result->vrt_tile_width,
+              result->vrt_tile_height, result->vrt_tile_hits,
+              result->vrt_tile_misses, result->vrt_tile_evictions,
+              result->vrt_tile_bytes);
+    }
+    if (result->window_pixels > 0) {
+      fprintf(out, "     \"window_pixels\": %lld,\n", result->window_pixels);
+    }
+    if (result->band_count > 1 || result->band_pixels > 0) {
+      fprintf(out,
+              "     \"bands\": {\"count\": %d, \"layout\": \"%s\", "
+              "\"pixels\": %lld},\n",
+              result->band_count, result->band_layout, result->band_pixels);
+    }
+    if (result->native_type) {
+      fprintf(out, "     \"native_type\": \"%s\",\n", result->native_type);
+    }
+    if (result->raw_tile_codec) {
+      fprintf(out,
+              "     \"raw_tile\": {\"codec\": \"%s\", \"predictor\": %d, "
+              "\"blocks_decoded\": %lld, \"blocks_fetched\": %lld, "
+              "\"bytes_fetched\": %lld, \"verified\": %lld},\n",
+              result->raw_tile_codec, result->raw_tile_predictor,
+              result->raw_tile_blocks_decoded,
+              result->raw_tile_blocks_fetched, result->raw_tile_bytes_fetched,
+              result->raw_tile_verified);
+    }
+    if (result->occupancy_enabled) {
+      fprintf(out,
+              "     \"occupancy\": {\"empty_blocks\": %lld, \"blocks\": %lld, "
+              "\"skipped\": %lld},\n",
+              result->occupancy_empty_blocks, result->occupancy_blocks,
+              result->occupancy_skipped);
+    }
+    if (result->target_resolution > 0.0) {
+      fprintf(out,
+              "     \"overview\": {\"target_resolution\": %.17g, "
+              "\"level\": %d},\n",
+              result->target_resolution, result->overview.level);
+    }
+    fprintf(out, "     \"phases\": {");
+    int first = 1;
+    for (int p = 0; p < PHASE_COUNT; p++) {
+      if (result->stats.hist[p].total_count == 0) {
+        continue;
+      }
+      fprintf(out, "%s\n       \"%s\": ", first ? "" : ",", phase_names[p]);
+      latency_histogram_write_json(out, &result->stats.hist[p]);
+      first = 0;
+    }
+    fprintf(out, "}}");
+  }
+  fprintf(out, "\n  ]\n}\n");
+  return fclose(out) == 0;
+}
+
+// Appends one row per run to csv_path, writing the header first if the file
+// is new or empty, so that repeated invocations build a single table.
+static int write_csv_report(const char *csv_path, const RunResult *results,
+                            int result_count) {
+  FILE *out = fopen(csv_path, "a");
+  if (!out) {
+    fprintf(stderr, "Error: Failed to open '%s' for writing\n", csv_path);
+    return 0;
+  }
+  if (ftell(out) == 0) {
+    fprintf(out, "mode,distribution,threads,batch_size,files,queries,"
+                 "elapsed_seconds,queries_per_second,mean_us,p50_us,p90_us,"
+                 "p99_us,p999_us,max_us\n");
+  }
+  for (int r = 0; r < result_count; r++) {
+    const RunResult *result = &results[r];
+    const LatencyHistogram *h = &result->stats.hist[PHASE_ITERATION];
+    fprintf(out,
+            "%s,%s,%d,%d,%d,%lld,%.6f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+            result->mode_name, result->distribution, result->threads,
+            result->batch_size, result->file_count, result->queries,
+            result->elapsed_seconds, run_qps(result),
+            latency_histogram_mean(h) / 1000.0,
+            (double)latency_histogram_percentile(h, 0.50) / 1000.0,
+            (double)latency_histogram_percentile(h, 0.90) / 1000.0,
+            (double)latency_histogram_percentile(h, 0.99) / 1000.0,
+            (double)latency_histogram_percentile(h, 0.999) / 1000.0,
+            (double)h->max_ns / 1000.0);
+  }
+  return fclose(out) == 0;
+}
+
+// Runs the mode on one thread and, if threads > 1, again on `threads` threads
+// to report scaling efficiency.
+static int run_scaling(const BenchConfig *cfg, int threads,
+                       RunResult *results, int *result_count) {
+  if (!run_workers(cfg, 1, &results[0])) {
+    return 0;
+  }
+  (*result_count)++;
+  double single_qps = run_qps(&results[0]);
+
+  printf("Completed %lld iterations in %.3f seconds (%.3f ms per iteration, "
+         "%.1f queries/s)\n",
+         results[0].queries, results[0].elapsed_seconds,
+         (results[0].elapsed_seconds * 1000.0) / results[0].queries,
+         single_qps);
+  print_run_details(&results[0]);
+
+  if (threads > 1) {
+    RunResult *multi = &results[1];
+    if (!run_workers(cfg, threads, multi)) {
+      return 0;
+    }
+    (*result_count)++;
+    double qps = run_qps(multi);
+    double efficiency =
+        single_qps > 0.0 ? qps / (single_qps * threads) * 100.0 : 0.0;
+    printf("Completed %lld iterations on %d threads in %.3f seconds "
+           "(%.1f queries/s aggregate)\n",
+           multi->queries, threads, multi->elapsed_seconds, qps);
+    printf("Scaling efficiency vs 1 thread: %.1f%% (%.2fx speedup)\n",
+           efficiency, single_qps > 0.0 ? qps / single_qps : 0.0);
+    print_run_details(multi);
+  }
+  return 1;
+}
+
+// Compares per-point reads (direct_reuse_band) with direct_batched_blocks at
+// batch sizes from 1 to 100k.
+static int run_batch_sweep(const BenchConfig *cfg, int threads,
+                           RunResult *results, int *result_count) {
+  static const int batch_sizes[BATCH_SWEEP_COUNT] = {1,    10,    100,
+                                                     1000, 10000, 100000};
+
+  BenchConfig baseline = *cfg;
+  baseline.mode = MODE_DIRECT_REUSE_BAND;
+  baseline.mode_name = "direct_reuse_band";
+  printf("Per-point baseline (%s):\n", baseline.mode_name);
+  if (!run_workers(&baseline, threads, &results[0])) {
+    return 0;
+  }
+  (*result_count)++;
+  print_run_details(&results[0]);
+  double baseline_qps = run_qps(&results[0]);
+
+  for (int b = 0; b < BATCH_SWEEP_COUNT; b++) {
+    BenchConfig batched = *cfg;
+    batched.batch_size = batch_sizes[b];
+    printf("Batch size %d:\n", batched.batch_size);
+    if (!run_workers(&batched, threads, &results[*result_count])) {
+      return 0;
+    }
+    print_run_details(&results[*result_count]);
+    (*result_count)++;
+  }
+
+  printf("\n%-22s %10s %14s %10s\n", "mode", "batch", "queries/s",
+         "speedup");
+  for (int r = 0; r < *result_count; r++) {
+    double qps = run_qps(&results[r]);
+    printf("%-22s %10d %14.1f %9.2fx\n", results[r].mode_name,
+           results[r].batch_size, qps,
+           baseline_qps > 0.0 ? qps / baseline_qps : 0.0);
+  }
+  return 1;
+}
+
+// Compares direct (reopen on every query) and direct_reuse_ds (one dataset
+// kept open) with direct_pooled as the number of distinct files grows past
+// the pool size.
+static int run_pool_sweep(const BenchConfig *cfg, int threads,
+                          RunResult *results, int *result_count) {
+  static const double working_set_factors[POOL_SWEEP_COUNT] = {0.5, 1.0, 2.0,
+                                                               4.0, 8.0};
+
+  BenchConfig direct = *cfg;
+  direct.mode = MODE_DIRECT;
+  direct.mode_name = "direct";
+  printf("Baseline %s over %d files:\n", direct.mode_name, direct.file_count);
+  if (!run_workers(&direct, threads, &results[*result_count])) {
+    return 0;
+  }
+  print_run_details(&results[(*result_count)++]);
+  double direct_qps = run_qps(&results[0]);
+
+  BenchConfig reuse = *cfg;
+  reuse.mode = MODE_DIRECT_REUSE_DS;
+  reuse.mode_name = "direct_reuse_ds";
+  reuse.file_count = 0;
+  printf("Baseline %s on '%s':\n", reuse.mode_name, reuse.path);
+  if (!run_workers(&reuse, threads, &results[*result_count])) {
+    return 0;
+  }
+  print_run_details(&results[(*result_count)++]);
+
+  int previous_files = 0;
+  for (int f = 0; f < POOL_SWEEP_COUNT; f++) {
+    BenchConfig pooled = *cfg;
+    pooled.file_count = (int)ceil(cfg->pool_size * working_set_factors[f]);
+    if (pooled.file_count > cfg->file_count) {
+      pooled.file_count = cfg->file_count;
+    }
+    if (pooled.file_count == previous_files) {
+      continue;
+    }
+    previous_files = pooled.file_count;
+    printf("%s with %d files, pool size %d:\n", pooled.mode_name,
+           pooled.file_count, pooled.pool_size);
+    if (!run_workers(&pooled, threads, &results[*result_count])) {
+      return 0;
+    }
+    print_run_details(&results[(*result_count)++]);
+  }
+
+  printf("\n%-18s %8s %8s %14s %10s %10s\n", "mode", "files", "pool",
+         "queries/s", "hit rate", "speedup");
+  for (int r = 0; r < *result_count; r++) {
+    const RunResult *result = &results[r];
+    double qps = run_qps(result);
+    int pooled = result->pool_hits + result->pool_misses > 0;
+    printf("%-18s %8d %8d %14.1f %9.1f%% %9.2fx\n", result->mode_name,
+           result->file_count ? result->file_count : 1,
+           pooled ? cfg->pool_size : 0, qps,
+           pooled ? pool_hit_rate(result) : 0.0,
+           direct_qps > 0.0 ? qps / direct_qps : 0.0);
+  }
+  return 1;
+}
+
+// Runs the mode relying on GDAL's block cache alone, then again with the
+// tile cache in front of it, and compares throughput and cache memory.
+static int run_tile_cache_compare(const BenchConfig *cfg, int threads,
+                                  RunResult *results, int *result_count) {
+  BenchConfig gdal_only = *cfg;
+  gdal_only.tile_cache = NULL;
+  printf("GDAL block cache only (GDAL_CACHEMAX %.2f MiB):\n",
+         (double)GDALGetCacheMax64() / (1024.0 * 1024.0));
+  if (!run_workers(&gdal_only, threads, &results[*result_count])) {
+    return 0;
+  }
+  print_run_details(&results[(*result_count)++]);
+
+  printf("Tile cache (%.2f MiB over %d shards):\n",
+         (double)cfg->tile_cache->budget_bytes / (1024.0 * 1024.0),
+         cfg->tile_cache->shard_count);
+  if (!run_workers(cfg, threads, &results[*result_count])) {
+    return 0;
+  }
+  print_run_details(&results[(*result_count)++]);
+
+  double baseline_qps = run_qps(&results[0]);
+  printf("\n%-12s %14s %10s %16s %16s\n", "cache", "queries/s", "speedup",
+         "GDAL cache MiB", "tile cache MiB");
+  for (int r = 0; r < *result_count; r++) {
+    const RunResult *result = &results[r];
+    double qps = run_qps(result);
+    printf("%-12s %14.1f %9.2fx %16.2f %16.2f\n",
+           result->tile_cache_enabled ? "tile_cache" : "gdal_only", qps,
+           baseline_qps > 0.0 ? qps / baseline_qps : 0.0,
+           (double)result->gdal_cache_used / (1024.0 * 1024.0),
+           (double)result->tile_cache.peak_bytes / (1024.0 * 1024.0));
+  }
+  return 1;
+}
+
+static double phase_mean_us(const PhaseStats *stats, Phase phase) {
+  return latency_histogram_mean(&stats->hist[phase]) / 1000.0;
+}
+
+// Runs vrt_xml, then vrt_xml_cached, and splits the cost of a vrt_xml query
+// into the source open, the XML work the template saves, and the rest.
+static int run_vrt_xml_compare(const BenchConfig *cfg, int threads,
+                               RunResult *results, int *result_count) {
+  BenchConfig xml = *cfg;
+  xml.mode = MODE_VRT_XML;
+  xml.mode_name = "vrt_xml";
+  BenchConfig cached = *cfg;
+  cached.mode = MODE_VRT_XML_CACHED;
+  cached.mode_name = "vrt_xml_cached";
+  const BenchConfig *runs[2] = {&xml, &cached};
+  for (int r = 0; r < 2; r++) {
+    printf("%s:\n", runs[r]->mode_name);
+    if (!run_workers(runs[r], threads, &results[*result_count])) {
+      return 0;
+    }
+    print_run_details(&results[(*result_count)++]);
+  }
+
+  static const Phase columns[] = {PHASE_OPEN, PHASE_VRT_BUILD, PHASE_RASTERIO,
+                                  PHASE_CLOSE, PHASE_ITERATION};
+  int column_count = (int)(sizeof(columns) / sizeof(columns[0]));
+  double baseline_qps = run_qps(&results[0]);
+  printf("\n%-15s %14s %10s", "mode", "queries/s", "speedup");
+  for (int c = 0; c < column_count; c++) {
+    printf(" %10s", phase_names[columns[c]]);
+  }
+  printf("\n");
+  for (int r = 0; r < *result_count; r++) {
+    const RunResult *result = &results[r];
+    double qps = run_qps(result);
+    printf("%-15s %14.1f %9.2fx", result->mode_name, qps,
+           baseline_qps > 0.0 ? qps / baseline_qps : 0.0);
+    for (int c = 0; c < column_count; c++) {
+      printf(" %10.2f", phase_mean_us(&result->stats, columns[c]));
+    }
+    printf("\n");
+  }
+
+  // vrt_xml's VRT build formats, parses and patches the document; the cached
+  // mode's only parses it, so the difference is the work the template saves
+  const PhaseStats *xml_stats = &results[0].stats;
+  const PhaseStats *cached_stats = &results[1].stats;
+  double query_us = phase_mean_us(xml_stats, PHASE_ITERATION);
+  double open_us = phase_mean_us(xml_stats, PHASE_OPEN);
+  double build_us = phase_mean_us(xml_stats, PHASE_VRT_BUILD);
+  double saved_us = build_us - phase_mean_us(cached_stats, PHASE_VRT_BUILD);
+  double share = query_us > 0.0 ? 100.0 / query_us : 0.0;
+  printf("\nvrt_xml query: %.2f us mean\n", query_us);
+  printf("  source open:           %10.2f us (%5.1f%%)\n", open_us,
+         open_us * share);
+  printf("  XML build and open:    %10.2f us (%5.1f%%)\n", build_us,
+         build_us * share);
+  printf("    saved by the template: %8.2f us (%5.1f%%)\n", saved_us,
+         saved_us * share);
+  return 1;
+}
+
+// Mean time per query spent in `phase`, over all queries of the run.
+static double phase_us_per_query(const RunResult *result, Phase phase) {
+  const LatencyHistogram *h = &result->stats.hist[phase];
+  return result->queries > 0 ? latency_histogram_mean(h) *
+                                   (double)h->total_count / result->queries /
+                                   1000.0
+                             : 0.0;
+}
+
+// Runs direct_reuse_band, then raw_tile, on the same points, and splits the
+// difference into raw fetch and decode time against GDAL's read. GDAL's
+// block cache keeps every block it decodes while raw_tile keeps the last
+// one, so the decode counts are printed alongside.
+static int run_raw_tile_compare(const BenchConfig *cfg, int threads,
+                                RunResult *results, int *result_count) {
+  BenchConfig gdal = *cfg;
+  gdal.mode = MODE_DIRECT_REUSE_BAND;
+  gdal.mode_name = "direct_reuse_band";
+  const BenchConfig *runs[2] = {&gdal, cfg};
+  for (int r = 0; r < 2; r++) {
+    printf("%s:\n", runs[r]->mode_name);
+    if (!run_workers(runs[r], threads, &results[*result_count])) {
+      return 0;
+    }
+    print_run_details(&results[(*result_count)++]);
+  }
+
+  static const Phase columns[] = {PHASE_GEO_TO_PIXEL, PHASE_RASTERIO,
+                                  PHASE_FETCH, PHASE_DECODE, PHASE_ITERATION};
+  int column_count = (int)(sizeof(columns) / sizeof(columns[0]));
+  double baseline_qps = run_qps(&results[0]);
+  printf("\n%-18s %14s %10s", "mode", "queries/s", "speedup");
+  for (int c = 0; c < column_count; c++) {
+    printf(" %12s", phase_names[columns[c]]);
+  }
+  printf("\n");
+  for (int r = 0; r < *result_count; r++) {
+    const RunResult *result = &results[r];
+    double qps = run_qps(result);
+    printf("%-18s %14.1f %9.2fx", result->mode_name, qps,
+           baseline_qps > 0.0 ? qps / baseline_qps : 0.0);
+    for (int c = 0; c < column_count; c++) {
+      printf(" %12.2f", phase_mean_us(&result->stats, columns[c]));
+    }
+    printf("\n");
+  }
+
+  const RunResult *gdal_result = &results[0];
+  const RunResult *raw_result = &results[1];
+  double gdal_us = phase_us_per_query(gdal_result, PHASE_RASTERIO);
+  double fetch_us = phase_us_per_query(raw_result, PHASE_FETCH);
+  double decode_us = phase_us_per_query(raw_result, PHASE_DECODE);
+  // Indexing into the decoded block is a few loads, left out of both
+  double raw_us = fetch_us + decode_us;
+  printf("\nPer query: GDALRasterIO %.2f us, raw fetch and decode %.2f us "
+         "(fetch %.2f us, decode %.2f us, %.3f blocks decoded)\n",
+         gdal_us, raw_us, fetch_us, decode_us,
+         raw_result->queries > 0
+             ? (double)raw_result->raw_tile_blocks_decoded / raw_result->queries
+             : 0.0);
+  printf("GDAL overhead over raw decode: %.2f us per query (%.1f%% of "
+         "GDALRasterIO)\n",
+         gdal_us - raw_us,
+         gdal_us > 0.0 ? (gdal_us - raw_us) / gdal_us * 100.0 : 0.0);
+  return 1;
+}
+
+// Runs the mode reading every point, then with the occupancy bitmap in front
+// of it, and reports the share of queries the bitmap answered.
+static int run_occupancy_compare(const BenchConfig *cfg, int threads,
+                                 RunResult *results, int *result_count) {
+  BenchConfig full = *cfg;
+  full.occupancy = NULL;
+  const BenchConfig *runs[2] = {&full, cfg};
+  for (int r = 0; r < 2; r++) {
+    printf("%s:\n", runs[r]->occupancy ? "Occupancy bitmap" : "Every point");
+    if (!run_workers(runs[r], threads, &results[*result_count])) {
+      return 0;
+    }
+    print_run_details(&results[(*result_count)++]);
+  }
+
+  double baseline_qps = run_qps(&results[0]);
+  printf("\n%-12s %14s %10s %12s %12s %12s %12s\n", "bitmap", "queries/s",
+         "speedup", "skipped", "occupancy", "iteration", "p99");
+  for (int r = 0; r < *result_count; r++) {
+    const RunResult *result = &results[r];
+    double qps = run_qps(result);
+    const LatencyHistogram *h = &result->stats.hist[PHASE_ITERATION];
+    printf("%-12s %14.1f %9.2fx %11.1f%% %12.2f %12.2f %12.2f\n",
+           result->occupancy_enabled ? "occupancy" : "none", qps,
+           baseline_qps > 0.0 ? qps / baseline_qps : 0.0,
+           result->queries > 0
+               ? 100.0 * result->occupancy_skipped / result->queries
+               : 0.0,
+           phase_mean_us(&result->stats, PHASE_OCCUPANCY),
+           phase_mean_us(&result->stats, PHASE_ITERATION),
+           (double)latency_histogram_percentile(h, 0.99) / 1000.0);
+  }
+  return 1;
+}
+
+// Runs vrt_tile with tiles of 1 to 16 internal blocks and compares build
+// cost, cache hit rate and memory per cached VRT.
+static int run_vrt_tile_sweep(const BenchConfig *cfg, int threads,
+                              RunResult *results, int *result_count) {
+  static const int tile_blocks[VRT_TILE_SWEEP_COUNT] = {1, 2, 4, 8, 16};
+  for (int b = 0; b < VRT_TILE_SWEEP_COUNT; b++) {
+    BenchConfig tiled = *cfg;
+    tiled.vrt_tile_blocks = tile_blocks[b];
+    printf("Tiles of %d blocks:\n", tiled.vrt_tile_blocks);
+    if (!run_workers(&tiled, threads, &results[*result_count])) {
+      return 0;
+    }
+    print_run_details(&results[(*result_count)++]);
+  }
+
+  printf("\n%-7s %12s %14s %10s %14s %10s %14s\n", "blocks", "tile",
+         "queries/s", "builds", "build us", "hit rate", "KiB per VRT");
+  for (int r = 0; r < *result_count; r++) {
+    const RunResult *result = &results[r];
+    char tile[32];
+    snprintf(tile, sizeof(tile), "%dx%d", result->vrt_tile_width,
+             result->vrt_tile_height);
+    printf("%-7d %12s %14.1f %10lld %14.2f %9.1f%% ", result->vrt_tile_blocks,
+           tile, run_qps(result), result->vrt_tile_misses,
+           phase_mean_us(&result->stats, PHASE_VRT_BUILD),
+           vrt_tile_hit_rate(result));
+    if (result->vrt_tile_bytes >= 0.0) {
+      printf("%14.1f\n", result->vrt_tile_bytes / 1024.0);
+    } else {
+      printf("%14s\n", "n/a");
+    }
+  }
+  return 1;
+}
+
+// Runs the mode with each band layout, separate GDALRasterIO calls first as
+// the baseline. Point reads lay out one pixel, so there the sequential and
+// interleaved runs only differ by noise.
+static int run_band_compare(const BenchConfig *cfg, int threads,
+                            RunResult *results, int *result_count) {
+  for (int l = 0; l < BAND_LAYOUT_COUNT; l++) {
+    BenchConfig layout = *cfg;
+    layout.bands.layout = (BandLayout)l;
+    layout.vrt_bands.layout = (BandLayout)l;
+    printf("%s layout:\n", band_layout_names[l]);
+    if (!run_workers(&layout, threads, &results[*result_count])) {
+      return 0;
+    }
+    print_run_details(&results[(*result_count)++]);
+  }
+
+  double baseline_qps = run_qps(&results[0]);
+  printf("\n%-12s %14s %10s %12s %14s\n", "layout", "queries/s", "speedup",
+         "rasterio us", "iteration us");
+  for (int r = 0; r < *result_count; r++) {
+    const RunResult *result = &results[r];
+    double qps = run_qps(result);
+    printf("%-12s %14.1f %9.2fx %12.2f %14.2f\n", result->band_layout, qps,
+           baseline_qps > 0.0 ? qps / baseline_qps : 0.0,
+           phase_mean_us(&result->stats, PHASE_RASTERIO),
+           phase_mean_us(&result->stats, PHASE_ITERATION));
+  }
+  return 1;
+}
+
+// Runs the mode at full resolution, then targeting the resolution of each
+// overview of the first band of `path`, and compares the bytes read and the
+// query latency with the full resolution run. `path` is read through
+// /vsicount/ so that every run counts its bytes.
+static int run_overview_sweep(const BenchConfig *cfg, int threads,
+                              RunResult *results, int *result_count) {
+  GDALDatasetH ds = GDALOpen(cfg->path, GA_ReadOnly);
+  if (!ds) {
+    fprintf(stderr, "Error: Failed to open dataset '%s'\n", cfg->path);
+    return 0;
+  }
+  double gt[6];
+  if (GDALGetGeoTransform(ds, gt) != CE_None) {
+    fprintf(stderr, "Error: Dataset '%s' has no geotransform\n", cfg->path);
+    GDALClose(ds);
+    return 0;
+  }
+  int full_x = GDALGetRasterXSize(ds);
+  int full_y = GDALGetRasterYSize(ds);
+  GDALRasterBandH band = GDALGetRasterBand(ds, cfg->bands.list[0]);
+  double targets[MAX_RUNS];
+  int target_count = 0;
+  targets[target_count++] = 0.0;
+  int overview_count = GDALGetOverviewCount(band);
+  for (int i = 0; i < overview_count && target_count < MAX_RUNS; i++) {
+    GDALRasterBandH overview = GDALGetOverview(band, i);
+    int overview_x = overview ? GDALGetRasterBandXSize(overview) : 0;
+    if (overview_x > 0) {
+      targets[target_count++] = fabs(gt[1]) * full_x / overview_x;
+    }
+  }
+  GDALClose(ds);
+  if (overview_count == 0) {
+    printf("'%s' has no overviews; running full resolution only\n",
+           cfg->path);
+  }
+
+  BenchConfig counted = *cfg;
+  char *counted_path = NULL;
+  if (strncmp(cfg->path, VSI_COUNT_PREFIX, strlen(VSI_COUNT_PREFIX)) != 0) {
+    counted_path = CPLStrdup(CPLSPrintf("%s%s", VSI_COUNT_PREFIX, cfg->path));
+    counted.path = counted_path;
+  }
+  int ok = 1;
+  for (int t = 0; t < target_count && ok; t++) {
+    counted.target_resolution = targets[t];
+    if (t == 0) {
+      printf("Full resolution:\n");
+    } else {
+      printf("Target resolution %g:\n", targets[t]);
+    }
+    ok = run_workers(&counted, threads, &results[*result_count]);
+    if (ok) {
+      print_run_details(&results[(*result_count)++]);
+    }
+  }
+  CPLFree(counted_path);
+  if (!ok) {
+    return 0;
+  }
+
+  const RunResult *full = &results[0];
+  double full_bytes =
+      full->queries > 0 ? (double)full->io.bytes_read / full->queries : 0.0;
+  double full_us = phase_mean_us(&full->stats, PHASE_ITERATION);
+  printf("\n%-6s %12s %12s %12s %10s %10s %12s %12s %12s\n", "level",
+         "size", "resolution", "queries/s", "mean us", "p99 us",
+         "bytes/query", "bytes saved", "mean saved");
+  for (int r = 0; r < *result_count; r++) {
+    const RunResult *result = &results[r];
+    const OverviewLevel *ov = &result->overview;
+    int level = r > 0 ? ov->level : -1;
+    char name[16];
+    char size[32];
+    if (level >= 0) {
+      snprintf(name, sizeof(name), "%d", level);
+      snprintf(size, sizeof(size), "%dx%d", ov->raster_x, ov->raster_y);
+    } else {
+      snprintf(name, sizeof(name), "full");
+      snprintf(size, sizeof(size), "%dx%d", full_x, full_y);
+    }
+    double bytes = result->queries > 0
+                       ? (double)result->io.bytes_read / result->queries
+                       : 0.0;
+    double mean_us = phase_mean_us(&result->stats, PHASE_ITERATION);
+    double p99_us = (double)latency_histogram_percentile(
+                        &result->stats.hist[PHASE_ITERATION], 0.99) /
+                    1000.0;
+    printf("%-6s %12s %12g %12.1f %10.2f %10.2f %12.1f %11.1f%% %11.1f%%\n",
+           name, size, level >= 0 ? fabs(gt[1]) / ov->scale_x : fabs(gt[1]),
+           run_qps(result), mean_us, p99_us, bytes,
+           full_bytes > 0.0 ? 100.0 * (1.0 - bytes / full_bytes) : 0.0,
+           full_us > 0.0 ? 100.0 * (1.0 - mean_us / full_us) : 0.0);
+  }
+  return 1;
+}
+
+// Runs the mode once under each query distribution, keeping the other
+// distribution parameters, to compare it across locality profiles.
+static int run_distribution_sweep(const BenchConfig *cfg, int threads,
+                                  RunResult *results, int *result_count) {
+  for (int k = 0; k < DIST_COUNT; k++) {
+    QueryDistParams params = cfg->dist->params;
+    params.kind = (DistKind)k;
+    if (k != (int)cfg->dist->params.kind) {
+      // Let each distribution pick its own default centers and spread
+      params.centers = 0;
+      params.spread = 0.0;
+    }
+    QueryDist dist;
+    if (!query_dist_init(&dist, &params, &cfg->bbox, cfg->seed)) {
+      fprintf(stderr, "Error: Failed to set up distribution '%s'\n",
+              query_dist_name(params.kind));
+      return 0;
+    }
+    BenchConfig run = *cfg;
+    run.dist = &dist;
+    char description[128];
+    query_dist_describe(&dist, description, sizeof(description));
+    printf("Distribution %s:\n", description);
+    int ok = run_workers(&run, threads, &results[*result_count]);
+    query_dist_destroy(&dist);
+    if (!ok) {
+      return 0;
+    }
+    print_run_details(&results[(*result_count)++]);
+  }
+
+  printf("\n%-10s %14s %12s %12s %12s %12s\n", "dist", "queries/s",
+         "p50 (us)", "p99 (us)", "block reuse", "tile cache");
+  for (int r = 0; r < *result_count; r++) {
+    const RunResult *result = &results[r];
+    const LatencyHistogram *h = &result->stats.hist[PHASE_ITERATION];
+    printf("%-10s %14.1f %12.2f %12.2f", result->distribution, run_qps(result),
+           (double)latency_histogram_percentile(h, 0.50) / 1000.0,
+           (double)latency_histogram_percentile(h, 0.99) / 1000.0);
+    if (result->block_queries > 0) {
+      printf(" %11.1f%%", block_reuse_rate(result));
+    } else {
+      printf(" %12s", "-");
+    }
+    if (result->tile_cache_enabled) {
+      printf(" %11.1f%%\n", tile_cache_hit_rate(&result->tile_cache));
+    } else {
+      printf(" %12s\n", "-");
+    }
+  }
+  return 1;
+}
+
+// Replays the trace at rising rates, starting at --rate or the trace's own
+// rate, until the achieved rate falls behind or p99 response time diverges,
+// and reports the highest rate that was sustained.
+static int run_rate_sweep(const BenchConfig *cfg, int threads,
+                          RunResult *results, int *result_count) {
+  static const double rate_factors[MAX_RUNS] = {0.25, 0.5, 1.0, 1.5,
+                                                2.0,  3.0, 4.0, 6.0};
+  double base_p99 = 0.0;
+  int sustained = -1;
+  for (int f = 0; f < MAX_RUNS; f++) {
+    BenchConfig run = *cfg;
+    if (cfg->replay_rate > 0.0) {
+      run.replay_rate = cfg->replay_rate * rate_factors[f];
+    } else {
+      run.replay_speed = rate_factors[f];
+    }
+    RunResult *result = &results[*result_count];
+    if (!run_workers(&run, threads, result)) {
+      return 0;
+    }
+    (*result_count)++;
+    printf("Offered rate %.1f queries/s:\n", result->offered_rate);
+    print_run_details(result);
+
+    double p99 = (double)latency_histogram_percentile(
+        &result->stats.hist[PHASE_RESPONSE], 0.99);
+    if (f == 0 || p99 < base_p99) {
+      base_p99 = p99;
+    }
+    if (run_qps(result) < result->offered_rate * SUSTAINED_THROUGHPUT_SHARE ||
+        p99 > base_p99 * SUSTAINED_P99_FACTOR) {
+      break;
+    }
+    sustained = f;
+  }
+
+  printf("\n%14s %14s %14s %14s %14s\n", "offered q/s", "achieved q/s",
+         "p50 resp (us)", "p99 resp (us)", "p99 svc (us)");
+  for (int r = 0; r < *result_count; r++) {
+    const RunResult *result = &results[r];
+    printf("%14.1f %14.1f %14.2f %14.2f %14.2f\n", result->offered_rate,
+           run_qps(result),
+           (double)latency_histogram_percentile(
+               &result->stats.hist[PHASE_RESPONSE], 0.50) /
+               1000.0,
+           (double)latency_histogram_percentile(
+               &result->stats.hist[PHASE_RESPONSE], 0.99) /
+               1000.0,
+           (double)latency_histogram_percentile(
+               &result->stats.hist[PHASE_ITERATION], 0.99) /
+               1000.0);
+  }
+  if (sustained >= 0) {
+    printf("Max sustained rate: %.1f queries/s\n",
+           results[sustained].offered_rate);
+  } else {
+    printf("Max sustained rate: none (the lowest rate already fell behind)\n");
+  }
+  return 1;
+}
+
+// Reads one dataset path per line, skipping blank lines and lines starting
+// with '#'. Returns NULL if the list cannot be read or is empty.
+static char **load_file_list(const char *list_path, int *count) {
+  char **lines = CSLLoad(list_path);
+  if (!lines) {
+    fprintf(stderr, "Error: Failed to read file list '%s'\n", list_path);
+    return NULL;
+  }
+  char **files = NULL;
+  for (int i = 0; lines[i]; i++) {
+    const char *line = lines[i];
+    while (*line == ' ' || *line == '\t') {
+      line++;
+    }
+    if (*line != '\0' && *line != '#') {
+      files = CSLAddString(files, line);
+    }
+  }
+  CSLDestroy(lines);
+  *count = CSLCount(files);
+  if (*count == 0) {
+    fprintf(stderr, "Error: File list '%s' is empty\n", list_path);
+    CSLDestroy(files);
+    return NULL;
+  }
+  return files;
+}
+
+// Parses "WxH" with both sides positive.
+static int parse_size(const char *str, int *width, int *height) {
+  return sscanf(str, "%dx%d", width, height) == 2 && *width > 0 &&
+         *height > 0;
+}
 
+static int parse_resampling(const char *name, GDALRIOResampleAlg *alg) {
+  static const struct {
+    const char *name;
+    GDALRIOResampleAlg alg;
+  } algs[] = {
+      {"nearest", GRIORA_NearestNeighbour}, {"bilinear", GRIORA_Bilinear},
+      {"cubic", GRIORA_Cubic},              {"cubicspline", GRIORA_CubicSpline},
+      {"lanczos", GRIORA_Lanczos},          {"average", GRIORA_Average},
+      {"mode", GRIORA_Mode},                {"gauss", GRIORA_Gauss},
+  };
+  for (size_t a = 0; a < sizeof(algs) / sizeof(algs[0]); a++) {
+    if (strcmp(name, algs[a].name) == 0) {
+      *alg = algs[a].alg;
+      return 1;
+    }
+  }
   return 0;
 }
+
+// Returns NULL for an unknown name or a kernel the CPU cannot run.
+static WindowStatsFunc parse_window_kernel(const char *name) {
+  if (strcmp(name, "auto") == 0) {
+    return window_stats_compute;
+  } else if (strcmp(name, "scalar") == 0) {
+    return window_stats_scalar;
+  } else if (strcmp(name, "sse2") == 0) {
+    return window_stats_kernel_sse2();
+  } else if (strcmp(name, "avx2") == 0) {
+    return window_stats_kernel_avx2();
+  }
+  return NULL;
+}
+
+static BandLayout parse_band_layout(const char *name) {
+  for (int l = 0; l < BAND_LAYOUT_COUNT; l++) {
+    if (strcmp(name, band_layout_names[l]) == 0) {
+      return (BandLayout)l;
+    }
+  }
+  return BAND_LAYOUT_COUNT;
+}
+
+// Modes whose reads go through read_pixel_bands_from_dataset or
+// read_band_window, and so honour --bands.
+static int mode_reads_bands(Mode mode) {
+  switch (mode) {
+  case MODE_DIRECT:
+  case MODE_DIRECT_REUSE_DS:
+  case MODE_DIRECT_POOLED:
+  case MODE_VRT_API:
+  case MODE_VRT_XML:
+  case MODE_VRT_XML_CACHED:
+  case MODE_VRT_TILE:
+  case MODE_VRT_API_REUSE_SOURCE:
+  case MODE_VRT_API_REUSE_DATASET:
+  case MODE_DIRECT_BANDS:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+// Fills bands from `spec`, "all" or a comma-separated list of band numbers
+// of the dataset at path (band 1 when NULL), and vrt_bands with the
+// numbers the same bands get in a VRT built over them. `available` and
+// `interleave` receive the dataset's band count and INTERLEAVE, if known.
+// Returns 0 on failure.
+static int resolve_bands(const char *path, const char *spec, BandSet *bands,
+                         BandSet *vrt_bands, int *available, char *interleave,
+                         size_t interleave_size) {
+  *available = 1;
+  snprintf(interleave, interleave_size, "unknown");
+  if (spec) {
+    GDALDatasetH ds = GDALOpen(path, GA_ReadOnly);
+    if (!ds) {
+      fprintf(stderr, "Error: Failed to open dataset '%s'\n", path);
+      return 0;
+    }
+    *available = GDALGetRasterCount(ds);
+    const char *item =
+        GDALGetMetadataItem(ds, "INTERLEAVE", "IMAGE_STRUCTURE");
+    if (item) {
+      snprintf(interleave, interleave_size, "%s", item);
+    }
+    GDALClose(ds);
+  }
+
+  int count = 1;
+  if (spec && strcmp(spec, "all") == 0) {
+    count = *available;
+  } else if (spec) {
+    for (const char *c = spec; *c; c++) {
+      count += *c == ',';
+    }
+  }
+  bands->list = (int *)malloc(sizeof(int) * (size_t)count);
+  vrt_bands->list = (int *)malloc(sizeof(int) * (size_t)count);
+  if (!bands->list || !vrt_bands->list) {
+    fprintf(stderr, "Error: Out of memory\n");
+    return 0;
+  }
+  bands->count = count;
+  vrt_bands->count = count;
+  const char *next = spec;
+  for (int b = 0; b < count; b++) {
+    vrt_bands->list[b] = b + 1;
+    if (!spec || strcmp(spec, "all") == 0) {
+      bands->list[b] = b + 1;
+      continue;
+    }
+    char *end;
+    long band = strtol(next, &end, 10);
+    if (end == next || (*end != ',' && *end != '\0') || band < 1 ||
+        band > *available) {
+      fprintf(stderr,
+              "Error: --bands must be 'all' or a comma-separated list of "
+              "bands between 1 and %d\n",
+              *available);
+      return 0;
+    }
+    bands->list[b] = (int)band;
+    next = end + 1;
+  }
+  return 1;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 6) {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  BenchConfig cfg;
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.path = argv[1];
+  cfg.iterations = atoi(argv[2]);
+  cfg.seed = (unsigned int)atoi(argv[3]);
+  if (!parse_bbox(argv[4], &cfg.bbox)) {
+    fprintf(stderr,
+            "Error: Invalid bounding box format. Use xmin,ymin,xmax,ymax\n");
+    return 1;
+  }
+
+  cfg.mode_name = argv[5];
+  cfg.mode = parse_mode(argv[5]);
+  if (cfg.mode == MODE_INVALID) {
+    fprintf(stderr, "Error: Invalid mode '%s'\n", argv[5]);
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  int threads = 1;
+  int batch_sweep = 0;
+  int pool_sweep = 0;
+  int tile_cache_compare = 0;
+  int vrt_xml_compare = 0;
+  int vrt_tile_sweep = 0;
+  int raw_tile_compare = 0;
+  // --occupancy: 0 off, 1 coverage status only, 2 also scan the blocks
+  int occupancy = 0;
+  int occupancy_compare = 0;
+  int distribution_sweep = 0;
+  int rate_sweep = 0;
+  const char *replay_path = NULL;
+  TraceRecorder recorder;
+  memset(&recorder, 0, sizeof(recorder));
+  QueryDistParams dist_params;
+  memset(&dist_params, 0, sizeof(dist_params));
+  dist_params.kind = DIST_UNIFORM;
+  double tile_cache_mib = 0.0;
+  int tile_cache_shards = DEFAULT_TILE_CACHE_SHARDS;
+  const char *mmap_dir = DEFAULT_MMAP_DIR;
+  cfg.lookahead = DEFAULT_LOOKAHEAD;
+  cfg.io_threads = DEFAULT_IO_THREADS;
+  const char *json_path = NULL;
+  const char *csv_path = NULL;
+  const char *file_list_path = NULL;
+  cfg.batch_size = DEFAULT_BATCH_SIZE;
+  cfg.pool_size = DEFAULT_POOL_SIZE;
+  cfg.vrt_tile_blocks = DEFAULT_VRT_TILE_BLOCKS;
+  cfg.vrt_tile_cache = DEFAULT_VRT_TILE_CACHE;
+  cfg.window_width = DEFAULT_WINDOW_SIZE;
+  cfg.window_height = DEFAULT_WINDOW_SIZE;
+  cfg.window_resampling = GRIORA_NearestNeighbour;
+  cfg.window_kernel = window_stats_compute;
+  const char *resampling_name = "nearest";
+  const char *window_kernel_name = "auto";
+  const char *bands_spec = NULL;
+  BandLayout band_layout = BAND_LAYOUT_SEQUENTIAL;
+  int band_compare = 0;
+  int overview_sweep = 0;
+  for (int i = 6; i < argc; i++) {
+    if (strcmp(argv[i], "--print-pixels") == 0) {
+      cfg.print_pixels = 1;
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+      if (threads <= 0) {
+        fprintf(stderr, "Error: --threads must be a positive integer\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+      json_path = argv[++i];
+    } else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+      csv_path = argv[++i];
+    } else if (strcmp(argv[i], "--batch-size") == 0 && i + 1 < argc) {
+      cfg.batch_size = atoi(argv[++i]);
+      if (cfg.batch_size <= 0) {
+        fprintf(stderr, "Error: --batch-size must be a positive integer\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--batch-sweep") == 0) {
+      batch_sweep = 1;
+    } else if (strcmp(argv[i], "--file-list") == 0 && i + 1 < argc) {
+      file_list_path = argv[++i];
+    } else if (strcmp(argv[i], "--pool-size") == 0 && i + 1 < argc) {
+      cfg.pool_size = atoi(argv[++i]);
+      if (cfg.pool_size <= 0) {
+        fprintf(stderr, "Error: --pool-size must be a positive integer\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--pool-sweep") == 0) {
+      pool_sweep = 1;
+    } else if (strcmp(argv[i], "--tile-cache") == 0 && i + 1 < argc) {
+      tile_cache_mib = atof(argv[++i]);
+      if (tile_cache_mib <= 0.0) {
+        fprintf(stderr, "Error: --tile-cache must be a positive size in "
+                        "MiB\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--tile-cache-shards") == 0 && i + 1 < argc) {
+      tile_cache_shards = atoi(argv[++i]);
+      if (tile_cache_shards <= 0) {
+        fprintf(stderr,
+                "Error: --tile-cache-shards must be a positive integer\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--tile-cache-compare") == 0) {
+      tile_cache_compare = 1;
+    } else if (strcmp(argv[i], "--vrt-xml-compare") == 0) {
+      vrt_xml_compare = 1;
+    } else if (strcmp(argv[i], "--vrt-tile-blocks") == 0 && i + 1 < argc) {
+      cfg.vrt_tile_blocks = atoi(argv[++i]);
+      if (cfg.vrt_tile_blocks <= 0 ||
+          (cfg.vrt_tile_blocks & (cfg.vrt_tile_blocks - 1)) != 0) {
+        fprintf(stderr, "Error: --vrt-tile-blocks must be a power of two\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--vrt-tile-cache") == 0 && i + 1 < argc) {
+      cfg.vrt_tile_cache = atoi(argv[++i]);
+      if (cfg.vrt_tile_cache <= 0) {
+        fprintf(stderr,
+                "Error: --vrt-tile-cache must be a positive integer\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--vrt-tile-sweep") == 0) {
+      vrt_tile_sweep = 1;
+    } else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc) {
+      if (!parse_size(argv[++i], &cfg.window_width, &cfg.window_height)) {
+        fprintf(stderr, "Error: --window must be WxH with positive sides\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--window-buffer") == 0 && i + 1 < argc) {
+      if (!parse_size(argv[++i], &cfg.window_buffer_width,
+                      &cfg.window_buffer_height)) {
+        fprintf(stderr,
+                "Error: --window-buffer must be WxH with positive sides\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--resampling") == 0 && i + 1 < argc) {
+      resampling_name = argv[++i];
+      if (!parse_resampling(resampling_name, &cfg.window_resampling)) {
+        fprintf(stderr, "Error: Unknown resampling '%s'\n", resampling_name);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--window-kernel") == 0 && i + 1 < argc) {
+      window_kernel_name = argv[++i];
+      cfg.window_kernel = parse_window_kernel(window_kernel_name);
+      if (!cfg.window_kernel) {
+        fprintf(stderr,
+                "Error: Window kernel '%s' is unknown or not supported on "
+                "this CPU\n",
+                window_kernel_name);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--bands") == 0 && i + 1 < argc) {
+      bands_spec = argv[++i];
+    } else if (strcmp(argv[i], "--band-layout") == 0 && i + 1 < argc) {
+      band_layout = parse_band_layout(argv[++i]);
+      if (band_layout == BAND_LAYOUT_COUNT) {
+        fprintf(stderr, "Error: Unknown band layout '%s'\n", argv[i]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--band-compare") == 0) {
+      band_compare = 1;
+    } else if (strcmp(argv[i], "--target-resolution") == 0 && i + 1 < argc) {
+      cfg.target_resolution = atof(argv[++i]);
+      if (cfg.target_resolution <= 0.0) {
+        fprintf(stderr, "Error: --target-resolution must be positive\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--overview-sweep") == 0) {
+      overview_sweep = 1;
+    } else if (strcmp(argv[i], "--native-type") == 0) {
+      cfg.native_type = 1;
+    } else if (strcmp(argv[i], "--raw-tile-verify") == 0) {
+      cfg.raw_tile_verify = 1;
+    } else if (strcmp(argv[i], "--raw-tile-compare") == 0) {
+      raw_tile_compare = 1;
+    } else if (strcmp(argv[i], "--occupancy") == 0 && i + 1 < argc) {
+      i++;
+      if (strcmp(argv[i], "coverage") == 0) {
+        occupancy = 1;
+      } else if (strcmp(argv[i], "scan") == 0) {
+        occupancy = 2;
+      } else {
+        fprintf(stderr, "Error: Unknown occupancy source '%s'\n", argv[i]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--occupancy-compare") == 0) {
+      occupancy_compare = 1;
+    } else if (strcmp(argv[i], "--mmap-dir") == 0 && i + 1 < argc) {
+      mmap_dir = argv[++i];
+    } else if (strcmp(argv[i], "--lookahead") == 0 && i + 1 < argc) {
+      cfg.lookahead = atoi(argv[++i]);
+      if (cfg.lookahead <= 0) {
+        fprintf(stderr, "Error: --lookahead must be a positive integer\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--io-threads") == 0 && i + 1 < argc) {
+      cfg.io_threads = atoi(argv[++i]);
+      if (cfg.io_threads <= 0) {
+        fprintf(stderr, "Error: --io-threads must be a positive integer\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--distribution") == 0 && i + 1 < argc) {
+      dist_params.kind = query_dist_parse(argv[++i]);
+      if (dist_params.kind == DIST_COUNT) {
+        fprintf(stderr, "Error: Unknown distribution '%s'\n", argv[i]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--centers") == 0 && i + 1 < argc) {
+      dist_params.centers = atoi(argv[++i]);
+      if (dist_params.centers <= 0) {
+        fprintf(stderr, "Error: --centers must be a positive integer\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--zipf-exponent") == 0 && i + 1 < argc) {
+      dist_params.zipf_exponent = atof(argv[++i]);
+      if (dist_params.zipf_exponent <= 0.0) {
+        fprintf(stderr, "Error: --zipf-exponent must be positive\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--spread") == 0 && i + 1 < argc) {
+      dist_params.spread = atof(argv[++i]);
+      if (dist_params.spread <= 0.0) {
+        fprintf(stderr, "Error: --spread must be positive\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--step") == 0 && i + 1 < argc) {
+      dist_params.step = atof(argv[++i]);
+      if (dist_params.step <= 0.0 || dist_params.step > 1.0) {
+        fprintf(stderr, "Error: --step must be in (0, 1]\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--distribution-sweep") == 0) {
+      distribution_sweep = 1;
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      recorder.path = argv[++i];
+    } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      replay_path = argv[++i];
+    } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+      cfg.replay_rate = atof(argv[++i]);
+      if (cfg.replay_rate <= 0.0) {
+        fprintf(stderr, "Error: --rate must be positive\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--rate-sweep") == 0) {
+      rate_sweep = 1;
+    } else {
+      fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (batch_sweep && cfg.mode != MODE_DIRECT_BATCHED_BLOCKS) {
+    fprintf(stderr, "Error: --batch-sweep requires mode "
+                    "'direct_batched_blocks'\n");
+    return 1;
+  }
+  // The other modes always read `path`
+  if (file_list_path && cfg.mode != MODE_DIRECT &&
+      cfg.mode != MODE_DIRECT_POOLED) {
+    fprintf(stderr, "Error: --file-list requires mode 'direct' or "
+                    "'direct_pooled'\n");
+    return 1;
+  }
+  if (pool_sweep && (cfg.mode != MODE_DIRECT_POOLED || !file_list_path)) {
+    fprintf(stderr, "Error: --pool-sweep requires mode 'direct_pooled' and "
+                    "--file-list\n");
+    return 1;
+  }
+  if (tile_cache_mib > 0.0 && cfg.mode != MODE_DIRECT_REUSE_BAND &&
+      cfg.mode != MODE_DIRECT_PIPELINED) {
+    fprintf(stderr, "Error: --tile-cache requires mode 'direct_reuse_band' or "
+                    "'direct_pipelined'\n");
+    return 1;
+  }
+  if (tile_cache_compare &&
+      (tile_cache_mib <= 0.0 || cfg.mode != MODE_DIRECT_REUSE_BAND)) {
+    fprintf(stderr, "Error: --tile-cache-compare requires mode "
+                    "'direct_reuse_band' and --tile-cache\n");
+    return 1;
+  }
+  if (vrt_xml_compare && cfg.mode != MODE_VRT_XML &&
+      cfg.mode != MODE_VRT_XML_CACHED) {
+    fprintf(stderr, "Error: --vrt-xml-compare requires mode 'vrt_xml' or "
+                    "'vrt_xml_cached'\n");
+    return 1;
+  }
+  if (cfg.window_buffer_width == 0) {
+    cfg.window_buffer_width = cfg.window_width;
+    cfg.window_buffer_height = cfg.window_height;
+  }
+  if (cfg.window_buffer_width > cfg.window_width ||
+      cfg.window_buffer_height > cfg.window_height) {
+    fprintf(stderr, "Error: --window-buffer must not exceed --window\n");
+    return 1;
+  }
+  if (vrt_tile_sweep && cfg.mode != MODE_VRT_TILE) {
+    fprintf(stderr, "Error: --vrt-tile-sweep requires mode 'vrt_tile'\n");
+    return 1;
+  }
+  if (bands_spec && !mode_reads_bands(cfg.mode)) {
+    fprintf(stderr, "Error: --bands is not supported in mode '%s'\n",
+            cfg.mode_name);
+    return 1;
+  }
+  if (band_compare && !bands_spec) {
+    fprintf(stderr, "Error: --band-compare requires --bands\n");
+    return 1;
+  }
+  // direct_bands reads a window around the point, which overviews would
+  // shrink, so it stays at full resolution like the other window modes
+  if ((cfg.target_resolution > 0.0 || overview_sweep) &&
+      (!mode_reads_bands(cfg.mode) || cfg.mode == MODE_DIRECT_BANDS)) {
+    fprintf(stderr,
+            "Error: --target-resolution and --overview-sweep are not "
+            "supported in mode '%s'\n",
+            cfg.mode_name);
+    return 1;
+  }
+  if (cfg.native_type &&
+      ((cfg.mode != MODE_DIRECT_REUSE_DS &&
+        cfg.mode != MODE_DIRECT_BATCHED_BLOCKS) ||
+       cfg.target_resolution > 0.0 || overview_sweep)) {
+    fprintf(stderr, "Error: --native-type requires mode 'direct_reuse_ds' or "
+                    "'direct_batched_blocks' at full resolution\n");
+    return 1;
+  }
+  if ((cfg.raw_tile_verify || raw_tile_compare) &&
+      cfg.mode != MODE_RAW_TILE) {
+    fprintf(stderr, "Error: --raw-tile-verify and --raw-tile-compare require "
+                    "mode 'raw_tile'\n");
+    return 1;
+  }
+  // The bitmap covers the full resolution grid of `path`
+  if (occupancy &&
+      ((cfg.mode != MODE_DIRECT && cfg.mode != MODE_DIRECT_REUSE_DS &&
+        cfg.mode != MODE_DIRECT_REUSE_BAND && cfg.mode != MODE_RAW_TILE) ||
+       file_list_path || cfg.target_resolution > 0.0 || overview_sweep)) {
+    fprintf(stderr, "Error: --occupancy requires mode 'direct', "
+                    "'direct_reuse_ds', 'direct_reuse_band' or 'raw_tile' "
+                    "on a single file at full resolution\n");
+    return 1;
+  }
+  if (occupancy_compare && !occupancy) {
+    fprintf(stderr, "Error: --occupancy-compare requires --occupancy\n");
+    return 1;
+  }
+  if (distribution_sweep + batch_sweep + pool_sweep + tile_cache_compare +
+          vrt_xml_compare + vrt_tile_sweep + band_compare + overview_sweep +
+          raw_tile_compare + occupancy_compare + rate_sweep >
+      1) {
+    fprintf(stderr, "Error: Only one of --batch-sweep, --pool-sweep, "
+                    "--tile-cache-compare, --vrt-xml-compare, "
+                    "--vrt-tile-sweep, --band-compare, --overview-sweep, "
+                    "--raw-tile-compare, --occupancy-compare, "
+                    "--distribution-sweep and --rate-sweep can be given\n");
+    return 1;
+  }
+  if ((cfg.replay_rate > 0.0 || rate_sweep) && !replay_path) {
+    fprintf(stderr, "Error: --rate and --rate-sweep require --replay\n");
+    return 1;
+  }
+  if (replay_path &&
+      (cfg.mode == MODE_DIRECT_BATCHED_BLOCKS ||
+       cfg.mode == MODE_DIRECT_PIPELINED || recorder.path ||
+       distribution_sweep)) {
+    fprintf(stderr, "Error: --replay sends one query at a time and cannot be "
+                    "combined with the batched or pipelined modes, --record "
+                    "or --distribution-sweep\n");
+    return 1;
+  }
+  if (recorder.path) {
+    cfg.recorder = &recorder;
+  }
+  Trace trace;
+  memset(&trace, 0, sizeof(trace));
+  if (replay_path) {
+    if (!trace_load(&trace, replay_path)) {
+      return 1;
+    }
+    cfg.replay = &trace;
+    cfg.replay_speed = 1.0;
+  }
+  if (cfg.mode == MODE_DIRECT_PIPELINED && tile_cache_mib <= 0.0) {
+    // The prefetched blocks have to live somewhere every thread can see
+    tile_cache_mib = DEFAULT_PIPELINE_CACHE_MIB;
+  }
+  if (file_list_path) {
+    cfg.file_list = load_file_list(file_list_path, &cfg.file_count);
+    if (!cfg.file_list) {
+      return 1;
+    }
+  }
+
+  GDALAllRegister();
+  if (!vsi_count_install()) {
+    fprintf(stderr, "Warning: Failed to register %s\n", VSI_COUNT_PREFIX);
+  }
+  int uses_sim = strstr(cfg.path, VSI_SIM_PREFIX) ||
+                 (file_list_path && cfg.file_count > 0 &&
+                  strstr(cfg.file_list[0], VSI_SIM_PREFIX));
+  if (!vsi_sim_install()) {
+    if (uses_sim) {
+      fprintf(stderr, "Error: Failed to register %s\n", VSI_SIM_PREFIX);
+      GDALDestroyDriverManager();
+      return 1;
+    }
+    fprintf(stderr, "Warning: Failed to register %s\n", VSI_SIM_PREFIX);
+  }
+
+  int available_bands;
+  char interleave[32];
+  if (!resolve_bands(cfg.path, bands_spec, &cfg.bands, &cfg.vrt_bands,
+                     &available_bands, interleave, sizeof(interleave))) {
+    free(cfg.bands.list);
+    free(cfg.vrt_bands.list);
+    GDALDestroyDriverManager();
+    return 1;
+  }
+  cfg.bands.layout = band_layout;
+  cfg.vrt_bands.layout = band_layout;
+  if ((cfg.native_type || occupancy) && cfg.bands.count > 1) {
+    fprintf(stderr, "Error: --native-type and --occupancy read a single "
+                    "band\n");
+    free(cfg.bands.list);
+    free(cfg.vrt_bands.list);
+    GDALDestroyDriverManager();
+    return 1;
+  }
+
+  print_cache_sizes();
+  if (uses_sim) {
+    const VsiSimConfig *sim = vsi_sim_config();
+    printf("Simulated remote storage: %.2f ms latency, %.2f MiB/s, min "
+           "request %zu bytes, chunk %zu bytes, chunk cache %zu bytes\n",
+           sim->latency_ms, sim->bandwidth_mbps, sim->min_request,
+           sim->chunk_size, sim->cache_size);
+  }
+
+  TileCache tile_cache;
+  memset(&tile_cache, 0, sizeof(tile_cache));
+  if (tile_cache_mib > 0.0) {
+    if (!tile_cache_init(&tile_cache,
+                         (size_t)(tile_cache_mib * 1024.0 * 1024.0),
+                         tile_cache_shards)) {
+      fprintf(stderr, "Error: Failed to create tile cache\n");
+      GDALDestroyDriverManager();
+      return 1;
+    }
+    printf("Tile cache: %.2f MiB over %d shards\n", tile_cache_mib,
+           tile_cache_shards);
+    cfg.tile_cache = &tile_cache;
+  }
+
+  MmapStore mmap_store;
+  memset(&mmap_store, 0, sizeof(mmap_store));
+  if (cfg.mode == MODE_MMAP_CACHE) {
+    int reused = 0;
+    uint64_t t0 = monotonic_ns();
+    if (!mmap_store_open(&mmap_store, cfg.path, &cfg.bbox, mmap_dir,
+                         &reused)) {
+      GDALDestroyDriverManager();
+      return 1;
+    }
+    printf("mmap store: %dx%d window (%.2f MiB) %s in %.3f seconds\n",
+           mmap_store.geo.raster_x, mmap_store.geo.raster_y,
+           (double)mmap_store.map_size / (1024.0 * 1024.0),
+           reused ? "reused" : "built", (double)(monotonic_ns() - t0) / 1e9);
+    cfg.mmap_store = &mmap_store;
+  }
+
+  TileOccupancy occ;
+  memset(&occ, 0, sizeof(occ));
+  if (occupancy) {
+    uint64_t t0 = monotonic_ns();
+    if (!tile_occupancy_build(&occ, cfg.path, cfg.bands.list[0],
+                              occupancy == 2)) {
+      GDALDestroyDriverManager();
+      return 1;
+    }
+    long long blocks = (long long)occ.blocks_x * occ.blocks_y;
+    printf("Occupancy: %lld of %lld blocks empty (%lld sparse, %lld all "
+           "%s), built in %.3f seconds\n",
+           tile_occupancy_empty_blocks(&occ), blocks, occ.sparse_blocks,
+           occ.fill_blocks, occ.has_nodata ? "nodata" : "zero",
+           (double)(monotonic_ns() - t0) / 1e9);
+    if (occ.unknown_blocks > 0) {
+      printf("Occupancy: the driver reports no coverage for %lld blocks, "
+             "kept as holding data\n",
+             occ.unknown_blocks);
+    }
+    cfg.occupancy = &occ;
+  }
+
+  Catalog catalog;
+  memset(&catalog, 0, sizeof(catalog));
+  if (cfg.mode == MODE_CATALOG || cfg.mode == MODE_CATALOG_VRT) {
+    uint64_t t0 = monotonic_ns();
+    if (!catalog_load(&catalog, cfg.path)) {
+      GDALDestroyDriverManager();
+      return 1;
+    }
+    printf("Catalog: %d files loaded and indexed in %.3f seconds, extent "
+           "(%.2f, %.2f) - (%.2f, %.2f)\n",
+           catalog.count, (double)(monotonic_ns() - t0) / 1e9,
+           catalog.extent.xmin, catalog.extent.ymin, catalog.extent.xmax,
+           catalog.extent.ymax);
+    cfg.catalog = &catalog;
+  }
+
+  QueryDist dist;
+  if (!query_dist_init(&dist, &dist_params, &cfg.bbox, cfg.seed)) {
+    fprintf(stderr, "Error: Failed to set up the query distribution\n");
+    GDALDestroyDriverManager();
+    return 1;
+  }
+  cfg.dist = &dist;
+
+  // Block geometry for the reuse measurement. Catalog and file-list modes
+  // spread queries over many files and are left out.
+  GeoContext block_geo;
+  if (cfg.file_count == 0 && cfg.mode != MODE_CATALOG &&
+      cfg.mode != MODE_CATALOG_VRT) {
+    GDALDatasetH ds = GDALOpen(cfg.path, GA_ReadOnly);
+    if (ds && geo_context_init(&block_geo, ds)) {
+      GDALGetBlockSize(GDALGetRasterBand(ds, 1), &cfg.block_width,
+                       &cfg.block_height);
+      cfg.block_geo = &block_geo;
+    }
+    if (ds) {
+      GDALClose(ds);
+    }
+  }
+
+  printf("Running %d iterations in mode '%s'", cfg.iterations, cfg.mode_name);
+  if (threads > 1) {
+    printf(" on each of %d threads", threads);
+  }
+  printf("\n");
+  if (cfg.file_count > 0) {
+    printf("Querying %d files from '%s'\n", cfg.file_count, file_list_path);
+  }
+  printf("Bounding box: (%.2f, %.2f) - (%.2f, %.2f)\n", cfg.bbox.xmin,
+         cfg.bbox.ymin, cfg.bbox.xmax, cfg.bbox.ymax);
+  if (cfg.mode == MODE_DIRECT_WINDOW) {
+    printf("Window: %dx%d pixels read into %dx%d (%s), %s reduction "
+           "kernel\n",
+           cfg.window_width, cfg.window_height, cfg.window_buffer_width,
+           cfg.window_buffer_height, resampling_name, window_kernel_name);
+  }
+  if (bands_spec) {
+    printf("Bands:");
+    for (int b = 0; b < cfg.bands.count; b++) {
+      printf("%s%d", b ? "," : " ", cfg.bands.list[b]);
+    }
+    printf(" of %d (source INTERLEAVE=%s), %s layout\n", available_bands,
+           interleave, band_layout_names[band_layout]);
+  }
+  if (cfg.mode == MODE_DIRECT_BANDS) {
+    printf("Band window: %dx%d pixels\n", cfg.window_width,
+           cfg.window_height);
+  }
+  if (cfg.replay) {
+    double duration = trace_duration(&trace);
+    printf("Replaying %d queries from '%s' (%.3f seconds", trace.count,
+           replay_path, duration);
+    if (cfg.replay_rate > 0.0) {
+      printf(", sent at %.1f queries/s)\n", cfg.replay_rate);
+    } else {
+      printf(", %.1f queries/s)\n",
+             duration > 0.0 ? (trace.count - 1) / duration : 0.0);
+    }
+  } else if (!distribution_sweep) {
+    char description[128];
+    query_dist_describe(&dist, description, sizeof(description));
+    printf("Distribution: %s\n", description);
+  }
+
+  // Histograms are large; keep them off the stack.
+  RunResult *results = (RunResult *)calloc(MAX_RUNS, sizeof(RunResult));
+  if (!results) {
+    fprintf(stderr, "Error: Out of memory\n");
+    return 1;
+  }
+  int result_count = 0;
+  int ok;
+  if (batch_sweep) {
+    ok = run_batch_sweep(&cfg, threads, results, &result_count);
+  } else if (pool_sweep) {
+    ok = run_pool_sweep(&cfg, threads, results, &result_count);
+  } else if (tile_cache_compare) {
+    ok = run_tile_cache_compare(&cfg, threads, results, &result_count);
+  } else if (vrt_xml_compare) {
+    ok = run_vrt_xml_compare(&cfg, threads, results, &result_count);
+  } else if (vrt_tile_sweep) {
+    ok = run_vrt_tile_sweep(&cfg, threads, results, &result_count);
+  } else if (band_compare) {
+    ok = run_band_compare(&cfg, threads, results, &result_count);
+  } else if (overview_sweep) {
+    ok = run_overview_sweep(&cfg, threads, results, &result_count);
+  } else if (raw_tile_compare) {
+    ok = run_raw_tile_compare(&cfg, threads, results, &result_count);
+  } else if (occupancy_compare) {
+    ok = run_occupancy_compare(&cfg, threads, results, &result_count);
+  } else if (distribution_sweep) {
+    ok = run_distribution_sweep(&cfg, threads, results, &result_count);
+  } else if (rate_sweep) {
+    ok = run_rate_sweep(&cfg, threads, results, &result_count);
+  } else {
+    ok = run_scaling(&cfg, threads, results, &result_count);
+  }
+  int exit_code = ok ? 0 : 1;
+
+  if (ok && json_path &&
+      !write_json_report(json_path, &cfg, results, result_count)) {
+    exit_code = 1;
+  }
+  if (ok && csv_path && !write_csv_report(csv_path, results, result_count)) {
+    exit_code = 1;
+  }
+
+  free(results);
+  free(cfg.bands.list);
+  free(cfg.vrt_bands.list);
+  CSLDestroy(cfg.file_list);
+  catalog_destroy(&catalog);
+  tile_cache_destroy(&tile_cache);
+  mmap_store_close(&mmap_store);
+  tile_occupancy_free(&occ);
+  query_dist_destroy(&dist);
+  trace_destroy(&trace);
+  GDALDestroyDriverManager();
+
+  return exit_code;
+}
@@ -0,0 +1,150 @@
+#include "gdal.h"
+#include "gdal_vrt.h"
+#include "geo_transform.h"
+#include "latency_histogram.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Compares the per-point geo_to_pixel against the precomputed GeoContext
+// and the batch kernels on `count` random points. The dataset is an
+// in-memory VRT with the geotransform of a 1km global raster, so no file is
+// needed.
+
+#define BENCH_RASTER_X 43200
+#define BENCH_RASTER_Y 18720
+#define BENCH_ROUNDS 5
+
+typedef struct {
+  const char *name;
+  double best_seconds;
+} BenchResult;
+
+static int check_same(const char *name, const int *ref_x, const int *ref_y,
+                      const uint8_t *ref_in, const int *x, const int *y,
+                      const uint8_t *in, int count) {
+  for (int i = 0; i < count; i++) {
+    if (ref_x[i] != x[i] || ref_y[i] != y[i] || ref_in[i] != in[i]) {
+      fprintf(stderr,
+              "Error: %s differs from geo_to_pixel at point %d: "
+              "(%d, %d, %d) != (%d, %d, %d)\n",
+              name, i, x[i], y[i], in[i], ref_x[i], ref_y[i], ref_in[i]);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static void print_result(const char *name, double seconds, int count,
+                         double baseline_seconds) {
+  printf("%-22s %10.3f ms %10.2f ns/point %10.1f Mpoints/s %8.1fx\n", name,
+         seconds * 1000.0, seconds * 1e9 / count, count / seconds / 1e6,
+         baseline_seconds / seconds);
+}
+
+int main(int argc, char *argv[]) {
+  int count = argc > 1 ? atoi(argv[1]) : 1000000;
+  if (count <= 0) {
+    fprintf(stderr, "Usage: %s [points]\n", argv[0]);
+    return 1;
+  }
+
+  GDALAllRegister();
+
+  GDALDatasetH ds = VRTCreate(BENCH_RASTER_X, BENCH_RASTER_Y);
+  if (!ds) {
+    fprintf(stderr, "Error: Failed to create VRT dataset\n");
+    return 1;
+  }
+  double gt[6] = {-180.001249, 0.008333333, 0.0, 83.99958, 0.0, -0.008333333};
+  GDALSetGeoTransform(ds, gt);
+
+  GeoContext ctx;
+  if (!geo_context_init(&ctx, ds)) {
+    GDALClose(ds);
+    return 1;
+  }
+
+  double *geo_x = (double *)malloc(sizeof(double) * (size_t)count);
+  double *geo_y = (double *)malloc(sizeof(double) * (size_t)count);
+  int *ref_x = (int *)malloc(sizeof(int) * (size_t)count);
+  int *ref_y = (int *)malloc(sizeof(int) * (size_t)count);
+  uint8_t *ref_in = (uint8_t *)malloc((size_t)count);
+  int *px = (int *)malloc(sizeof(int) * (size_t)count);
+  int *py = (int *)malloc(sizeof(int) * (size_t)count);
+  uint8_t *in = (uint8_t *)malloc((size_t)count);
+  if (!geo_x || !geo_y || !ref_x || !ref_y || !ref_in || !px || !py || !in) {
+    fprintf(stderr, "Error: Out of memory\n");
+    return 1;
+  }
+
+  // Slightly larger than the raster extent so the bounds mask is exercised
+  unsigned int rng = 42;
+  for (int i = 0; i < count; i++) {
+    geo_x[i] = -185.0 + ((double)rand_r(&rng) / RAND_MAX) * 370.0;
+    geo_y[i] = -75.0 + ((double)rand_r(&rng) / RAND_MAX) * 165.0;
+  }
+
+  printf("Converting %d points (best of %d rounds)\n", count, BENCH_ROUNDS);
+
+  double baseline = 0.0;
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    uint64_t t0 = monotonic_ns();
+    for (int i = 0; i < count; i++) {
+      geo_to_pixel(ds, geo_x[i], geo_y[i], &ref_x[i], &ref_y[i]);
+    }
+    double seconds = (double)(monotonic_ns() - t0) / 1e9;
+    if (round == 0 || seconds < baseline) {
+      baseline = seconds;
+    }
+  }
+  for (int i = 0; i < count; i++) {
+    ref_in[i] = (uint8_t)(ref_x[i] >= 0 && ref_y[i] >= 0 &&
+                          ref_x[i] < BENCH_RASTER_X &&
+                          ref_y[i] < BENCH_RASTER_Y);
+  }
+  print_result("geo_to_pixel", baseline, count, baseline);
+
+  struct {
+    const char *name;
+    GeoToPixelsFunc func;
+  } kernels[] = {
+      {"kernel_scalar", geo_context_to_pixels_scalar},
+      {"kernel_sse2", geo_kernel_sse2()},
+      {"kernel_avx2", geo_kernel_avx2()},
+      {"kernel_dispatch", geo_context_to_pixels},
+  };
+
+  int ok = 1;
+  for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+    if (!kernels[k].func) {
+      printf("%-22s (not supported on this CPU)\n", kernels[k].name);
+      continue;
+    }
+    double best = 0.0;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+      memset(px, 0, sizeof(int) * (size_t)count);
+      uint64_t t0 = monotonic_ns();
+      kernels[k].func(&ctx, geo_x, geo_y, count, px, py, in);
+      double seconds = (double)(monotonic_ns() - t0) / 1e9;
+      if (round == 0 || seconds < best) {
+        best = seconds;
+      }
+    }
+    print_result(kernels[k].name, best, count, baseline);
+    ok &= check_same(kernels[k].name, ref_x, ref_y, ref_in, px, py, in, count);
+  }
+
+  free(geo_x);
+  free(geo_y);
+  free(ref_x);
+  free(ref_y);
+  free(ref_in);
+  free(px);
+  free(py);
+  free(in);
+  GDALClose(ds);
+  GDALDestroyDriverManager();
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,302 @@
+#include "geo_transform.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define GEO_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+// Converts world coordinates to fractional pixel coordinates. Returns 0,
+// with a warning, if the dataset has no usable geotransform.
+static int geo_to_pixel_fraction(GDALDatasetH dataset, double geo_x,
+                                 double geo_y, double *pixel_x,
+                                 double *pixel_y) {
+  double adfGeoTransform[6];
+  double adfInvGeoTransform[6];
+
+  // Get the geotransform (pixel -> world)
+  if (GDALGetGeoTransform(dataset, adfGeoTransform) != CE_None) {
+    fprintf(stderr, "Warning: Dataset has no geotransform\n");
+    return 0;
+  }
+
+  // Invert the geotransform (world -> pixel) using GDAL's built-in function
+  if (!GDALInvGeoTransform(adfGeoTransform, adfInvGeoTransform)) {
+    fprintf(stderr, "Warning: Geotransform is not invertible\n");
+    return 0;
+  }
+
+  // Apply the inverted transform to convert world coordinates to pixel
+  // coordinates
+  GDALApplyGeoTransform(adfInvGeoTransform, geo_x, geo_y, pixel_x, pixel_y);
+  return 1;
+}
+
+void geo_to_pixel(GDALDatasetH dataset, double geo_x, double geo_y,
+                  int *pixel_x, int *pixel_y) {
+  double pixel_x_d, pixel_y_d;
+  if (!geo_to_pixel_fraction(dataset, geo_x, geo_y, &pixel_x_d, &pixel_y_d)) {
+    *pixel_x = 0;
+    *pixel_y = 0;
+    return;
+  }
+
+  *pixel_x = (int)pixel_x_d;
+  *pixel_y = (int)pixel_y_d;
+}
+
+void overview_select(GDALDatasetH dataset, GDALRasterBandH band,
+                     double target_resolution, OverviewLevel *ov) {
+  int full_x = GDALGetRasterXSize(dataset);
+  int full_y = GDALGetRasterYSize(dataset);
+  ov->level = -1;
+  ov->raster_x = full_x;
+  ov->raster_y = full_y;
+  ov->scale_x = 1.0;
+  ov->scale_y = 1.0;
+  double gt[6];
+  if (target_resolution <= 0.0 ||
+      GDALGetGeoTransform(dataset, gt) != CE_None) {
+    return;
+  }
+  double full_resolution = fabs(gt[1]);
+  int count = GDALGetOverviewCount(band);
+  for (int i = 0; i < count; i++) {
+    GDALRasterBandH overview = GDALGetOverview(band, i);
+    if (!overview) {
+      continue;
+    }
+    int overview_x = GDALGetRasterBandXSize(overview);
+    int overview_y = GDALGetRasterBandYSize(overview);
+    // Overviews are not guaranteed to be sorted by size
+    if (overview_x <= 0 || overview_y <= 0 || overview_x >= ov->raster_x) {
+      continue;
+    }
+    double resolution = full_resolution * full_x / overview_x;
+    if (resolution > target_resolution * (1.0 + 1e-9)) {
+      continue;
+    }
+    ov->level = i;
+    ov->raster_x = overview_x;
+    ov->raster_y = overview_y;
+    ov->scale_x = (double)overview_x / full_x;
+    ov->scale_y = (double)overview_y / full_y;
+  }
+}
+
+void geo_to_overview_pixel(GDALDatasetH dataset, const OverviewLevel *ov,
+                           double geo_x, double geo_y, int *pixel_x,
+                           int *pixel_y) {
+  double pixel_x_d, pixel_y_d;
+  if (!geo_to_pixel_fraction(dataset, geo_x, geo_y, &pixel_x_d, &pixel_y_d)) {
+    *pixel_x = 0;
+    *pixel_y = 0;
+    return;
+  }
+
+  *pixel_x = (int)(pixel_x_d * ov->scale_x);
+  *pixel_y = (int)(pixel_y_d * ov->scale_y);
+}
+
+void overview_scale_window(const OverviewLevel *ov, int *xoff, int *yoff,
+                           int *width, int *height) {
+  int x0 = (int)floor(*xoff * ov->scale_x);
+  int y0 = (int)floor(*yoff * ov->scale_y);
+  int x1 = (int)ceil((*xoff + *width) * ov->scale_x);
+  int y1 = (int)ceil((*yoff + *height) * ov->scale_y);
+  // Rounding may step one pixel past the edge of the overview
+  x1 = x1 < ov->raster_x ? x1 : ov->raster_x;
+  y1 = y1 < ov->raster_y ? y1 : ov->raster_y;
+  *xoff = x0;
+  *yoff = y0;
+  *width = x1 > x0 ? x1 - x0 : 1;
+  *height = y1 > y0 ? y1 - y0 : 1;
+}
+
+void overview_geo_transform(const OverviewLevel *ov,
+                            const double *geo_transform, double *out) {
+  out[0] = geo_transform[0];
+  out[1] = geo_transform[1] / ov->scale_x;
+  out[2] = geo_transform[2] / ov->scale_y;
+  out[3] = geo_transform[3];
+  out[4] = geo_transform[4] / ov->scale_x;
+  out[5] = geo_transform[5] / ov->scale_y;
+}
+
+void bbox_to_pixel_window(GDALDatasetH dataset, const BoundingBox *bbox,
+                          int *xoff, int *yoff, int *width, int *height) {
+  int xmax_pix, ymax_pix;
+  geo_to_pixel(dataset, bbox->xmin, bbox->ymax, xoff, yoff);
+  geo_to_pixel(dataset, bbox->xmax, bbox->ymin, &xmax_pix, &ymax_pix);
+
+  *width = xmax_pix - *xoff;
+  *height = ymax_pix - *yoff;
+
+  if (*width <= 0)
+    *width = 1;
+  if (*height <= 0)
+    *height = 1;
+}
+
+int geo_context_init(GeoContext *ctx, GDALDatasetH dataset) {
+  if (GDALGetGeoTransform(dataset, ctx->geo_transform) != CE_None) {
+    fprintf(stderr, "Warning: Dataset has no geotransform\n");
+    return 0;
+  }
+  if (!GDALInvGeoTransform(ctx->geo_transform, ctx->inv_geo_transform)) {
+    fprintf(stderr, "Warning: Geotransform is not invertible\n");
+    return 0;
+  }
+  ctx->raster_x = GDALGetRasterXSize(dataset);
+  ctx->raster_y = GDALGetRasterYSize(dataset);
+  return 1;
+}
+
+void geo_context_to_pixels_scalar(const GeoContext *ctx, const double *geo_x,
+                                  const double *geo_y, int count, int *pixel_x,
+                                  int *pixel_y, uint8_t *in_bounds) {
+  for (int i = 0; i < count; i++) {
+    int x, y;
+    geo_context_to_pixel(ctx, geo_x[i], geo_y[i], &x, &y);
+    pixel_x[i] = x;
+    pixel_y[i] = y;
+    in_bounds[i] =
+        (uint8_t)(x >= 0 && y >= 0 && x < ctx->raster_x && y < ctx->raster_y);
+  }
+}
+
+#ifdef GEO_KERNEL_X86
+
+// Writes one 0/1 byte per lane of a 4 x int32 comparison mask.
+static inline void store_mask4(uint8_t *dst, __m128i inside) {
+  int mask = _mm_movemask_ps(_mm_castsi128_ps(inside));
+  dst[0] = (uint8_t)(mask & 1);
+  dst[1] = (uint8_t)((mask >> 1) & 1);
+  dst[2] = (uint8_t)((mask >> 2) & 1);
+  dst[3] = (uint8_t)((mask >> 3) & 1);
+}
+
+// 0 <= x < max_x && 0 <= y < max_y, per lane.
+static inline __m128i inside_mask4(__m128i ix, __m128i iy, __m128i max_x,
+                                   __m128i max_y) {
+  const __m128i minus_one = _mm_set1_epi32(-1);
+  __m128i x_ok = _mm_and_si128(_mm_cmpgt_epi32(ix, minus_one),
+                               _mm_cmplt_epi32(ix, max_x));
+  __m128i y_ok = _mm_and_si128(_mm_cmpgt_epi32(iy, minus_one),
+                               _mm_cmplt_epi32(iy, max_y));
+  return _mm_and_si128(x_ok, y_ok);
+}
+
+// The multiply and add order matches geo_context_to_pixel and no FMA is
+// used, so every kernel produces bit-identical pixel coordinates.
+static void geo_to_pixels_sse2(const GeoContext *ctx, const double *geo_x,
+                               const double *geo_y, int count, int *pixel_x,
+                               int *pixel_y, uint8_t *in_bounds) {
+  const double *gt = ctx->inv_geo_transform;
+  const __m128d gt0 = _mm_set1_pd(gt[0]), gt1 = _mm_set1_pd(gt[1]),
+                gt2 = _mm_set1_pd(gt[2]), gt3 = _mm_set1_pd(gt[3]),
+                gt4 = _mm_set1_pd(gt[4]), gt5 = _mm_set1_pd(gt[5]);
+  const __m128i max_x = _mm_set1_epi32(ctx->raster_x);
+  const __m128i max_y = _mm_set1_epi32(ctx->raster_y);
+
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128d x0 = _mm_loadu_pd(geo_x + i), x1 = _mm_loadu_pd(geo_x + i + 2);
+    __m128d y0 = _mm_loadu_pd(geo_y + i), y1 = _mm_loadu_pd(geo_y + i + 2);
+    __m128d px0 = _mm_add_pd(_mm_add_pd(gt0, _mm_mul_pd(x0, gt1)),
+                             _mm_mul_pd(y0, gt2));
+    __m128d px1 = _mm_add_pd(_mm_add_pd(gt0, _mm_mul_pd(x1, gt1)),
+                             _mm_mul_pd(y1, gt2));
+    __m128d py0 = _mm_add_pd(_mm_add_pd(gt3, _mm_mul_pd(x0, gt4)),
+                             _mm_mul_pd(y0, gt5));
+    __m128d py1 = _mm_add_pd(_mm_add_pd(gt3, _mm_mul_pd(x1, gt4)),
+                             _mm_mul_pd(y1, gt5));
+    __m128i ix =
+        _mm_unpacklo_epi64(_mm_cvttpd_epi32(px0), _mm_cvttpd_epi32(px1));
+    __m128i iy =
+        _mm_unpacklo_epi64(_mm_cvttpd_epi32(py0), _mm_cvttpd_epi32(py1));
+    _mm_storeu_si128((__m128i *)(pixel_x + i), ix);
+    _mm_storeu_si128((__m128i *)(pixel_y + i), iy);
+    store_mask4(in_bounds + i, inside_mask4(ix, iy, max_x, max_y));
+  }
+  geo_context_to_pixels_scalar(ctx, geo_x + i, geo_y + i, count - i,
+                               pixel_x + i, pixel_y + i, in_bounds + i);
+}
+
+__attribute__((target("avx2"))) static void
+geo_to_pixels_avx2(const GeoContext *ctx, const double *geo_x,
+                   const double *geo_y, int count, int *pixel_x, int *pixel_y,
+                   uint8_t *in_bounds) {
+  const double *gt = ctx->inv_geo_transform;
+  const __m256d gt0 = _mm256_set1_pd(gt[0]), gt1 = _mm256_set1_pd(gt[1]),
+                gt2 = _mm256_set1_pd(gt[2]), gt3 = _mm256_set1_pd(gt[3]),
+                gt4 = _mm256_set1_pd(gt[4]), gt5 = _mm256_set1_pd(gt[5]);
+  const __m256i max_x = _mm256_set1_epi32(ctx->raster_x);
+  const __m256i max_y = _mm256_set1_epi32(ctx->raster_y);
+  const __m256i minus_one = _mm256_set1_epi32(-1);
+
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256d x0 = _mm256_loadu_pd(geo_x + i);
+    __m256d x1 = _mm256_loadu_pd(geo_x + i + 4);
+    __m256d y0 = _mm256_loadu_pd(geo_y + i);
+    __m256d y1 = _mm256_loadu_pd(geo_y + i + 4);
+    __m256d px0 = _mm256_add_pd(_mm256_add_pd(gt0, _mm256_mul_pd(x0, gt1)),
+                                _mm256_mul_pd(y0, gt2));
+    __m256d px1 = _mm256_add_pd(_mm256_add_pd(gt0, _mm256_mul_pd(x1, gt1)),
+                                _mm256_mul_pd(y1, gt2));
+    __m256d py0 = _mm256_add_pd(_mm256_add_pd(gt3, _mm256_mul_pd(x0, gt4)),
+                                _mm256_mul_pd(y0, gt5));
+    __m256d py1 = _mm256_add_pd(_mm256_add_pd(gt3, _mm256_mul_pd(x1, gt4)),
+                                _mm256_mul_pd(y1, gt5));
+    __m256i ix = _mm256_set_m128i(_mm256_cvttpd_epi32(px1),
+                                  _mm256_cvttpd_epi32(px0));
+    __m256i iy = _mm256_set_m128i(_mm256_cvttpd_epi32(py1),
+                                  _mm256_cvttpd_epi32(py0));
+    _mm256_storeu_si256((__m256i *)(pixel_x + i), ix);
+    _mm256_storeu_si256((__m256i *)(pixel_y + i), iy);
+
+    __m256i x_ok = _mm256_and_si256(_mm256_cmpgt_epi32(ix, minus_one),
+                                    _mm256_cmpgt_epi32(max_x, ix));
+    __m256i y_ok = _mm256_and_si256(_mm256_cmpgt_epi32(iy, minus_one),
+                                    _mm256_cmpgt_epi32(max_y, iy));
+    int mask = _mm256_movemask_ps(
+        _mm256_castsi256_ps(_mm256_and_si256(x_ok, y_ok)));
+    for (int lane = 0; lane < 8; lane++) {
+      in_bounds[i + lane] = (uint8_t)((mask >> lane) & 1);
+    }
+  }
+  geo_to_pixels_sse2(ctx, geo_x + i, geo_y + i, count - i, pixel_x + i,
+                     pixel_y + i, in_bounds + i);
+}
+
+GeoToPixelsFunc geo_kernel_sse2(void) { return geo_to_pixels_sse2; }
+
+GeoToPixelsFunc geo_kernel_avx2(void) {
+  return __builtin_cpu_supports("avx2") ? geo_to_pixels_avx2 : NULL;
+}
+
+#else
+
+GeoToPixelsFunc geo_kernel_sse2(void) { return NULL; }
+
+GeoToPixelsFunc geo_kernel_avx2(void) { return NULL; }
+
+#endif
+
+void geo_context_to_pixels(const GeoContext *ctx, const double *geo_x,
+                           const double *geo_y, int count, int *pixel_x,
+                           int *pixel_y, uint8_t *in_bounds) {
+  // Resolved per call: the CPU feature check is a load from a static
+  // structure and is negligible next to a batch.
+  GeoToPixelsFunc kernel = geo_kernel_avx2();
+  if (!kernel) {
+    kernel = geo_kernel_sse2();
+  }
+  if (!kernel) {
+    kernel = geo_context_to_pixels_scalar;
+  }
+  kernel(ctx, geo_x, geo_y, count, pixel_x, pixel_y, in_bounds);
+}
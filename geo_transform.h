@@ -0,0 +1,103 @@
+#ifndef GEO_TRANSFORM_H
+#define GEO_TRANSFORM_H
+
+#include "bounding_box.h"
+#include "gdal.h"
+#include <stdint.h>
+
+// Converts world coordinates to pixel coordinates, fetching and inverting
+// the dataset geotransform on every call.
+void geo_to_pixel(GDALDatasetH dataset, double geo_x, double geo_y,
+                  int *pixel_x, int *pixel_y);
+
+// Pixel window of the dataset covering bbox, as used for the VRT modes. The
+// window is not clipped to the raster and is at least 1x1.
+void bbox_to_pixel_window(GDALDatasetH dataset, const BoundingBox *bbox,
+                          int *xoff, int *yoff, int *width, int *height);
+
+// Resolution level of a raster picked for a target resolution.
+typedef struct {
+  // Index for GDALGetOverview, or -1 for full resolution
+  int level;
+  int raster_x;
+  int raster_y;
+  // Pixels of this level per full resolution pixel, at most 1
+  double scale_x;
+  double scale_y;
+} OverviewLevel;
+
+// Picks the coarsest overview of `band` whose pixels are at most
+// target_resolution georeferenced units wide, so reads keep the detail the
+// caller asked for. Falls back to full resolution when no overview
+// qualifies or target_resolution is not positive. Assumes north-up.
+void overview_select(GDALDatasetH dataset, GDALRasterBandH band,
+                     double target_resolution, OverviewLevel *ov);
+
+// Like geo_to_pixel, in the pixel space of overview level ov.
+void geo_to_overview_pixel(GDALDatasetH dataset, const OverviewLevel *ov,
+                           double geo_x, double geo_y, int *pixel_x,
+                           int *pixel_y);
+
+// Scales a full resolution pixel window to overview level ov. The window
+// grows to whole overview pixels, clipped to the overview, and stays at
+// least 1x1.
+void overview_scale_window(const OverviewLevel *ov, int *xoff, int *yoff,
+                           int *width, int *height);
+
+// Geotransform of overview level ov, given the full resolution one.
+void overview_geo_transform(const OverviewLevel *ov,
+                            const double *geo_transform, double *out);
+
+// Geotransform of a dataset, inverted once so that per-point conversion is
+// a plain affine transform.
+typedef struct {
+  double geo_transform[6];
+  double inv_geo_transform[6];
+  int raster_x;
+  int raster_y;
+} GeoContext;
+
+// Returns 0 if the dataset has no invertible geotransform.
+int geo_context_init(GeoContext *ctx, GDALDatasetH dataset);
+
+// Same result as geo_to_pixel, without any GDAL call.
+static inline void geo_context_to_pixel(const GeoContext *ctx, double geo_x,
+                                        double geo_y, int *pixel_x,
+                                        int *pixel_y) {
+  const double *gt = ctx->inv_geo_transform;
+  *pixel_x = (int)(gt[0] + geo_x * gt[1] + geo_y * gt[2]);
+  *pixel_y = (int)(gt[3] + geo_x * gt[4] + geo_y * gt[5]);
+}
+
+// Same result as geo_to_overview_pixel, from the context of the full
+// resolution grid, without any GDAL call.
+static inline void geo_context_to_overview_pixel(const GeoContext *ctx,
+                                                 const OverviewLevel *ov,
+                                                 double geo_x, double geo_y,
+                                                 int *pixel_x, int *pixel_y) {
+  const double *gt = ctx->inv_geo_transform;
+  *pixel_x = (int)((gt[0] + geo_x * gt[1] + geo_y * gt[2]) * ov->scale_x);
+  *pixel_y = (int)((gt[3] + geo_x * gt[4] + geo_y * gt[5]) * ov->scale_y);
+}
+
+typedef void (*GeoToPixelsFunc)(const GeoContext *ctx, const double *geo_x,
+                                const double *geo_y, int count, int *pixel_x,
+                                int *pixel_y, uint8_t *in_bounds);
+
+// Converts `count` points from structure-of-arrays world coordinates to
+// pixel coordinates, truncating like geo_to_pixel, and sets in_bounds[i] to
+// 1 if the pixel lies inside the raster and 0 otherwise. Dispatches to the
+// widest kernel the CPU supports.
+void geo_context_to_pixels(const GeoContext *ctx, const double *geo_x,
+                           const double *geo_y, int count, int *pixel_x,
+                           int *pixel_y, uint8_t *in_bounds);
+
+// Individual kernels, exposed for benchmarking. The SIMD kernels are NULL
+// when not compiled in or not supported by the CPU.
+void geo_context_to_pixels_scalar(const GeoContext *ctx, const double *geo_x,
+                                  const double *geo_y, int count, int *pixel_x,
+                                  int *pixel_y, uint8_t *in_bounds);
+GeoToPixelsFunc geo_kernel_sse2(void);
+GeoToPixelsFunc geo_kernel_avx2(void);
+
+#endif
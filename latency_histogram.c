@@ -0,0 +1,107 @@
+#include "latency_histogram.h"
+
+#include <string.h>
+
+static int bucket_index(uint64_t value) {
+  if (value < 2 * LATENCY_SUB_BUCKET_HALF) {
+    return (int)value;
+  }
+  int msb = 63 - __builtin_clzll(value);
+  if (msb >= LATENCY_MAX_MAGNITUDE) {
+    return LATENCY_BUCKET_COUNT - 1;
+  }
+  int magnitude = msb - LATENCY_SUB_BUCKET_BITS + 1;
+  int sub_bucket = (int)(value >> magnitude);
+  return magnitude * LATENCY_SUB_BUCKET_HALF + sub_bucket;
+}
+
+// Largest value that maps to the given bucket.
+static uint64_t bucket_upper_bound(int index) {
+  if (index < 2 * LATENCY_SUB_BUCKET_HALF) {
+    return (uint64_t)index;
+  }
+  int magnitude = index / LATENCY_SUB_BUCKET_HALF - 1;
+  uint64_t sub_bucket =
+      (uint64_t)(index - magnitude * LATENCY_SUB_BUCKET_HALF);
+  return ((sub_bucket + 1) << magnitude) - 1;
+}
+
+void latency_histogram_init(LatencyHistogram *h) {
+  memset(h, 0, sizeof(*h));
+  h->min_ns = UINT64_MAX;
+}
+
+void latency_histogram_record(LatencyHistogram *h, uint64_t value_ns) {
+  h->counts[bucket_index(value_ns)]++;
+  h->total_count++;
+  h->sum_ns += (double)value_ns;
+  if (value_ns < h->min_ns) {
+    h->min_ns = value_ns;
+  }
+  if (value_ns > h->max_ns) {
+    h->max_ns = value_ns;
+  }
+}
+
+void latency_histogram_merge(LatencyHistogram *dst,
+                             const LatencyHistogram *src) {
+  for (int i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+    dst->counts[i] += src->counts[i];
+  }
+  dst->total_count += src->total_count;
+  dst->sum_ns += src->sum_ns;
+  if (src->min_ns < dst->min_ns) {
+    dst->min_ns = src->min_ns;
+  }
+  if (src->max_ns > dst->max_ns) {
+    dst->max_ns = src->max_ns;
+  }
+}
+
+uint64_t latency_histogram_percentile(const LatencyHistogram *h,
+                                      double quantile) {
+  if (h->total_count == 0) {
+    return 0;
+  }
+  uint64_t rank = (uint64_t)(quantile * (double)h->total_count + 0.5);
+  if (rank < 1) {
+    rank = 1;
+  }
+  if (rank > h->total_count) {
+    rank = h->total_count;
+  }
+  uint64_t seen = 0;
+  for (int i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+    seen += h->counts[i];
+    if (seen >= rank) {
+      uint64_t value = bucket_upper_bound(i);
+      if (value > h->max_ns) {
+        value = h->max_ns;
+      }
+      if (value < h->min_ns) {
+        value = h->min_ns;
+      }
+      return value;
+    }
+  }
+  return h->max_ns;
+}
+
+double latency_histogram_mean(const LatencyHistogram *h) {
+  return h->total_count ? h->sum_ns / (double)h->total_count : 0.0;
+}
+
+void latency_histogram_write_json(FILE *out, const LatencyHistogram *h) {
+  fprintf(out,
+          "{\"count\": %llu, \"mean_us\": %.3f, \"min_us\": %.3f, "
+          "\"p50_us\": %.3f, \"p90_us\": %.3f, \"p99_us\": %.3f, "
+          "\"p999_us\": %.3f, \"max_us\": %.3f}",
+          (unsigned long long)h->total_count,
+          latency_histogram_mean(h) / 1000.0,
+          h->total_count ? (double)h->min_ns / 1000.0 : 0.0,
+          (double)latency_histogram_percentile(h, 0.50) / 1000.0,
+          (double)latency_histogram_percentile(h, 0.90) / 1000.0,
+          (double)latency_histogram_percentile(h, 0.99) / 1000.0,
+          (double)latency_histogram_percentile(h, 0.999) / 1000.0,
+          (double)h->max_ns / 1000.0);
+}
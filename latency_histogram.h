@@ -0,0 +1,47 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+// Log-linear (HDR-style) histogram of nanosecond latencies. Values below
+// 2^LATENCY_SUB_BUCKET_BITS are recorded exactly; larger values keep
+// LATENCY_SUB_BUCKET_BITS significant bits (< 0.8% relative error). Values up
+// to 2^LATENCY_MAX_MAGNITUDE ns (~18 minutes) are tracked, larger ones are
+// clamped into the last bucket.
+#define LATENCY_SUB_BUCKET_BITS 8
+#define LATENCY_SUB_BUCKET_HALF (1 << (LATENCY_SUB_BUCKET_BITS - 1))
+#define LATENCY_MAX_MAGNITUDE 40
+#define LATENCY_BUCKET_COUNT                                                   \
+  ((LATENCY_MAX_MAGNITUDE - LATENCY_SUB_BUCKET_BITS + 3) *                     \
+   LATENCY_SUB_BUCKET_HALF)
+
+typedef struct {
+  uint64_t counts[LATENCY_BUCKET_COUNT];
+  uint64_t total_count;
+  uint64_t min_ns;
+  uint64_t max_ns;
+  double sum_ns;
+} LatencyHistogram;
+
+static inline uint64_t monotonic_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void latency_histogram_init(LatencyHistogram *h);
+void latency_histogram_record(LatencyHistogram *h, uint64_t value_ns);
+void latency_histogram_merge(LatencyHistogram *dst,
+                             const LatencyHistogram *src);
+// Returns the smallest recorded value v such that at least `quantile` of the
+// samples are <= v (up to bucket precision). quantile is in [0, 1].
+uint64_t latency_histogram_percentile(const LatencyHistogram *h,
+                                      double quantile);
+double latency_histogram_mean(const LatencyHistogram *h);
+// Writes the summary as a JSON object (count, mean and percentiles in
+// microseconds) without a trailing newline.
+void latency_histogram_write_json(FILE *out, const LatencyHistogram *h);
+
+#endif
@@ -0,0 +1,320 @@
+#include "mmap_store.h"
+
+#include "cpl_conv.h"
+#include "cpl_vsi.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MMAP_STORE_MAGIC "GTMMAP01"
+#define MMAP_STORE_MAX_PATH 1024
+// Tiles start on a page boundary so that each maps cleanly.
+#define MMAP_STORE_DATA_OFFSET 4096
+
+// Written at the start of the file. The layout is only meant to be read
+// back by the same build on the same machine.
+typedef struct {
+  char magic[8];
+  uint32_t header_size;
+  uint32_t tile_size;
+  char source_path[MMAP_STORE_MAX_PATH];
+  int64_t source_size;
+  int64_t source_mtime;
+  BoundingBox bbox;
+  double geo_transform[6];
+  int32_t width;
+  int32_t height;
+  int32_t tiles_x;
+  int32_t tiles_y;
+  int32_t data_type;
+  int32_t has_nodata;
+  double nodata;
+} MmapStoreHeader;
+
+// FNV-1a over the source path and bbox, used to name the file
+static uint64_t store_key(const char *source_path, const BoundingBox *bbox) {
+  uint64_t h = 14695981039346656037ull;
+  for (const unsigned char *c = (const unsigned char *)source_path; *c; c++) {
+    h ^= *c;
+    h *= 1099511628211ull;
+  }
+  const unsigned char *b = (const unsigned char *)bbox;
+  for (size_t i = 0; i < sizeof(*bbox); i++) {
+    h ^= b[i];
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+// The types mmap_store_read_pixel converts; any other is rejected before
+// a store is built or mapped.
+static int store_type_supported(GDALDataType type) {
+  switch (type) {
+  case GDT_Byte:
+  case GDT_UInt16:
+  case GDT_Int16:
+  case GDT_UInt32:
+  case GDT_Int32:
+  case GDT_Float32:
+  case GDT_Float64:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+static int headers_match(const MmapStoreHeader *a, const MmapStoreHeader *b) {
+  return memcmp(a->magic, b->magic, sizeof(a->magic)) == 0 &&
+         a->header_size == b->header_size && a->tile_size == b->tile_size &&
+         strcmp(a->source_path, b->source_path) == 0 &&
+         a->source_size == b->source_size &&
+         a->source_mtime == b->source_mtime &&
+         memcmp(&a->bbox, &b->bbox, sizeof(a->bbox)) == 0;
+}
+
+// Fills the identifying part of the header from the source's current state.
+static int describe_source(MmapStoreHeader *header, const char *source_path,
+                           const BoundingBox *bbox) {
+  if (strlen(source_path) >= MMAP_STORE_MAX_PATH) {
+    fprintf(stderr, "Error: Source path too long for mmap store\n");
+    return 0;
+  }
+  VSIStatBufL st;
+  if (VSIStatL(source_path, &st) != 0) {
+    fprintf(stderr, "Error: Failed to stat '%s'\n", source_path);
+    return 0;
+  }
+  memset(header, 0, sizeof(*header));
+  memcpy(header->magic, MMAP_STORE_MAGIC, sizeof(header->magic));
+  header->header_size = sizeof(MmapStoreHeader);
+  header->tile_size = MMAP_STORE_TILE_SIZE;
+  strcpy(header->source_path, source_path);
+  header->source_size = (int64_t)st.st_size;
+  header->source_mtime = (int64_t)st.st_mtime;
+  header->bbox = *bbox;
+  return 1;
+}
+
+// Reads the window one row of tiles at a time and writes the tiles in
+// row-major order. Pixels outside the source raster get the nodata value
+// (or 0).
+static int write_tiles(FILE *out, GDALDatasetH ds, MmapStoreHeader *header,
+                       int xoff, int yoff) {
+  const int tile = MMAP_STORE_TILE_SIZE;
+  GDALRasterBandH band = GDALGetRasterBand(ds, 1);
+  GDALDataType type = (GDALDataType)header->data_type;
+  int type_size = GDALGetDataTypeSizeBytes(type);
+  int raster_x = GDALGetRasterXSize(ds);
+  int raster_y = GDALGetRasterYSize(ds);
+  size_t strip_width = (size_t)header->tiles_x * tile;
+  size_t tile_row_bytes = (size_t)tile * type_size;
+
+  unsigned char *strip =
+      (unsigned char *)malloc(strip_width * tile * type_size);
+  unsigned char *tile_buf = (unsigned char *)malloc(tile_row_bytes * tile);
+  if (!strip || !tile_buf) {
+    fprintf(stderr, "Error: Out of memory building mmap store\n");
+    free(strip);
+    free(tile_buf);
+    return 0;
+  }
+  double fill = header->has_nodata ? header->nodata : 0.0;
+
+  // Part of the window's columns that overlaps the raster
+  int read_x0 = xoff > 0 ? xoff : 0;
+  int read_x1 = xoff + header->width < raster_x ? xoff + header->width
+                                                 : raster_x;
+
+  int ok = 1;
+  for (int ty = 0; ok && ty < header->tiles_y; ty++) {
+    GDALCopyWords(&fill, GDT_Float64, 0, strip, type, type_size,
+                  (int)(strip_width * tile));
+    int row0 = yoff + ty * tile;
+    int rows = header->height - ty * tile < tile ? header->height - ty * tile
+                                                 : tile;
+    int read_y0 = row0 > 0 ? row0 : 0;
+    int read_y1 = row0 + rows < raster_y ? row0 + rows : raster_y;
+    if (read_x1 > read_x0 && read_y1 > read_y0) {
+      unsigned char *dst = strip +
+                           ((size_t)(read_y0 - row0) * strip_width +
+                            (read_x0 - xoff)) *
+                               type_size;
+      ok = GDALRasterIO(band, GF_Read, read_x0, read_y0, read_x1 - read_x0,
+                        read_y1 - read_y0, dst, read_x1 - read_x0,
+                        read_y1 - read_y0, type, type_size,
+                        (int)(strip_width * type_size)) == CE_None;
+    }
+    for (int tx = 0; ok && tx < header->tiles_x; tx++) {
+      for (int r = 0; r < tile; r++) {
+        memcpy(tile_buf + r * tile_row_bytes,
+               strip + ((size_t)r * strip_width + (size_t)tx * tile) *
+                           type_size,
+               tile_row_bytes);
+      }
+      ok = fwrite(tile_buf, tile_row_bytes * tile, 1, out) == 1;
+    }
+  }
+  free(strip);
+  free(tile_buf);
+  return ok;
+}
+
+// Builds the store in a temporary file and renames it into place, so a
+// concurrent or interrupted build never leaves a partial file at file_path.
+static int build_store(const char *file_path, MmapStoreHeader *header) {
+  GDALDatasetH ds = GDALOpen(header->source_path, GA_ReadOnly);
+  if (!ds) {
+    fprintf(stderr, "Error: Failed to open dataset '%s'\n",
+            header->source_path);
+    return 0;
+  }
+  int xoff, yoff;
+  bbox_to_pixel_window(ds, &header->bbox, &xoff, &yoff, &header->width,
+                       &header->height);
+  double gt[6];
+  GDALGetGeoTransform(ds, gt);
+  header->geo_transform[0] = gt[0] + xoff * gt[1] + yoff * gt[2];
+  header->geo_transform[1] = gt[1];
+  header->geo_transform[2] = gt[2];
+  header->geo_transform[3] = gt[3] + xoff * gt[4] + yoff * gt[5];
+  header->geo_transform[4] = gt[4];
+  header->geo_transform[5] = gt[5];
+  header->tiles_x =
+      (header->width + MMAP_STORE_TILE_SIZE - 1) / MMAP_STORE_TILE_SIZE;
+  header->tiles_y =
+      (header->height + MMAP_STORE_TILE_SIZE - 1) / MMAP_STORE_TILE_SIZE;
+  GDALRasterBandH band = GDALGetRasterBand(ds, 1);
+  header->data_type = GDALGetRasterDataType(band);
+  if (!store_type_supported((GDALDataType)header->data_type)) {
+    fprintf(stderr, "Error: mmap_cache does not support data type %s\n",
+            GDALGetDataTypeName((GDALDataType)header->data_type));
+    GDALClose(ds);
+    return 0;
+  }
+  int has_nodata = FALSE;
+  header->nodata = GDALGetRasterNoDataValue(band, &has_nodata);
+  header->has_nodata = has_nodata;
+
+  char tmp_path[MMAP_STORE_MAX_PATH + 32];
+  snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", file_path,
+           (long)getpid());
+  FILE *out = fopen(tmp_path, "wb");
+  if (!out) {
+    fprintf(stderr, "Error: Failed to create '%s'\n", tmp_path);
+    GDALClose(ds);
+    return 0;
+  }
+  int ok = fwrite(header, sizeof(*header), 1, out) == 1 &&
+           fseek(out, MMAP_STORE_DATA_OFFSET, SEEK_SET) == 0 &&
+           write_tiles(out, ds, header, xoff, yoff);
+  ok = (fclose(out) == 0) && ok;
+  GDALClose(ds);
+  if (!ok || rename(tmp_path, file_path) != 0) {
+    fprintf(stderr, "Error: Failed to write mmap store '%s'\n", file_path);
+    unlink(tmp_path);
+    return 0;
+  }
+  return 1;
+}
+
+// Maps file_path and returns 1 if it was built from the source and bbox in
+// `expected`.
+static int map_store(MmapStore *store, const char *file_path,
+                     const MmapStoreHeader *expected) {
+  int fd = open(file_path, O_RDONLY);
+  if (fd < 0) {
+    return 0;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < MMAP_STORE_DATA_OFFSET) {
+    close(fd);
+    return 0;
+  }
+  void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+  if (map == MAP_FAILED) {
+    return 0;
+  }
+  const MmapStoreHeader *header = (const MmapStoreHeader *)map;
+  // A file of an unsupported type is treated as stale, and its rebuild
+  // reports the error
+  if (!store_type_supported((GDALDataType)header->data_type)) {
+    munmap(map, (size_t)st.st_size);
+    return 0;
+  }
+  size_t tile_bytes = (size_t)MMAP_STORE_TILE_SIZE * MMAP_STORE_TILE_SIZE *
+                      GDALGetDataTypeSizeBytes((GDALDataType)header->data_type);
+  size_t expected_size = MMAP_STORE_DATA_OFFSET +
+                         (size_t)header->tiles_x * header->tiles_y * tile_bytes;
+  if (!headers_match(header, expected) ||
+      (size_t)st.st_size != expected_size) {
+    munmap(map, (size_t)st.st_size);
+    return 0;
+  }
+#ifdef MADV_RANDOM
+  // Point lookups gain nothing from readahead.
+  madvise(map, (size_t)st.st_size, MADV_RANDOM);
+#endif
+
+  memset(store, 0, sizeof(*store));
+  store->map = map;
+  store->map_size = (size_t)st.st_size;
+  store->tiles = (const unsigned char *)map + MMAP_STORE_DATA_OFFSET;
+  memcpy(store->geo.geo_transform, header->geo_transform,
+         sizeof(header->geo_transform));
+  if (!GDALInvGeoTransform(store->geo.geo_transform,
+                           store->geo.inv_geo_transform)) {
+    fprintf(stderr, "Error: Geotransform is not invertible\n");
+    mmap_store_close(store);
+    return 0;
+  }
+  store->geo.raster_x = header->width;
+  store->geo.raster_y = header->height;
+  store->tiles_x = header->tiles_x;
+  store->data_type = (GDALDataType)header->data_type;
+  store->data_type_size = GDALGetDataTypeSizeBytes(store->data_type);
+  store->tile_bytes = tile_bytes;
+  store->has_nodata = header->has_nodata;
+  store->nodata = header->nodata;
+  return 1;
+}
+
+int mmap_store_open(MmapStore *store, const char *source_path,
+                    const BoundingBox *bbox, const char *dir, int *reused) {
+  memset(store, 0, sizeof(*store));
+  MmapStoreHeader header;
+  if (!describe_source(&header, source_path, bbox)) {
+    return 0;
+  }
+
+  char file_path[MMAP_STORE_MAX_PATH];
+  snprintf(file_path, sizeof(file_path), "%s/gdal_test_%016llx.mmap", dir,
+           (unsigned long long)store_key(source_path, bbox));
+
+  if (map_store(store, file_path, &header)) {
+    *reused = 1;
+    return 1;
+  }
+  *reused = 0;
+  if (!build_store(file_path, &header)) {
+    return 0;
+  }
+  if (!map_store(store, file_path, &header)) {
+    fprintf(stderr, "Error: Failed to map '%s'\n", file_path);
+    return 0;
+  }
+  return 1;
+}
+
+void mmap_store_close(MmapStore *store) {
+  if (store->map) {
+    munmap(store->map, store->map_size);
+  }
+  memset(store, 0, sizeof(*store));
+}
@@ -0,0 +1,75 @@
+#ifndef MMAP_STORE_H
+#define MMAP_STORE_H
+
+#include "gdal.h"
+#include "geo_transform.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Edge length of the square tiles the window is stored in
+#define MMAP_STORE_TILE_SIZE 256
+
+// Band 1 of the pixel window covering a bbox, decoded once into a flat file
+// of native-type tiles and mapped read-only. Lookups are plain pointer
+// arithmetic with no GDAL call, so one store can be shared by all threads.
+typedef struct {
+  void *map;
+  size_t map_size;
+  const unsigned char *tiles;
+  // Geotransform of the window; raster_x/raster_y are the window size.
+  GeoContext geo;
+  int tiles_x;
+  GDALDataType data_type;
+  int data_type_size;
+  size_t tile_bytes;
+  int has_nodata;
+  double nodata;
+} MmapStore;
+
+// Maps the store for the window of source_path covering bbox, kept in dir.
+// The file is built on first use and rebuilt when the source size or mtime
+// or the bbox no longer match; *reused is set to 1 if an existing file was
+// mapped. Returns 0 on failure.
+int mmap_store_open(MmapStore *store, const char *source_path,
+                    const BoundingBox *bbox, const char *dir, int *reused);
+// Safe to call on a zeroed store.
+void mmap_store_close(MmapStore *store);
+
+// Returns the value at window pixel (pixel_x, pixel_y), which must lie
+// inside the window. mmap_store_open only maps Byte, UInt16, Int16, UInt32,
+// Int32, Float32 and Float64 bands.
+static inline float mmap_store_read_pixel(const MmapStore *store, int pixel_x,
+                                          int pixel_y) {
+  int tile_x = pixel_x / MMAP_STORE_TILE_SIZE;
+  int tile_y = pixel_y / MMAP_STORE_TILE_SIZE;
+  size_t index = (size_t)(pixel_y % MMAP_STORE_TILE_SIZE) *
+                     MMAP_STORE_TILE_SIZE +
+                 pixel_x % MMAP_STORE_TILE_SIZE;
+  const unsigned char *tile =
+      store->tiles +
+      ((size_t)tile_y * store->tiles_x + tile_x) * store->tile_bytes;
+
+  switch (store->data_type) {
+  case GDT_Byte:
+    return (float)((const uint8_t *)tile)[index];
+  case GDT_UInt16:
+    return (float)((const uint16_t *)tile)[index];
+  case GDT_Int16:
+    return (float)((const int16_t *)tile)[index];
+  case GDT_UInt32:
+    return (float)((const uint32_t *)tile)[index];
+  case GDT_Int32:
+    return (float)((const int32_t *)tile)[index];
+  case GDT_Float32:
+    return ((const float *)tile)[index];
+  case GDT_Float64:
+    return (float)((const double *)tile)[index];
+  default:
+    // mmap_store_open never maps another type
+    return NAN;
+  }
+}
+
+#endif
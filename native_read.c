@@ -0,0 +1,112 @@
+#include "native_read.h"
+
+#include <math.h>
+#include <string.h>
+
+#define MATCH_INT(v, nodata) ((v) == (nodata))
+// NaN never compares equal, but a NaN nodata value still marks NaN pixels
+#define MATCH_FLOAT(v, nodata)                                                 \
+  ((v) == (nodata) || ((v) != (v) && (nodata) != (nodata)))
+
+// Defines gather_<field>, is_nodata_<field> and to_double_<field> for the
+// NativeValue member `field` of C type `ctype`. The gather loop is compiled
+// once per type, so the compiler sees a plain typed load and compare.
+#define DEFINE_NATIVE_KERNELS(field, ctype, MATCH)                             \
+  static void gather_##field(const NativeKernels *kernels, const void *block, \
+                             const size_t *offsets, const int *dest,           \
+                             int count, NativeValue *values,                   \
+                             int *is_nodata) {                                 \
+    const ctype *src = (const ctype *)block;                                   \
+    const ctype nodata = kernels->nodata.field;                                \
+    const int check = kernels->nodata_matches;                                 \
+    for (int k = 0; k < count; k++) {                                          \
+      ctype v = src[offsets[k]];                                               \
+      values[dest[k]].field = v;                                               \
+      is_nodata[dest[k]] = check && MATCH(v, nodata);                          \
+    }                                                                          \
+  }                                                                            \
+  static int is_nodata_##field(const NativeKernels *kernels,                   \
+                               const NativeValue *value) {                     \
+    return kernels->nodata_matches &&                                          \
+           MATCH(value->field, kernels->nodata.field);                         \
+  }                                                                            \
+  static double to_double_##field(const NativeValue *value) {                  \
+    return (double)value->field;                                               \
+  }
+
+DEFINE_NATIVE_KERNELS(u8, uint8_t, MATCH_INT)
+DEFINE_NATIVE_KERNELS(u16, uint16_t, MATCH_INT)
+DEFINE_NATIVE_KERNELS(i16, int16_t, MATCH_INT)
+DEFINE_NATIVE_KERNELS(u32, uint32_t, MATCH_INT)
+DEFINE_NATIVE_KERNELS(i32, int32_t, MATCH_INT)
+DEFINE_NATIVE_KERNELS(f32, float, MATCH_FLOAT)
+DEFINE_NATIVE_KERNELS(f64, double, MATCH_FLOAT)
+
+// An integer nodata value only matches if the type holds it exactly
+static int integer_nodata(double nodata, double lo, double hi) {
+  return nodata >= lo && nodata <= hi && nodata == floor(nodata);
+}
+
+#define USE_KERNELS(kernels, field)                                            \
+  do {                                                                         \
+    (kernels)->gather = gather_##field;                                        \
+    (kernels)->is_nodata = is_nodata_##field;                                  \
+    (kernels)->to_double = to_double_##field;                                  \
+  } while (0)
+
+int native_kernels_init(NativeKernels *kernels, GDALDataType data_type,
+                        int has_nodata, double nodata) {
+  memset(kernels, 0, sizeof(*kernels));
+  kernels->data_type = data_type;
+  kernels->data_type_size = GDALGetDataTypeSizeBytes(data_type);
+  switch (data_type) {
+  case GDT_Byte:
+    USE_KERNELS(kernels, u8);
+    kernels->nodata_matches = has_nodata && integer_nodata(nodata, 0, 255);
+    kernels->nodata.u8 = kernels->nodata_matches ? (uint8_t)nodata : 0;
+    return 1;
+  case GDT_UInt16:
+    USE_KERNELS(kernels, u16);
+    kernels->nodata_matches = has_nodata && integer_nodata(nodata, 0, 65535);
+    kernels->nodata.u16 = kernels->nodata_matches ? (uint16_t)nodata : 0;
+    return 1;
+  case GDT_Int16:
+    USE_KERNELS(kernels, i16);
+    kernels->nodata_matches =
+        has_nodata && integer_nodata(nodata, -32768, 32767);
+    kernels->nodata.i16 = kernels->nodata_matches ? (int16_t)nodata : 0;
+    return 1;
+  case GDT_UInt32:
+    USE_KERNELS(kernels, u32);
+    kernels->nodata_matches =
+        has_nodata && integer_nodata(nodata, 0, 4294967295.0);
+    kernels->nodata.u32 = kernels->nodata_matches ? (uint32_t)nodata : 0;
+    return 1;
+  case GDT_Int32:
+    USE_KERNELS(kernels, i32);
+    kernels->nodata_matches =
+        has_nodata && integer_nodata(nodata, -2147483648.0, 2147483647.0);
+    kernels->nodata.i32 = kernels->nodata_matches ? (int32_t)nodata : 0;
+    return 1;
+  case GDT_Float32:
+    // Like GDAL, compare against the nodata value rounded to Float32
+    USE_KERNELS(kernels, f32);
+    kernels->nodata_matches = has_nodata;
+    kernels->nodata.f32 = (float)nodata;
+    return 1;
+  case GDT_Float64:
+    USE_KERNELS(kernels, f64);
+    kernels->nodata_matches = has_nodata;
+    kernels->nodata.f64 = nodata;
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+int native_kernels_init_band(NativeKernels *kernels, GDALRasterBandH band) {
+  int has_nodata = FALSE;
+  double nodata = GDALGetRasterNoDataValue(band, &has_nodata);
+  return native_kernels_init(kernels, GDALGetRasterDataType(band), has_nodata,
+                             nodata);
+}
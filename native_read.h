@@ -0,0 +1,58 @@
+#ifndef NATIVE_READ_H
+#define NATIVE_READ_H
+
+#include "gdal.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Pixel reads that keep the band's own data type instead of converting to
+// Float32, with the nodata comparison done in that type. Float32 cannot hold
+// every Int32, UInt32 or Float64 value, so converting first can both change
+// the value and report a pixel next to the nodata value as nodata.
+
+// One pixel in any of the supported data types.
+typedef union {
+  uint8_t u8;
+  uint16_t u16;
+  int16_t i16;
+  uint32_t u32;
+  int32_t i32;
+  float f32;
+  double f64;
+} NativeValue;
+
+typedef struct NativeKernels NativeKernels;
+
+// Copies the pixels at offsets[0..count) of a block of the kernels' type to
+// values[dest[k]] and sets is_nodata[dest[k]].
+typedef void (*NativeGatherFunc)(const NativeKernels *kernels,
+                                 const void *block, const size_t *offsets,
+                                 const int *dest, int count,
+                                 NativeValue *values, int *is_nodata);
+
+// Kernels specialized for one data type, picked once per dataset by
+// native_kernels_init so that reads make no per-pixel type switch.
+struct NativeKernels {
+  GDALDataType data_type;
+  int data_type_size;
+  // Set when the band has a nodata value that the type can represent; a
+  // value it cannot represent (e.g. -1 on a Byte band) matches no pixel
+  int nodata_matches;
+  // The nodata value in the data type. A NaN nodata matches NaN pixels.
+  NativeValue nodata;
+  NativeGatherFunc gather;
+  int (*is_nodata)(const NativeKernels *kernels, const NativeValue *value);
+  double (*to_double)(const NativeValue *value);
+};
+
+// Picks the kernels for data_type. Returns 0 for types without native
+// kernels (Int8, 64-bit integers and complex types), which keep the Float32
+// path.
+int native_kernels_init(NativeKernels *kernels, GDALDataType data_type,
+                        int has_nodata, double nodata);
+
+// native_kernels_init for the type and nodata value of band.
+int native_kernels_init_band(NativeKernels *kernels, GDALRasterBandH band);
+
+#endif
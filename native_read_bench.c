@@ -0,0 +1,319 @@
+#include "cpl_conv.h"
+#include "gdal.h"
+#include "latency_histogram.h"
+#include "native_read.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Measures what converting pixels to Float32 costs against keeping the
+// band's data type, for Byte, Int16, Float32 and Float64 rasters:
+//   point_*   1x1 GDALRasterIO reads of an in-memory (MEM) raster, as the
+//             per-point modes do, into Float32 or into the band's type
+//   gather_*  the same points gathered from a decoded block, through
+//             GDALCopyWords to Float32 as block_batch_read does, or with the
+//             native gather kernel as block_batch_read_native does
+// About 10% of the pixels are nodata. Both paths are checked against the
+// values written, and the Float32 path's changed values and false nodata
+// hits are counted: the Float64 raster also holds values one step away from
+// its nodata value, which only differ beyond Float32 precision.
+
+#define BENCH_RASTER_SIZE 1024
+#define BENCH_BLOCK_SIZE 256
+#define BENCH_ROUNDS 5
+
+typedef struct {
+  GDALDataType type;
+  double nodata;
+} BenchType;
+
+static const BenchType bench_types[] = {
+    {GDT_Byte, 255.0},
+    {GDT_Int16, -32768.0},
+    {GDT_Float32, -9999.0},
+    {GDT_Float64, -9999.0},
+};
+
+typedef struct {
+  double seconds;
+  // Points whose value or nodata flag is wrong, and for the Float32 paths
+  // the points whose value conversion changed and the non-nodata points
+  // reported as nodata
+  long long wrong;
+  long long changed;
+  long long false_nodata;
+} PathResult;
+
+typedef struct {
+  GDALRasterBandH band;
+  NativeKernels kernels;
+  int has_nodata;
+  double nodata;
+  // Values written to the raster, row by row, and its top-left block in the
+  // band's type
+  double *expected;
+  GByte *block;
+  int points;
+  int *point_x;
+  int *point_y;
+  // Offsets of the points folded into the block, and 0..points-1
+  size_t *offsets;
+  int *dest;
+  float *float_values;
+  NativeValue *values;
+  int *is_nodata;
+} Bench;
+
+// A pixel value exactly representable in `type`.
+static double random_value(GDALDataType type, double nodata,
+                           unsigned int *rng) {
+  int r = rand_r(rng) % 100;
+  if (r < 10) {
+    return nodata;
+  }
+  switch (type) {
+  case GDT_Byte:
+    return (double)(rand_r(rng) % 255);
+  case GDT_Int16:
+    return (double)(rand_r(rng) % 60000 - 30000);
+  case GDT_Float32:
+    return (double)(float)(-1000.0 + (double)rand_r(rng) / RAND_MAX * 5000.0);
+  default:
+    if (r < 12) {
+      return nextafter(nodata, 0.0);
+    }
+    return -1000.0 + (double)rand_r(rng) / RAND_MAX * 5000.0;
+  }
+}
+
+static double expected_at(const Bench *b, int i, int in_block) {
+  int x = b->point_x[i];
+  int y = b->point_y[i];
+  if (in_block) {
+    x %= BENCH_BLOCK_SIZE;
+    y %= BENCH_BLOCK_SIZE;
+  }
+  return b->expected[(size_t)y * BENCH_RASTER_SIZE + x];
+}
+
+static void check_float(const Bench *b, PathResult *result, int in_block) {
+  for (int i = 0; i < b->points; i++) {
+    double expected = expected_at(b, i, in_block);
+    int expected_nodata = expected == b->nodata;
+    result->changed += (double)b->float_values[i] != expected;
+    result->false_nodata += b->is_nodata[i] && !expected_nodata;
+    // Anything else is the conversion doing what it should
+    result->wrong += !b->is_nodata[i] && expected_nodata;
+  }
+}
+
+static void check_native(const Bench *b, PathResult *result, int in_block) {
+  for (int i = 0; i < b->points; i++) {
+    double expected = expected_at(b, i, in_block);
+    result->wrong += b->kernels.to_double(&b->values[i]) != expected ||
+                     b->is_nodata[i] != (expected == b->nodata);
+  }
+}
+
+static double elapsed_since(uint64_t t0) {
+  return (double)(monotonic_ns() - t0) / 1e9;
+}
+
+static void point_float32(Bench *b, PathResult *result) {
+  float nodata_f = (float)b->nodata;
+  uint64_t t0 = monotonic_ns();
+  for (int i = 0; i < b->points; i++) {
+    float value = 0.0f;
+    GDALRasterIO(b->band, GF_Read, b->point_x[i], b->point_y[i], 1, 1, &value,
+                 1, 1, GDT_Float32, 0, 0);
+    b->float_values[i] = value;
+    b->is_nodata[i] = b->has_nodata && value == nodata_f;
+  }
+  result->seconds = elapsed_since(t0);
+  check_float(b, result, 0);
+}
+
+static void point_native(Bench *b, PathResult *result) {
+  const NativeKernels *kernels = &b->kernels;
+  uint64_t t0 = monotonic_ns();
+  for (int i = 0; i < b->points; i++) {
+    GDALRasterIO(b->band, GF_Read, b->point_x[i], b->point_y[i], 1, 1,
+                 &b->values[i], 1, 1, kernels->data_type, 0, 0);
+    b->is_nodata[i] = kernels->is_nodata(kernels, &b->values[i]);
+  }
+  result->seconds = elapsed_since(t0);
+  check_native(b, result, 0);
+}
+
+static void gather_float32(Bench *b, PathResult *result) {
+  GDALDataType type = b->kernels.data_type;
+  int type_size = b->kernels.data_type_size;
+  float nodata_f = (float)b->nodata;
+  uint64_t t0 = monotonic_ns();
+  for (int i = 0; i < b->points; i++) {
+    float value = 0.0f;
+    GDALCopyWords(b->block + b->offsets[i] * type_size, type, 0, &value,
+                  GDT_Float32, 0, 1);
+    b->float_values[i] = value;
+    b->is_nodata[i] = b->has_nodata && value == nodata_f;
+  }
+  result->seconds = elapsed_since(t0);
+  check_float(b, result, 1);
+}
+
+static void gather_native(Bench *b, PathResult *result) {
+  uint64_t t0 = monotonic_ns();
+  b->kernels.gather(&b->kernels, b->block, b->offsets, b->dest, b->points,
+                    b->values, b->is_nodata);
+  result->seconds = elapsed_since(t0);
+  check_native(b, result, 1);
+}
+
+typedef struct {
+  const char *name;
+  void (*run)(Bench *b, PathResult *result);
+  // Index of the path this one is compared against
+  int baseline;
+} BenchPath;
+
+static const BenchPath bench_paths[] = {
+    {"point_float32", point_float32, 0},
+    {"point_native", point_native, 0},
+    {"gather_float32", gather_float32, 2},
+    {"gather_native", gather_native, 2},
+};
+
+#define BENCH_PATH_COUNT ((int)(sizeof(bench_paths) / sizeof(bench_paths[0])))
+
+// Creates the MEM raster holding b->expected and the block copy of its
+// corner. Returns NULL on failure.
+static GDALDatasetH create_raster(Bench *b, const BenchType *bench) {
+  GDALDriverH driver = GDALGetDriverByName("MEM");
+  GDALDatasetH ds = driver ? GDALCreate(driver, "", BENCH_RASTER_SIZE,
+                                        BENCH_RASTER_SIZE, 1, bench->type,
+                                        NULL)
+                           : NULL;
+  if (!ds) {
+    return NULL;
+  }
+  b->band = GDALGetRasterBand(ds, 1);
+  GDALSetRasterNoDataValue(b->band, bench->nodata);
+  if (GDALRasterIO(b->band, GF_Write, 0, 0, BENCH_RASTER_SIZE,
+                   BENCH_RASTER_SIZE, b->expected, BENCH_RASTER_SIZE,
+                   BENCH_RASTER_SIZE, GDT_Float64, 0, 0) != CE_None ||
+      !native_kernels_init_band(&b->kernels, b->band)) {
+    GDALClose(ds);
+    return NULL;
+  }
+  b->nodata = GDALGetRasterNoDataValue(b->band, &b->has_nodata);
+  int type_size = b->kernels.data_type_size;
+  for (int y = 0; y < BENCH_BLOCK_SIZE; y++) {
+    GDALCopyWords(b->expected + (size_t)y * BENCH_RASTER_SIZE, GDT_Float64,
+                  (int)sizeof(double),
+                  b->block + (size_t)y * BENCH_BLOCK_SIZE * type_size,
+                  bench->type, type_size, BENCH_BLOCK_SIZE);
+  }
+  return ds;
+}
+
+static int bench_type(const BenchType *bench, int points) {
+  const char *type_name = GDALGetDataTypeName(bench->type);
+  size_t pixels = (size_t)BENCH_RASTER_SIZE * BENCH_RASTER_SIZE;
+  size_t n = (size_t)points;
+  Bench b;
+  memset(&b, 0, sizeof(b));
+  b.points = points;
+  b.expected = (double *)malloc(sizeof(double) * pixels);
+  b.block = (GByte *)malloc((size_t)BENCH_BLOCK_SIZE * BENCH_BLOCK_SIZE *
+                            sizeof(double));
+  b.point_x = (int *)malloc(sizeof(int) * n);
+  b.point_y = (int *)malloc(sizeof(int) * n);
+  b.offsets = (size_t *)malloc(sizeof(size_t) * n);
+  b.dest = (int *)malloc(sizeof(int) * n);
+  b.float_values = (float *)malloc(sizeof(float) * n);
+  b.values = (NativeValue *)malloc(sizeof(NativeValue) * n);
+  b.is_nodata = (int *)malloc(sizeof(int) * n);
+  int ok = 0;
+  GDALDatasetH ds = NULL;
+  if (!b.expected || !b.block || !b.point_x || !b.point_y || !b.offsets ||
+      !b.dest || !b.float_values || !b.values || !b.is_nodata) {
+    fprintf(stderr, "Error: Out of memory\n");
+  } else {
+    unsigned int rng = 42;
+    for (size_t i = 0; i < pixels; i++) {
+      b.expected[i] = random_value(bench->type, bench->nodata, &rng);
+    }
+    for (int i = 0; i < points; i++) {
+      b.point_x[i] = rand_r(&rng) % BENCH_RASTER_SIZE;
+      b.point_y[i] = rand_r(&rng) % BENCH_RASTER_SIZE;
+      b.offsets[i] =
+          (size_t)(b.point_y[i] % BENCH_BLOCK_SIZE) * BENCH_BLOCK_SIZE +
+          (size_t)(b.point_x[i] % BENCH_BLOCK_SIZE);
+      b.dest[i] = i;
+    }
+    ds = create_raster(&b, bench);
+    if (!ds) {
+      fprintf(stderr, "Error: Failed to create a %s MEM raster\n",
+              type_name);
+    }
+  }
+
+  if (ds) {
+    PathResult best[BENCH_PATH_COUNT];
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+      for (int p = 0; p < BENCH_PATH_COUNT; p++) {
+        PathResult result;
+        memset(&result, 0, sizeof(result));
+        bench_paths[p].run(&b, &result);
+        if (round == 0 || result.seconds < best[p].seconds) {
+          best[p] = result;
+        }
+      }
+    }
+    ok = 1;
+    for (int p = 0; p < BENCH_PATH_COUNT; p++) {
+      const PathResult *r = &best[p];
+      printf("%-8s %-15s %10.2f ns/point %8.2fx %10lld changed %10lld false "
+             "nodata\n",
+             type_name, bench_paths[p].name, r->seconds * 1e9 / points,
+             best[bench_paths[p].baseline].seconds / r->seconds, r->changed,
+             r->false_nodata);
+      if (r->wrong > 0) {
+        fprintf(stderr, "Error: %s %s read %lld wrong pixels\n", type_name,
+                bench_paths[p].name, r->wrong);
+        ok = 0;
+      }
+    }
+    GDALClose(ds);
+  }
+
+  free(b.expected);
+  free(b.block);
+  free(b.point_x);
+  free(b.point_y);
+  free(b.offsets);
+  free(b.dest);
+  free(b.float_values);
+  free(b.values);
+  free(b.is_nodata);
+  return ok;
+}
+
+int main(int argc, char *argv[]) {
+  int points = argc > 1 ? atoi(argv[1]) : 1000000;
+  if (points <= 0) {
+    fprintf(stderr, "Usage: %s [points]\n", argv[0]);
+    return 1;
+  }
+
+  GDALAllRegister();
+  printf("Reading %d points per data type (best of %d rounds)\n", points,
+         BENCH_ROUNDS);
+  int ok = 1;
+  for (size_t t = 0; t < sizeof(bench_types) / sizeof(bench_types[0]); t++) {
+    ok &= bench_type(&bench_types[t], points);
+  }
+  GDALDestroyDriverManager();
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+#include "prefetch_pool.h"
+
+#include "latency_histogram.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct PrefetchThread {
+  PrefetchPool *pool;
+  pthread_t tid;
+  int started;
+  GDALDatasetH ds;
+  GDALRasterBandH band;
+};
+
+static void *prefetch_thread_main(void *arg) {
+  PrefetchThread *t = (PrefetchThread *)arg;
+  PrefetchPool *pool = t->pool;
+
+  pthread_mutex_lock(&pool->mutex);
+  for (;;) {
+    while (pool->count == 0 && !pool->stop) {
+      pthread_cond_wait(&pool->cond, &pool->mutex);
+    }
+    if (pool->stop) {
+      break;
+    }
+    int *job = &pool->jobs[pool->head * 2];
+    int block_x = job[0];
+    int block_y = job[1];
+    pool->head = (pool->head + 1) % pool->capacity;
+    pool->count--;
+    pthread_mutex_unlock(&pool->mutex);
+
+    uint64_t t0 = monotonic_ns();
+    int read = tile_cache_prefetch(pool->cache, pool->dataset_id, t->band,
+                                   block_x, block_y);
+    uint64_t elapsed = monotonic_ns() - t0;
+
+    pthread_mutex_lock(&pool->mutex);
+    if (read) {
+      pool->blocks_read++;
+      pool->read_ns += elapsed;
+    }
+  }
+  pthread_mutex_unlock(&pool->mutex);
+  return NULL;
+}
+
+int prefetch_pool_start(PrefetchPool *pool, const char *path,
+                        TileCache *cache, uint64_t dataset_id,
+                        int thread_count, int queue_capacity) {
+  memset(pool, 0, sizeof(*pool));
+  pool->cache = cache;
+  pool->dataset_id = dataset_id;
+  pool->path = path;
+  pool->capacity = queue_capacity;
+  pool->jobs = (int *)malloc(sizeof(int) * 2 * (size_t)queue_capacity);
+  pool->threads =
+      (PrefetchThread *)calloc((size_t)thread_count, sizeof(PrefetchThread));
+  pthread_mutex_init(&pool->mutex, NULL);
+  pthread_cond_init(&pool->cond, NULL);
+  pool->thread_count = thread_count;
+  if (!pool->jobs || !pool->threads) {
+    fprintf(stderr, "Error: Out of memory starting prefetch pool\n");
+    return 0;
+  }
+
+  for (int i = 0; i < thread_count; i++) {
+    PrefetchThread *t = &pool->threads[i];
+    t->pool = pool;
+    t->ds = GDALOpen(path, GA_ReadOnly);
+    if (!t->ds) {
+      fprintf(stderr, "Error: Failed to open dataset '%s'\n", path);
+      return 0;
+    }
+    t->band = GDALGetRasterBand(t->ds, 1);
+    if (pthread_create(&t->tid, NULL, prefetch_thread_main, t) != 0) {
+      fprintf(stderr, "Error: Failed to start prefetch thread %d\n", i);
+      return 0;
+    }
+    t->started = 1;
+  }
+  return 1;
+}
+
+void prefetch_pool_stop(PrefetchPool *pool) {
+  if (!pool->threads) {
+    return;
+  }
+  pthread_mutex_lock(&pool->mutex);
+  pool->stop = 1;
+  pool->count = 0;
+  pthread_cond_broadcast(&pool->cond);
+  pthread_mutex_unlock(&pool->mutex);
+
+  for (int i = 0; i < pool->thread_count; i++) {
+    PrefetchThread *t = &pool->threads[i];
+    if (t->started) {
+      pthread_join(t->tid, NULL);
+    }
+    if (t->ds) {
+      GDALClose(t->ds);
+    }
+  }
+  pthread_cond_destroy(&pool->cond);
+  pthread_mutex_destroy(&pool->mutex);
+  free(pool->threads);
+  free(pool->jobs);
+  pool->threads = NULL;
+  pool->jobs = NULL;
+}
+
+int prefetch_pool_submit(PrefetchPool *pool, int block_x, int block_y) {
+  pthread_mutex_lock(&pool->mutex);
+  pool->submitted++;
+  if (pool->count == pool->capacity) {
+    pool->dropped++;
+    pthread_mutex_unlock(&pool->mutex);
+    return 0;
+  }
+  int *job = &pool->jobs[((pool->head + pool->count) % pool->capacity) * 2];
+  job[0] = block_x;
+  job[1] = block_y;
+  pool->count++;
+  pthread_cond_signal(&pool->cond);
+  pthread_mutex_unlock(&pool->mutex);
+  return 1;
+}
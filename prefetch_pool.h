@@ -0,0 +1,54 @@
+#ifndef PREFETCH_POOL_H
+#define PREFETCH_POOL_H
+
+#include "gdal.h"
+#include "tile_cache.h"
+
+#include <pthread.h>
+#include <stdint.h>
+
+typedef struct PrefetchThread PrefetchThread;
+
+// Small pool of I/O threads that load blocks of band 1 of one dataset into a
+// TileCache ahead of the thread that will read them. Each I/O thread opens its
+// own dataset handle. Jobs go through a bounded queue; submitting to a full
+// queue drops the job rather than blocking the submitter.
+typedef struct {
+  TileCache *cache;
+  uint64_t dataset_id;
+  const char *path;
+
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  // Ring buffer of pending (block_x, block_y) jobs
+  int *jobs;
+  int capacity;
+  int head;
+  int count;
+  int stop;
+
+  PrefetchThread *threads;
+  int thread_count;
+
+  // Guarded by mutex
+  long long submitted;
+  long long dropped;
+  long long blocks_read;
+  // Time the I/O threads spent reading blocks that were not yet cached
+  uint64_t read_ns;
+} PrefetchPool;
+
+// Starts thread_count I/O threads with a queue of queue_capacity jobs.
+// Returns 0 if a dataset cannot be opened or a thread cannot be started; the
+// pool must still be stopped.
+int prefetch_pool_start(PrefetchPool *pool, const char *path,
+                        TileCache *cache, uint64_t dataset_id,
+                        int thread_count, int queue_capacity);
+// Discards pending jobs, joins the threads and closes their datasets. Safe
+// to call on a zeroed pool.
+void prefetch_pool_stop(PrefetchPool *pool);
+
+// Queues a block load. Returns 0 if the job was dropped.
+int prefetch_pool_submit(PrefetchPool *pool, int block_x, int block_y);
+
+#endif
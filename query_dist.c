@@ -0,0 +1,322 @@
+#include "query_dist.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_ZIPF_CENTERS 1000
+#define DEFAULT_GAUSSIAN_CENTERS 16
+#define DEFAULT_ZIPF_EXPONENT 1.0
+#define DEFAULT_ZIPF_SPREAD 0.001
+#define DEFAULT_GAUSSIAN_SPREAD 0.01
+#define DEFAULT_STEP 0.001
+
+static const char *const dist_names[DIST_COUNT] = {"uniform", "zipf",
+                                                   "gaussian", "sweep", "walk"};
+
+static uint64_t splitmix64(uint64_t *state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+// Advances the generator by 2^128 draws.
+static void rng_jump(Rng *rng) {
+  static const uint64_t jump[4] = {0x180EC6D33CFD0ABAull,
+                                   0xD5A61266F0C9392Cull,
+                                   0xA9582618E03FC9AAull,
+                                   0x39ABDC4529B1661Cull};
+  uint64_t s[4] = {0, 0, 0, 0};
+  for (int i = 0; i < 4; i++) {
+    for (int b = 0; b < 64; b++) {
+      if (jump[i] & ((uint64_t)1 << b)) {
+        for (int k = 0; k < 4; k++) {
+          s[k] ^= rng->s[k];
+        }
+      }
+      rng_next(rng);
+    }
+  }
+  memcpy(rng->s, s, sizeof(s));
+}
+
+void rng_seed(Rng *rng, uint64_t seed, uint64_t stream) {
+  uint64_t state = seed;
+  for (int k = 0; k < 4; k++) {
+    rng->s[k] = splitmix64(&state);
+  }
+  for (uint64_t j = 0; j < stream; j++) {
+    rng_jump(rng);
+  }
+}
+
+DistKind query_dist_parse(const char *name) {
+  for (int k = 0; k < DIST_COUNT; k++) {
+    if (strcmp(name, dist_names[k]) == 0) {
+      return (DistKind)k;
+    }
+  }
+  return DIST_COUNT;
+}
+
+const char *query_dist_name(DistKind kind) {
+  return kind < DIST_COUNT ? dist_names[kind] : "invalid";
+}
+
+int query_dist_init(QueryDist *dist, const QueryDistParams *params,
+                    const BoundingBox *bbox, uint64_t seed) {
+  memset(dist, 0, sizeof(*dist));
+  if (params->kind >= DIST_COUNT || params->centers < 0 ||
+      params->zipf_exponent < 0.0 || params->spread < 0.0 ||
+      params->step < 0.0 || params->step > 1.0) {
+    return 0;
+  }
+  dist->params = *params;
+  dist->bbox = *bbox;
+  QueryDistParams *p = &dist->params;
+  if (p->centers == 0) {
+    p->centers = p->kind == DIST_ZIPF ? DEFAULT_ZIPF_CENTERS
+                                      : DEFAULT_GAUSSIAN_CENTERS;
+  }
+  if (p->zipf_exponent == 0.0) {
+    p->zipf_exponent = DEFAULT_ZIPF_EXPONENT;
+  }
+  if (p->spread == 0.0) {
+    p->spread =
+        p->kind == DIST_ZIPF ? DEFAULT_ZIPF_SPREAD : DEFAULT_GAUSSIAN_SPREAD;
+  }
+  if (p->step == 0.0) {
+    p->step = DEFAULT_STEP;
+  }
+
+  if (p->kind == DIST_ZIPF || p->kind == DIST_GAUSSIAN) {
+    size_t n = (size_t)p->centers;
+    dist->center_x = (double *)malloc(sizeof(double) * n);
+    dist->center_y = (double *)malloc(sizeof(double) * n);
+    if (!dist->center_x || !dist->center_y) {
+      query_dist_destroy(dist);
+      return 0;
+    }
+    // Centers come from their own stream so they do not depend on the
+    // number of workers.
+    Rng rng;
+    rng_seed(&rng, seed ^ 0xC3A5C85C97CB3127ull, 0);
+    for (size_t i = 0; i < n; i++) {
+      dist->center_x[i] =
+          bbox->xmin + rng_uniform(&rng) * (bbox->xmax - bbox->xmin);
+      dist->center_y[i] =
+          bbox->ymin + rng_uniform(&rng) * (bbox->ymax - bbox->ymin);
+    }
+  }
+  if (p->kind == DIST_ZIPF) {
+    dist->cdf = (double *)malloc(sizeof(double) * (size_t)p->centers);
+    if (!dist->cdf) {
+      query_dist_destroy(dist);
+      return 0;
+    }
+    double total = 0.0;
+    for (int i = 0; i < p->centers; i++) {
+      total += pow((double)(i + 1), -p->zipf_exponent);
+      dist->cdf[i] = total;
+    }
+    for (int i = 0; i < p->centers; i++) {
+      dist->cdf[i] /= total;
+    }
+    dist->cdf[p->centers - 1] = 1.0;
+  }
+  if (p->kind == DIST_SWEEP) {
+    dist->sweep_columns = (long long)ceil(1.0 / p->step);
+    dist->sweep_rows = dist->sweep_columns;
+  }
+  return 1;
+}
+
+void query_dist_destroy(QueryDist *dist) {
+  free(dist->center_x);
+  free(dist->center_y);
+  free(dist->cdf);
+  dist->center_x = NULL;
+  dist->center_y = NULL;
+  dist->cdf = NULL;
+}
+
+void query_dist_describe(const QueryDist *dist, char *buf, size_t size) {
+  const QueryDistParams *p = &dist->params;
+  switch (p->kind) {
+  case DIST_ZIPF:
+    snprintf(buf, size,
+             "zipf over %d hotspots (exponent %.2f, half-width %g of bbox)",
+             p->centers, p->zipf_exponent, p->spread);
+    break;
+  case DIST_GAUSSIAN:
+    snprintf(buf, size, "gaussian around %d centers (sigma %g of bbox)",
+             p->centers, p->spread);
+    break;
+  case DIST_SWEEP:
+    snprintf(buf, size, "raster-order sweep over a %lldx%lld grid",
+             dist->sweep_columns, dist->sweep_rows);
+    break;
+  case DIST_WALK:
+    snprintf(buf, size, "random walk (step up to %g of bbox)", p->step);
+    break;
+  default:
+    snprintf(buf, size, "uniform");
+    break;
+  }
+}
+
+// Folds v back into [lo, hi] as if reflected at the edges.
+static double reflect(double v, double lo, double hi) {
+  if (v < lo) {
+    v = lo + (lo - v);
+  }
+  if (v > hi) {
+    v = hi - (v - hi);
+  }
+  return v < lo ? lo : v;
+}
+
+static double clamp(double v, double lo, double hi) {
+  return v < lo ? lo : (v > hi ? hi : v);
+}
+
+void query_stream_init(QueryStream *stream, const QueryDist *dist,
+                       uint64_t seed, int stream_index) {
+  memset(stream, 0, sizeof(*stream));
+  stream->dist = dist;
+  rng_seed(&stream->rng, seed, (uint64_t)stream_index);
+  const BoundingBox *bbox = &dist->bbox;
+  if (dist->params.kind == DIST_SWEEP) {
+    stream->position = (long long)(rng_uniform(&stream->rng) *
+                                   (double)dist->sweep_columns *
+                                   (double)dist->sweep_rows);
+  } else if (dist->params.kind == DIST_WALK) {
+    stream->x =
+        bbox->xmin + rng_uniform(&stream->rng) * (bbox->xmax - bbox->xmin);
+    stream->y =
+        bbox->ymin + rng_uniform(&stream->rng) * (bbox->ymax - bbox->ymin);
+  }
+}
+
+void query_stream_next(QueryStream *stream, double *x, double *y) {
+  const QueryDist *dist = stream->dist;
+  const BoundingBox *bbox = &dist->bbox;
+  const QueryDistParams *p = &dist->params;
+  double width = bbox->xmax - bbox->xmin;
+  double height = bbox->ymax - bbox->ymin;
+  Rng *rng = &stream->rng;
+
+  switch (p->kind) {
+  case DIST_ZIPF: {
+    double u = rng_uniform(rng);
+    int lo = 0;
+    int hi = p->centers - 1;
+    while (lo < hi) {
+      int mid = (lo + hi) / 2;
+      if (dist->cdf[mid] <= u) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    *x = clamp(dist->center_x[lo] +
+                   (2.0 * rng_uniform(rng) - 1.0) * p->spread * width,
+               bbox->xmin, bbox->xmax);
+    *y = clamp(dist->center_y[lo] +
+                   (2.0 * rng_uniform(rng) - 1.0) * p->spread * height,
+               bbox->ymin, bbox->ymax);
+    break;
+  }
+  case DIST_GAUSSIAN: {
+    uint32_t c = rng_below(rng, (uint32_t)p->centers);
+    // Box-Muller; 1 - u keeps the logarithm finite
+    double r = sqrt(-2.0 * log(1.0 - rng_uniform(rng)));
+    double theta = 2.0 * M_PI * rng_uniform(rng);
+    *x = clamp(dist->center_x[c] + r * cos(theta) * p->spread * width,
+               bbox->xmin, bbox->xmax);
+    *y = clamp(dist->center_y[c] + r * sin(theta) * p->spread * height,
+               bbox->ymin, bbox->ymax);
+    break;
+  }
+  case DIST_SWEEP: {
+    long long column = stream->position % dist->sweep_columns;
+    long long row = (stream->position / dist->sweep_columns) % dist->sweep_rows;
+    stream->position++;
+    // Top to bottom, left to right, like the rows of a north-up raster
+    *x = bbox->xmin + ((double)column + 0.5) / dist->sweep_columns * width;
+    *y = bbox->ymax - ((double)row + 0.5) / dist->sweep_rows * height;
+    break;
+  }
+  case DIST_WALK: {
+    double dx = (2.0 * rng_uniform(rng) - 1.0) * p->step * width;
+    double dy = (2.0 * rng_uniform(rng) - 1.0) * p->step * height;
+    stream->x = reflect(stream->x + dx, bbox->xmin, bbox->xmax);
+    stream->y = reflect(stream->y + dy, bbox->ymin, bbox->ymax);
+    *x = stream->x;
+    *y = stream->y;
+    break;
+  }
+  default:
+    *x = bbox->xmin + rng_uniform(rng) * width;
+    *y = bbox->ymin + rng_uniform(rng) * height;
+    break;
+  }
+}
+
+static size_t key_slot(uint64_t key, size_t mask) {
+  key ^= key >> 33;
+  key *= 0xFF51AFD7ED558CCDull;
+  key ^= key >> 33;
+  return (size_t)key & mask;
+}
+
+static int key_set_grow(KeySet *set) {
+  size_t capacity = set->capacity ? set->capacity * 2 : 1024;
+  uint64_t *slots = (uint64_t *)malloc(sizeof(uint64_t) * capacity);
+  if (!slots) {
+    return 0;
+  }
+  memset(slots, 0xFF, sizeof(uint64_t) * capacity);
+  for (size_t i = 0; i < set->capacity; i++) {
+    uint64_t key = set->slots[i];
+    if (key == UINT64_MAX) {
+      continue;
+    }
+    size_t s = key_slot(key, capacity - 1);
+    while (slots[s] != UINT64_MAX) {
+      s = (s + 1) & (capacity - 1);
+    }
+    slots[s] = key;
+  }
+  free(set->slots);
+  set->slots = slots;
+  set->capacity = capacity;
+  return 1;
+}
+
+int key_set_insert(KeySet *set, uint64_t key) {
+  // Keep the load factor at or below one half
+  if ((set->count + 1) * 2 > set->capacity && !key_set_grow(set)) {
+    return -1;
+  }
+  size_t mask = set->capacity - 1;
+  for (size_t s = key_slot(key, mask);; s = (s + 1) & mask) {
+    if (set->slots[s] == key) {
+      return 1;
+    }
+    if (set->slots[s] == UINT64_MAX) {
+      set->slots[s] = key;
+      set->count++;
+      return 0;
+    }
+  }
+}
+
+void key_set_destroy(KeySet *set) {
+  free(set->slots);
+  set->slots = NULL;
+  set->capacity = 0;
+  set->count = 0;
+}
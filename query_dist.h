@@ -0,0 +1,122 @@
+#ifndef QUERY_DIST_H
+#define QUERY_DIST_H
+
+#include "bounding_box.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// xoshiro256** generator. Streams seeded from the same seed with different
+// stream numbers are 2^128 draws apart, so they never overlap in practice.
+typedef struct {
+  uint64_t s[4];
+} Rng;
+
+void rng_seed(Rng *rng, uint64_t seed, uint64_t stream);
+
+static inline uint64_t rng_rotl(uint64_t x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t rng_next(Rng *rng) {
+  uint64_t *s = rng->s;
+  uint64_t result = rng_rotl(s[1] * 5, 7) * 9;
+  uint64_t t = s[1] << 17;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rng_rotl(s[3], 45);
+  return result;
+}
+
+// Uniform in [0, 1) with 53 random bits.
+static inline double rng_uniform(Rng *rng) {
+  return (double)(rng_next(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Uniform in [0, n). n must be positive.
+static inline uint32_t rng_below(Rng *rng, uint32_t n) {
+  return (uint32_t)(((rng_next(rng) >> 32) * n) >> 32);
+}
+
+typedef enum {
+  DIST_UNIFORM,
+  DIST_ZIPF,
+  DIST_GAUSSIAN,
+  DIST_SWEEP,
+  DIST_WALK,
+  DIST_COUNT
+} DistKind;
+
+// Returns DIST_COUNT for an unknown name.
+DistKind query_dist_parse(const char *name);
+const char *query_dist_name(DistKind kind);
+
+// Parameters of a distribution. Zero selects the default for the kind.
+typedef struct {
+  DistKind kind;
+  // Hotspots for zipf (default 1000), clusters for gaussian (default 16)
+  int centers;
+  // Weight of the k-th hotspot is 1 / k^s (default 1.0)
+  double zipf_exponent;
+  // As a fraction of the bbox width and height: half-width of a zipf
+  // hotspot (default 0.001) or standard deviation of a gaussian cluster
+  // (default 0.01)
+  double spread;
+  // As a fraction of the bbox width and height: grid spacing of sweep and
+  // maximum step of walk (default 0.001)
+  double step;
+} QueryDistParams;
+
+// A distribution over a bounding box. Hotspot and cluster centers are drawn
+// once from the seed, so every worker queries around the same centers.
+// Read-only after query_dist_init and shared by all workers.
+typedef struct {
+  QueryDistParams params;
+  BoundingBox bbox;
+  double *center_x;
+  double *center_y;
+  // Cumulative zipf weights, normalized so the last is 1
+  double *cdf;
+  long long sweep_columns;
+  long long sweep_rows;
+} QueryDist;
+
+// Returns 0 if a parameter is out of range or allocation fails.
+int query_dist_init(QueryDist *dist, const QueryDistParams *params,
+                    const BoundingBox *bbox, uint64_t seed);
+// Safe to call on a zeroed distribution.
+void query_dist_destroy(QueryDist *dist);
+// Writes a one-line description such as "zipf over 1000 hotspots".
+void query_dist_describe(const QueryDist *dist, char *buf, size_t size);
+
+// One worker's sequence of points. Sweeps and walks start at a random
+// position of the stream and continue from there.
+typedef struct {
+  const QueryDist *dist;
+  Rng rng;
+  double x;
+  double y;
+  long long position;
+} QueryStream;
+
+void query_stream_init(QueryStream *stream, const QueryDist *dist,
+                       uint64_t seed, int stream_index);
+void query_stream_next(QueryStream *stream, double *x, double *y);
+
+// Set of 64-bit keys, used to measure how often queries return to a block.
+// Keys must not be UINT64_MAX.
+typedef struct {
+  uint64_t *slots;
+  size_t capacity;
+  size_t count;
+} KeySet;
+
+// Returns 1 if key was already in the set, 0 if it was added, -1 if the set
+// could not grow. Safe to call on a zeroed set.
+int key_set_insert(KeySet *set, uint64_t key);
+void key_set_destroy(KeySet *set);
+
+#endif
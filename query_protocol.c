@@ -0,0 +1,250 @@
+#include "query_protocol.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define REQUEST_HEADER_SIZE 16
+#define RESPONSE_HEADER_SIZE 8
+
+int read_full(int fd, void *buf, size_t n, int *eof) {
+  unsigned char *p = (unsigned char *)buf;
+  size_t done = 0;
+  *eof = 0;
+  while (done < n) {
+    ssize_t r = read(fd, p + done, n - done);
+    if (r < 0 && errno == EINTR) {
+      continue;
+    }
+    if (r <= 0) {
+      *eof = r == 0 && done == 0;
+      return 0;
+    }
+    done += (size_t)r;
+  }
+  return 1;
+}
+
+int write_full(int fd, const void *buf, size_t n) {
+  const unsigned char *p = (const unsigned char *)buf;
+  size_t done = 0;
+  while (done < n) {
+    ssize_t r = write(fd, p + done, n - done);
+    if (r < 0 && errno == EINTR) {
+      continue;
+    }
+    if (r <= 0) {
+      return 0;
+    }
+    done += (size_t)r;
+  }
+  return 1;
+}
+
+// writev until every buffer is written; advances iov in place.
+static int writev_full(int fd, struct iovec *iov, int count) {
+  while (count > 0) {
+    ssize_t r = writev(fd, iov, count);
+    if (r < 0 && errno == EINTR) {
+      continue;
+    }
+    if (r <= 0) {
+      return 0;
+    }
+    size_t left = (size_t)r;
+    while (count > 0 && left >= iov->iov_len) {
+      left -= iov->iov_len;
+      iov++;
+      count--;
+    }
+    if (count > 0) {
+      iov->iov_base = (unsigned char *)iov->iov_base + left;
+      iov->iov_len -= left;
+    }
+  }
+  return 1;
+}
+
+// Grows batch buffers to hold the request; returns 0 on allocation failure.
+static int reserve_batch(QueryBatch *batch, size_t body_bytes, int path_count,
+                         int count) {
+  if (body_bytes > batch->body_capacity) {
+    unsigned char *body = (unsigned char *)realloc(batch->body, body_bytes);
+    if (!body) {
+      return 0;
+    }
+    batch->body = body;
+    batch->body_capacity = body_bytes;
+  }
+  if (path_count > batch->path_capacity) {
+    const char **paths = (const char **)realloc(
+        (void *)batch->paths, sizeof(const char *) * (size_t)path_count);
+    if (!paths) {
+      return 0;
+    }
+    batch->paths = paths;
+    batch->path_capacity = path_count;
+  }
+  if (count > batch->query_capacity) {
+    QueryPoint *queries = (QueryPoint *)realloc(
+        batch->queries, sizeof(QueryPoint) * (size_t)count);
+    if (!queries) {
+      return 0;
+    }
+    batch->queries = queries;
+    batch->query_capacity = count;
+  }
+  return 1;
+}
+
+int query_batch_read(int fd, QueryBatch *batch, int *eof) {
+  uint32_t header[4];
+  if (!read_full(fd, header, sizeof(header), eof)) {
+    if (!*eof) {
+      fprintf(stderr, "Error: Truncated request header\n");
+    }
+    return 0;
+  }
+  uint32_t body_bytes = header[1];
+  uint32_t path_count = header[2];
+  uint32_t count = header[3];
+  if (header[0] != QUERY_REQUEST_MAGIC || path_count > QUERY_MAX_PATHS ||
+      count > QUERY_MAX_BATCH ||
+      body_bytes > (size_t)path_count * (2 + QUERY_MAX_PATH_LENGTH) +
+                       (size_t)count * QUERY_WIRE_SIZE) {
+    fprintf(stderr, "Error: Malformed request header\n");
+    return 0;
+  }
+  // At least one byte so that an empty body has somewhere to point
+  if (!reserve_batch(batch, body_bytes + 1, (int)path_count, (int)count)) {
+    fprintf(stderr, "Error: Out of memory\n");
+    return 0;
+  }
+  if (!read_full(fd, batch->body, body_bytes, eof)) {
+    fprintf(stderr, "Error: Truncated request body\n");
+    *eof = 0;
+    return 0;
+  }
+
+  // Each path is moved over its length field and NUL-terminated in place,
+  // which never reaches the entry after it
+  size_t offset = 0;
+  for (uint32_t i = 0; i < path_count; i++) {
+    uint16_t length;
+    if (offset + sizeof(length) > body_bytes) {
+      fprintf(stderr, "Error: Malformed request paths\n");
+      return 0;
+    }
+    memcpy(&length, batch->body + offset, sizeof(length));
+    if (length > QUERY_MAX_PATH_LENGTH ||
+        offset + sizeof(length) + length > body_bytes) {
+      fprintf(stderr, "Error: Malformed request paths\n");
+      return 0;
+    }
+    char *path = (char *)batch->body + offset;
+    memmove(path, path + sizeof(length), length);
+    path[length] = '\0';
+    batch->paths[i] = path;
+    offset += sizeof(length) + length;
+  }
+  if (body_bytes - offset != (size_t)count * QUERY_WIRE_SIZE) {
+    fprintf(stderr, "Error: Request body does not hold %u queries\n", count);
+    return 0;
+  }
+  const unsigned char *wire = batch->body + offset;
+  for (uint32_t k = 0; k < count; k++, wire += QUERY_WIRE_SIZE) {
+    QueryPoint *q = &batch->queries[k];
+    memcpy(&q->path, wire, 4);
+    memcpy(&q->x, wire + 4, 8);
+    memcpy(&q->y, wire + 12, 8);
+    if (q->path >= path_count) {
+      fprintf(stderr, "Error: Query %u names path %u of %u\n", k, q->path,
+              path_count);
+      return 0;
+    }
+  }
+  batch->path_count = (int)path_count;
+  batch->count = (int)count;
+  return 1;
+}
+
+void query_batch_free(QueryBatch *batch) {
+  free((void *)batch->paths);
+  free(batch->queries);
+  free(batch->body);
+  memset(batch, 0, sizeof(*batch));
+}
+
+int query_request_write(int fd, const char *const *paths, int path_count,
+                        const QueryPoint *queries, int count) {
+  size_t body_bytes = (size_t)count * QUERY_WIRE_SIZE;
+  for (int i = 0; i < path_count; i++) {
+    size_t length = strlen(paths[i]);
+    if (length > QUERY_MAX_PATH_LENGTH) {
+      fprintf(stderr, "Error: Path '%s' is too long\n", paths[i]);
+      return 0;
+    }
+    body_bytes += 2 + length;
+  }
+  unsigned char *frame =
+      (unsigned char *)malloc(REQUEST_HEADER_SIZE + body_bytes);
+  if (!frame) {
+    fprintf(stderr, "Error: Out of memory\n");
+    return 0;
+  }
+  uint32_t header[4] = {QUERY_REQUEST_MAGIC, (uint32_t)body_bytes,
+                        (uint32_t)path_count, (uint32_t)count};
+  memcpy(frame, header, sizeof(header));
+  unsigned char *p = frame + REQUEST_HEADER_SIZE;
+  for (int i = 0; i < path_count; i++) {
+    uint16_t length = (uint16_t)strlen(paths[i]);
+    memcpy(p, &length, sizeof(length));
+    memcpy(p + sizeof(length), paths[i], length);
+    p += sizeof(length) + length;
+  }
+  for (int k = 0; k < count; k++, p += QUERY_WIRE_SIZE) {
+    memcpy(p, &queries[k].path, 4);
+    memcpy(p + 4, &queries[k].x, 8);
+    memcpy(p + 12, &queries[k].y, 8);
+  }
+  int ok = write_full(fd, frame, REQUEST_HEADER_SIZE + body_bytes);
+  free(frame);
+  return ok;
+}
+
+int query_response_write(int fd, const double *values, const uint8_t *status,
+                         int count) {
+  uint32_t header[2] = {QUERY_RESPONSE_MAGIC, (uint32_t)count};
+  struct iovec iov[3];
+  iov[0].iov_base = header;
+  iov[0].iov_len = sizeof(header);
+  iov[1].iov_base = (void *)values;
+  iov[1].iov_len = sizeof(double) * (size_t)count;
+  iov[2].iov_base = (void *)status;
+  iov[2].iov_len = (size_t)count;
+  return writev_full(fd, iov, 3);
+}
+
+int query_response_read(int fd, double *values, uint8_t *status,
+                        int capacity, int *count) {
+  uint32_t header[2];
+  int eof = 0;
+  if (!read_full(fd, header, RESPONSE_HEADER_SIZE, &eof)) {
+    fprintf(stderr, "Error: The server closed the connection\n");
+    return 0;
+  }
+  if (header[0] != QUERY_RESPONSE_MAGIC || header[1] > (uint32_t)capacity) {
+    fprintf(stderr, "Error: Malformed response header\n");
+    return 0;
+  }
+  *count = (int)header[1];
+  if (!read_full(fd, values, sizeof(double) * header[1], &eof) ||
+      !read_full(fd, status, header[1], &eof)) {
+    fprintf(stderr, "Error: Truncated response\n");
+    return 0;
+  }
+  return 1;
+}
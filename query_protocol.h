@@ -0,0 +1,77 @@
+#ifndef QUERY_PROTOCOL_H
+#define QUERY_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Framing between gdal_query_server and its clients. Both ends run on the
+// same host, so fields are in native byte order and packed without padding.
+//
+// Request:  uint32 magic QUERY_REQUEST_MAGIC, uint32 body bytes,
+//           uint32 path_count, uint32 query_count, then the body:
+//           path_count x (uint16 length, `length` bytes of path),
+//           query_count x (uint32 path index, float64 x, float64 y)
+// Response: uint32 magic QUERY_RESPONSE_MAGIC, uint32 query_count,
+//           query_count x float64 value, query_count x uint8 QueryStatus
+//
+// Responses hold one value per query, in request order.
+#define QUERY_REQUEST_MAGIC 0x51525147u  // "GQRQ"
+#define QUERY_RESPONSE_MAGIC 0x53525147u // "GQRS"
+#define QUERY_MAX_PATHS 4096
+#define QUERY_MAX_PATH_LENGTH 4095
+#define QUERY_MAX_BATCH (1 << 20)
+// Bytes of one query on the wire
+#define QUERY_WIRE_SIZE 20
+
+typedef enum {
+  QUERY_VALUE = 0,
+  QUERY_NODATA = 1,
+  // The point is outside the raster
+  QUERY_OUTSIDE = 2,
+  // The dataset could not be opened or read
+  QUERY_ERROR = 3
+} QueryStatus;
+
+typedef struct {
+  uint32_t path;
+  double x;
+  double y;
+} QueryPoint;
+
+// A decoded request. The buffers are reused by later reads into the same
+// batch; paths point into `body` and are NUL-terminated.
+typedef struct {
+  int path_count;
+  int count;
+  const char **paths;
+  QueryPoint *queries;
+  unsigned char *body;
+  size_t body_capacity;
+  int path_capacity;
+  int query_capacity;
+} QueryBatch;
+
+// Reads or writes exactly n bytes, retrying on short transfers and EINTR.
+// read_full sets *eof and returns 0 when the peer closed before the first
+// byte.
+int read_full(int fd, void *buf, size_t n, int *eof);
+int write_full(int fd, const void *buf, size_t n);
+
+// Reads one request into batch. Returns 0 at end of stream (*eof set) or on
+// a malformed frame, which is reported.
+int query_batch_read(int fd, QueryBatch *batch, int *eof);
+void query_batch_free(QueryBatch *batch);
+
+// Writes one request. Returns 0 if the write fails.
+int query_request_write(int fd, const char *const *paths, int path_count,
+                        const QueryPoint *queries, int count);
+
+// Writes the response for `count` queries. Returns 0 if the write fails.
+int query_response_write(int fd, const double *values, const uint8_t *status,
+                         int count);
+// Reads a response of at most `capacity` queries. Returns 0 if the peer
+// closed or the frame is malformed, which is reported.
+int query_response_read(int fd, double *values, uint8_t *status,
+                        int capacity, int *count);
+
+#endif
@@ -0,0 +1,491 @@
+#include "raw_tile.h"
+
+#include "cpl_conv.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <zlib.h>
+#ifdef GDAL_TEST_ZSTD
+#include <zstd.h>
+#endif
+
+#define LZW_CLEAR 256
+#define LZW_EOI 257
+#define LZW_FIRST 258
+#define LZW_MAX_BITS 12
+#define LZW_MAX_CODES (1 << LZW_MAX_BITS)
+
+const char *raw_tile_codec_name(RawTileCodec codec) {
+  switch (codec) {
+  case RAW_TILE_DEFLATE:
+    return "DEFLATE";
+  case RAW_TILE_LZW:
+    return "LZW";
+  case RAW_TILE_ZSTD:
+    return "ZSTD";
+  default:
+    return "NONE";
+  }
+}
+
+static int host_big_endian(void) {
+  const uint16_t one = 1;
+  return *(const unsigned char *)&one == 0;
+}
+
+static int read_at(RawTileReader *reader, uint64_t offset, void *buffer,
+                   size_t size) {
+  if (reader->vsi) {
+    return VSIFSeekL(reader->vsi, (vsi_l_offset)offset, SEEK_SET) == 0 &&
+           VSIFReadL(buffer, 1, size, reader->vsi) == size;
+  }
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = pread(reader->fd, (char *)buffer + done, size - done,
+                      (off_t)(offset + done));
+    if (n <= 0) {
+      return 0;
+    }
+    done += (size_t)n;
+  }
+  return 1;
+}
+
+static int parse_codec(const char *compression, RawTileCodec *codec) {
+  if (!compression || strcasecmp(compression, "NONE") == 0) {
+    *codec = RAW_TILE_NONE;
+  } else if (strcasecmp(compression, "DEFLATE") == 0) {
+    *codec = RAW_TILE_DEFLATE;
+  } else if (strcasecmp(compression, "LZW") == 0) {
+    *codec = RAW_TILE_LZW;
+  } else if (strcasecmp(compression, "ZSTD") == 0) {
+#ifdef GDAL_TEST_ZSTD
+    *codec = RAW_TILE_ZSTD;
+#else
+    fprintf(stderr, "Error: raw_tile was built without libzstd\n");
+    return 0;
+#endif
+  } else {
+    fprintf(stderr, "Error: raw_tile does not decode %s compression\n",
+            compression);
+    return 0;
+  }
+  return 1;
+}
+
+// Checks the dataset's layout and fills in everything but the file access.
+static int describe_band(RawTileReader *reader, const char *path,
+                         int band_number) {
+  GDALDatasetH ds = reader->ds;
+  const char *driver = GDALGetDriverShortName(GDALGetDatasetDriver(ds));
+  if (strcmp(driver, "GTiff") != 0) {
+    fprintf(stderr, "Error: raw_tile reads GTiff files, '%s' is %s\n", path,
+            driver);
+    return 0;
+  }
+  if (band_number < 1 || band_number > GDALGetRasterCount(ds)) {
+    fprintf(stderr, "Error: '%s' has no band %d\n", path, band_number);
+    return 0;
+  }
+  if (!geo_context_init(&reader->geo, ds)) {
+    fprintf(stderr, "Error: Dataset '%s' has no invertible geotransform\n",
+            path);
+    return 0;
+  }
+  reader->band = GDALGetRasterBand(ds, band_number);
+  if (!parse_codec(GDALGetMetadataItem(ds, "COMPRESSION", "IMAGE_STRUCTURE"),
+                   &reader->codec)) {
+    return 0;
+  }
+  const char *predictor =
+      GDALGetMetadataItem(ds, "PREDICTOR", "IMAGE_STRUCTURE");
+  reader->predictor = predictor ? atoi(predictor) : 1;
+  reader->data_type = GDALGetRasterDataType(reader->band);
+  reader->data_type_size = GDALGetDataTypeSizeBytes(reader->data_type);
+  const char *nbits =
+      GDALGetMetadataItem(reader->band, "NBITS", "IMAGE_STRUCTURE");
+  if (GDALDataTypeIsComplex(reader->data_type) ||
+      (nbits && atoi(nbits) != reader->data_type_size * 8) ||
+      reader->predictor < 1 || reader->predictor > 3 ||
+      (reader->predictor == 2 && reader->data_type_size > 8)) {
+    fprintf(stderr, "Error: raw_tile does not decode %s pixels with "
+                    "NBITS=%s and PREDICTOR=%d\n",
+            GDALGetDataTypeName(reader->data_type), nbits ? nbits : "(unset)",
+            reader->predictor);
+    return 0;
+  }
+  const char *interleave =
+      GDALGetMetadataItem(ds, "INTERLEAVE", "IMAGE_STRUCTURE");
+  if (interleave && strcasecmp(interleave, "PIXEL") == 0) {
+    reader->samples = GDALGetRasterCount(ds);
+    reader->sample = band_number - 1;
+  } else {
+    reader->samples = 1;
+    reader->sample = 0;
+  }
+  int has_nodata = FALSE;
+  reader->nodata = GDALGetRasterNoDataValue(reader->band, &has_nodata);
+  reader->has_nodata = has_nodata;
+  GDALGetBlockSize(reader->band, &reader->block_width, &reader->block_height);
+  reader->blocks_x =
+      (reader->geo.raster_x + reader->block_width - 1) / reader->block_width;
+  reader->blocks_y =
+      (reader->geo.raster_y + reader->block_height - 1) / reader->block_height;
+  return 1;
+}
+
+int raw_tile_open(RawTileReader *reader, const char *path, int band) {
+  memset(reader, 0, sizeof(*reader));
+  reader->fd = -1;
+  reader->decoded_x = -1;
+  reader->decoded_y = -1;
+  reader->fetched_x = -1;
+  reader->fetched_y = -1;
+  reader->ds = GDALOpen(path, GA_ReadOnly);
+  if (!reader->ds) {
+    fprintf(stderr, "Error: Failed to open dataset '%s'\n", path);
+    return 0;
+  }
+  if (!describe_band(reader, path, band)) {
+    raw_tile_close(reader);
+    return 0;
+  }
+
+  // Remote and virtual files go through VSI, local files through pread
+  if (strncmp(path, "/vsi", 4) == 0) {
+    reader->vsi = VSIFOpenL(path, "rb");
+  } else {
+    reader->fd = open(path, O_RDONLY);
+  }
+  unsigned char byte_order[2];
+  if ((!reader->vsi && reader->fd < 0) ||
+      !read_at(reader, 0, byte_order, sizeof(byte_order))) {
+    fprintf(stderr, "Error: Failed to read '%s'\n", path);
+    raw_tile_close(reader);
+    return 0;
+  }
+  reader->swap = (byte_order[0] == 'M') != host_big_endian();
+
+  size_t blocks = (size_t)reader->blocks_x * reader->blocks_y;
+  size_t row_bytes = (size_t)reader->block_width * reader->samples *
+                     reader->data_type_size;
+  reader->decoded_bytes = row_bytes * reader->block_height;
+  reader->offsets = (uint64_t *)calloc(blocks, sizeof(uint64_t));
+  reader->sizes = (uint64_t *)calloc(blocks, sizeof(uint64_t));
+  reader->known = (uint8_t *)calloc(blocks, 1);
+  reader->decoded = (unsigned char *)malloc(reader->decoded_bytes);
+  reader->row_buffer = (unsigned char *)malloc(row_bytes);
+  if (!reader->offsets || !reader->sizes || !reader->known ||
+      !reader->decoded || !reader->row_buffer) {
+    fprintf(stderr, "Error: Out of memory opening '%s' for raw reads\n",
+            path);
+    raw_tile_close(reader);
+    return 0;
+  }
+  return 1;
+}
+
+void raw_tile_close(RawTileReader *reader) {
+  // fd is only set once ds is, so a zeroed reader closes nothing
+  if (reader->ds) {
+    if (reader->fd >= 0) {
+      close(reader->fd);
+    }
+    GDALClose(reader->ds);
+  }
+  if (reader->vsi) {
+    VSIFCloseL(reader->vsi);
+  }
+  free(reader->offsets);
+  free(reader->sizes);
+  free(reader->known);
+  free(reader->compressed);
+  free(reader->row_buffer);
+  free(reader->decoded);
+  reader->ds = NULL;
+  reader->band = NULL;
+  reader->fd = -1;
+  reader->vsi = NULL;
+  reader->offsets = NULL;
+  reader->sizes = NULL;
+  reader->known = NULL;
+  reader->compressed = NULL;
+  reader->compressed_capacity = 0;
+  reader->row_buffer = NULL;
+  reader->decoded = NULL;
+  reader->decoded_x = -1;
+  reader->decoded_y = -1;
+}
+
+// Looks up the offset and size of a block in the "TIFF" metadata domain on
+// first use. The driver has no entry for sparse blocks.
+static void locate_block(RawTileReader *reader, int block_x, int block_y) {
+  size_t index = (size_t)block_y * reader->blocks_x + block_x;
+  if (reader->known[index]) {
+    return;
+  }
+  const char *offset = GDALGetMetadataItem(
+      reader->band, CPLSPrintf("BLOCK_OFFSET_%d_%d", block_x, block_y),
+      "TIFF");
+  const char *size = GDALGetMetadataItem(
+      reader->band, CPLSPrintf("BLOCK_SIZE_%d_%d", block_x, block_y), "TIFF");
+  if (offset && size) {
+    reader->offsets[index] = strtoull(offset, NULL, 10);
+    reader->sizes[index] = strtoull(size, NULL, 10);
+  }
+  reader->known[index] = 1;
+}
+
+int raw_tile_fetch(RawTileReader *reader, int block_x, int block_y) {
+  locate_block(reader, block_x, block_y);
+  size_t index = (size_t)block_y * reader->blocks_x + block_x;
+  uint64_t size = reader->sizes[index];
+  reader->fetched_x = block_x;
+  reader->fetched_y = block_y;
+  reader->compressed_size = 0;
+  if (reader->offsets[index] == 0 || size == 0) {
+    return 1;
+  }
+  if (size > reader->compressed_capacity) {
+    unsigned char *grown =
+        (unsigned char *)realloc(reader->compressed, (size_t)size);
+    if (!grown) {
+      fprintf(stderr, "Error: Out of memory fetching block %d,%d\n", block_x,
+              block_y);
+      return 0;
+    }
+    reader->compressed = grown;
+    reader->compressed_capacity = (size_t)size;
+  }
+  if (!read_at(reader, reader->offsets[index], reader->compressed,
+               (size_t)size)) {
+    fprintf(stderr, "Error: Failed to read block %d,%d (%llu bytes at %llu)\n",
+            block_x, block_y, (unsigned long long)size,
+            (unsigned long long)reader->offsets[index]);
+    return 0;
+  }
+  reader->compressed_size = (size_t)size;
+  reader->blocks_fetched++;
+  reader->bytes_fetched += (long long)size;
+  return 1;
+}
+
+typedef struct {
+  uint16_t prefix;
+  uint16_t length;
+  uint8_t suffix;
+  uint8_t first;
+} LzwEntry;
+
+static int lzw_code(const unsigned char *src, size_t src_size, size_t bit,
+                    int width) {
+  size_t byte = bit >> 3;
+  uint32_t v = 0;
+  for (int k = 0; k < 3; k++) {
+    v = v << 8 | (byte + k < src_size ? src[byte + k] : 0);
+  }
+  return (int)(v >> (24 - width - (int)(bit & 7))) & ((1 << width) - 1);
+}
+
+// TIFF's LZW: MSB-first codes of 9 to 12 bits that widen one code early.
+// Returns the bytes written, or -1 on a code that is not in the table.
+static long lzw_decode(const unsigned char *src, size_t src_size,
+                       unsigned char *dst, size_t dst_size) {
+  LzwEntry table[LZW_MAX_CODES];
+  for (int c = 0; c < 256; c++) {
+    table[c].prefix = 0;
+    table[c].length = 1;
+    table[c].suffix = (uint8_t)c;
+    table[c].first = (uint8_t)c;
+  }
+  size_t pos = 0;
+  size_t bit = 0;
+  int width = 9;
+  int next = LZW_FIRST;
+  int prev = -1;
+  while (bit + (size_t)width <= src_size * 8) {
+    int code = lzw_code(src, src_size, bit, width);
+    bit += (size_t)width;
+    if (code == LZW_EOI) {
+      break;
+    }
+    if (code == LZW_CLEAR) {
+      width = 9;
+      next = LZW_FIRST;
+      prev = -1;
+      continue;
+    }
+    if (code > next || (code == next && prev < 0)) {
+      return -1;
+    }
+    if (prev >= 0 && next < LZW_MAX_CODES) {
+      LzwEntry *e = &table[next];
+      e->prefix = (uint16_t)prev;
+      e->length = (uint16_t)(table[prev].length + 1);
+      e->first = table[prev].first;
+      // A code not yet in the table is the previous string plus its own
+      // first byte
+      e->suffix = code == next ? table[prev].first : table[code].first;
+      next++;
+      if (next >= (1 << width) - 1 && width < LZW_MAX_BITS) {
+        width++;
+      }
+    }
+    size_t length = table[code].length;
+    if (pos + length > dst_size) {
+      // More data than the block holds; keep what fits, like libtiff
+      break;
+    }
+    int c = code;
+    for (size_t k = length; k-- > 0;) {
+      dst[pos + k] = table[c].suffix;
+      c = table[c].prefix;
+    }
+    pos += length;
+    prev = code;
+  }
+  return (long)pos;
+}
+
+// Decompresses the fetched block into reader->decoded. Returns the bytes
+// written, or -1 if the data is corrupt.
+static long decompress(RawTileReader *reader) {
+  const unsigned char *src = reader->compressed;
+  size_t size = reader->compressed_size;
+  size_t capacity = reader->decoded_bytes;
+  switch (reader->codec) {
+  case RAW_TILE_DEFLATE: {
+    uLongf written = (uLongf)capacity;
+    return uncompress(reader->decoded, &written, src, (uLong)size) == Z_OK
+               ? (long)written
+               : -1;
+  }
+  case RAW_TILE_LZW:
+    // Old-style LZW, which libtiff still reads, starts with a clear code
+    // written LSB-first
+    if (size >= 2 && src[0] == 0 && (src[1] & 1)) {
+      return -1;
+    }
+    return lzw_decode(src, size, reader->decoded, capacity);
+  case RAW_TILE_ZSTD: {
+#ifdef GDAL_TEST_ZSTD
+    size_t written = ZSTD_decompress(reader->decoded, capacity, src, size);
+    return ZSTD_isError(written) ? -1 : (long)written;
+#else
+    return -1;
+#endif
+  }
+  default: {
+    size_t written = size < capacity ? size : capacity;
+    memcpy(reader->decoded, src, written);
+    return (long)written;
+  }
+  }
+}
+
+static void swap_samples(unsigned char *data, size_t count, int size) {
+  for (size_t i = 0; i < count; i++) {
+    unsigned char *s = data + i * size;
+    for (int a = 0, b = size - 1; a < b; a++, b--) {
+      unsigned char t = s[a];
+      s[a] = s[b];
+      s[b] = t;
+    }
+  }
+}
+
+#define HORIZONTAL_ACCUMULATE(ctype, row, count, stride)                       \
+  do {                                                                         \
+    ctype *p = (ctype *)(row);                                                 \
+    for (size_t i = (stride); i < (count); i++) {                              \
+      p[i] = (ctype)(p[i] + p[i - (stride)]);                                  \
+    }                                                                          \
+  } while (0)
+
+// Undoes PREDICTOR=2 on one row of `count` samples.
+static void undo_horizontal(unsigned char *row, size_t count, int samples,
+                            int size) {
+  switch (size) {
+  case 1:
+    HORIZONTAL_ACCUMULATE(uint8_t, row, count, (size_t)samples);
+    break;
+  case 2:
+    HORIZONTAL_ACCUMULATE(uint16_t, row, count, (size_t)samples);
+    break;
+  case 4:
+    HORIZONTAL_ACCUMULATE(uint32_t, row, count, (size_t)samples);
+    break;
+  default:
+    HORIZONTAL_ACCUMULATE(uint64_t, row, count, (size_t)samples);
+    break;
+  }
+}
+
+// Undoes PREDICTOR=3 on one row of `count` samples: the bytes were
+// differenced, then stored as planes from the most significant byte of the
+// value down, whatever the file's byte order. Gathering the planes back
+// yields values in host order, so like libtiff no swap follows.
+static void undo_floating_point(unsigned char *row, unsigned char *scratch,
+                                size_t count, int samples, int size) {
+  int big_endian = host_big_endian();
+  size_t bytes = count * size;
+  for (size_t i = (size_t)samples; i < bytes; i++) {
+    row[i] = (unsigned char)(row[i] + row[i - samples]);
+  }
+  memcpy(scratch, row, bytes);
+  for (size_t i = 0; i < count; i++) {
+    for (int b = 0; b < size; b++) {
+      int plane = big_endian ? b : size - 1 - b;
+      row[i * size + b] = scratch[(size_t)plane * count + i];
+    }
+  }
+}
+
+int raw_tile_decode(RawTileReader *reader) {
+  int block_x = reader->fetched_x;
+  int block_y = reader->fetched_y;
+  reader->decoded_x = -1;
+  reader->decoded_y = -1;
+  int size = reader->data_type_size;
+  size_t row_samples = (size_t)reader->block_width * reader->samples;
+  if (reader->compressed_size == 0) {
+    // Sparse block
+    double fill = reader->has_nodata ? reader->nodata : 0.0;
+    GDALCopyWords(&fill, GDT_Float64, 0, reader->decoded, reader->data_type,
+                  size, (int)(row_samples * reader->block_height));
+  } else {
+    long written = decompress(reader);
+    // The last strip of a stripped file only holds the rows left
+    int rows = reader->geo.raster_y - block_y * reader->block_height;
+    rows = rows < reader->block_height ? rows : reader->block_height;
+    size_t needed = row_samples * size * rows;
+    if (written < 0 || (size_t)written < needed) {
+      fprintf(stderr, "Error: Block %d,%d is corrupt or truncated (%s)\n",
+              block_x, block_y, raw_tile_codec_name(reader->codec));
+      return 0;
+    }
+    rows = (int)((size_t)written / (row_samples * size));
+    // Floating point prediction works on the bytes as stored, integer
+    // prediction on the values
+    if (reader->swap && size > 1 && reader->predictor != 3) {
+      swap_samples(reader->decoded, row_samples * rows, size);
+    }
+    for (int r = 0; r < rows && reader->predictor > 1; r++) {
+      unsigned char *row = reader->decoded + r * row_samples * size;
+      if (reader->predictor == 2) {
+        undo_horizontal(row, row_samples, reader->samples, size);
+      } else {
+        undo_floating_point(row, reader->row_buffer, row_samples,
+                            reader->samples, size);
+      }
+    }
+  }
+  reader->decoded_x = block_x;
+  reader->decoded_y = block_y;
+  reader->blocks_decoded++;
+  return 1;
+}
@@ -0,0 +1,107 @@
+#ifndef RAW_TILE_H
+#define RAW_TILE_H
+
+#include "cpl_vsi.h"
+#include "gdal.h"
+#include "geo_transform.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Point reads from a GTiff/COG that bypass GDAL's block machinery: the
+// offset and byte count of each block come from the driver's "TIFF" metadata
+// domain (looked up once per block), the compressed bytes are fetched with
+// pread (VSI reads for /vsi paths) and decoded here. Only the last decoded
+// block is kept. Supports uncompressed, DEFLATE, LZW and, when built with
+// libzstd, ZSTD blocks, with horizontal or floating point prediction.
+// Readers are not thread-safe; each worker opens its own.
+typedef enum {
+  RAW_TILE_NONE,
+  RAW_TILE_DEFLATE,
+  RAW_TILE_LZW,
+  RAW_TILE_ZSTD
+} RawTileCodec;
+
+typedef struct {
+  // Kept open for the metadata lookups and verification reads
+  GDALDatasetH ds;
+  GDALRasterBandH band;
+  GeoContext geo;
+  int fd;
+  VSILFILE *vsi;
+  RawTileCodec codec;
+  int predictor;
+  // The file's byte order differs from the host's
+  int swap;
+  GDALDataType data_type;
+  int data_type_size;
+  int has_nodata;
+  double nodata;
+  int block_width;
+  int block_height;
+  int blocks_x;
+  int blocks_y;
+  // Samples per pixel in a block (the band count for INTERLEAVE=PIXEL) and
+  // the one read
+  int samples;
+  int sample;
+  // Per block: file offset and compressed size, and whether they have been
+  // looked up. Blocks without an offset are sparse and read as the nodata
+  // value (or 0).
+  uint64_t *offsets;
+  uint64_t *sizes;
+  uint8_t *known;
+  // Compressed bytes of block (fetched_x, fetched_y)
+  unsigned char *compressed;
+  size_t compressed_capacity;
+  size_t compressed_size;
+  int fetched_x;
+  int fetched_y;
+  // One block row, for undoing floating point prediction
+  unsigned char *row_buffer;
+  // Decoded pixels of block (decoded_x, decoded_y); -1 when none is
+  unsigned char *decoded;
+  size_t decoded_bytes;
+  int decoded_x;
+  int decoded_y;
+  long long blocks_fetched;
+  long long bytes_fetched;
+  long long blocks_decoded;
+} RawTileReader;
+
+// Opens band `band` of the GTiff at path. Prints the reason and returns 0
+// if the file is not a GTiff or uses a layout or codec the reader does not
+// handle.
+int raw_tile_open(RawTileReader *reader, const char *path, int band);
+// Frees what the reader holds and keeps its counters and layout. Safe to
+// call on a zeroed or closed reader.
+void raw_tile_close(RawTileReader *reader);
+
+const char *raw_tile_codec_name(RawTileCodec codec);
+
+// Fetches the compressed bytes of block (block_x, block_y). Returns 0 if the
+// read fails.
+int raw_tile_fetch(RawTileReader *reader, int block_x, int block_y);
+// Decodes the block fetched last into reader->decoded. Returns 0 if the
+// data is corrupt.
+int raw_tile_decode(RawTileReader *reader);
+
+// Whether block (block_x, block_y) is the decoded one.
+static inline int raw_tile_is_decoded(const RawTileReader *reader,
+                                      int block_x, int block_y) {
+  return reader->decoded_x == block_x && reader->decoded_y == block_y;
+}
+
+// Address of pixel (pixel_x, pixel_y), in the band's data type, in the
+// decoded block holding it.
+static inline const void *raw_tile_pixel(const RawTileReader *reader,
+                                         int pixel_x, int pixel_y) {
+  size_t index = ((size_t)(pixel_y % reader->block_height) *
+                      reader->block_width +
+                  pixel_x % reader->block_width) *
+                     reader->samples +
+                 reader->sample;
+  return reader->decoded + index * reader->data_type_size;
+}
+
+#endif
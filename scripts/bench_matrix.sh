@@ -0,0 +1,151 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Usage: scripts/bench_matrix.sh
+# Runs gdal_test over every cell of a matrix of modes and GDAL settings,
+# repeats each cell, and writes one summary table with the mean and a 95%
+# confidence interval of throughput and iteration latency per cell.
+#
+# The matrix is read from the environment (space-separated lists):
+#   BENCH_DATASET      dataset to query (required)
+#   BENCH_MODES        gdal_test modes (default: the seven original modes)
+#   BENCH_CACHEMAX     GDAL_CACHEMAX values (default: "64 512")
+#   BENCH_CURL_CACHE   CPL_VSIL_CURL_CACHE_SIZE values in bytes (default:
+#                      "16384000", GDAL's default)
+#   BENCH_NUM_THREADS  GDAL_NUM_THREADS values (default: "1")
+#   BENCH_BATCH_SIZES  --batch-size values, used by direct_batched_blocks
+#                      only (default: "1000")
+#   BENCH_THREADS      --threads value (default: 1)
+#   BENCH_REPEATS      runs per cell (default: 5)
+#   BENCH_ITERATIONS, BENCH_SEED, BENCH_BBOX
+#                      gdal_test arguments (defaults: 10000, 42,
+#                      -180,-90,180,90)
+#   BENCH_ARGS         extra gdal_test options, e.g. "--distribution zipf"
+#   BENCH_OUT          output directory (default: bench_results)
+#
+# Writes $BENCH_OUT/raw.csv (one row per run), $BENCH_OUT/summary.csv and
+# $BENCH_OUT/summary.json (one row per cell).
+# Example:
+#   make bench BENCH_DATASET=/path/to/file.tif BENCH_MODES="direct vrt_api"
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+GDAL_TEST="$ROOT_DIR/gdal_test"
+
+DATASET="${BENCH_DATASET:-}"
+if [[ -z "$DATASET" ]]; then
+  echo "Error: set BENCH_DATASET to the dataset to benchmark"
+  exit 1
+fi
+MODES="${BENCH_MODES:-direct direct_reuse_ds direct_reuse_band vrt_api vrt_xml vrt_api_reuse_source vrt_api_reuse_dataset}"
+CACHEMAX_VALUES="${BENCH_CACHEMAX:-64 512}"
+CURL_CACHE_VALUES="${BENCH_CURL_CACHE:-16384000}"
+NUM_THREADS_VALUES="${BENCH_NUM_THREADS:-1}"
+BATCH_SIZES="${BENCH_BATCH_SIZES:-1000}"
+THREADS="${BENCH_THREADS:-1}"
+REPEATS="${BENCH_REPEATS:-5}"
+ITERS="${BENCH_ITERATIONS:-10000}"
+SEED="${BENCH_SEED:-42}"
+BBOX="${BENCH_BBOX:--180,-90,180,90}"
+EXTRA_ARGS="${BENCH_ARGS:-}"
+OUT_DIR="${BENCH_OUT:-bench_results}"
+
+mkdir -p "$OUT_DIR"
+RAW="$OUT_DIR/raw.csv"
+RUN_CSV="$OUT_DIR/.run.csv"
+echo "cachemax,curl_cache,gdal_num_threads,repeat,mode,distribution,threads,batch_size,files,queries,elapsed_seconds,queries_per_second,mean_us,p50_us,p90_us,p99_us,p999_us,max_us" > "$RAW"
+
+for MODE in $MODES; do
+  # Batch size only changes direct_batched_blocks
+  if [[ "$MODE" == "direct_batched_blocks" ]]; then
+    MODE_BATCHES="$BATCH_SIZES"
+  else
+    MODE_BATCHES="-"
+  fi
+  for CACHEMAX in $CACHEMAX_VALUES; do
+    for CURL_CACHE in $CURL_CACHE_VALUES; do
+      for NUM_THREADS in $NUM_THREADS_VALUES; do
+        for BATCH in $MODE_BATCHES; do
+          BATCH_ARGS=()
+          if [[ "$BATCH" != "-" ]]; then
+            BATCH_ARGS=(--batch-size "$BATCH")
+          fi
+          for ((r = 1; r <= REPEATS; r++)); do
+            echo "$MODE cachemax=$CACHEMAX curl_cache=$CURL_CACHE" \
+              "num_threads=$NUM_THREADS batch=$BATCH repeat $r/$REPEATS"
+            rm -f "$RUN_CSV"
+            # shellcheck disable=SC2086
+            GDAL_CACHEMAX="$CACHEMAX" CPL_VSIL_CURL_CACHE_SIZE="$CURL_CACHE" \
+              GDAL_NUM_THREADS="$NUM_THREADS" \
+              "$GDAL_TEST" "$DATASET" "$ITERS" "$SEED" "$BBOX" "$MODE" \
+              --threads "$THREADS" ${BATCH_ARGS[@]+"${BATCH_ARGS[@]}"} $EXTRA_ARGS \
+              --csv "$RUN_CSV" > /dev/null
+            tail -n +2 "$RUN_CSV" | sed "s/^/$CACHEMAX,$CURL_CACHE,$NUM_THREADS,$r,/" >> "$RAW"
+          done
+        done
+      done
+    done
+  done
+done
+rm -f "$RUN_CSV"
+
+# Groups runs by cell and reports the mean of each metric with the half-width
+# of its 95% confidence interval (Student's t with repeats - 1 degrees of
+# freedom).
+awk -F, -v csv="$OUT_DIR/summary.csv" -v json="$OUT_DIR/summary.json" '
+function t95(df) {
+  split("12.706 4.303 3.182 2.776 2.571 2.447 2.365 2.306 2.262 2.228 " \
+        "2.201 2.179 2.160 2.145 2.131 2.120 2.110 2.101 2.093 2.086 " \
+        "2.080 2.074 2.069 2.064 2.060 2.056 2.052 2.048 2.045 2.042", t, " ")
+  return df < 1 ? 0 : (df <= 30 ? t[df] : 1.960)
+}
+function ci(key, m,   n, mean, var) {
+  n = count[key]
+  mean = sum[key, m] / n
+  var = n > 1 ? (sumsq[key, m] - n * mean * mean) / (n - 1) : 0
+  if (var < 0) var = 0
+  half[key, m] = t95(n - 1) * sqrt(var / n)
+  return mean
+}
+NR == 1 { next }
+{
+  # cachemax, curl_cache, gdal_num_threads, mode, distribution, threads,
+  # batch_size
+  key = $1 "," $2 "," $3 "," $5 "," $6 "," $7 "," $8
+  if (!(key in count)) order[++cells] = key
+  count[key]++
+  # queries_per_second, mean_us, p50_us, p90_us, p99_us, p999_us
+  for (m = 1; m <= 6; m++) {
+    v = $(11 + m)
+    sum[key, m] += v
+    sumsq[key, m] += v * v
+  }
+}
+END {
+  split("qps mean_us p50_us p90_us p99_us p999_us", names, " ")
+  header = "cachemax,curl_cache,gdal_num_threads,mode,distribution,threads,batch_size,repeats"
+  for (m = 1; m <= 6; m++) header = header "," names[m] "," names[m] "_ci95"
+  print header > csv
+  print "[" > json
+  for (c = 1; c <= cells; c++) {
+    key = order[c]
+    split(key, f, ",")
+    line = key "," count[key]
+    obj = sprintf("  {\"cachemax\": \"%s\", \"curl_cache\": \"%s\", " \
+                  "\"gdal_num_threads\": \"%s\", \"mode\": \"%s\", " \
+                  "\"distribution\": \"%s\", \"threads\": %s, " \
+                  "\"batch_size\": %s, \"repeats\": %d",
+                  f[1], f[2], f[3], f[4], f[5], f[6], f[7], count[key])
+    for (m = 1; m <= 6; m++) {
+      mean = ci(key, m)
+      line = line sprintf(",%.3f,%.3f", mean, half[key, m])
+      obj = obj sprintf(", \"%s\": %.3f, \"%s_ci95\": %.3f",
+                        names[m], mean, names[m], half[key, m])
+    }
+    print line > csv
+    print obj "}" (c < cells ? "," : "") > json
+  }
+  print "]" > json
+}' "$RAW"
+
+column -s, -t < "$OUT_DIR/summary.csv" 2>/dev/null || cat "$OUT_DIR/summary.csv"
+echo "Generated: $OUT_DIR/summary.csv $OUT_DIR/summary.json"
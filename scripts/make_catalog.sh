@@ -0,0 +1,47 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Usage: scripts/make_catalog.sh <dataset_path> <tiles_x> <tiles_y> <output_dir>
+# Cuts one GeoTIFF into a <tiles_x> by <tiles_y> grid of GeoTIFF tiles with
+# gdal_translate, and writes their paths to <output_dir>/files.txt. Either the
+# directory or the list can be passed as <path> in the catalog modes.
+# Example:
+#   scripts/make_catalog.sh /path/to/file.tif 16 8 /tmp/catalog
+
+if [[ $# -ne 4 ]]; then
+  echo "Usage: $0 <dataset_path> <tiles_x> <tiles_y> <output_dir>"
+  exit 1
+fi
+
+DATASET="$1"
+TILES_X="$2"
+TILES_Y="$3"
+OUT_DIR="$4"
+
+read -r WIDTH HEIGHT < <(gdalinfo "$DATASET" |
+  sed -n 's/^Size is \([0-9]*\), *\([0-9]*\)$/\1 \2/p')
+TILE_W=$(((WIDTH + TILES_X - 1) / TILES_X))
+TILE_H=$(((HEIGHT + TILES_Y - 1) / TILES_Y))
+
+mkdir -p "$OUT_DIR"
+OUT_DIR="$(cd "$OUT_DIR" && pwd)"
+LIST="$OUT_DIR/files.txt"
+: > "$LIST"
+
+for ((ty = 0; ty < TILES_Y; ty++)); do
+  for ((tx = 0; tx < TILES_X; tx++)); do
+    XOFF=$((tx * TILE_W))
+    YOFF=$((ty * TILE_H))
+    W=$((WIDTH - XOFF < TILE_W ? WIDTH - XOFF : TILE_W))
+    H=$((HEIGHT - YOFF < TILE_H ? HEIGHT - YOFF : TILE_H))
+    if ((W <= 0 || H <= 0)); then
+      continue
+    fi
+    TILE="$OUT_DIR/tile_${tx}_${ty}.tif"
+    gdal_translate -q -srcwin "$XOFF" "$YOFF" "$W" "$H" \
+      -co TILED=YES -co COMPRESS=DEFLATE "$DATASET" "$TILE"
+    echo "$TILE" >> "$LIST"
+  done
+done
+
+echo "Generated: $LIST"
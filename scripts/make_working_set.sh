@@ -0,0 +1,31 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Usage: scripts/make_working_set.sh <dataset_path> <count> <output_dir>
+# Creates <count> symlinks to one GeoTIFF so that GDAL opens each of them as a
+# distinct dataset, and writes their paths to <output_dir>/files.txt for use
+# with gdal_test --file-list.
+# Example:
+#   scripts/make_working_set.sh /path/to/file.tif 1024 /tmp/working_set
+
+if [[ $# -ne 3 ]]; then
+  echo "Usage: $0 <dataset_path> <count> <output_dir>"
+  exit 1
+fi
+
+DATASET="$(cd "$(dirname "$1")" && pwd)/$(basename "$1")"
+COUNT="$2"
+OUT_DIR="$3"
+
+mkdir -p "$OUT_DIR"
+OUT_DIR="$(cd "$OUT_DIR" && pwd)"
+LIST="$OUT_DIR/files.txt"
+: > "$LIST"
+
+for ((i = 0; i < COUNT; i++)); do
+  LINK="$OUT_DIR/file_$i.tif"
+  ln -sf "$DATASET" "$LINK"
+  echo "$LINK" >> "$LIST"
+done
+
+echo "Generated: $LIST"
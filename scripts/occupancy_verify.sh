@@ -0,0 +1,67 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Usage: scripts/occupancy_verify.sh <dataset_path> <bbox> <output_dir> [iterations]
+# Warps band 1 of one dataset onto an extent twice as wide as <bbox>, once
+# per data type and nodata value below, so that the added half is nodata
+# written out in full blocks. Runs gdal_test direct_reuse_ds on each copy
+# with and without --occupancy scan and checks that the scan finds empty
+# blocks and that every point reads the same either way. <bbox> is
+# xmin,ymin,xmax,ymax in the dataset's coordinates.
+# Exits with an error if any copy does not match.
+# Example:
+#   scripts/occupancy_verify.sh /path/to/file.tif -180,-90,0,90 /tmp/occupancy
+
+if [[ $# -lt 3 || $# -gt 4 ]]; then
+  echo "Usage: $0 <dataset_path> <bbox> <output_dir> [iterations]"
+  exit 1
+fi
+
+DATASET="$1"
+BBOX="$2"
+OUT_DIR="$3"
+ITERS="${4:-2000}"
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+GDAL_TEST="$ROOT_DIR/gdal_test"
+
+IFS=, read -r XMIN YMIN XMAX YMAX <<< "$BBOX"
+WIDE_XMAX="$(awk -v a="$XMIN" -v b="$XMAX" 'BEGIN { printf "%.17g", 2 * b - a }')"
+WIDE_BBOX="$XMIN,$YMIN,$WIDE_XMAX,$YMAX"
+
+# name|data type|nodata
+CASES=(
+  "byte|Byte|255"
+  "int16|Int16|-32768"
+  # Not representable as a float: the band holds it rounded, and the scan
+  # must compare against the rounded value
+  "float32|Float32|-3.4e38"
+  "float32_nan|Float32|nan"
+  "float64|Float64|-3.4e38"
+)
+
+mkdir -p "$OUT_DIR"
+SOURCE="$OUT_DIR/band1.vrt"
+gdal_translate -q -of VRT -b 1 "$DATASET" "$SOURCE"
+FAILED=0
+for CASE in "${CASES[@]}"; do
+  IFS='|' read -r NAME TYPE NODATA <<< "$CASE"
+  COPY="$OUT_DIR/$NAME.tif"
+  rm -f "$COPY"
+  gdalwarp -q -ot "$TYPE" -dstnodata "$NODATA" \
+    -te "$XMIN" "$YMIN" "$WIDE_XMAX" "$YMAX" -co TILED=YES "$SOURCE" "$COPY"
+  "$GDAL_TEST" "$COPY" "$ITERS" 42 "$WIDE_BBOX" direct_reuse_ds \
+    --print-pixels > "$OUT_DIR/$NAME.read.log" 2>&1
+  "$GDAL_TEST" "$COPY" "$ITERS" 42 "$WIDE_BBOX" direct_reuse_ds \
+    --print-pixels --occupancy scan > "$OUT_DIR/$NAME.occupancy.log" 2>&1
+  if ! grep -q '^Occupancy: [1-9][0-9]* of' "$OUT_DIR/$NAME.occupancy.log"; then
+    echo "FAILED  $NAME: no empty blocks found (see $OUT_DIR/$NAME.occupancy.log)"
+    FAILED=1
+  elif ! diff -q <(grep '^Iteration' "$OUT_DIR/$NAME.read.log") \
+    <(grep '^Iteration' "$OUT_DIR/$NAME.occupancy.log") > /dev/null; then
+    echo "FAILED  $NAME: values differ from reading every point"
+    FAILED=1
+  else
+    echo "ok      $NAME"
+  fi
+done
+exit "$FAILED"
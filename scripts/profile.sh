@@ -2,19 +2,25 @@
 set -euo pipefail
 
 # Usage: scripts/profile.sh [dataset_path] <iterations> <seed> <bbox> <mode> <duration_seconds>
+# macOS only (uses /usr/bin/sample); on Linux use scripts/profile_linux.sh.
 # Examples:
 #   scripts/profile.sh 10000 42 -180,-90,180,90 direct 30
 #   scripts/profile.sh /path/to/file.tif 10000 42 -180,-90,180,90 direct 30
 
 ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
 PROFILES_DIR="$ROOT_DIR/profiles"
-FLAMEGRAPH_DIR="$HOME/workspace/github/FlameGraph"
+FLAMEGRAPH_DIR="${FLAMEGRAPH_DIR:-$HOME/workspace/github/FlameGraph}"
 GDAL_TEST="$ROOT_DIR/gdal_test"
 
 mkdir -p "$PROFILES_DIR"
 
+if [[ "$(uname)" != "Darwin" ]]; then
+  echo "Error: $0 needs macOS; use scripts/profile_linux.sh on Linux"
+  exit 1
+fi
+
 # Determine dataset path (optional first argument)
-DATASET_DEFAULT="/Users/bopeng/workspace/data/raster/population/ppp_2020_1km_Aggregated.tif"
+DATASET_DEFAULT="${PROFILE_DATASET:-/Users/bopeng/workspace/data/raster/population/ppp_2020_1km_Aggregated.tif}"
 if [[ $# -ge 6 && -f "$1" ]]; then
   DATASET="$1"; shift
 else
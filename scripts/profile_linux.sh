@@ -0,0 +1,84 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Usage: scripts/profile_linux.sh <dataset_path> <iterations> <seed> <bbox> <mode> [gdal_test options...]
+# Profiles one gdal_test run on Linux with perf and writes into profiles/:
+#   <mode>.perfstat.txt   hardware counters: cycles, instructions (IPC),
+#                         cache references/misses, L1d and LLC load misses,
+#                         branches and branch misses
+#   <mode>.perf.data      on-CPU samples with call graphs (perf report -i)
+#   <mode>.folded/.svg    flame graph, if FlameGraph is found
+#   <mode>.phases.txt     per-phase on-CPU stacks, off-CPU time and latency
+#                         histograms from the USDT probes, if bpftrace is
+#                         installed and gdal_test was built with <sys/sdt.h>
+# Environment:
+#   FLAMEGRAPH_DIR   FlameGraph checkout (default: ~/FlameGraph)
+#   PERF_FREQ        sampling frequency in Hz (default: 999)
+#   PERF_CALL_GRAPH  perf --call-graph mode (default: dwarf, which does not
+#                    need frame pointers)
+# Example:
+#   scripts/profile_linux.sh /path/to/file.tif 100000 42 -180,-90,180,90 vrt_xml
+
+if [[ $# -lt 5 ]]; then
+  echo "Usage: $0 <dataset_path> <iterations> <seed> <bbox> <mode> [gdal_test options...]"
+  exit 1
+fi
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+PROFILES_DIR="$ROOT_DIR/profiles"
+FLAMEGRAPH_DIR="${FLAMEGRAPH_DIR:-$HOME/FlameGraph}"
+PERF_FREQ="${PERF_FREQ:-999}"
+PERF_CALL_GRAPH="${PERF_CALL_GRAPH:-dwarf}"
+GDAL_TEST="$ROOT_DIR/gdal_test"
+MODE="$5"
+
+if ! command -v perf > /dev/null; then
+  echo "Error: perf not found (linux-tools-\$(uname -r) or linux-perf)"
+  exit 1
+fi
+mkdir -p "$PROFILES_DIR"
+CMD=("$GDAL_TEST" "$@")
+
+# Counters that are not supported on this CPU or in this VM show up as
+# "<not supported>" rather than failing the run
+STAT_OUT="$PROFILES_DIR/${MODE}.perfstat.txt"
+perf stat -e cycles,instructions,cache-references,cache-misses \
+  -e L1-dcache-load-misses,LLC-load-misses,branches,branch-misses \
+  -o "$STAT_OUT" -- "${CMD[@]}" > /dev/null
+cat "$STAT_OUT"
+
+DATA_OUT="$PROFILES_DIR/${MODE}.perf.data"
+perf record -F "$PERF_FREQ" --call-graph "$PERF_CALL_GRAPH" -o "$DATA_OUT" \
+  -- "${CMD[@]}" > /dev/null
+echo "Generated: $DATA_OUT"
+
+if [[ -x "$FLAMEGRAPH_DIR/flamegraph.pl" ]]; then
+  FOLDED_OUT="$PROFILES_DIR/${MODE}.folded"
+  SVG_OUT="$PROFILES_DIR/${MODE}.svg"
+  perf script -i "$DATA_OUT" | "$FLAMEGRAPH_DIR/stackcollapse-perf.pl" > "$FOLDED_OUT"
+  "$FLAMEGRAPH_DIR/flamegraph.pl" --title "gdal_test $MODE" "$FOLDED_OUT" > "$SVG_OUT"
+  echo "Generated: $SVG_OUT"
+else
+  echo "FlameGraph not found in $FLAMEGRAPH_DIR; skipping the flame graph"
+fi
+
+if ! command -v bpftrace > /dev/null; then
+  echo "bpftrace not found; skipping the per-phase profile"
+elif ! readelf -n "$GDAL_TEST" 2>/dev/null | grep -q stapsdt; then
+  echo "gdal_test has no USDT probes (install systemtap-sdt-dev and rebuild);" \
+    "skipping the per-phase profile"
+else
+  PHASES_OUT="$PROFILES_DIR/${MODE}.phases.txt"
+  # The probes name ./gdal_test, and bpftrace runs the command itself, so
+  # run from the repository root and quote each argument
+  (cd "$ROOT_DIR" && bpftrace -o "$PHASES_OUT" \
+    -c "$(printf '%q ' "${CMD[@]}")" scripts/phase_profile.bt > /dev/null)
+  echo "Generated: $PHASES_OUT"
+  if [[ -x "$FLAMEGRAPH_DIR/flamegraph.pl" ]] &&
+    [[ -x "$FLAMEGRAPH_DIR/stackcollapse-bpftrace.pl" ]]; then
+    SVG_OUT="$PROFILES_DIR/${MODE}.phases.svg"
+    "$FLAMEGRAPH_DIR/stackcollapse-bpftrace.pl" "$PHASES_OUT" |
+      "$FLAMEGRAPH_DIR/flamegraph.pl" --title "gdal_test $MODE by phase" > "$SVG_OUT"
+    echo "Generated: $SVG_OUT"
+  fi
+fi
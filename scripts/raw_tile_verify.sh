@@ -0,0 +1,80 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Usage: scripts/raw_tile_verify.sh <dataset_path> <bbox> <output_dir> [iterations]
+# Rewrites band 1 of one dataset with gdal_translate into the layouts the
+# raw_tile decoder handles (codecs, predictors, byte orders, strips, pixel
+# and band interleaving) and runs gdal_test raw_tile --raw-tile-verify on
+# each copy, which checks every read against GDALRasterIO. Multi-band copies
+# add the mask band after band 1, so a wrong sample stride reads mask values.
+# <bbox> is xmin,ymin,xmax,ymax as for gdal_test. Cases whose codec GDAL
+# cannot write or gdal_test was built without are skipped.
+# Exits with an error if any copy does not match.
+# Example:
+#   scripts/raw_tile_verify.sh /path/to/file.tif -180,-90,180,90 /tmp/raw_tile
+
+if [[ $# -lt 3 || $# -gt 4 ]]; then
+  echo "Usage: $0 <dataset_path> <bbox> <output_dir> [iterations]"
+  exit 1
+fi
+
+DATASET="$1"
+BBOX="$2"
+OUT_DIR="$3"
+ITERS="${4:-10000}"
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+GDAL_TEST="$ROOT_DIR/gdal_test"
+
+# name|gdal_translate options
+CASES=(
+  "byte_none|-ot Byte -co TILED=YES"
+  "byte_lzw_strip|-ot Byte -co COMPRESS=LZW"
+  "int16_deflate_p2|-ot Int16 -co TILED=YES -co COMPRESS=DEFLATE -co PREDICTOR=2"
+  "int16_deflate_p2_be|-ot Int16 -co TILED=YES -co COMPRESS=DEFLATE -co PREDICTOR=2 -co ENDIANNESS=BIG"
+  "uint32_lzw_be|-ot UInt32 -co TILED=YES -co COMPRESS=LZW -co ENDIANNESS=BIG"
+  "float32_deflate_p3|-ot Float32 -co TILED=YES -co COMPRESS=DEFLATE -co PREDICTOR=3"
+  # The floating point predictor stores byte planes independently of the
+  # file's byte order; decoding must not swap the values afterwards
+  "float32_deflate_p3_be|-ot Float32 -co TILED=YES -co COMPRESS=DEFLATE -co PREDICTOR=3 -co ENDIANNESS=BIG"
+  "float64_lzw_p3_be|-ot Float64 -co TILED=YES -co COMPRESS=LZW -co PREDICTOR=3 -co ENDIANNESS=BIG"
+  "float32_strip_deflate_p3_be|-ot Float32 -co COMPRESS=DEFLATE -co PREDICTOR=3 -co ENDIANNESS=BIG"
+  "byte_zstd|-ot Byte -co TILED=YES -co COMPRESS=ZSTD"
+  "int16_zstd_p2_be|-ot Int16 -co TILED=YES -co COMPRESS=ZSTD -co PREDICTOR=2 -co ENDIANNESS=BIG"
+  "float32_zstd_p3|-ot Float32 -co TILED=YES -co COMPRESS=ZSTD -co PREDICTOR=3"
+  "float64_strip_zstd_p3_be|-ot Float64 -co COMPRESS=ZSTD -co PREDICTOR=3 -co ENDIANNESS=BIG"
+  "byte_pixel3_lzw_p2|-ot Byte -b mask -b mask -co TILED=YES -co COMPRESS=LZW -co PREDICTOR=2 -co INTERLEAVE=PIXEL"
+  "uint16_pixel2_none_be|-ot UInt16 -b mask -co TILED=YES -co INTERLEAVE=PIXEL -co ENDIANNESS=BIG"
+  "int16_pixel2_deflate_p2_be|-ot Int16 -b mask -co TILED=YES -co COMPRESS=DEFLATE -co PREDICTOR=2 -co INTERLEAVE=PIXEL -co ENDIANNESS=BIG"
+  "float32_pixel3_deflate_p3|-ot Float32 -b mask -b mask -co TILED=YES -co COMPRESS=DEFLATE -co PREDICTOR=3 -co INTERLEAVE=PIXEL"
+  "float64_pixel2_zstd_p3_be|-ot Float64 -b mask -co TILED=YES -co COMPRESS=ZSTD -co PREDICTOR=3 -co INTERLEAVE=PIXEL -co ENDIANNESS=BIG"
+  "uint32_strip_pixel2_lzw_p2|-ot UInt32 -b mask -co COMPRESS=LZW -co PREDICTOR=2 -co INTERLEAVE=PIXEL"
+  "int16_band3_deflate_p2|-ot Int16 -b mask -b mask -co TILED=YES -co COMPRESS=DEFLATE -co PREDICTOR=2 -co INTERLEAVE=BAND"
+)
+
+mkdir -p "$OUT_DIR"
+FAILED=0
+for CASE in "${CASES[@]}"; do
+  NAME="${CASE%%|*}"
+  OPTIONS="${CASE#*|}"
+  COPY="$OUT_DIR/$NAME.tif"
+  COMPRESS="$(sed -n 's/.*-co COMPRESS=\([A-Z]*\).*/\1/p' <<< "$OPTIONS")"
+  rm -f "$COPY"
+  # shellcheck disable=SC2086
+  gdal_translate -q -b 1 $OPTIONS "$DATASET" "$COPY"
+  # GDAL writes an uncompressed file when it lacks the codec
+  if [[ -n "$COMPRESS" ]] &&
+    ! gdalinfo "$COPY" | grep -q "COMPRESSION=$COMPRESS"; then
+    echo "skipped $NAME (GDAL cannot write $COMPRESS)"
+    continue
+  fi
+  if "$GDAL_TEST" "$COPY" "$ITERS" 42 "$BBOX" raw_tile --raw-tile-verify \
+    > "$OUT_DIR/$NAME.log" 2>&1; then
+    echo "ok      $NAME"
+  elif grep -q "built without libzstd" "$OUT_DIR/$NAME.log"; then
+    echo "skipped $NAME (gdal_test was built without libzstd)"
+  else
+    echo "FAILED  $NAME (see $OUT_DIR/$NAME.log)"
+    FAILED=1
+  fi
+done
+exit "$FAILED"
@@ -0,0 +1,435 @@
+#include "tile_cache.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_BUCKET_COUNT 256
+
+typedef struct TileCacheEntry TileCacheEntry;
+typedef struct TileCacheLoad TileCacheLoad;
+
+struct TileCacheEntry {
+  uint64_t dataset_id;
+  uint64_t hash;
+  int band;
+  int block_x;
+  int block_y;
+  int block_width;
+  GDALDataType data_type;
+  int data_type_size;
+  size_t bytes;
+  // Set on every hit and cleared as the CLOCK hand passes.
+  int referenced;
+  TileCacheEntry *bucket_next;
+  unsigned char *data;
+};
+
+// A block some thread is reading. Lives on the loading thread's stack and
+// is linked into its shard until the block is published.
+struct TileCacheLoad {
+  uint64_t dataset_id;
+  uint64_t hash;
+  int band;
+  int block_x;
+  int block_y;
+  TileCacheLoad *next;
+};
+
+struct TileCacheShard {
+  pthread_mutex_t mutex;
+  // Broadcast whenever a load finishes, successfully or not
+  pthread_cond_t loaded;
+  TileCacheLoad *loads;
+  TileCacheEntry **buckets;
+  unsigned int bucket_mask;
+  // Entries in CLOCK order; the hand walks this array.
+  TileCacheEntry **ring;
+  int count;
+  int ring_capacity;
+  int hand;
+  size_t budget;
+  size_t bytes;
+  size_t peak_bytes;
+  long long hits;
+  long long misses;
+  long long waits;
+  long long evictions;
+};
+
+// FNV-1a
+uint64_t tile_cache_dataset_id(const char *path) {
+  uint64_t h = 14695981039346656037ull;
+  for (const unsigned char *c = (const unsigned char *)path; *c; c++) {
+    h ^= *c;
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+// splitmix64 finalizer over the key fields
+static uint64_t hash_key(uint64_t dataset_id, int band, int block_x,
+                         int block_y) {
+  uint64_t h = dataset_id ^ ((uint64_t)(uint32_t)band << 48) ^
+               ((uint64_t)(uint32_t)block_x << 24) ^ (uint32_t)block_y;
+  h ^= h >> 30;
+  h *= 0xBF58476D1CE4E5B9ull;
+  h ^= h >> 27;
+  h *= 0x94D049BB133111EBull;
+  h ^= h >> 31;
+  return h;
+}
+
+int tile_cache_init(TileCache *cache, size_t budget_bytes, int shard_count) {
+  memset(cache, 0, sizeof(*cache));
+  if (budget_bytes == 0 || shard_count <= 0) {
+    return 0;
+  }
+  cache->shards =
+      (TileCacheShard *)calloc((size_t)shard_count, sizeof(TileCacheShard));
+  if (!cache->shards) {
+    return 0;
+  }
+  for (int s = 0; s < shard_count; s++) {
+    TileCacheShard *shard = &cache->shards[s];
+    shard->buckets = (TileCacheEntry **)calloc(INITIAL_BUCKET_COUNT,
+                                               sizeof(TileCacheEntry *));
+    if (!shard->buckets) {
+      cache->shard_count = s;
+      tile_cache_destroy(cache);
+      return 0;
+    }
+    pthread_mutex_init(&shard->mutex, NULL);
+    pthread_cond_init(&shard->loaded, NULL);
+    shard->bucket_mask = INITIAL_BUCKET_COUNT - 1;
+    shard->budget = budget_bytes / (size_t)shard_count;
+  }
+  cache->shard_count = shard_count;
+  cache->budget_bytes = budget_bytes;
+  return 1;
+}
+
+static void shard_free_entries(TileCacheShard *shard) {
+  for (int i = 0; i < shard->count; i++) {
+    free(shard->ring[i]->data);
+    free(shard->ring[i]);
+  }
+  memset(shard->buckets, 0,
+         sizeof(TileCacheEntry *) * (shard->bucket_mask + 1));
+  shard->count = 0;
+  shard->hand = 0;
+  shard->bytes = 0;
+}
+
+void tile_cache_destroy(TileCache *cache) {
+  if (!cache->shards) {
+    return;
+  }
+  for (int s = 0; s < cache->shard_count; s++) {
+    TileCacheShard *shard = &cache->shards[s];
+    shard_free_entries(shard);
+    free(shard->buckets);
+    free(shard->ring);
+    pthread_mutex_destroy(&shard->mutex);
+    pthread_cond_destroy(&shard->loaded);
+  }
+  free(cache->shards);
+  memset(cache, 0, sizeof(*cache));
+}
+
+void tile_cache_clear(TileCache *cache) {
+  for (int s = 0; s < cache->shard_count; s++) {
+    TileCacheShard *shard = &cache->shards[s];
+    pthread_mutex_lock(&shard->mutex);
+    shard_free_entries(shard);
+    shard->peak_bytes = 0;
+    shard->hits = 0;
+    shard->misses = 0;
+    shard->waits = 0;
+    shard->evictions = 0;
+    pthread_mutex_unlock(&shard->mutex);
+  }
+}
+
+static TileCacheEntry *shard_find(TileCacheShard *shard, uint64_t hash,
+                                  uint64_t dataset_id, int band, int block_x,
+                                  int block_y) {
+  TileCacheEntry *e = shard->buckets[hash & shard->bucket_mask];
+  for (; e; e = e->bucket_next) {
+    if (e->hash == hash && e->dataset_id == dataset_id && e->band == band &&
+        e->block_x == block_x && e->block_y == block_y) {
+      return e;
+    }
+  }
+  return NULL;
+}
+
+static int shard_loading(const TileCacheShard *shard, uint64_t hash,
+                         uint64_t dataset_id, int band, int block_x,
+                         int block_y) {
+  for (const TileCacheLoad *l = shard->loads; l; l = l->next) {
+    if (l->hash == hash && l->dataset_id == dataset_id && l->band == band &&
+        l->block_x == block_x && l->block_y == block_y) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Marks the block as being read by the calling thread. Called with the
+// shard locked, after checking that it is neither cached nor loading.
+static void shard_begin_load(TileCacheShard *shard, TileCacheLoad *load,
+                             uint64_t hash, uint64_t dataset_id, int band,
+                             int block_x, int block_y) {
+  load->dataset_id = dataset_id;
+  load->hash = hash;
+  load->band = band;
+  load->block_x = block_x;
+  load->block_y = block_y;
+  load->next = shard->loads;
+  shard->loads = load;
+}
+
+static void shard_unlink(TileCacheShard *shard, TileCacheEntry *entry) {
+  TileCacheEntry **link = &shard->buckets[entry->hash & shard->bucket_mask];
+  while (*link != entry) {
+    link = &(*link)->bucket_next;
+  }
+  *link = entry->bucket_next;
+}
+
+// Doubles the bucket count once the load factor reaches 1. Keeps the old
+// table if allocation fails.
+static void shard_grow_buckets(TileCacheShard *shard) {
+  unsigned int bucket_count = (shard->bucket_mask + 1) * 2;
+  TileCacheEntry **buckets =
+      (TileCacheEntry **)calloc(bucket_count, sizeof(TileCacheEntry *));
+  if (!buckets) {
+    return;
+  }
+  for (int i = 0; i < shard->count; i++) {
+    TileCacheEntry *e = shard->ring[i];
+    unsigned int b = (unsigned int)(e->hash & (bucket_count - 1));
+    e->bucket_next = buckets[b];
+    buckets[b] = e;
+  }
+  free(shard->buckets);
+  shard->buckets = buckets;
+  shard->bucket_mask = bucket_count - 1;
+}
+
+// Evicts entries until `bytes` more fit in the shard's budget. Entries
+// referenced since the hand last passed get a second chance.
+static void shard_make_room(TileCacheShard *shard, size_t bytes) {
+  while (shard->count > 0 && shard->bytes + bytes > shard->budget) {
+    if (shard->hand >= shard->count) {
+      shard->hand = 0;
+    }
+    TileCacheEntry *e = shard->ring[shard->hand];
+    if (e->referenced) {
+      e->referenced = 0;
+      shard->hand++;
+      continue;
+    }
+    shard_unlink(shard, e);
+    shard->bytes -= e->bytes;
+    shard->count--;
+    if (shard->hand < shard->count) {
+      shard->ring[shard->hand] = shard->ring[shard->count];
+    }
+    shard->evictions++;
+    free(e->data);
+    free(e);
+  }
+}
+
+// Takes ownership of entry. Returns 0 (leaving entry to the caller) if it
+// does not fit in the shard at all or the ring cannot grow.
+static int shard_insert(TileCacheShard *shard, TileCacheEntry *entry) {
+  if (entry->bytes > shard->budget) {
+    return 0;
+  }
+  shard_make_room(shard, entry->bytes);
+  if (shard->count == shard->ring_capacity) {
+    int capacity = shard->ring_capacity ? shard->ring_capacity * 2 : 64;
+    TileCacheEntry **ring = (TileCacheEntry **)realloc(
+        shard->ring, sizeof(TileCacheEntry *) * (size_t)capacity);
+    if (!ring) {
+      return 0;
+    }
+    shard->ring = ring;
+    shard->ring_capacity = capacity;
+  }
+  if ((unsigned int)shard->count > shard->bucket_mask) {
+    shard_grow_buckets(shard);
+  }
+  shard->ring[shard->count++] = entry;
+  TileCacheEntry **bucket = &shard->buckets[entry->hash & shard->bucket_mask];
+  entry->bucket_next = *bucket;
+  *bucket = entry;
+  shard->bytes += entry->bytes;
+  if (shard->bytes > shard->peak_bytes) {
+    shard->peak_bytes = shard->bytes;
+  }
+  return 1;
+}
+
+static void entry_get_pixel(const TileCacheEntry *e, int offset_x,
+                            int offset_y, float *value) {
+  size_t index = (size_t)offset_y * e->block_width + offset_x;
+  GDALCopyWords(e->data + index * e->data_type_size, e->data_type, 0, value,
+                GDT_Float32, 0, 1);
+}
+
+static TileCacheShard *shard_for(TileCache *cache, uint64_t hash) {
+  return &cache->shards[(hash >> 32) % (uint64_t)cache->shard_count];
+}
+
+// Reads a block into a new entry. Decoding happens outside any shard lock,
+// so misses on one shard do not serialize.
+static TileCacheEntry *load_entry(uint64_t dataset_id, uint64_t hash,
+                                  GDALRasterBandH band, int band_index,
+                                  int block_x, int block_y) {
+  int block_width, block_height;
+  GDALGetBlockSize(band, &block_width, &block_height);
+  TileCacheEntry *e = (TileCacheEntry *)calloc(1, sizeof(TileCacheEntry));
+  if (!e) {
+    return NULL;
+  }
+  e->dataset_id = dataset_id;
+  e->hash = hash;
+  e->band = band_index;
+  e->block_x = block_x;
+  e->block_y = block_y;
+  e->block_width = block_width;
+  e->data_type = GDALGetRasterDataType(band);
+  e->data_type_size = GDALGetDataTypeSizeBytes(e->data_type);
+  e->bytes = (size_t)block_width * block_height * e->data_type_size;
+  e->data = (unsigned char *)malloc(e->bytes);
+  if (!e->data || GDALReadBlock(band, block_x, block_y, e->data) != CE_None) {
+    free(e->data);
+    free(e);
+    return NULL;
+  }
+  return e;
+}
+
+// Ends `load`, caches e (NULL if the read failed) and wakes the threads
+// waiting for the block. Frees e if it does not fit.
+static void publish_entry(TileCacheShard *shard, TileCacheLoad *load,
+                          TileCacheEntry *e) {
+  pthread_mutex_lock(&shard->mutex);
+  TileCacheLoad **link = &shard->loads;
+  while (*link != load) {
+    link = &(*link)->next;
+  }
+  *link = load->next;
+  int inserted = e && shard_insert(shard, e);
+  pthread_cond_broadcast(&shard->loaded);
+  pthread_mutex_unlock(&shard->mutex);
+  if (e && !inserted) {
+    free(e->data);
+    free(e);
+  }
+}
+
+int tile_cache_read_pixel(TileCache *cache, uint64_t dataset_id,
+                          GDALRasterBandH band, int pixel_x, int pixel_y,
+                          float *value, int *hit) {
+  int block_width, block_height;
+  GDALGetBlockSize(band, &block_width, &block_height);
+  int band_index = GDALGetBandNumber(band);
+  int block_x = pixel_x / block_width;
+  int block_y = pixel_y / block_height;
+  int offset_x = pixel_x - block_x * block_width;
+  int offset_y = pixel_y - block_y * block_height;
+
+  uint64_t hash = hash_key(dataset_id, band_index, block_x, block_y);
+  TileCacheShard *shard = shard_for(cache, hash);
+
+  // The pixel is copied out under the lock, so another thread cannot evict
+  // the block while it is being read.
+  pthread_mutex_lock(&shard->mutex);
+  TileCacheEntry *e =
+      shard_find(shard, hash, dataset_id, band_index, block_x, block_y);
+  if (e) {
+    e->referenced = 1;
+    shard->hits++;
+    entry_get_pixel(e, offset_x, offset_y, value);
+    pthread_mutex_unlock(&shard->mutex);
+    if (hit)
+      *hit = 1;
+    return 1;
+  }
+  shard->misses++;
+  if (hit)
+    *hit = 0;
+  // A block another thread (typically a prefetch) is already reading is
+  // waited for rather than read a second time. If that read fails or the
+  // block is evicted before this thread wakes, it reads the block itself.
+  if (shard_loading(shard, hash, dataset_id, band_index, block_x, block_y)) {
+    shard->waits++;
+    do {
+      pthread_cond_wait(&shard->loaded, &shard->mutex);
+    } while (
+        shard_loading(shard, hash, dataset_id, band_index, block_x, block_y));
+    e = shard_find(shard, hash, dataset_id, band_index, block_x, block_y);
+    if (e) {
+      e->referenced = 1;
+      entry_get_pixel(e, offset_x, offset_y, value);
+      pthread_mutex_unlock(&shard->mutex);
+      return 1;
+    }
+  }
+  TileCacheLoad load;
+  shard_begin_load(shard, &load, hash, dataset_id, band_index, block_x,
+                   block_y);
+  pthread_mutex_unlock(&shard->mutex);
+
+  e = load_entry(dataset_id, hash, band, band_index, block_x, block_y);
+  if (e) {
+    entry_get_pixel(e, offset_x, offset_y, value);
+  }
+  publish_entry(shard, &load, e);
+  return e != NULL;
+}
+
+int tile_cache_prefetch(TileCache *cache, uint64_t dataset_id,
+                        GDALRasterBandH band, int block_x, int block_y) {
+  int band_index = GDALGetBandNumber(band);
+  uint64_t hash = hash_key(dataset_id, band_index, block_x, block_y);
+  TileCacheShard *shard = shard_for(cache, hash);
+
+  pthread_mutex_lock(&shard->mutex);
+  if (shard_find(shard, hash, dataset_id, band_index, block_x, block_y) ||
+      shard_loading(shard, hash, dataset_id, band_index, block_x, block_y)) {
+    pthread_mutex_unlock(&shard->mutex);
+    return 0;
+  }
+  TileCacheLoad load;
+  shard_begin_load(shard, &load, hash, dataset_id, band_index, block_x,
+                   block_y);
+  pthread_mutex_unlock(&shard->mutex);
+
+  TileCacheEntry *e =
+      load_entry(dataset_id, hash, band, band_index, block_x, block_y);
+  publish_entry(shard, &load, e);
+  return e != NULL;
+}
+
+void tile_cache_get_stats(TileCache *cache, TileCacheStats *stats) {
+  memset(stats, 0, sizeof(*stats));
+  for (int s = 0; s < cache->shard_count; s++) {
+    TileCacheShard *shard = &cache->shards[s];
+    pthread_mutex_lock(&shard->mutex);
+    stats->hits += shard->hits;
+    stats->misses += shard->misses;
+    stats->waits += shard->waits;
+    stats->evictions += shard->evictions;
+    stats->tiles += shard->count;
+    stats->bytes += shard->bytes;
+    // Shards peak at different times, so this is an upper bound.
+    stats->peak_bytes += shard->peak_bytes;
+    pthread_mutex_unlock(&shard->mutex);
+  }
+}
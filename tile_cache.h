@@ -0,0 +1,66 @@
+#ifndef TILE_CACHE_H
+#define TILE_CACHE_H
+
+#include "gdal.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct TileCacheShard TileCacheShard;
+
+// Application-side cache of decoded blocks keyed by (dataset, band, block x,
+// block y), shared by all worker threads. Keys are spread over independently
+// locked shards, and each shard evicts with the CLOCK algorithm once its share
+// of the byte budget is used. Blocks are read with GDALReadBlock, so they do
+// not also occupy GDAL's global block cache. A block is read by one thread at
+// a time; other threads missing on it wait for that read.
+typedef struct {
+  TileCacheShard *shards;
+  int shard_count;
+  size_t budget_bytes;
+} TileCache;
+
+typedef struct {
+  long long hits;
+  long long misses;
+  // Misses that waited for another thread's read of the block
+  long long waits;
+  long long evictions;
+  long long tiles;
+  size_t bytes;
+  // Highest `bytes` seen since the last clear
+  size_t peak_bytes;
+} TileCacheStats;
+
+// Returns 0 if budget_bytes or shard_count is not positive or allocation
+// fails.
+int tile_cache_init(TileCache *cache, size_t budget_bytes, int shard_count);
+// Frees every cached block. Safe to call on a zeroed cache.
+void tile_cache_destroy(TileCache *cache);
+// Drops every cached block and resets the statistics.
+void tile_cache_clear(TileCache *cache);
+
+// Identifies a dataset by path, so that handles opened by different threads
+// on the same file share cached blocks.
+uint64_t tile_cache_dataset_id(const char *path);
+
+// Reads pixel (pixel_x, pixel_y) of band as Float32, reading and caching the
+// containing block on a miss, or waiting for it if another thread is already
+// reading it. The pixel must be inside the band. If hit is not NULL it is set
+// to 1 when the block was already cached. Returns 0 if the block cannot be
+// read.
+int tile_cache_read_pixel(TileCache *cache, uint64_t dataset_id,
+                          GDALRasterBandH band, int pixel_x, int pixel_y,
+                          float *value, int *hit);
+
+// Reads and caches block (block_x, block_y) of band unless it is already
+// cached or being read. Lookups here do not count as hits or misses. Returns
+// 1 if the block was read, 0 if it was cached, being read or could not be
+// read.
+int tile_cache_prefetch(TileCache *cache, uint64_t dataset_id,
+                        GDALRasterBandH band, int block_x, int block_y);
+
+// Sums the statistics of all shards.
+void tile_cache_get_stats(TileCache *cache, TileCacheStats *stats);
+
+#endif
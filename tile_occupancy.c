@@ -0,0 +1,152 @@
+#include "tile_occupancy.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void mark_empty(TileOccupancy *occ, size_t block) {
+  occ->occupied[block / 64] &= ~((uint64_t)1 << (block % 64));
+}
+
+// Pixel window of block (block_x, block_y), clipped to the raster.
+static void block_window(const TileOccupancy *occ, int block_x, int block_y,
+                         int *x0, int *y0, int *width, int *height) {
+  *x0 = block_x * occ->block_width;
+  *y0 = block_y * occ->block_height;
+  *width = occ->geo.raster_x - *x0 < occ->block_width ? occ->geo.raster_x - *x0
+                                                      : occ->block_width;
+  *height = occ->geo.raster_y - *y0 < occ->block_height
+                ? occ->geo.raster_y - *y0
+                : occ->block_height;
+}
+
+// The fill value as stored in a band of data_type. A Float32 band holds
+// nodata rounded to float, which is also how GDAL matches it, so a nodata
+// value with no exact float representation must be rounded the same way.
+static double stored_fill_value(double fill, GDALDataType data_type) {
+  if (data_type == GDT_Float32 && fabs(fill) <= FLT_MAX) {
+    return (double)(float)fill;
+  }
+  return fill;
+}
+
+// Whether every pixel of the window holds fill. NaN pixels match a NaN
+// nodata value.
+static int holds_only_fill(double fill, const double *pixels, size_t count) {
+  int fill_is_nan = fill != fill;
+  for (size_t i = 0; i < count; i++) {
+    double v = pixels[i];
+    if (v != fill && !(fill_is_nan && v != v)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// Reads every block still marked occupied and marks those holding only the
+// fill value empty. Returns 0 if a read fails.
+static int scan_blocks(TileOccupancy *occ, GDALRasterBandH band,
+                       const char *path) {
+  double *pixels = (double *)malloc(sizeof(double) * occ->block_width *
+                                    occ->block_height);
+  if (!pixels) {
+    fprintf(stderr, "Error: Out of memory\n");
+    return 0;
+  }
+  int ok = 1;
+  for (int by = 0; by < occ->blocks_y && ok; by++) {
+    for (int bx = 0; bx < occ->blocks_x; bx++) {
+      int x0, y0, width, height;
+      block_window(occ, bx, by, &x0, &y0, &width, &height);
+      if (tile_occupancy_is_empty(occ, x0, y0)) {
+        continue;
+      }
+      if (GDALRasterIO(band, GF_Read, x0, y0, width, height, pixels, width,
+                       height, GDT_Float64, 0, 0) != CE_None) {
+        fprintf(stderr, "Error: Failed to read block %d,%d of '%s'\n", bx, by,
+                path);
+        ok = 0;
+        break;
+      }
+      if (holds_only_fill(occ->fill_value, pixels, (size_t)width * height)) {
+        mark_empty(occ, (size_t)by * occ->blocks_x + bx);
+        occ->fill_blocks++;
+      }
+    }
+  }
+  free(pixels);
+  return ok;
+}
+
+int tile_occupancy_build(TileOccupancy *occ, const char *path, int band,
+                         int scan) {
+  memset(occ, 0, sizeof(*occ));
+  GDALDatasetH ds = GDALOpen(path, GA_ReadOnly);
+  if (!ds) {
+    fprintf(stderr, "Error: Failed to open dataset '%s'\n", path);
+    return 0;
+  }
+  if (band < 1 || band > GDALGetRasterCount(ds)) {
+    fprintf(stderr, "Error: '%s' has no band %d\n", path, band);
+    GDALClose(ds);
+    return 0;
+  }
+  if (!geo_context_init(&occ->geo, ds)) {
+    fprintf(stderr, "Error: Dataset '%s' has no invertible geotransform\n",
+            path);
+    GDALClose(ds);
+    return 0;
+  }
+  GDALRasterBandH raster_band = GDALGetRasterBand(ds, band);
+  int has_nodata = FALSE;
+  double nodata = GDALGetRasterNoDataValue(raster_band, &has_nodata);
+  occ->has_nodata = has_nodata;
+  occ->nodata_value = nodata;
+  occ->fill_value = has_nodata ? nodata : 0.0;
+  occ->fill_value =
+      stored_fill_value(occ->fill_value, GDALGetRasterDataType(raster_band));
+  GDALGetBlockSize(raster_band, &occ->block_width, &occ->block_height);
+  occ->blocks_x =
+      (occ->geo.raster_x + occ->block_width - 1) / occ->block_width;
+  occ->blocks_y =
+      (occ->geo.raster_y + occ->block_height - 1) / occ->block_height;
+  size_t blocks = (size_t)occ->blocks_x * occ->blocks_y;
+  occ->occupied = (uint64_t *)malloc(sizeof(uint64_t) * ((blocks + 63) / 64));
+  if (!occ->occupied) {
+    fprintf(stderr, "Error: Out of memory\n");
+    GDALClose(ds);
+    return 0;
+  }
+  memset(occ->occupied, 0xff, sizeof(uint64_t) * ((blocks + 63) / 64));
+
+  for (int by = 0; by < occ->blocks_y; by++) {
+    for (int bx = 0; bx < occ->blocks_x; bx++) {
+      int x0, y0, width, height;
+      block_window(occ, bx, by, &x0, &y0, &width, &height);
+      double percent = 0.0;
+      int status = GDALGetDataCoverageStatus(raster_band, x0, y0, width,
+                                             height, 0, &percent);
+      if (status & GDAL_DATA_COVERAGE_STATUS_UNIMPLEMENTED) {
+        occ->unknown_blocks++;
+      } else if ((status & GDAL_DATA_COVERAGE_STATUS_EMPTY) &&
+                 !(status & GDAL_DATA_COVERAGE_STATUS_DATA)) {
+        mark_empty(occ, (size_t)by * occ->blocks_x + bx);
+        occ->sparse_blocks++;
+      }
+    }
+  }
+
+  int ok = !scan || scan_blocks(occ, raster_band, path);
+  GDALClose(ds);
+  if (!ok) {
+    tile_occupancy_free(occ);
+  }
+  return ok;
+}
+
+void tile_occupancy_free(TileOccupancy *occ) {
+  free(occ->occupied);
+  occ->occupied = NULL;
+}
@@ -0,0 +1,57 @@
+#ifndef TILE_OCCUPANCY_H
+#define TILE_OCCUPANCY_H
+
+#include "gdal.h"
+#include "geo_transform.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// One bit per internal block of a band, set when the block may hold
+// something other than its fill value (the nodata value, or 0 without one).
+// Built once per dataset and read-only afterwards, so one bitmap can be
+// shared by all threads. Points in an empty block read as the fill value
+// without any GDAL call.
+typedef struct {
+  GeoContext geo;
+  int block_width;
+  int block_height;
+  int blocks_x;
+  int blocks_y;
+  uint64_t *occupied;
+  int has_nodata;
+  double nodata_value;
+  // What a pixel of an empty block reads as: the nodata value as stored in
+  // the band's data type, or 0
+  double fill_value;
+  // Blocks the driver reported as empty, blocks found to hold only the fill
+  // value when scanning, and blocks the driver could not report on
+  long long sparse_blocks;
+  long long fill_blocks;
+  long long unknown_blocks;
+} TileOccupancy;
+
+// Builds the bitmap of band `band` of the dataset at path from
+// GDALGetDataCoverageStatus, which reports the GTiff blocks that have no
+// data in the file (zero byte count) as empty. With `scan`, the blocks it
+// reports as holding data are also read, and those holding only the fill
+// value are marked empty. Returns 0 on failure.
+int tile_occupancy_build(TileOccupancy *occ, const char *path, int band,
+                         int scan);
+// Safe to call on a zeroed bitmap.
+void tile_occupancy_free(TileOccupancy *occ);
+
+static inline long long tile_occupancy_empty_blocks(const TileOccupancy *occ) {
+  return occ->sparse_blocks + occ->fill_blocks;
+}
+
+// Whether pixel (pixel_x, pixel_y), which must lie inside the raster, is in
+// an empty block.
+static inline int tile_occupancy_is_empty(const TileOccupancy *occ,
+                                          int pixel_x, int pixel_y) {
+  size_t block = (size_t)(pixel_y / occ->block_height) * occ->blocks_x +
+                 pixel_x / occ->block_width;
+  return !(occ->occupied[block / 64] & ((uint64_t)1 << (block % 64)));
+}
+
+#endif
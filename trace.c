@@ -0,0 +1,224 @@
+#include "trace.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Distinct paths of a trace being loaded, indexed by an open-addressing table
+// of path indices.
+typedef struct {
+  char **paths;
+  int count;
+  int capacity;
+  int *slots;
+  unsigned int slot_mask;
+} PathTable;
+
+// FNV-1a
+static unsigned int hash_path(const char *path) {
+  unsigned int h = 2166136261u;
+  for (const unsigned char *c = (const unsigned char *)path; *c; c++) {
+    h ^= *c;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static int path_table_grow(PathTable *table) {
+  int capacity = table->capacity ? table->capacity * 2 : 64;
+  unsigned int slot_count = (unsigned int)capacity * 2;
+  char **paths = (char **)realloc(table->paths, sizeof(char *) * capacity);
+  if (!paths) {
+    return 0;
+  }
+  table->paths = paths;
+  int *slots = (int *)malloc(sizeof(int) * slot_count);
+  if (!slots) {
+    return 0;
+  }
+  for (unsigned int s = 0; s < slot_count; s++) {
+    slots[s] = -1;
+  }
+  for (int i = 0; i < table->count; i++) {
+    unsigned int s = hash_path(paths[i]) & (slot_count - 1);
+    while (slots[s] >= 0) {
+      s = (s + 1) & (slot_count - 1);
+    }
+    slots[s] = i;
+  }
+  free(table->slots);
+  table->slots = slots;
+  table->slot_mask = slot_count - 1;
+  table->capacity = capacity;
+  return 1;
+}
+
+// Returns the index of path, adding it if needed, or -1 on allocation
+// failure.
+static int path_table_intern(PathTable *table, const char *path) {
+  if (table->count == table->capacity && !path_table_grow(table)) {
+    return -1;
+  }
+  unsigned int s = hash_path(path) & table->slot_mask;
+  for (; table->slots[s] >= 0; s = (s + 1) & table->slot_mask) {
+    if (strcmp(table->paths[table->slots[s]], path) == 0) {
+      return table->slots[s];
+    }
+  }
+  char *copy = strdup(path);
+  if (!copy) {
+    return -1;
+  }
+  table->paths[table->count] = copy;
+  table->slots[s] = table->count;
+  return table->count++;
+}
+
+static int compare_arrival(const void *a, const void *b) {
+  double ta = ((const TraceQuery *)a)->t;
+  double tb = ((const TraceQuery *)b)->t;
+  return ta < tb ? -1 : (ta > tb ? 1 : 0);
+}
+
+static const char *skip_separators(const char *p) {
+  while (*p == ' ' || *p == '\t' || *p == ',') {
+    p++;
+  }
+  return p;
+}
+
+// Parses "<t> <x> <y> [path]" into query, interning the path. Returns 0 if
+// the line is malformed.
+static int parse_line(char *line, TraceQuery *query, PathTable *table) {
+  double fields[3];
+  const char *p = line;
+  for (int f = 0; f < 3; f++) {
+    char *end;
+    p = skip_separators(p);
+    fields[f] = strtod(p, &end);
+    if (end == p) {
+      return 0;
+    }
+    p = end;
+  }
+  query->t = fields[0];
+  query->x = fields[1];
+  query->y = fields[2];
+  query->path = -1;
+
+  p = skip_separators(p);
+  size_t len = strlen(p);
+  while (len > 0 && (p[len - 1] == '\n' || p[len - 1] == '\r' ||
+                     p[len - 1] == ' ' || p[len - 1] == '\t')) {
+    len--;
+  }
+  if (len > 0) {
+    line[(p - line) + len] = '\0';
+    query->path = path_table_intern(table, p);
+    if (query->path < 0) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+int trace_load(Trace *trace, const char *file) {
+  memset(trace, 0, sizeof(*trace));
+  FILE *in = fopen(file, "r");
+  if (!in) {
+    fprintf(stderr, "Error: Failed to open trace '%s'\n", file);
+    return 0;
+  }
+
+  PathTable table;
+  memset(&table, 0, sizeof(table));
+  int capacity = 0;
+  char *line = NULL;
+  size_t line_size = 0;
+  int line_number = 0;
+  int ok = 1;
+  while (getline(&line, &line_size, in) >= 0) {
+    line_number++;
+    const char *p = line;
+    while (*p == ' ' || *p == '\t') {
+      p++;
+    }
+    if (*p == '\0' || *p == '\n' || *p == '\r' || *p == '#') {
+      continue;
+    }
+    if (trace->count == capacity) {
+      capacity = capacity ? capacity * 2 : 4096;
+      TraceQuery *queries = (TraceQuery *)realloc(
+          trace->queries, sizeof(TraceQuery) * (size_t)capacity);
+      if (!queries) {
+        fprintf(stderr, "Error: Out of memory loading trace '%s'\n", file);
+        ok = 0;
+        break;
+      }
+      trace->queries = queries;
+    }
+    if (!parse_line(line, &trace->queries[trace->count], &table)) {
+      fprintf(stderr, "Error: Malformed line %d in trace '%s'\n", line_number,
+              file);
+      ok = 0;
+      break;
+    }
+    trace->count++;
+  }
+  free(line);
+  fclose(in);
+  free(table.slots);
+  trace->paths = table.paths;
+  trace->path_count = table.count;
+
+  if (ok && trace->count == 0) {
+    fprintf(stderr, "Error: Trace '%s' holds no queries\n", file);
+    ok = 0;
+  }
+  if (!ok) {
+    trace_destroy(trace);
+    return 0;
+  }
+
+  qsort(trace->queries, (size_t)trace->count, sizeof(TraceQuery),
+        compare_arrival);
+  double t0 = trace->queries[0].t;
+  for (int i = 0; i < trace->count; i++) {
+    trace->queries[i].t -= t0;
+  }
+  return 1;
+}
+
+void trace_destroy(Trace *trace) {
+  for (int i = 0; i < trace->path_count; i++) {
+    free(trace->paths[i]);
+  }
+  free(trace->paths);
+  free(trace->queries);
+  memset(trace, 0, sizeof(*trace));
+}
+
+double trace_duration(const Trace *trace) {
+  return trace->count > 0 ? trace->queries[trace->count - 1].t : 0.0;
+}
+
+int trace_write(const char *file, TraceQuery *queries, int count,
+                char *const *paths) {
+  FILE *out = fopen(file, "w");
+  if (!out) {
+    fprintf(stderr, "Error: Failed to open '%s' for writing\n", file);
+    return 0;
+  }
+  qsort(queries, (size_t)count, sizeof(TraceQuery), compare_arrival);
+  fprintf(out, "# seconds x y [path]\n");
+  for (int i = 0; i < count; i++) {
+    const TraceQuery *q = &queries[i];
+    fprintf(out, "%.9f %.17g %.17g", q->t, q->x, q->y);
+    if (q->path >= 0 && paths) {
+      fprintf(out, " %s", paths[q->path]);
+    }
+    fputc('\n', out);
+  }
+  return fclose(out) == 0;
+}
@@ -0,0 +1,44 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Point-query traces. A trace is a text file with one query per line:
+//
+//   <seconds> <x> <y> [path]
+//
+// where seconds is the arrival time of the query, x and y its world
+// coordinates and path the dataset it was sent to, if any. Fields may be
+// separated by whitespace or commas; the path is the rest of the line. Blank
+// lines and lines starting with '#' are skipped.
+
+typedef struct {
+  // Seconds since the first query of the trace
+  double t;
+  double x;
+  double y;
+  // Index into Trace.paths, or -1
+  int path;
+} TraceQuery;
+
+typedef struct {
+  TraceQuery *queries;
+  int count;
+  char **paths;
+  int path_count;
+} Trace;
+
+// Loads a trace, sorted by arrival time. Returns 0 if the file cannot be
+// read, has a malformed line or holds no queries.
+int trace_load(Trace *trace, const char *file);
+// Safe to call on a zeroed trace.
+void trace_destroy(Trace *trace);
+
+// Time between the first and the last query, in seconds.
+double trace_duration(const Trace *trace);
+
+// Sorts queries by arrival time and writes them to file, taking the path of
+// each query from paths (which may be NULL if no query has one). Returns 0
+// if the file cannot be written.
+int trace_write(const char *file, TraceQuery *queries, int count,
+                char *const *paths);
+
+#endif
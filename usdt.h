@@ -0,0 +1,18 @@
+#ifndef USDT_H
+#define USDT_H
+
+// Static tracepoints (USDT) in the "gdal_test" provider, for perf, bpftrace
+// and SystemTap. They are compiled in when the Makefile finds <sys/sdt.h>
+// and defines GDAL_TEST_USDT; each probe is a single nop until a tracer
+// attaches to it. Without <sys/sdt.h> they compile to nothing; the
+// arguments are still used, so their variables do not turn unused.
+#ifdef GDAL_TEST_USDT
+#include <sys/sdt.h>
+#define USDT_PROBE2(name, a, b) DTRACE_PROBE2(gdal_test, name, a, b)
+#define USDT_PROBE3(name, a, b, c) DTRACE_PROBE3(gdal_test, name, a, b, c)
+#else
+#define USDT_PROBE2(name, a, b) ((void)(a), (void)(b))
+#define USDT_PROBE3(name, a, b, c) ((void)(a), (void)(b), (void)(c))
+#endif
+
+#endif
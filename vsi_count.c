@@ -0,0 +1,162 @@
+#include "vsi_count.h"
+
+#include "cpl_vsi.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  VSILFILE *fp;
+  vsi_l_offset offset;
+} CountHandle;
+
+static __thread VsiCountStats thread_stats;
+static VsiCountStats total_stats;
+
+// Counts in both the calling thread's and the process-wide statistics.
+#define COUNT(field, n)                                                        \
+  do {                                                                         \
+    thread_stats.field += (n);                                                 \
+    __atomic_fetch_add(&total_stats.field, (long long)(n), __ATOMIC_RELAXED);  \
+  } while (0)
+
+static const char *real_path(const char *filename) {
+  return filename + strlen(VSI_COUNT_PREFIX);
+}
+
+static int count_stat(void *user_data, const char *filename,
+                      VSIStatBufL *stat_buf, int flags) {
+  (void)user_data;
+  COUNT(stats, 1);
+  return VSIStatExL(real_path(filename), stat_buf, flags);
+}
+
+static char **count_read_dir(void *user_data, const char *dirname,
+                             int max_files) {
+  (void)user_data;
+  COUNT(dir_reads, 1);
+  return VSIReadDirEx(real_path(dirname), max_files);
+}
+
+static void *count_open(void *user_data, const char *filename,
+                        const char *access) {
+  (void)user_data;
+  if (strchr(access, 'w') || strchr(access, 'a') || strchr(access, '+')) {
+    return NULL;
+  }
+  COUNT(opens, 1);
+  VSILFILE *fp = VSIFOpenL(real_path(filename), access);
+  if (!fp) {
+    return NULL;
+  }
+  CountHandle *handle = (CountHandle *)calloc(1, sizeof(CountHandle));
+  if (!handle) {
+    VSIFCloseL(fp);
+    return NULL;
+  }
+  handle->fp = fp;
+  return handle;
+}
+
+static vsi_l_offset count_tell(void *file) {
+  return ((CountHandle *)file)->offset;
+}
+
+static int count_seek(void *file, vsi_l_offset offset, int whence) {
+  CountHandle *handle = (CountHandle *)file;
+  if (whence == SEEK_SET && offset == handle->offset) {
+    // GDAL seeks before most reads; staying in place costs nothing.
+    return VSIFSeekL(handle->fp, offset, whence);
+  }
+  COUNT(seeks, 1);
+  int ret = VSIFSeekL(handle->fp, offset, whence);
+  handle->offset = VSIFTellL(handle->fp);
+  return ret;
+}
+
+static size_t count_read(void *file, void *buffer, size_t size,
+                         size_t count) {
+  CountHandle *handle = (CountHandle *)file;
+  size_t n = VSIFReadL(buffer, size, count, handle->fp);
+  COUNT(reads, 1);
+  COUNT(bytes_read, n * size);
+  handle->offset = VSIFTellL(handle->fp);
+  return n;
+}
+
+static int count_read_multi_range(void *file, int ranges, void **data,
+                                  const vsi_l_offset *offsets,
+                                  const size_t *sizes) {
+  CountHandle *handle = (CountHandle *)file;
+  long long bytes = 0;
+  for (int i = 0; i < ranges; i++) {
+    bytes += (long long)sizes[i];
+  }
+  COUNT(reads, ranges);
+  COUNT(bytes_read, bytes);
+  int ret = VSIFReadMultiRangeL(ranges, data, offsets, sizes, handle->fp);
+  handle->offset = VSIFTellL(handle->fp);
+  return ret;
+}
+
+static int count_eof(void *file) {
+  return VSIFEofL(((CountHandle *)file)->fp);
+}
+
+static int count_close(void *file) {
+  CountHandle *handle = (CountHandle *)file;
+  int ret = VSIFCloseL(handle->fp);
+  free(handle);
+  return ret;
+}
+
+int vsi_count_install(void) {
+  VSIFilesystemPluginCallbacksStruct *cb =
+      VSIAllocFilesystemPluginCallbacksStruct();
+  if (!cb) {
+    return 0;
+  }
+  cb->stat = count_stat;
+  cb->read_dir = count_read_dir;
+  cb->open = count_open;
+  cb->tell = count_tell;
+  cb->seek = count_seek;
+  cb->read = count_read;
+  cb->read_multi_range = count_read_multi_range;
+  cb->eof = count_eof;
+  cb->close = count_close;
+  // No buffering layer between GDAL and the counters, so every request the
+  // driver makes is seen.
+  cb->nBufferSize = 0;
+  cb->nCacheSize = 0;
+  int ret = VSIInstallPluginHandler(VSI_COUNT_PREFIX, cb);
+  VSIFreeFilesystemPluginCallbacksStruct(cb);
+  return ret == 0;
+}
+
+void vsi_count_thread_stats(VsiCountStats *stats) { *stats = thread_stats; }
+
+void vsi_count_total_stats(VsiCountStats *stats) {
+  stats->opens = __atomic_load_n(&total_stats.opens, __ATOMIC_RELAXED);
+  stats->reads = __atomic_load_n(&total_stats.reads, __ATOMIC_RELAXED);
+  stats->bytes_read =
+      __atomic_load_n(&total_stats.bytes_read, __ATOMIC_RELAXED);
+  stats->seeks = __atomic_load_n(&total_stats.seeks, __ATOMIC_RELAXED);
+  stats->stats = __atomic_load_n(&total_stats.stats, __ATOMIC_RELAXED);
+  stats->dir_reads = __atomic_load_n(&total_stats.dir_reads, __ATOMIC_RELAXED);
+}
+
+void vsi_count_stats_sub(VsiCountStats *diff, const VsiCountStats *after,
+                         const VsiCountStats *before) {
+  diff->opens = after->opens - before->opens;
+  diff->reads = after->reads - before->reads;
+  diff->bytes_read = after->bytes_read - before->bytes_read;
+  diff->seeks = after->seeks - before->seeks;
+  diff->stats = after->stats - before->stats;
+  diff->dir_reads = after->dir_reads - before->dir_reads;
+}
+
+int vsi_count_stats_any(const VsiCountStats *stats) {
+  return stats->opens || stats->reads || stats->bytes_read || stats->seeks ||
+         stats->stats || stats->dir_reads;
+}
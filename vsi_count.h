@@ -0,0 +1,35 @@
+#ifndef VSI_COUNT_H
+#define VSI_COUNT_H
+
+// Prefix of the counting filesystem: /vsicount/<path> opens <path> (which
+// may itself be a /vsi path, e.g. /vsicount//vsis3/bucket/key.tif) and
+// counts every operation GDAL performs on it.
+#define VSI_COUNT_PREFIX "/vsicount/"
+
+typedef struct {
+  long long opens;
+  // Each range of a multi-range read counts as one read.
+  long long reads;
+  long long bytes_read;
+  // Seeks that move away from the current offset
+  long long seeks;
+  long long stats;
+  long long dir_reads;
+} VsiCountStats;
+
+// Registers VSI_COUNT_PREFIX with GDAL's VSI plugin API. The filesystem is
+// read-only. Returns 0 on failure.
+int vsi_count_install(void);
+
+// Operations issued by the calling thread since it started.
+void vsi_count_thread_stats(VsiCountStats *stats);
+// Operations issued by all threads since the filesystem was installed.
+void vsi_count_total_stats(VsiCountStats *stats);
+
+// diff = after - before
+void vsi_count_stats_sub(VsiCountStats *diff, const VsiCountStats *after,
+                         const VsiCountStats *before);
+// Returns 1 if any counter is non-zero.
+int vsi_count_stats_any(const VsiCountStats *stats);
+
+#endif
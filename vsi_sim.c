@@ -0,0 +1,471 @@
+#include "vsi_sim.h"
+
+#include "cpl_conv.h"
+#include "cpl_vsi.h"
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+  uint64_t path_hash;
+  int64_t chunk;
+  int bucket_next;
+  int prev;
+  int next;
+} ChunkEntry;
+
+// LRU set of (file, chunk) pairs that /vsicurl would hold in its cache. Only
+// residency is tracked; the bytes themselves always come from the local file.
+typedef struct {
+  int capacity;
+  int count;
+  ChunkEntry *entries;
+  int *buckets;
+  unsigned int bucket_mask;
+  int head;
+  int tail;
+} ChunkCache;
+
+typedef struct {
+  VSILFILE *fp;
+  uint64_t path_hash;
+  vsi_l_offset offset;
+  vsi_l_offset size;
+  // Range fetched by the last request, when not emulating chunks
+  vsi_l_offset window_start;
+  vsi_l_offset window_end;
+} SimHandle;
+
+static VsiSimConfig config;
+// Guards everything below.
+static pthread_mutex_t sim_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ChunkCache chunk_cache;
+// Open-addressed set of path hashes whose size is already known, so that
+// (like /vsicurl) only the first stat or open of a file costs a HEAD request.
+static uint64_t *known_files;
+static size_t known_capacity;
+static size_t known_count;
+static VsiSimStats total_stats;
+
+static const char *real_path(const char *filename) {
+  return filename + strlen(VSI_SIM_PREFIX);
+}
+
+// FNV-1a, never 0 so that 0 can mark empty slots
+static uint64_t hash_path(const char *path) {
+  uint64_t h = 14695981039346656037ull;
+  for (const unsigned char *c = (const unsigned char *)path; *c; c++) {
+    h ^= *c;
+    h *= 1099511628211ull;
+  }
+  return h ? h : 1;
+}
+
+static unsigned int chunk_bucket(uint64_t path_hash, int64_t chunk) {
+  uint64_t h = path_hash ^ ((uint64_t)chunk * 0x9E3779B97F4A7C15ull);
+  return (unsigned int)(h ^ (h >> 32)) & chunk_cache.bucket_mask;
+}
+
+static int chunk_cache_init(int capacity) {
+  unsigned int bucket_count = 1;
+  while (bucket_count < (unsigned int)capacity * 2) {
+    bucket_count <<= 1;
+  }
+  chunk_cache.entries =
+      (ChunkEntry *)calloc((size_t)capacity, sizeof(ChunkEntry));
+  chunk_cache.buckets = (int *)malloc(sizeof(int) * bucket_count);
+  if (!chunk_cache.entries || !chunk_cache.buckets) {
+    return 0;
+  }
+  for (unsigned int b = 0; b < bucket_count; b++) {
+    chunk_cache.buckets[b] = -1;
+  }
+  chunk_cache.capacity = capacity;
+  chunk_cache.bucket_mask = bucket_count - 1;
+  chunk_cache.head = -1;
+  chunk_cache.tail = -1;
+  return 1;
+}
+
+static void lru_unlink(int i) {
+  ChunkEntry *e = &chunk_cache.entries[i];
+  if (e->prev >= 0) {
+    chunk_cache.entries[e->prev].next = e->next;
+  } else {
+    chunk_cache.head = e->next;
+  }
+  if (e->next >= 0) {
+    chunk_cache.entries[e->next].prev = e->prev;
+  } else {
+    chunk_cache.tail = e->prev;
+  }
+}
+
+static void lru_push_front(int i) {
+  ChunkEntry *e = &chunk_cache.entries[i];
+  e->prev = -1;
+  e->next = chunk_cache.head;
+  if (chunk_cache.head >= 0) {
+    chunk_cache.entries[chunk_cache.head].prev = i;
+  }
+  chunk_cache.head = i;
+  if (chunk_cache.tail < 0) {
+    chunk_cache.tail = i;
+  }
+}
+
+static int chunk_cache_find(uint64_t path_hash, int64_t chunk) {
+  int i = chunk_cache.buckets[chunk_bucket(path_hash, chunk)];
+  while (i >= 0 && (chunk_cache.entries[i].path_hash != path_hash ||
+                    chunk_cache.entries[i].chunk != chunk)) {
+    i = chunk_cache.entries[i].bucket_next;
+  }
+  return i;
+}
+
+// Marks the chunk as most recently used; returns 0 if it was not cached.
+static int chunk_cache_touch(uint64_t path_hash, int64_t chunk) {
+  int i = chunk_cache_find(path_hash, chunk);
+  if (i < 0) {
+    return 0;
+  }
+  lru_unlink(i);
+  lru_push_front(i);
+  return 1;
+}
+
+static void chunk_cache_insert(uint64_t path_hash, int64_t chunk) {
+  if (chunk_cache_find(path_hash, chunk) >= 0) {
+    return;
+  }
+  int i;
+  if (chunk_cache.count < chunk_cache.capacity) {
+    i = chunk_cache.count++;
+  } else {
+    // Reuse the least recently used entry
+    i = chunk_cache.tail;
+    ChunkEntry *old = &chunk_cache.entries[i];
+    int *link = &chunk_cache.buckets[chunk_bucket(old->path_hash, old->chunk)];
+    while (*link != i) {
+      link = &chunk_cache.entries[*link].bucket_next;
+    }
+    *link = old->bucket_next;
+    lru_unlink(i);
+  }
+  ChunkEntry *e = &chunk_cache.entries[i];
+  e->path_hash = path_hash;
+  e->chunk = chunk;
+  unsigned int b = chunk_bucket(path_hash, chunk);
+  e->bucket_next = chunk_cache.buckets[b];
+  chunk_cache.buckets[b] = i;
+  lru_push_front(i);
+}
+
+// Returns 1 the first time a path is seen.
+static int known_files_add(uint64_t path_hash) {
+  if ((known_count + 1) * 2 > known_capacity) {
+    size_t capacity = known_capacity ? known_capacity * 2 : 64;
+    uint64_t *slots = (uint64_t *)calloc(capacity, sizeof(uint64_t));
+    if (!slots) {
+      // Treat every file as new rather than failing the I/O
+      return 1;
+    }
+    for (size_t i = 0; i < known_capacity; i++) {
+      if (known_files[i]) {
+        size_t j = known_files[i] & (capacity - 1);
+        while (slots[j]) {
+          j = (j + 1) & (capacity - 1);
+        }
+        slots[j] = known_files[i];
+      }
+    }
+    free(known_files);
+    known_files = slots;
+    known_capacity = capacity;
+  }
+  size_t j = path_hash & (known_capacity - 1);
+  while (known_files[j]) {
+    if (known_files[j] == path_hash) {
+      return 0;
+    }
+    j = (j + 1) & (known_capacity - 1);
+  }
+  known_files[j] = path_hash;
+  known_count++;
+  return 1;
+}
+
+// Sleeps for `count` back-to-back round trips carrying `bytes` of payload in
+// total.
+static void charge_requests(int count, size_t bytes) {
+  if (count == 0) {
+    return;
+  }
+  double seconds = count * config.latency_ms / 1000.0;
+  if (config.bandwidth_mbps > 0.0) {
+    seconds += (double)bytes / (config.bandwidth_mbps * 1024.0 * 1024.0);
+  }
+
+  pthread_mutex_lock(&sim_mutex);
+  total_stats.requests += count;
+  total_stats.bytes_fetched += (long long)bytes;
+  total_stats.wait_seconds += seconds;
+  pthread_mutex_unlock(&sim_mutex);
+
+  struct timespec ts;
+  ts.tv_sec = (time_t)seconds;
+  ts.tv_nsec = (long)((seconds - (double)ts.tv_sec) * 1e9);
+  while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+  }
+}
+
+static void charge_metadata_request(uint64_t path_hash) {
+  pthread_mutex_lock(&sim_mutex);
+  int first = known_files_add(path_hash);
+  pthread_mutex_unlock(&sim_mutex);
+  charge_requests(first, 0);
+}
+
+// Charges the requests needed to make [offset, offset + length) resident,
+// fetching whole chunks and merging runs of missing chunks into one request
+// like /vsicurl does.
+static void fetch_chunks(SimHandle *handle, vsi_l_offset offset,
+                         size_t length) {
+  const size_t chunk_size = config.chunk_size;
+  int64_t last_in_file = (int64_t)((handle->size - 1) / chunk_size);
+  int64_t first = (int64_t)(offset / chunk_size);
+  int64_t last = (int64_t)((offset + length - 1) / chunk_size);
+  int64_t min_chunks =
+      (int64_t)((config.min_request + chunk_size - 1) / chunk_size);
+  if (last > last_in_file) {
+    last = last_in_file;
+  }
+
+  // Charged once the lock is released
+  int request_count = 0;
+  size_t request_bytes = 0;
+
+  pthread_mutex_lock(&sim_mutex);
+  for (int64_t c = first; c <= last;) {
+    if (chunk_cache_touch(handle->path_hash, c)) {
+      c++;
+      continue;
+    }
+    int64_t run_start = c;
+    while (c <= last && chunk_cache_find(handle->path_hash, c) < 0) {
+      c++;
+    }
+    int64_t run_end = c - 1;
+    if (run_end - run_start + 1 < min_chunks) {
+      run_end = run_start + min_chunks - 1;
+      if (run_end > last_in_file) {
+        run_end = last_in_file;
+      }
+    }
+    for (int64_t k = run_start; k <= run_end; k++) {
+      chunk_cache_insert(handle->path_hash, k);
+    }
+    vsi_l_offset start = (vsi_l_offset)run_start * chunk_size;
+    vsi_l_offset end = (vsi_l_offset)(run_end + 1) * chunk_size;
+    if (end > handle->size) {
+      end = handle->size;
+    }
+    request_count++;
+    request_bytes += (size_t)(end - start);
+    if (run_end + 1 > c) {
+      c = run_end + 1;
+    }
+  }
+  pthread_mutex_unlock(&sim_mutex);
+
+  charge_requests(request_count, request_bytes);
+}
+
+// Without chunk emulation, a request fetches at least min_request bytes and
+// later reads inside that range are free.
+static void fetch_range(SimHandle *handle, vsi_l_offset offset,
+                        size_t length) {
+  if (offset >= handle->window_start &&
+      offset + length <= handle->window_end) {
+    return;
+  }
+  size_t fetch = length > config.min_request ? length : config.min_request;
+  if (offset + fetch > handle->size) {
+    fetch = (size_t)(handle->size - offset);
+  }
+  charge_requests(1, fetch);
+  handle->window_start = offset;
+  handle->window_end = offset + fetch;
+}
+
+static int sim_stat(void *user_data, const char *filename,
+                    VSIStatBufL *stat_buf, int flags) {
+  (void)user_data;
+  const char *path = real_path(filename);
+  charge_metadata_request(hash_path(path));
+  return VSIStatExL(path, stat_buf, flags);
+}
+
+static char **sim_read_dir(void *user_data, const char *dirname,
+                           int max_files) {
+  (void)user_data;
+  // A LIST request every time
+  charge_requests(1, 0);
+  return VSIReadDirEx(real_path(dirname), max_files);
+}
+
+static void *sim_open(void *user_data, const char *filename,
+                      const char *access) {
+  (void)user_data;
+  if (strchr(access, 'w') || strchr(access, 'a') || strchr(access, '+')) {
+    return NULL;
+  }
+  const char *path = real_path(filename);
+  VSIStatBufL st;
+  if (VSIStatL(path, &st) != 0) {
+    return NULL;
+  }
+  VSILFILE *fp = VSIFOpenL(path, access);
+  if (!fp) {
+    return NULL;
+  }
+  SimHandle *handle = (SimHandle *)calloc(1, sizeof(SimHandle));
+  if (!handle) {
+    VSIFCloseL(fp);
+    return NULL;
+  }
+  handle->fp = fp;
+  handle->path_hash = hash_path(path);
+  handle->size = (vsi_l_offset)st.st_size;
+  charge_metadata_request(handle->path_hash);
+  return handle;
+}
+
+static vsi_l_offset sim_tell(void *file) {
+  return ((SimHandle *)file)->offset;
+}
+
+static int sim_seek(void *file, vsi_l_offset offset, int whence) {
+  SimHandle *handle = (SimHandle *)file;
+  if (whence == SEEK_SET) {
+    handle->offset = offset;
+  } else if (whence == SEEK_CUR) {
+    handle->offset += offset;
+  } else {
+    handle->offset = handle->size + offset;
+  }
+  return 0;
+}
+
+static size_t sim_read(void *file, void *buffer, size_t size, size_t count) {
+  SimHandle *handle = (SimHandle *)file;
+  size_t length = size * count;
+  if (length == 0 || handle->offset >= handle->size) {
+    return 0;
+  }
+  if (handle->offset + length > handle->size) {
+    length = (size_t)(handle->size - handle->offset);
+  }
+  if (config.chunk_size > 0) {
+    fetch_chunks(handle, handle->offset, length);
+  } else {
+    fetch_range(handle, handle->offset, length);
+  }
+  if (VSIFSeekL(handle->fp, handle->offset, SEEK_SET) != 0) {
+    return 0;
+  }
+  size_t n = VSIFReadL(buffer, size, count, handle->fp);
+  handle->offset += n * size;
+  return n;
+}
+
+static int sim_eof(void *file) {
+  SimHandle *handle = (SimHandle *)file;
+  return handle->offset >= handle->size;
+}
+
+static int sim_close(void *file) {
+  SimHandle *handle = (SimHandle *)file;
+  int ret = VSIFCloseL(handle->fp);
+  free(handle);
+  return ret;
+}
+
+// Reads configuration option `key` as a finite, non-negative number; with
+// `whole`, also an integer that fits in size_t. Returns 0, with an error,
+// for anything else.
+static int read_option(const char *key, const char *default_value, int whole,
+                       double *value) {
+  const char *text = CPLGetConfigOption(key, default_value);
+  char *end = NULL;
+  errno = 0;
+  double v = strtod(text, &end);
+  if (end == text || *end != '\0' || errno == ERANGE || !isfinite(v) ||
+      v < 0.0 || (whole && (v != floor(v) || v >= (double)SIZE_MAX))) {
+    fprintf(stderr, "Error: %s must be a non-negative %s, got '%s'\n", key,
+            whole ? "integer" : "number", text);
+    return 0;
+  }
+  *value = v;
+  return 1;
+}
+
+int vsi_sim_install(void) {
+  double min_request, chunk_size, cache_size;
+  if (!read_option("VSISIM_LATENCY_MS", "20", 0, &config.latency_ms) ||
+      !read_option("VSISIM_BANDWIDTH_MBPS", "100", 0,
+                   &config.bandwidth_mbps) ||
+      !read_option("VSISIM_MIN_REQUEST", "0", 1, &min_request) ||
+      !read_option("VSISIM_CHUNK_SIZE", "16384", 1, &chunk_size) ||
+      !read_option("VSISIM_CACHE_SIZE", "16777216", 1, &cache_size)) {
+    return 0;
+  }
+  config.min_request = (size_t)min_request;
+  config.chunk_size = (size_t)chunk_size;
+  config.cache_size = (size_t)cache_size;
+
+  if (config.chunk_size > 0) {
+    size_t capacity = config.cache_size / config.chunk_size;
+    if (!chunk_cache_init(capacity > 0 ? (int)capacity : 1)) {
+      return 0;
+    }
+  }
+
+  VSIFilesystemPluginCallbacksStruct *cb =
+      VSIAllocFilesystemPluginCallbacksStruct();
+  if (!cb) {
+    return 0;
+  }
+  cb->stat = sim_stat;
+  cb->read_dir = sim_read_dir;
+  cb->open = sim_open;
+  cb->tell = sim_tell;
+  cb->seek = sim_seek;
+  cb->read = sim_read;
+  cb->eof = sim_eof;
+  cb->close = sim_close;
+  int ret = VSIInstallPluginHandler(VSI_SIM_PREFIX, cb);
+  VSIFreeFilesystemPluginCallbacksStruct(cb);
+  return ret == 0;
+}
+
+const VsiSimConfig *vsi_sim_config(void) { return &config; }
+
+void vsi_sim_total_stats(VsiSimStats *stats) {
+  pthread_mutex_lock(&sim_mutex);
+  *stats = total_stats;
+  pthread_mutex_unlock(&sim_mutex);
+}
+
+void vsi_sim_stats_sub(VsiSimStats *diff, const VsiSimStats *after,
+                       const VsiSimStats *before) {
+  diff->requests = after->requests - before->requests;
+  diff->bytes_fetched = after->bytes_fetched - before->bytes_fetched;
+  diff->wait_seconds = after->wait_seconds - before->wait_seconds;
+}
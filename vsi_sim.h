@@ -0,0 +1,49 @@
+#ifndef VSI_SIM_H
+#define VSI_SIM_H
+
+#include <stddef.h>
+
+// Prefix of the remote-storage simulator: /vsisim/<path> serves the local
+// file <path> but charges every request to "remote storage" a latency and a
+// transfer time, so /vsis3-like access can be measured without a network.
+#define VSI_SIM_PREFIX "/vsisim/"
+
+// Read from GDAL configuration options (or environment variables) by
+// vsi_sim_install; defaults in parentheses.
+typedef struct {
+  // VSISIM_LATENCY_MS (20): added to every request
+  double latency_ms;
+  // VSISIM_BANDWIDTH_MBPS (100): MiB/s per request; 0 for unlimited
+  double bandwidth_mbps;
+  // VSISIM_MIN_REQUEST (0): smallest number of bytes one request fetches
+  size_t min_request;
+  // VSISIM_CHUNK_SIZE (16384): when non-zero, emulate /vsicurl by fetching
+  // whole chunks and keeping them in a cache shared by all handles and
+  // threads. Falls back to the file's last fetched range when 0.
+  size_t chunk_size;
+  // VSISIM_CACHE_SIZE (16 MiB): budget of the chunk cache
+  size_t cache_size;
+} VsiSimConfig;
+
+typedef struct {
+  // Simulated round trips: ranged GETs, plus HEAD/LIST for stat and
+  // directory listings
+  long long requests;
+  long long bytes_fetched;
+  // Total time spent sleeping for latency and bandwidth
+  double wait_seconds;
+} VsiSimStats;
+
+// Reads the configuration and registers VSI_SIM_PREFIX with GDAL's VSI
+// plugin API. Returns 0 on failure, including a negative or malformed
+// VSISIM_* value, which is reported.
+int vsi_sim_install(void);
+const VsiSimConfig *vsi_sim_config(void);
+
+// Requests issued by all threads since the filesystem was installed.
+void vsi_sim_total_stats(VsiSimStats *stats);
+// diff = after - before
+void vsi_sim_stats_sub(VsiSimStats *diff, const VsiSimStats *after,
+                       const VsiSimStats *before);
+
+#endif
@@ -0,0 +1,173 @@
+#include "window_stats.h"
+
+#include <math.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define WINDOW_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+// Folds the partial result b into a.
+static inline void merge_stats(WindowStats *a, const WindowStats *b) {
+  a->sum += b->sum;
+  a->min = b->min < a->min ? b->min : a->min;
+  a->max = b->max > a->max ? b->max : a->max;
+  a->count += b->count;
+}
+
+void window_stats_scalar(const float *values, int count, int has_nodata,
+                         float nodata, WindowStats *stats) {
+  double sum = 0.0;
+  float min = INFINITY;
+  float max = -INFINITY;
+  long long valid = 0;
+  for (int i = 0; i < count; i++) {
+    float v = values[i];
+    if (v != v || (has_nodata && v == nodata)) {
+      continue;
+    }
+    sum += v;
+    min = v < min ? v : min;
+    max = v > max ? v : max;
+    valid++;
+  }
+  stats->sum = sum;
+  stats->min = min;
+  stats->max = max;
+  stats->count = valid;
+}
+
+#ifdef WINDOW_KERNEL_X86
+
+// Without nodata the comparison runs against NaN, which matches nothing, so
+// the loops need no branch.
+static inline float nodata_or_nan(int has_nodata, float nodata) {
+  return has_nodata ? nodata : NAN;
+}
+
+static void window_stats_sse2(const float *values, int count, int has_nodata,
+                              float nodata, WindowStats *stats) {
+  const __m128 nodata_v = _mm_set1_ps(nodata_or_nan(has_nodata, nodata));
+  const __m128 pos_inf = _mm_set1_ps(INFINITY);
+  const __m128 neg_inf = _mm_set1_ps(-INFINITY);
+  __m128d sum_lo = _mm_setzero_pd(), sum_hi = _mm_setzero_pd();
+  __m128 vmin = pos_inf, vmax = neg_inf;
+  __m128i vcount = _mm_setzero_si128();
+
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 v = _mm_loadu_ps(values + i);
+    __m128 valid =
+        _mm_andnot_ps(_mm_cmpeq_ps(v, nodata_v), _mm_cmpord_ps(v, v));
+    __m128 masked = _mm_and_ps(valid, v);
+    sum_lo = _mm_add_pd(sum_lo, _mm_cvtps_pd(masked));
+    sum_hi = _mm_add_pd(sum_hi, _mm_cvtps_pd(_mm_movehl_ps(masked, masked)));
+    vmin = _mm_min_ps(vmin, _mm_or_ps(masked, _mm_andnot_ps(valid, pos_inf)));
+    vmax = _mm_max_ps(vmax, _mm_or_ps(masked, _mm_andnot_ps(valid, neg_inf)));
+    // Valid lanes are all ones, i.e. -1
+    vcount = _mm_sub_epi32(vcount, _mm_castps_si128(valid));
+  }
+
+  double sums[2];
+  float mins[4], maxs[4];
+  int counts[4];
+  _mm_storeu_pd(sums, _mm_add_pd(sum_lo, sum_hi));
+  _mm_storeu_ps(mins, vmin);
+  _mm_storeu_ps(maxs, vmax);
+  _mm_storeu_si128((__m128i *)counts, vcount);
+  stats->sum = sums[0] + sums[1];
+  stats->min = INFINITY;
+  stats->max = -INFINITY;
+  stats->count = 0;
+  for (int lane = 0; lane < 4; lane++) {
+    stats->min = mins[lane] < stats->min ? mins[lane] : stats->min;
+    stats->max = maxs[lane] > stats->max ? maxs[lane] : stats->max;
+    stats->count += counts[lane];
+  }
+
+  WindowStats tail;
+  window_stats_scalar(values + i, count - i, has_nodata, nodata, &tail);
+  merge_stats(stats, &tail);
+}
+
+__attribute__((target("avx2"))) static void
+window_stats_avx2(const float *values, int count, int has_nodata, float nodata,
+                  WindowStats *stats) {
+  const __m256 nodata_v = _mm256_set1_ps(nodata_or_nan(has_nodata, nodata));
+  const __m256 pos_inf = _mm256_set1_ps(INFINITY);
+  const __m256 neg_inf = _mm256_set1_ps(-INFINITY);
+  __m256d sum_lo = _mm256_setzero_pd(), sum_hi = _mm256_setzero_pd();
+  __m256 vmin = pos_inf, vmax = neg_inf;
+  __m256i vcount = _mm256_setzero_si256();
+
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 v = _mm256_loadu_ps(values + i);
+    __m256 valid = _mm256_andnot_ps(_mm256_cmp_ps(v, nodata_v, _CMP_EQ_OQ),
+                                    _mm256_cmp_ps(v, v, _CMP_ORD_Q));
+    __m256 masked = _mm256_and_ps(valid, v);
+    sum_lo = _mm256_add_pd(sum_lo,
+                           _mm256_cvtps_pd(_mm256_castps256_ps128(masked)));
+    sum_hi = _mm256_add_pd(sum_hi,
+                           _mm256_cvtps_pd(_mm256_extractf128_ps(masked, 1)));
+    vmin = _mm256_min_ps(vmin, _mm256_blendv_ps(pos_inf, v, valid));
+    vmax = _mm256_max_ps(vmax, _mm256_blendv_ps(neg_inf, v, valid));
+    vcount = _mm256_sub_epi32(vcount, _mm256_castps_si256(valid));
+  }
+
+  double sums[4];
+  float mins[8], maxs[8];
+  int counts[8];
+  _mm256_storeu_pd(sums, _mm256_add_pd(sum_lo, sum_hi));
+  _mm256_storeu_ps(mins, vmin);
+  _mm256_storeu_ps(maxs, vmax);
+  _mm256_storeu_si256((__m256i *)counts, vcount);
+  stats->sum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+  stats->min = INFINITY;
+  stats->max = -INFINITY;
+  stats->count = 0;
+  for (int lane = 0; lane < 8; lane++) {
+    stats->min = mins[lane] < stats->min ? mins[lane] : stats->min;
+    stats->max = maxs[lane] > stats->max ? maxs[lane] : stats->max;
+    stats->count += counts[lane];
+  }
+
+  // Leave the upper halves clean before running SSE code
+  _mm256_zeroupper();
+  WindowStats tail;
+  window_stats_scalar(values + i, count - i, has_nodata, nodata, &tail);
+  merge_stats(stats, &tail);
+}
+
+WindowStatsFunc window_stats_kernel_sse2(void) { return window_stats_sse2; }
+
+WindowStatsFunc window_stats_kernel_avx2(void) {
+  return __builtin_cpu_supports("avx2") ? window_stats_avx2 : NULL;
+}
+
+#else
+
+WindowStatsFunc window_stats_kernel_sse2(void) { return NULL; }
+
+WindowStatsFunc window_stats_kernel_avx2(void) { return NULL; }
+
+#endif
+
+void window_stats_compute(const float *values, int count, int has_nodata,
+                          float nodata, WindowStats *stats) {
+  // Resolved per call, like geo_context_to_pixels: the CPU feature check is
+  // negligible next to a window read. Below one AVX2 vector the horizontal
+  // reduction costs more than the lanes save.
+  if (count < 8) {
+    window_stats_scalar(values, count, has_nodata, nodata, stats);
+    return;
+  }
+  WindowStatsFunc kernel = window_stats_kernel_avx2();
+  if (!kernel) {
+    kernel = window_stats_kernel_sse2();
+  }
+  if (!kernel) {
+    kernel = window_stats_scalar;
+  }
+  kernel(values, count, has_nodata, nodata, stats);
+}
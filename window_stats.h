@@ -0,0 +1,32 @@
+#ifndef WINDOW_STATS_H
+#define WINDOW_STATS_H
+
+// Reductions over a window of float pixels that skip the band's nodata
+// value and NaNs.
+
+typedef struct {
+  // Accumulated in double, so the kernels agree up to summation order
+  double sum;
+  float min;
+  float max;
+  // Valid pixels; min and max are +/-inf when there are none
+  long long count;
+} WindowStats;
+
+typedef void (*WindowStatsFunc)(const float *values, int count,
+                                int has_nodata, float nodata,
+                                WindowStats *stats);
+
+// Reduces `count` values into stats, overwriting it. Dispatches to the
+// widest kernel the CPU supports.
+void window_stats_compute(const float *values, int count, int has_nodata,
+                          float nodata, WindowStats *stats);
+
+// Individual kernels, exposed for benchmarking. The SIMD kernels are NULL
+// when not compiled in or not supported by the CPU.
+void window_stats_scalar(const float *values, int count, int has_nodata,
+                         float nodata, WindowStats *stats);
+WindowStatsFunc window_stats_kernel_sse2(void);
+WindowStatsFunc window_stats_kernel_avx2(void);
+
+#endif
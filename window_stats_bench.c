@@ -0,0 +1,119 @@
+#include "latency_histogram.h"
+#include "window_stats.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Compares the scalar window reduction against the SIMD kernels on `pixels`
+// random float pixels, reduced in windows of `window` pixels as a zonal
+// query would. About 10% of the pixels are the nodata value and 1% NaN.
+
+#define BENCH_ROUNDS 5
+#define BENCH_NODATA -9999.0f
+
+static int check_same(const char *name, const WindowStats *ref,
+                      const WindowStats *got, int windows) {
+  for (int w = 0; w < windows; w++) {
+    const WindowStats *a = &ref[w];
+    const WindowStats *b = &got[w];
+    // The kernels add in a different order, so the sums may differ in the
+    // last bits
+    double tolerance = 1e-9 * (fabs(a->sum) + 1.0);
+    if (a->count != b->count || a->min != b->min || a->max != b->max ||
+        fabs(a->sum - b->sum) > tolerance) {
+      fprintf(stderr,
+              "Error: %s differs from the scalar kernel in window %d: "
+              "(%lld, %g, %g, %.17g) != (%lld, %g, %g, %.17g)\n",
+              name, w, b->count, (double)b->min, (double)b->max, b->sum,
+              a->count, (double)a->min, (double)a->max, a->sum);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static void print_result(const char *name, double seconds, long long pixels,
+                         double baseline_seconds) {
+  printf("%-18s %10.3f ms %10.3f ns/pixel %10.1f Mpixels/s %8.1fx\n", name,
+         seconds * 1000.0, seconds * 1e9 / pixels, pixels / seconds / 1e6,
+         baseline_seconds / seconds);
+}
+
+int main(int argc, char *argv[]) {
+  int pixels = argc > 1 ? atoi(argv[1]) : 10000000;
+  int window = argc > 2 ? atoi(argv[2]) : 256;
+  if (pixels <= 0 || window <= 0) {
+    fprintf(stderr, "Usage: %s [pixels] [window_pixels]\n", argv[0]);
+    return 1;
+  }
+  int windows = (pixels + window - 1) / window;
+
+  float *values = (float *)malloc(sizeof(float) * (size_t)pixels);
+  WindowStats *ref = (WindowStats *)malloc(sizeof(WindowStats) * windows);
+  WindowStats *got = (WindowStats *)malloc(sizeof(WindowStats) * windows);
+  if (!values || !ref || !got) {
+    fprintf(stderr, "Error: Out of memory\n");
+    return 1;
+  }
+
+  unsigned int rng = 42;
+  for (int i = 0; i < pixels; i++) {
+    int r = rand_r(&rng) % 100;
+    if (r < 10) {
+      values[i] = BENCH_NODATA;
+    } else if (r < 11) {
+      values[i] = NAN;
+    } else {
+      values[i] = -1000.0f + ((float)rand_r(&rng) / RAND_MAX) * 5000.0f;
+    }
+  }
+
+  printf("Reducing %d pixels in windows of %d (best of %d rounds)\n", pixels,
+         window, BENCH_ROUNDS);
+
+  struct {
+    const char *name;
+    WindowStatsFunc func;
+  } kernels[] = {
+      {"kernel_scalar", window_stats_scalar},
+      {"kernel_sse2", window_stats_kernel_sse2()},
+      {"kernel_avx2", window_stats_kernel_avx2()},
+      {"kernel_dispatch", window_stats_compute},
+  };
+
+  int ok = 1;
+  double baseline = 0.0;
+  for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+    if (!kernels[k].func) {
+      printf("%-18s (not supported on this CPU)\n", kernels[k].name);
+      continue;
+    }
+    WindowStats *out = k == 0 ? ref : got;
+    double best = 0.0;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+      memset(out, 0, sizeof(WindowStats) * windows);
+      uint64_t t0 = monotonic_ns();
+      for (int w = 0; w < windows; w++) {
+        int first = w * window;
+        int count = pixels - first < window ? pixels - first : window;
+        kernels[k].func(values + first, count, 1, BENCH_NODATA, &out[w]);
+      }
+      double seconds = (double)(monotonic_ns() - t0) / 1e9;
+      if (round == 0 || seconds < best) {
+        best = seconds;
+      }
+    }
+    if (k == 0) {
+      baseline = best;
+    } else {
+      ok &= check_same(kernels[k].name, ref, got, windows);
+    }
+    print_result(kernels[k].name, best, pixels, baseline);
+  }
+
+  free(values);
+  free(ref);
+  free(got);
+  return ok ? 0 : 1;
+}